@@ -0,0 +1,66 @@
+# - Try to find liblzo2
+# Once done this will define
+#
+#  LZO_FOUND - system has liblzo2
+#  LZO_INCLUDE_DIRS - the liblzo2 include directory
+#  LZO_LIBRARIES - Link these to use liblzo2
+#
+#  Copyright (c) 2026 SUSE LINUX GmbH
+#
+#  Redistribution and use is allowed according to the terms of the New
+#  BSD license.
+#  For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+#
+
+
+if (LZO_LIBRARIES AND LZO_INCLUDE_DIRS)
+  # in cache already
+  set(LZO_FOUND TRUE)
+else (LZO_LIBRARIES AND LZO_INCLUDE_DIRS)
+  find_path(LZO_INCLUDE_DIR
+    NAMES
+      lzo/lzo1x.h
+    PATHS
+      /usr/include
+      /usr/local/include
+      /opt/local/include
+      /sw/include
+  )
+
+  find_library(LZO_LIBRARY
+    NAMES
+      lzo2
+    PATHS
+      /usr/lib
+      /usr/local/lib
+      /opt/local/lib
+      /sw/lib
+  )
+  mark_as_advanced(LZO_LIBRARY)
+
+  if (LZO_INCLUDE_DIR AND LZO_LIBRARY)
+    set(LZO_INCLUDE_DIRS
+      ${LZO_INCLUDE_DIR}
+    )
+    set(LZO_LIBRARIES
+      ${LZO_LIBRARIES}
+      ${LZO_LIBRARY}
+    )
+    set(LZO_FOUND TRUE)
+  endif (LZO_INCLUDE_DIR AND LZO_LIBRARY)
+
+  if (LZO_FOUND)
+    if (NOT lzo_FIND_QUIETLY)
+      message(STATUS "Found lzo: ${LZO_LIBRARIES}")
+    endif (NOT lzo_FIND_QUIETLY)
+  else (LZO_FOUND)
+    if (lzo_FIND_REQUIRED)
+      message(FATAL_ERROR "Could not find lzo")
+    endif (lzo_FIND_REQUIRED)
+  endif (LZO_FOUND)
+
+  # show the LZO_INCLUDE_DIRS and LZO_LIBRARIES variables only in the advanced view
+  mark_as_advanced(LZO_INCLUDE_DIR LZO_INCLUDE_DIRS LZO_LIBRARIES)
+
+endif (LZO_LIBRARIES AND LZO_INCLUDE_DIRS)
+
@@ -0,0 +1,66 @@
+# - Try to find libsnappy
+# Once done this will define
+#
+#  SNAPPY_FOUND - system has libsnappy
+#  SNAPPY_INCLUDE_DIRS - the libsnappy include directory
+#  SNAPPY_LIBRARIES - Link these to use libsnappy
+#
+#  Copyright (c) 2026 SUSE LINUX GmbH
+#
+#  Redistribution and use is allowed according to the terms of the New
+#  BSD license.
+#  For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+#
+
+
+if (SNAPPY_LIBRARIES AND SNAPPY_INCLUDE_DIRS)
+  # in cache already
+  set(SNAPPY_FOUND TRUE)
+else (SNAPPY_LIBRARIES AND SNAPPY_INCLUDE_DIRS)
+  find_path(SNAPPY_INCLUDE_DIR
+    NAMES
+      snappy-c.h
+    PATHS
+      /usr/include
+      /usr/local/include
+      /opt/local/include
+      /sw/include
+  )
+
+  find_library(SNAPPY_LIBRARY
+    NAMES
+      snappy
+    PATHS
+      /usr/lib
+      /usr/local/lib
+      /opt/local/lib
+      /sw/lib
+  )
+  mark_as_advanced(SNAPPY_LIBRARY)
+
+  if (SNAPPY_INCLUDE_DIR AND SNAPPY_LIBRARY)
+    set(SNAPPY_INCLUDE_DIRS
+      ${SNAPPY_INCLUDE_DIR}
+    )
+    set(SNAPPY_LIBRARIES
+      ${SNAPPY_LIBRARIES}
+      ${SNAPPY_LIBRARY}
+    )
+    set(SNAPPY_FOUND TRUE)
+  endif (SNAPPY_INCLUDE_DIR AND SNAPPY_LIBRARY)
+
+  if (SNAPPY_FOUND)
+    if (NOT snappy_FIND_QUIETLY)
+      message(STATUS "Found snappy: ${SNAPPY_LIBRARIES}")
+    endif (NOT snappy_FIND_QUIETLY)
+  else (SNAPPY_FOUND)
+    if (snappy_FIND_REQUIRED)
+      message(FATAL_ERROR "Could not find snappy")
+    endif (snappy_FIND_REQUIRED)
+  endif (SNAPPY_FOUND)
+
+  # show the SNAPPY_INCLUDE_DIRS and SNAPPY_LIBRARIES variables only in the advanced view
+  mark_as_advanced(SNAPPY_INCLUDE_DIR SNAPPY_INCLUDE_DIRS SNAPPY_LIBRARIES)
+
+endif (SNAPPY_LIBRARIES AND SNAPPY_INCLUDE_DIRS)
+
@@ -21,11 +21,15 @@ kdump_needed() {
 kdump_check_net() {
     kdump_neednet=
     for protocol in "${kdump_Protocol[@]}" ; do
-	if [ "$protocol" != "file" -a "$protocol" != "srcfile" ]; then
+	if [ "$protocol" != "file" -a "$protocol" != "srcfile" -a \
+	     "$protocol" != "spool" ]; then
 	    kdump_neednet=y
 	fi
     done
 
+    # with a spool, the targets are not used in the kdump environment
+    [ -n "$KDUMP_SPOOL" ] && kdump_neednet=
+
     # network configuration
     if [ -n "$KDUMP_SMTP_SERVER" -a -n "$KDUMP_NOTIFICATION_TO" ]; then
 	kdump_neednet=y
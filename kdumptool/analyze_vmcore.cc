@@ -0,0 +1,160 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <unistd.h>
+
+#include "subcommand.h"
+#include "debug.h"
+#include "analyze_vmcore.h"
+#include "configuration.h"
+#include "vmcoreimage.h"
+#include "vmcoreinfo.h"
+#include "vmcoreanalyzer.h"
+#include "calibrate.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::ostringstream;
+using std::setw;
+
+//{{{ AnalyzeVmcore ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+AnalyzeVmcore::AnalyzeVmcore()
+    throw ()
+    : m_dump(DEFAULT_DUMP), m_samples(4096), m_jobs(0), m_dumplevel(-1),
+      m_bandwidth(0)
+{
+    m_options.push_back(new StringOption("dump", 'u', &m_dump,
+        "Use the specified dump instead of " DEFAULT_DUMP));
+    m_options.push_back(new IntOption("samples", 's', &m_samples,
+        "Number of sampled pages (default: 4096)"));
+    m_options.push_back(new IntOption("jobs", 'j', &m_jobs,
+        "Number of threads (default: KDUMP_CPUS or online CPUs)"));
+    m_options.push_back(new IntOption("dumplevel", 'd', &m_dumplevel,
+        "Dump level (default: KDUMP_DUMPLEVEL)"));
+    m_options.push_back(new IntOption("bandwidth", 'w', &m_bandwidth,
+        "Target bandwidth in MiB/s (default: unknown)"));
+}
+
+// -----------------------------------------------------------------------------
+const char *AnalyzeVmcore::getName() const
+    throw ()
+{
+    return "analyze_vmcore";
+}
+
+// -----------------------------------------------------------------------------
+void AnalyzeVmcore::execute()
+    throw (KError)
+{
+    Debug::debug()->trace("AnalyzeVmcore::execute()");
+
+    Configuration *config = Configuration::config();
+
+    int dumplevel = m_dumplevel;
+    if (dumplevel < 0)
+        dumplevel = config->KDUMP_DUMPLEVEL.value();
+
+    // same CPU count that save_dump would use
+    unsigned long cpus = m_jobs;
+    if (!cpus) {
+        cpus = config->KDUMP_CPUS.value();
+        unsigned long online = SystemCPU().numOnline();
+        if (cpus > online)
+            cpus = online;
+    }
+    if (!cpus)
+        cpus = 1;
+
+    VmcoreImage image(m_dump);
+
+    unsigned long pageSize = sysconf(_SC_PAGESIZE);
+    try {
+        Vmcoreinfo vm;
+        vm.readFromImage(image);
+        if (vm.hasValue(Vmcoreinfo::ID_PAGESIZE))
+            pageSize = vm.getValue(Vmcoreinfo::ID_PAGESIZE);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+
+    VmcoreAnalyzer analyzer(image, pageSize);
+    analyzer.setSamples(m_samples > 0 ? m_samples : 1);
+    analyzer.setThreads(cpus);
+    analyzer.analyze();
+
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "Dump:         " << m_dump << endl;
+    ss << "Memory:       " << (analyzer.getTotalPages() * pageSize >> 20)
+       << " MiB (" << analyzer.getTotalPages() << " pages of "
+       << pageSize << " bytes)" << endl;
+    ss << "Sample:       " << analyzer.getSampledPages() << " pages" << endl;
+    ss << "Zero pages:   " << analyzer.getZeroRatio() * 100 << " %" << endl;
+    ss << "Dump level:   " << dumplevel << endl;
+    ss << "CPUs:         " << cpus << endl;
+    unsigned long long bandwidth = 0;
+    if (m_bandwidth > 0) {
+        bandwidth = (unsigned long long)m_bandwidth << 20;
+        ss << "Bandwidth:    " << m_bandwidth << " MiB/s" << endl;
+    }
+    ss << endl;
+    ss << "Format       Size (MiB)  MiB/s per CPU   Time (s)" << endl;
+
+    for (int f = 0; f < VmcoreAnalyzer::FORMAT_MAX; ++f) {
+        VmcoreAnalyzer::Format format = VmcoreAnalyzer::Format(f);
+        VmcoreAnalyzer::Estimate est = analyzer.estimate(format, dumplevel);
+
+        ss << std::left << setw(12) << VmcoreAnalyzer::formatName(format)
+           << std::right;
+        if (!est.available) {
+            ss << " not available" << endl;
+            continue;
+        }
+        ss << setw(11) << est.size / 1048576.0 << "   ";
+        if (est.cpuRate > 0)
+            ss << setw(12) << est.cpuRate / 1048576.0;
+        else
+            ss << setw(12) << "-";
+        ss << setw(11)
+           << analyzer.predictSeconds(format, dumplevel, cpus, bandwidth)
+           << endl;
+    }
+
+    // what KDUMP_DUMPFORMAT="auto" would do
+    VmcoreAnalyzer::Plan plan =
+        analyzer.choose(dumplevel, cpus, bandwidth, true);
+    ss << endl;
+    ss << "Recommended:  " << VmcoreAnalyzer::formatName(plan.format);
+    if (plan.split)
+        ss << ", split into " << plan.split << " parts";
+    else if (plan.threads)
+        ss << ", " << plan.threads << " threads";
+    ss << " (" << plan.seconds << " s)" << endl;
+    cout << ss.str();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,66 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef ANALYZE_VMCORE_H
+#define ANALYZE_VMCORE_H
+
+#include "subcommand.h"
+
+//{{{ AnalyzeVmcore ------------------------------------------------------------
+
+/**
+ * Subcommand to predict the size of a saved dump and the time needed
+ * to save it in each dump format (see VmcoreAnalyzer).
+ */
+class AnalyzeVmcore : public Subcommand {
+
+    public:
+        /**
+         * Creates a new AnalyzeVmcore object.
+         */
+        AnalyzeVmcore()
+        throw ();
+
+    public:
+        /**
+         * Returns the name of the subcommand (analyze_vmcore).
+         */
+        const char *getName() const
+        throw ();
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute()
+        throw (KError);
+
+    private:
+        std::string m_dump;
+        int m_samples;
+        int m_jobs;
+        int m_dumplevel;
+        int m_bandwidth;
+};
+
+//}}}
+
+#endif /* ANALYZE_VMCORE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
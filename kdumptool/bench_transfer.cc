@@ -0,0 +1,161 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <strings.h>
+
+#include "subcommand.h"
+#include "debug.h"
+#include "bench_transfer.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "transfer.h"
+#include "dataprovider.h"
+#include "savedump.h"
+#include "phasereport.h"
+#include "stringutil.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::auto_ptr;
+using std::ostringstream;
+
+#define BENCH_FILE  "kdump-bench"
+
+//{{{ BenchTransfer ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+BenchTransfer::BenchTransfer()
+    throw ()
+    : m_pattern("scatter"), m_size(256), m_zeroRatio(0),
+      m_compressibility(0), m_chunkSize(4), m_keep(false)
+{
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+    m_options.push_back(new IntOption("size", 's', &m_size,
+        "Amount of data in MB (default: 256)"));
+    m_options.push_back(new IntOption("zero", 'z', &m_zeroRatio,
+        "Percentage of chunks that contain only zeros"));
+    m_options.push_back(new IntOption("compress", 'c', &m_compressibility,
+        "Percentage of each chunk that compresses well"));
+    m_options.push_back(new IntOption("chunk", 'k', &m_chunkSize,
+        "Chunk size in KiB (default: 4)"));
+    m_options.push_back(new StringOption("pattern", 'p', &m_pattern,
+        "Placement of zero chunks ('scatter', 'runs')"));
+    m_options.push_back(new FlagOption("keep", 'K', &m_keep,
+        "Don't remove the test file from the target"));
+}
+
+// -----------------------------------------------------------------------------
+const char *BenchTransfer::getName() const
+    throw ()
+{
+    return "bench_transfer";
+}
+
+// -----------------------------------------------------------------------------
+void BenchTransfer::parseArgs(const StringVector &args)
+    throw (KError)
+{
+    Debug::debug()->trace(__FUNCTION__);
+
+    m_targets = args;
+
+    if (m_size <= 0)
+        throw KError("The size must be positive.");
+    if (m_chunkSize <= 0)
+        throw KError("The chunk size must be positive.");
+    if (m_zeroRatio < 0 || m_zeroRatio > 100 ||
+        m_compressibility < 0 || m_compressibility > 100)
+        throw KError("Percentages must be between 0 and 100.");
+    if (strcasecmp(m_pattern.c_str(), "scatter") != 0 &&
+        strcasecmp(m_pattern.c_str(), "runs") != 0)
+        throw KError("Invalid pattern: " + m_pattern + ".");
+}
+
+// -----------------------------------------------------------------------------
+void BenchTransfer::execute()
+    throw (KError)
+{
+    Debug::debug()->trace("BenchTransfer::execute()");
+
+    // without arguments, test the configured targets
+    if (m_targets.empty()) {
+        std::istringstream iss(
+            Configuration::config()->KDUMP_SAVEDIR.value());
+        string elem;
+        while (iss >> elem)
+            m_targets.push_back(elem);
+    }
+
+    RootDirURLVector urlv;
+    StringVector::const_iterator it;
+    for (it = m_targets.begin(); it != m_targets.end(); ++it)
+        urlv.push_back(RootDirURL(*it, m_rootdir));
+
+    unsigned long long size = (unsigned long long)m_size << 20;
+    SyntheticDataProvider provider(size);
+    provider.setChunkSize((size_t)m_chunkSize << 10);
+    provider.setZeroRatio(m_zeroRatio);
+    provider.setCompressibility(m_compressibility);
+    if (strcasecmp(m_pattern.c_str(), "runs") == 0)
+        provider.setPattern(SyntheticDataProvider::PATTERN_RUNS);
+
+    auto_ptr<Transfer> transfer(SaveDump::getTransfer(urlv));
+
+    ProcessUsage before, after;
+    before.sample();
+    transfer->perform(&provider, BENCH_FILE, NULL);
+    after.sample();
+
+    if (!m_keep) {
+        try {
+            transfer->remove(BENCH_FILE);
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+        }
+    }
+
+    double secs = after.wall - before.wall;
+    if (secs < 1e-6)
+        secs = 1e-6;
+
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for (it = m_targets.begin(); it != m_targets.end(); ++it)
+        ss << "Target:       " << *it << endl;
+    ss << "Bytes:        " << size << endl;
+    ss << "Time:         " << secs << " s" << endl;
+    ss << "Throughput:   " << size / secs / (1 << 20) << " MB/s" << endl;
+    ss << "CPU user:     " << after.user - before.user << " s" << endl;
+    ss << "CPU system:   " << after.system - before.system << " s" << endl;
+    ss << "Read calls:   " << after.readCalls - before.readCalls << endl;
+    ss << "Write calls:  " << after.writeCalls - before.writeCalls << endl;
+    ss << "Peak RSS:     " << after.maxrss << " KiB" << endl;
+    cout << ss.str();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,78 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef BENCH_TRANSFER_H
+#define BENCH_TRANSFER_H
+
+#include "subcommand.h"
+#include "rootdirurl.h"
+
+//{{{ BenchTransfer ------------------------------------------------------------
+
+/**
+ * Subcommand to measure the throughput of a dump target.
+ *
+ * Generated data is saved to the target with the same Transfer classes
+ * that save_dump uses, and the resource usage of kdumptool is reported.
+ */
+class BenchTransfer : public Subcommand {
+
+    public:
+        /**
+         * Creates a new BenchTransfer object.
+         */
+        BenchTransfer()
+        throw ();
+
+    public:
+        /**
+         * Returns the name of the subcommand (bench_transfer).
+         */
+        const char *getName() const
+        throw ();
+
+        /**
+         * Parses the non-option arguments (the target URLs).
+         */
+        void parseArgs(const StringVector &args)
+        throw (KError);
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute()
+        throw (KError);
+
+    private:
+        std::string m_rootdir;
+        std::string m_pattern;
+        int m_size;
+        int m_zeroRatio;
+        int m_compressibility;
+        int m_chunkSize;
+        bool m_keep;
+        StringVector m_targets;
+};
+
+//}}}
+
+#endif /* BENCH_TRANSFER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
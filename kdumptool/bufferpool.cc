@@ -0,0 +1,214 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "global.h"
+#include "debug.h"
+#include "bufferpool.h"
+#include "configuration.h"
+#include "stringutil.h"
+
+using std::string;
+using std::ifstream;
+using std::istringstream;
+
+#define MEMINFO                 "/proc/meminfo"
+
+// budget if /proc/meminfo cannot be read
+#define DEFAULT_BUDGET          (16*1024*1024)
+
+//{{{ BufferPool ---------------------------------------------------------------
+
+BufferPool *BufferPool::m_instance = NULL;
+
+// -----------------------------------------------------------------------------
+BufferPool *BufferPool::pool()
+    throw ()
+{
+    if (!m_instance)
+        m_instance = new BufferPool();
+    return m_instance;
+}
+
+// -----------------------------------------------------------------------------
+BufferPool::BufferPool()
+    throw ()
+    : m_memAvailable(0), m_budget(DEFAULT_BUDGET), m_used(0),
+      m_hugePageSize(0)
+{
+    unsigned long long memFree = 0;
+
+    ifstream fin(MEMINFO);
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string key;
+        unsigned long long kib;
+        if (!(iss >> key >> kib))
+            continue;
+
+        if (key == "MemAvailable:")
+            m_memAvailable = kib * 1024;
+        else if (key == "MemFree:")
+            memFree = kib * 1024;
+        else if (key == "Hugepagesize:")
+            m_hugePageSize = kib * 1024;
+    }
+
+    // kernels before 3.14 have no MemAvailable
+    if (!m_memAvailable)
+        m_memAvailable = memFree;
+
+    int percent = Configuration::config()->KDUMP_BUFFER_MEMORY.value();
+    if (percent < 1)
+        percent = 1;
+    else if (percent > 100)
+        percent = 100;
+    if (m_memAvailable)
+        m_budget = m_memAvailable / 100 * percent;
+
+    Debug::debug()->dbg("Buffer budget: %llu bytes (%d%% of %llu bytes "
+        "available)", m_budget, percent, m_memAvailable);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long BufferPool::getUsed()
+    throw ()
+{
+    MutexLocker locker(m_lock);
+    return m_used;
+}
+
+// -----------------------------------------------------------------------------
+size_t BufferPool::bufferSize(size_t maximum, size_t minimum, unsigned count)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    unsigned long long left = m_budget > m_used ? m_budget - m_used : 0;
+    if (count == 0)
+        count = 1;
+
+    size_t size = maximum;
+    while (size > minimum && (unsigned long long)size * count > left)
+        size /= 2;
+    if (size < minimum)
+        size = minimum;
+
+    Debug::debug()->dbg("BufferPool: %u x %lu bytes (wanted %lu, "
+        "%llu bytes left)", count, (unsigned long)size,
+        (unsigned long)maximum, left);
+    return size;
+}
+
+// -----------------------------------------------------------------------------
+char *BufferPool::allocate(size_t size)
+    throw (KError)
+{
+    Allocation alloc;
+    alloc.size = size;
+    alloc.mapped = 0;
+    void *p = MAP_FAILED;
+
+    if (m_hugePageSize && size >= m_hugePageSize) {
+        size_t len = (size + m_hugePageSize - 1) / m_hugePageSize *
+            m_hugePageSize;
+#ifdef MAP_HUGETLB
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        // no reserved huge pages: ask for transparent huge pages
+        if (p == MAP_FAILED) {
+            p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (p != MAP_FAILED)
+                madvise(p, len, MADV_HUGEPAGE);
+#endif
+        }
+        if (p != MAP_FAILED)
+            alloc.mapped = len;
+    }
+
+    if (p == MAP_FAILED) {
+        int err = posix_memalign(&p, sysconf(_SC_PAGESIZE), size);
+        if (err != 0)
+            throw KSystemError("Cannot allocate a buffer of " +
+                Stringutil::number2string(size) + " bytes.", err);
+    }
+
+    char *ret = static_cast<char *>(p);
+    MutexLocker locker(m_lock);
+    m_allocations[ret] = alloc;
+    m_used += alloc.mapped ? alloc.mapped : alloc.size;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void BufferPool::release(char *buffer)
+    throw ()
+{
+    if (!buffer)
+        return;
+
+    Allocation alloc;
+    {
+        MutexLocker locker(m_lock);
+        std::map<char *, Allocation>::iterator it =
+            m_allocations.find(buffer);
+        if (it == m_allocations.end())
+            return;
+        alloc = it->second;
+        m_allocations.erase(it);
+        m_used -= alloc.mapped ? alloc.mapped : alloc.size;
+    }
+
+    if (alloc.mapped)
+        munmap(buffer, alloc.mapped);
+    else
+        free(buffer);
+}
+
+//}}}
+//{{{ PoolBuffer ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PoolBuffer::PoolBuffer(size_t maximum, size_t minimum)
+    throw (KError)
+    : m_data(NULL), m_size(BufferPool::pool()->bufferSize(maximum, minimum))
+{
+    m_data = BufferPool::pool()->allocate(m_size);
+}
+
+// -----------------------------------------------------------------------------
+PoolBuffer::~PoolBuffer()
+    throw ()
+{
+    BufferPool::pool()->release(m_data);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
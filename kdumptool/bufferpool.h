@@ -0,0 +1,167 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <map>
+#include <cstddef>
+
+#include "global.h"
+#include "threads.h"
+
+//{{{ BufferPool ---------------------------------------------------------------
+
+/**
+ * Hands out I/O buffers within a memory budget.
+ *
+ * The crash kernel usually runs with a small memory reservation that
+ * kdumptool shares with makedumpfile. On first use, the pool reads
+ * MemAvailable from /proc/meminfo and reserves KDUMP_BUFFER_MEMORY
+ * percent of it for buffers. Callers ask bufferSize() for the largest
+ * size that still fits, and allocate() page-aligned buffers of that
+ * size. Buffers of at least one huge page are backed by huge pages if
+ * possible.
+ *
+ * The budget is a soft limit: a caller always gets its minimum size,
+ * so a transfer never fails because the budget is exhausted.
+ *
+ * All methods are thread-safe.
+ */
+class BufferPool {
+
+    public:
+        /**
+         * Returns the only instance.
+         */
+        static BufferPool *pool()
+        throw ();
+
+        /**
+         * Returns the memory available when the pool was created (in
+         * bytes), or 0 if it is unknown.
+         */
+        unsigned long long getMemAvailable() const
+        throw ()
+        { return m_memAvailable; }
+
+        /**
+         * Returns the budget for all buffers in bytes.
+         */
+        unsigned long long getBudget() const
+        throw ()
+        { return m_budget; }
+
+        /**
+         * Returns the number of bytes currently allocated.
+         */
+        unsigned long long getUsed()
+        throw ();
+
+        /**
+         * Chooses a buffer size for @p count buffers that fit into the
+         * rest of the budget. The size is halved, starting at
+         * @p maximum, until the buffers fit, but it is never smaller
+         * than @p minimum.
+         *
+         * @param[in] maximum the preferred size
+         * @param[in] minimum the smallest useful size (e.g. the block
+         *            size of the target)
+         * @param[in] count number of buffers the caller needs
+         */
+        size_t bufferSize(size_t maximum, size_t minimum, unsigned count = 1)
+        throw ();
+
+        /**
+         * Allocates a page-aligned buffer.
+         *
+         * @param[in] size size of the buffer
+         * @exception KError if there is not enough memory
+         */
+        char *allocate(size_t size)
+        throw (KError);
+
+        /**
+         * Frees a buffer that was returned by allocate().
+         */
+        void release(char *buffer)
+        throw ();
+
+    protected:
+        BufferPool()
+        throw ();
+
+    private:
+        struct Allocation {
+            size_t size;
+            size_t mapped;      /* length of the mapping, 0 if malloc'ed */
+        };
+
+        static BufferPool *m_instance;
+
+        unsigned long long m_memAvailable;
+        unsigned long long m_budget;
+        unsigned long long m_used;
+        size_t m_hugePageSize;
+        Mutex m_lock;
+        std::map<char *, Allocation> m_allocations;
+};
+
+//}}}
+//{{{ PoolBuffer ---------------------------------------------------------------
+
+/**
+ * A buffer from the BufferPool that is released when the object goes
+ * out of scope.
+ */
+class PoolBuffer {
+
+    public:
+        /**
+         * Allocates a buffer of BufferPool::bufferSize(maximum, minimum).
+         *
+         * @exception KError if there is not enough memory
+         */
+        PoolBuffer(size_t maximum, size_t minimum)
+        throw (KError);
+
+        ~PoolBuffer()
+        throw ();
+
+        char *data() const
+        throw ()
+        { return m_data; }
+
+        size_t size() const
+        throw ()
+        { return m_size; }
+
+    private:
+        char *m_data;
+        size_t m_size;
+
+        // non-copyable
+        PoolBuffer(const PoolBuffer &);
+        PoolBuffer &operator=(const PoolBuffer &);
+};
+
+//}}}
+
+#endif /* BUFFERPOOL_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
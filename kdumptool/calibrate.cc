@@ -18,10 +18,13 @@
  */
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
 #include <limits>
+#include <algorithm>
 #include <unistd.h>
 #include <dirent.h>
 
@@ -31,6 +34,7 @@
 #include "configuration.h"
 #include "util.h"
 #include "fileutil.h"
+#include "stringutil.h"
 
 // All calculations are in KiB
 
@@ -245,9 +249,16 @@ static inline unsigned long s390x_align_memmap(unsigned long maxpfn)
      INIT_KB + INIT_NET_KB +				\
      ((INIT_KB + INIT_NET_KB) * INITRD_COMPRESS) / 100)
 
+// Peak memory usage of past kdump runs (see MemoryHistory)
+#define HISTORY_KEEP		32	// samples kept in the history file
+#define HISTORY_SAMPLES		8	// recent samples used by calibrate
+#define HISTORY_MIN_SAMPLES	3	// fewer samples are not trusted
+#define HISTORY_MARGIN		25	// safety margin (percent)
+
 using std::cout;
 using std::endl;
 using std::ifstream;
+using std::string;
 
 //{{{ SystemCPU ----------------------------------------------------------------
 
@@ -927,13 +938,267 @@ unsigned long long MemMap::find(unsigned long size, unsigned long align) const
     return ~0ULL;
 }
 
+//}}}
+//{{{ MemoryMonitor ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+MemoryMonitor::MemoryMonitor(double interval)
+    throw ()
+    : m_interval(interval), m_stop(false)
+{
+    memset(&m_usage, 0, sizeof m_usage);
+    try {
+	m_usage.ram = MemMap().total() >> 10;
+    } catch (const KError &e) {
+	Debug::debug()->dbg("Cannot get RAM size: %s", e.what());
+    }
+    sample();
+}
+
+// -----------------------------------------------------------------------------
+MemoryMonitor::~MemoryMonitor()
+    throw ()
+{
+    try {
+	stop();
+    } catch (const KError &error) {
+	Debug::debug()->dbg("%s", error.what());
+    }
+}
+
+// -----------------------------------------------------------------------------
+void MemoryMonitor::stop()
+    throw (KError)
+{
+    {
+	MutexLocker locker(m_lock);
+	if (m_stop)
+	    return;
+	m_stop = true;
+	m_cond.signal();
+    }
+
+    join();
+
+    MutexLocker locker(m_lock);
+    sample();
+
+    // the high-water mark of the cgroup (v2 or v1)
+    ifstream fin("/proc/self/cgroup");
+    string line;
+    while (std::getline(fin, line)) {
+	FilePath peakfile;
+	if (line.compare(0, 3, "0::") == 0)
+	    peakfile = FilePath("/sys/fs/cgroup" + line.substr(3))
+		.appendPath("memory.peak");
+	else if (line.find(":memory:") != string::npos)
+	    peakfile = FilePath("/sys/fs/cgroup/memory" +
+				line.substr(line.find(":memory:") + 8))
+		.appendPath("memory.max_usage_in_bytes");
+	else
+	    continue;
+
+	ifstream pin(peakfile.c_str());
+	unsigned long long bytes;
+	if (pin >> bytes) {
+	    m_usage.cgroupPeak = bytes >> 10;
+	    break;
+	}
+    }
+}
+
+// -----------------------------------------------------------------------------
+MemoryMonitor::Usage MemoryMonitor::getUsage()
+    throw ()
+{
+    MutexLocker locker(m_lock);
+    return m_usage;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MemoryMonitor::peak(const Usage &usage)
+    throw ()
+{
+    // MemAvailable counts reclaimable page cache as available, unlike
+    // memory.peak, so it tells how much memory was really needed
+    if (!usage.ram || usage.minAvailable >= usage.ram)
+	return 0;
+    return usage.ram - usage.minAvailable;
+}
+
+// -----------------------------------------------------------------------------
+void MemoryMonitor::run()
+    throw (KError)
+{
+    MutexLocker locker(m_lock);
+
+    while (!m_stop) {
+	if (m_cond.timedWait(m_lock, m_interval) || m_stop)
+	    continue;
+	sample();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void MemoryMonitor::sample()
+    throw ()
+{
+    unsigned long long memTotal = 0, available = 0, memFree = 0;
+
+    ifstream fin("/proc/meminfo");
+    string line;
+    while (std::getline(fin, line)) {
+	std::istringstream iss(line);
+	string key;
+	unsigned long long kib;
+	if (!(iss >> key >> kib))
+	    continue;
+
+	if (key == "MemTotal:")
+	    memTotal = kib;
+	else if (key == "MemAvailable:")
+	    available = kib;
+	else if (key == "MemFree:")
+	    memFree = kib;
+    }
+
+    // kernels before 3.14 have no MemAvailable
+    if (!available)
+	available = memFree;
+    if (!memTotal)
+	return;
+
+    m_usage.memTotal = memTotal;
+    if (!m_usage.minAvailable || available < m_usage.minAvailable)
+	m_usage.minAvailable = available;
+}
+
+//}}}
+//{{{ MemoryHistory ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+MemoryHistory::SampleVector MemoryHistory::load() const
+    throw (KError)
+{
+    SampleVector ret;
+
+    if (!m_path.exists())
+	return ret;
+    ifstream fin(m_path.c_str());
+    if (!fin)
+	throw KError("Cannot open " + m_path + ".");
+
+    string line;
+    while (std::getline(fin, line)) {
+	if (line.empty() || line[0] == '#')
+	    continue;
+
+	std::istringstream iss(line);
+	Sample sample;
+	long long time;
+	int network, makedumpfile;
+	if (!(iss >> time >> sample.usage.ram >> sample.usage.memTotal
+	      >> sample.usage.minAvailable >> sample.usage.cgroupPeak
+	      >> sample.cpus >> network >> makedumpfile)) {
+	    Debug::debug()->dbg("Ignoring invalid history line: %s",
+				line.c_str());
+	    continue;
+	}
+	iss >> sample.kernel;
+	sample.time = time;
+	sample.network = network != 0;
+	sample.makedumpfile = makedumpfile != 0;
+	ret.push_back(sample);
+    }
+    if (fin.bad())
+	throw KError("Cannot read " + m_path + ".");
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void MemoryHistory::append(const Sample &sample) const
+    throw (KError)
+{
+    SampleVector samples = load();
+    samples.push_back(sample);
+    if (samples.size() > HISTORY_KEEP)
+	samples.erase(samples.begin(), samples.end() - HISTORY_KEEP);
+
+    std::ostringstream ss;
+    ss << "# kdump memory history 1" << endl;
+    ss << "# time ram memtotal min_available cgroup_peak cpus network "
+       << "makedumpfile kernel (sizes in KiB)" << endl;
+    SampleVector::const_iterator it;
+    for (it = samples.begin(); it != samples.end(); ++it)
+	ss << (long long)it->time << ' ' << it->usage.ram << ' '
+	   << it->usage.memTotal << ' ' << it->usage.minAvailable << ' '
+	   << it->usage.cgroupPeak << ' ' << it->cpus << ' '
+	   << int(it->network) << ' ' << int(it->makedumpfile) << ' '
+	   << (it->kernel.empty() ? "-" : it->kernel) << endl;
+
+    FilePath(m_path.dirName()).mkdir(true);
+
+    FilePath tmp = m_path;
+    tmp += ".tmp";
+    {
+	std::ofstream fout(tmp.c_str());
+	fout << ss.str();
+	fout.close();
+	if (!fout)
+	    throw KError("Cannot write " + tmp + ".");
+    }
+    if (rename(tmp.c_str(), m_path.c_str()) != 0)
+	throw KSystemError("Cannot rename " + tmp + ".", errno);
+}
+
 //}}}
 //{{{ Calibrate ----------------------------------------------------------------
 
+// -----------------------------------------------------------------------------
+// Returns the reservation (in KiB) that the recent kdump runs with the
+// same setup needed, or 0 if there are not enough of them.
+static unsigned long observed_kb(const MemoryHistory::SampleVector &history,
+				 bool needsnet, bool needsmakedumpfile,
+				 unsigned long cpus)
+{
+    unsigned long long peak = 0;
+    unsigned long count = 0;
+
+    MemoryHistory::SampleVector::const_reverse_iterator it;
+    for (it = history.rbegin();
+	 it != history.rend() && count < HISTORY_SAMPLES; ++it) {
+	if (it->network != needsnet ||
+	    it->makedumpfile != needsmakedumpfile)
+	    continue;
+
+	unsigned long long needed = MemoryMonitor::peak(it->usage);
+	if (!needed)
+	    continue;
+	if (cpus > it->cpus)
+	    needed += (cpus - it->cpus) * PERCPU_KB;
+	peak = std::max(peak, needed);
+	++count;
+    }
+
+    Debug::debug()->dbg("Matching history samples: %lu, peak: %llu KiB",
+			count, peak);
+    if (count < HISTORY_MIN_SAMPLES)
+	return 0;
+    return peak * (100 + HISTORY_MARGIN) / 100;
+}
+
 // -----------------------------------------------------------------------------
 Calibrate::Calibrate()
     throw ()
-{}
+    : m_history(MEMORY_HISTORY_FILE), m_static(false)
+{
+    m_options.push_back(new StringOption("history", 'H', &m_history,
+        "Read the memory usage of past kdump runs from this file "
+	"(default: " MEMORY_HISTORY_FILE ")"));
+    m_options.push_back(new FlagOption("static", 's', &m_static,
+        "Ignore the memory usage of past kdump runs"));
+}
 
 // -----------------------------------------------------------------------------
 const char *Calibrate::getName() const
@@ -969,6 +1234,7 @@ void Calibrate::execute()
     unsigned long pagesize = sysconf(_SC_PAGESIZE);
     unsigned long memtotal = shr_round_up(mm.total(), 10);
     unsigned long bootsize = DEF_BOOTSIZE;
+    bool measured = false;
 
     try {
 	Configuration *config = Configuration::config();
@@ -1084,6 +1350,23 @@ void Calibrate::execute()
         // so subtract it again after memmap has been sized.
 	required -= KDUMP_PHYS_LOAD;
 
+	// Prefer what the kdump environment has really used
+	if (!m_static) {
+	    try {
+		MemoryHistory history(m_history);
+		unsigned long observed = observed_kb(history.load(), needsnet,
+		    config->needsMakedumpfile(), cpus);
+		if (observed) {
+		    Debug::debug()->dbg("Static estimate: %lu KiB, "
+					"observed: %lu KiB", required, observed);
+		    required = observed;
+		    measured = true;
+		}
+	    } catch (const KError &e) {
+		Debug::debug()->dbg("Cannot read memory history: %s", e.what());
+	    }
+	}
+
 	// Make sure there is enough space at boot
 	Debug::debug()->dbg("Total run-time size: %lu KiB", required);
 	if (required < bootsize)
@@ -1102,8 +1385,9 @@ void Calibrate::execute()
 
     Debug::debug()->dbg("Estimated crash area base: 0x%llx", base);
 
-    // If maxpfn is above 4G, SWIOTLB may be needed
-    if ((base + (required << 10)) >= (1ULL<<32)) {
+    // If maxpfn is above 4G, SWIOTLB may be needed (a measured size
+    // includes it already)
+    if (!measured && (base + (required << 10)) >= (1ULL<<32)) {
 	Debug::debug()->dbg("Adding 64 MiB for SWIOTLB");
 	required += MB(64);
     }
@@ -19,8 +19,16 @@
 #ifndef CALIBRATE_H
 #define CALIBRATE_H
 
+#include <string>
+#include <vector>
+#include <ctime>
+
 #include "subcommand.h"
 #include "fileutil.h"
+#include "threads.h"
+
+// peak memory usage of past kdump runs, read by calibrate
+#define MEMORY_HISTORY_FILE "/var/lib/kdump/memory-history"
 
 //{{{ Calibrate ----------------------------------------------------------------
 
@@ -52,6 +60,8 @@ class Calibrate : public Subcommand {
         throw (KError);
 
     private:
+        std::string m_history;
+        bool m_static;
 };
 
 //}}}
@@ -104,6 +114,144 @@ class SystemCPU {
 
 };
 
+//}}}
+//{{{ MemoryMonitor ------------------------------------------------------------
+
+/**
+ * Measures the peak memory usage of the kdump environment while the
+ * dump is saved. /proc/meminfo is sampled periodically, and the
+ * high-water mark of the cgroup (memory.peak) is read at the end,
+ * because short peaks fall between the samples.
+ */
+class MemoryMonitor : public Thread {
+
+    public:
+        /**
+         * Memory usage in KiB.
+         */
+        struct Usage {
+            /** System RAM (i.e. the size of the crash kernel area) */
+            unsigned long long ram;
+            /** MemTotal, i.e. RAM minus the kernel image and reservations */
+            unsigned long long memTotal;
+            /** lowest MemAvailable seen */
+            unsigned long long minAvailable;
+            /** memory.peak of the cgroup (0 if not available) */
+            unsigned long long cgroupPeak;
+        };
+
+        /**
+         * Creates a new monitor.
+         *
+         * @param[in] interval seconds between two samples
+         */
+        MemoryMonitor(double interval = 0.5)
+        throw ();
+
+        /**
+         * Stops the monitor.
+         */
+        ~MemoryMonitor()
+        throw ();
+
+        /**
+         * Stops the monitor and takes the last sample.
+         *
+         * @exception KError if the thread failed
+         */
+        void stop()
+        throw (KError);
+
+        /**
+         * Returns the usage measured so far.
+         */
+        Usage getUsage()
+        throw ();
+
+        /**
+         * Returns the peak usage of the kdump environment in KiB, i.e.
+         * the part of the crash kernel area that has been in use.
+         */
+        static unsigned long long peak(const Usage &usage)
+        throw ();
+
+    protected:
+        void run()
+        throw (KError);
+
+    private:
+        double m_interval;
+        bool m_stop;
+        Mutex m_lock;
+        Condition m_cond;
+        Usage m_usage;
+
+        void sample()
+        throw ();
+};
+
+//}}}
+//{{{ MemoryHistory ------------------------------------------------------------
+
+/**
+ * Persistent record of the memory usage of past kdump runs. save_dump
+ * appends one line per run in the kdump kernel, and calibrate combines
+ * the recent runs with its static estimate.
+ */
+class MemoryHistory {
+
+    public:
+        /**
+         * One run of save_dump.
+         */
+        struct Sample {
+            /** when the dump was saved */
+            time_t time;
+            /** measured usage */
+            MemoryMonitor::Usage usage;
+            /** online CPUs in the kdump kernel */
+            unsigned long cpus;
+            /** whether the network was set up */
+            bool network;
+            /** whether makedumpfile was used */
+            bool makedumpfile;
+            /** release of the kdump kernel */
+            std::string kernel;
+        };
+
+        typedef std::vector<Sample> SampleVector;
+
+        /**
+         * Creates a history object. Nothing is read yet.
+         *
+         * @param[in] path the history file
+         */
+        MemoryHistory(const FilePath &path)
+        throw ()
+            : m_path(path)
+        {}
+
+        /**
+         * Reads the history, oldest first.
+         *
+         * @return the samples, empty if there is no history file
+         * @exception KError if the file cannot be read
+         */
+        SampleVector load() const
+        throw (KError);
+
+        /**
+         * Appends a sample. Only the most recent samples are kept.
+         *
+         * @exception KError if the file cannot be written
+         */
+        void append(const Sample &sample) const
+        throw (KError);
+
+    private:
+        FilePath m_path;
+};
+
 //}}}
 
 #endif /* CALIBRATE_H */
@@ -0,0 +1,430 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "catalog.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "savedump.h"
+#include "upload_pending.h"
+
+using std::string;
+using std::ifstream;
+using std::ostringstream;
+using std::endl;
+
+// first line of the catalog file
+#define CATALOG_HEADER      "# kdump catalog 1"
+
+// number of fields per line
+#define CATALOG_FIELDS      8
+
+// -----------------------------------------------------------------------------
+// Fields are separated by tabs; empty fields are written as "-".
+static string catalog_field(const string &value)
+{
+    if (value.empty())
+        return "-";
+
+    string ret = value;
+    for (string::iterator it = ret.begin(); it != ret.end(); ++it)
+        if (*it == '\t' || *it == '\n')
+            *it = ' ';
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static string catalog_value(const string &field)
+{
+    return field == "-" ? string() : field;
+}
+
+// -----------------------------------------------------------------------------
+static bool entry_less(const DumpCatalog::Entry &a, const DumpCatalog::Entry &b)
+{
+    return a.id < b.id;
+}
+
+//{{{ DumpCatalog --------------------------------------------------------------
+
+const unsigned long long DumpCatalog::UNKNOWN_SIZE = ~0ULL;
+
+// -----------------------------------------------------------------------------
+DumpCatalog::DumpCatalog(const FilePath &dir)
+    throw ()
+    : m_dir(dir), m_lockfd(-1)
+{
+}
+
+// -----------------------------------------------------------------------------
+DumpCatalog::~DumpCatalog()
+    throw ()
+{
+    unlock();
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::lock()
+    throw (KError)
+{
+    if (m_lockfd >= 0)
+        return;
+
+    // the catalog itself is replaced on every update, so the lock
+    // needs a file of its own
+    FilePath path = m_dir;
+    path.appendPath(CATALOG_FILE ".lock");
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + path + ".", errno);
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            int err = errno;
+            close(fd);
+            throw KSystemError("Cannot lock " + path + ".", err);
+        }
+    }
+    m_lockfd = fd;
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::unlock()
+    throw ()
+{
+    if (m_lockfd >= 0) {
+        close(m_lockfd);
+        m_lockfd = -1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::load()
+    throw (KError)
+{
+    m_entries.clear();
+
+    FilePath path = m_dir;
+    path.appendPath(CATALOG_FILE);
+    if (!path.exists())
+        return false;
+    ifstream fin(path.c_str());
+    if (!fin)
+        throw KError("Cannot open " + path + ".");
+
+    string line;
+    while (std::getline(fin, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        StringVector fields = Stringutil::split(line, '\t');
+        if (fields.size() < CATALOG_FIELDS) {
+            Debug::debug()->dbg("Ignoring invalid catalog line: %s",
+                line.c_str());
+            continue;
+        }
+
+        Entry entry;
+        entry.id = fields[0];
+        entry.crashTime = Stringutil::string2llong(fields[1]);
+        entry.kernel = catalog_value(fields[2]);
+        entry.host = catalog_value(fields[3]);
+        entry.format = catalog_value(fields[4]);
+        if (fields[5] != "-")
+            entry.dumpLevel = Stringutil::string2number(fields[5]);
+        if (fields[6] != "-")
+            entry.size = Stringutil::string2llong(fields[6]);
+        entry.status = catalog_value(fields[7]);
+        m_entries.push_back(entry);
+    }
+    if (fin.bad())
+        throw KError("Cannot read " + path + ".");
+
+    std::sort(m_entries.begin(), m_entries.end(), entry_less);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::save()
+    throw (KError)
+{
+    ostringstream ss;
+    ss << CATALOG_HEADER << endl;
+    ss << "# id\tcrash time\tkernel\thost\tformat\tlevel\tsize\tstatus"
+       << endl;
+    for (EntryVector::const_iterator it = m_entries.begin();
+            it != m_entries.end(); ++it) {
+        ss << catalog_field(it->id) << '\t'
+           << (long long)it->crashTime << '\t'
+           << catalog_field(it->kernel) << '\t'
+           << catalog_field(it->host) << '\t'
+           << catalog_field(it->format) << '\t';
+        if (it->dumpLevel >= 0)
+            ss << it->dumpLevel;
+        else
+            ss << '-';
+        ss << '\t';
+        if (it->size != UNKNOWN_SIZE)
+            ss << it->size;
+        else
+            ss << '-';
+        ss << '\t' << catalog_field(it->status) << endl;
+    }
+    string data = ss.str();
+
+    // readers must never see a partial catalog
+    FilePath path = m_dir;
+    path.appendPath(CATALOG_FILE);
+    FilePath tmp = path;
+    tmp += ".tmp";
+
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + tmp + ".", errno);
+
+    const char *p = data.c_str();
+    size_t remaining = data.size();
+    while (remaining) {
+        ssize_t ret = write(fd, p, remaining);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            int err = errno;
+            close(fd);
+            throw KSystemError("Cannot write " + tmp + ".", err);
+        }
+        p += ret;
+        remaining -= ret;
+    }
+    if (fsync(fd) != 0 && errno != EINVAL) {
+        int err = errno;
+        close(fd);
+        throw KSystemError("Cannot write " + tmp + ".", err);
+    }
+    if (close(fd) != 0)
+        throw KSystemError("Cannot write " + tmp + ".", errno);
+
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+        throw KSystemError("Cannot rename " + tmp + ".", errno);
+}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::sync(bool sizes)
+    throw (KError)
+{
+    Debug::debug()->trace("DumpCatalog::sync(%s)", m_dir.c_str());
+
+    // d_type is enough for the known dumps; only new directories are
+    // checked for a vmcore file
+    StringVector dirs = m_dir.listDir(FilterDotsAndNondirs());
+    std::sort(dirs.begin(), dirs.end());
+
+    bool changed = false;
+    EntryVector::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (std::binary_search(dirs.begin(), dirs.end(), it->id)) {
+            ++it;
+            continue;
+        }
+        Debug::debug()->dbg("%s is gone", it->id.c_str());
+        it = m_entries.erase(it);
+        changed = true;
+    }
+
+    for (StringVector::const_iterator dit = dirs.begin();
+            dit != dirs.end(); ++dit) {
+        if (find(*dit))
+            continue;
+
+        FilePath dumpdir = m_dir;
+        dumpdir.appendPath(*dit);
+        FilePath vmcore = dumpdir;
+        if (!vmcore.appendPath("vmcore").exists())
+            continue;
+
+        Debug::debug()->dbg("Adding %s to the catalog", dit->c_str());
+        update(scan(dumpdir, sizes));
+        changed = true;
+    }
+
+    return changed;
+}
+
+// -----------------------------------------------------------------------------
+DumpCatalog::Entry *DumpCatalog::find(const string &id)
+    throw ()
+{
+    Entry key;
+    key.id = id;
+    EntryVector::iterator it = std::lower_bound(m_entries.begin(),
+        m_entries.end(), key, entry_less);
+    if (it == m_entries.end() || it->id != id)
+        return NULL;
+    return &*it;
+}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::isComplete(const Entry &entry) const
+    throw ()
+{
+    if (entry.status != "ok")
+        return false;
+
+    FilePath vmcore = m_dir;
+    vmcore.appendPath(entry.id).appendPath("vmcore");
+    return vmcore.exists();
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::update(const Entry &entry)
+    throw ()
+{
+    EntryVector::iterator it = std::lower_bound(m_entries.begin(),
+        m_entries.end(), entry, entry_less);
+    if (it != m_entries.end() && it->id == entry.id)
+        *it = entry;
+    else
+        m_entries.insert(it, entry);
+}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::remove(const string &id)
+    throw ()
+{
+    Entry *entry = find(id);
+    if (!entry)
+        return false;
+    m_entries.erase(m_entries.begin() + (entry - &m_entries[0]));
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void DumpCatalog::record(const Entry &entry)
+    throw (KError)
+{
+    Debug::debug()->trace("DumpCatalog::record(%s)", entry.id.c_str());
+
+    lock();
+    try {
+        load();
+        update(entry);
+        save();
+    } catch (...) {
+        unlock();
+        throw;
+    }
+    unlock();
+}
+
+// -----------------------------------------------------------------------------
+DumpCatalog::Entry DumpCatalog::scan(const FilePath &dumpdir, bool size)
+    throw (KError)
+{
+    Entry entry;
+    entry.id = dumpdir.baseName();
+    entry.status = "ok";
+
+    bool haveTime = parseTime(entry.id, entry.crashTime);
+
+    FilePath readme = dumpdir;
+    readme.appendPath(README_FILE);
+    ifstream fin(readme.c_str());
+    string line;
+    while (std::getline(fin, line)) {
+        if (line.compare(0, strlen(README_KERNEL), README_KERNEL) == 0)
+            entry.kernel = line.substr(strlen(README_KERNEL));
+        else if (line.compare(0, strlen(README_HOST), README_HOST) == 0)
+            entry.host = line.substr(strlen(README_HOST));
+        else if (line.compare(0, strlen(README_FORMAT), README_FORMAT) == 0)
+            entry.format = line.substr(strlen(README_FORMAT));
+        else if (line.compare(0, strlen(README_LEVEL), README_LEVEL) == 0)
+            entry.dumpLevel = Stringutil::string2number(
+                line.substr(strlen(README_LEVEL)));
+        else if (!haveTime &&
+                line.compare(0, strlen(README_TIME), README_TIME) == 0) {
+            struct tm tm;
+            memset(&tm, 0, sizeof tm);
+            tm.tm_isdst = -1;
+            string value = line.substr(strlen(README_TIME));
+            if (strptime(value.c_str(), "%Y-%m-%d %H:%M", &tm)) {
+                entry.crashTime = mktime(&tm);
+                haveTime = true;
+            }
+        }
+    }
+
+    if (!haveTime) {
+        struct stat st;
+        entry.crashTime = stat(dumpdir.c_str(), &st) == 0
+            ? st.st_mtime
+            : time(NULL);
+    }
+
+    FilePath marker = dumpdir;
+    marker.appendPath(UPLOAD_PENDING_FILE);
+    FilePath vmcore = dumpdir;
+    if (!vmcore.appendPath("vmcore").exists())
+        entry.status = "failed";
+    else if (marker.exists())
+        entry.status = "pending";
+    else {
+        FilePath report = dumpdir;
+        report.appendPath(REPORT_FILE);
+        ifstream rin(report.c_str());
+        while (std::getline(rin, line))
+            if (line.find("\"ok\": false") != string::npos) {
+                entry.status = "failed";
+                break;
+            }
+    }
+
+    if (size)
+        entry.size = dumpdir.diskUsage();
+
+    return entry;
+}
+
+// -----------------------------------------------------------------------------
+bool DumpCatalog::parseTime(const string &name, time_t &result)
+    throw ()
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof tm);
+    tm.tm_isdst = -1;
+    const char *end = strptime(name.c_str(), ISO_DATETIME, &tm);
+    if (end == NULL || *end != '\0')
+        return false;
+    result = mktime(&tm);
+    return true;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
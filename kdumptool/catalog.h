@@ -0,0 +1,222 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+#include "global.h"
+#include "fileutil.h"
+
+// index of the dumps in a local target, next to the dump directories
+#define CATALOG_FILE ".catalog"
+
+//{{{ DumpCatalog --------------------------------------------------------------
+
+/**
+ * Index of the dumps in a local target.
+ *
+ * The catalog is a small text file with one line per dump, so that the
+ * dumps can be listed without scanning every dump directory. save_dump,
+ * upload_pending and recompress update it; delete_dumps reconciles it
+ * with the directory and removes the deleted dumps.
+ *
+ * The file is always replaced atomically (written to a temporary file
+ * and renamed), so readers need no lock. Writers must hold the lock
+ * (see lock()) from load() to save(), otherwise concurrent updates
+ * may get lost.
+ */
+class DumpCatalog {
+
+    public:
+        /**
+         * Size of a dump that has not been determined yet.
+         */
+        static const unsigned long long UNKNOWN_SIZE;
+
+        /**
+         * One dump.
+         */
+        struct Entry {
+            Entry()
+            throw ()
+                : crashTime(0), dumpLevel(-1), size(UNKNOWN_SIZE)
+            {}
+
+            /** name of the dump directory */
+            std::string id;
+            /** crash time (Unix time) */
+            time_t crashTime;
+            /** kernel release of the crashed kernel */
+            std::string kernel;
+            /** host name of the crashed system */
+            std::string host;
+            /** KDUMP_DUMPFORMAT of the dump */
+            std::string format;
+            /** makedumpfile dump level, or -1 if unknown */
+            int dumpLevel;
+            /** disk usage of the dump directory in bytes */
+            unsigned long long size;
+            /** "ok", "failed" or "pending" (not uploaded from the spool) */
+            std::string status;
+        };
+
+        typedef std::vector<Entry> EntryVector;
+
+        /**
+         * Creates a catalog object for a target. Nothing is read yet.
+         *
+         * @param[in] dir the directory that contains the dump directories
+         */
+        DumpCatalog(const FilePath &dir)
+        throw ();
+
+        /**
+         * Releases the lock.
+         */
+        ~DumpCatalog()
+        throw ();
+
+        /**
+         * Takes the lock of the catalog. The lock is held until
+         * unlock() is called or the object is destroyed.
+         *
+         * @exception KError if the lock file cannot be created
+         */
+        void lock()
+        throw (KError);
+
+        /**
+         * Releases the lock.
+         */
+        void unlock()
+        throw ();
+
+        /**
+         * Reads the catalog.
+         *
+         * @return @c false if there is no catalog yet (the catalog is
+         *         empty then)
+         * @exception KError if the catalog cannot be read
+         */
+        bool load()
+        throw (KError);
+
+        /**
+         * Replaces the catalog file with the entries of this object.
+         *
+         * @exception KError if the catalog cannot be written
+         */
+        void save()
+        throw (KError);
+
+        /**
+         * Brings the catalog in line with the dump directories, using
+         * one directory listing: entries of directories that are gone
+         * are removed, and new dumps are scanned (see scan()).
+         *
+         * @param[in] sizes whether to compute the size of new dumps
+         * @return @c true if the catalog has been changed
+         * @exception KError if the directory cannot be listed
+         */
+        bool sync(bool sizes)
+        throw (KError);
+
+        /**
+         * Returns the entries, sorted by name (i.e. oldest first).
+         */
+        const EntryVector &getEntries() const
+        throw ()
+        { return m_entries; }
+
+        /**
+         * Returns the entry of a dump, or @c NULL if there is none.
+         */
+        Entry *find(const std::string &id)
+        throw ();
+
+        /**
+         * Checks whether an entry is a complete dump, i.e. saving it
+         * has succeeded and its vmcore file still exists. Only complete
+         * dumps count for KDUMP_KEEP_OLD_DUMPS.
+         */
+        bool isComplete(const Entry &entry) const
+        throw ();
+
+        /**
+         * Adds an entry or replaces the entry with the same id.
+         */
+        void update(const Entry &entry)
+        throw ();
+
+        /**
+         * Removes the entry of a dump.
+         *
+         * @return @c false if there was no such entry
+         */
+        bool remove(const std::string &id)
+        throw ();
+
+        /**
+         * Adds or replaces one entry in the catalog file, taking the
+         * lock. The catalog file is created if it does not exist.
+         *
+         * @exception KError if the catalog cannot be updated
+         */
+        void record(const Entry &entry)
+        throw (KError);
+
+        /**
+         * Creates the entry of a dump from its directory, i.e. from
+         * the directory name, README.txt and the marker files.
+         *
+         * @param[in] dumpdir the dump directory
+         * @param[in] size whether to compute the disk usage
+         * @exception KError if the size cannot be computed
+         */
+        static Entry scan(const FilePath &dumpdir, bool size)
+        throw (KError);
+
+        /**
+         * Parses the crash time from the name of a dump directory.
+         *
+         * @param[in] name the directory name (without host prefix)
+         * @param[out] result the crash time
+         * @return @c false if @p name is not a date
+         */
+        static bool parseTime(const std::string &name, time_t &result)
+        throw ();
+
+    private:
+        FilePath m_dir;
+        EntryVector m_entries;
+        int m_lockfd;
+
+        // non-copyable
+        DumpCatalog(const DumpCatalog &);
+        DumpCatalog &operator=(const DumpCatalog &);
+};
+
+//}}}
+
+#endif /* CATALOG_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -20,8 +20,15 @@
 #include <cstdarg>
 #include <cerrno>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <csignal>
 
 #include "dataprovider.h"
 #include "global.h"
@@ -29,6 +36,7 @@
 #include "debug.h"
 #include "stringutil.h"
 #include "fileutil.h"
+#include "metrics.h"
 
 using std::fopen;
 using std::fread;
@@ -210,6 +218,85 @@ size_t BufferDataProvider::getData(char *buffer, size_t maxread)
     return size;
 }
 
+//}}}
+//{{{ SyntheticDataProvider ----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+SyntheticDataProvider::SyntheticDataProvider(unsigned long long size,
+                                             unsigned long long seed)
+    throw ()
+    : m_size(size), m_currentPos(0), m_seed(seed), m_state(seed ? seed : 1),
+      m_chunkSize(4096), m_zeroPercent(0), m_compressPercent(0),
+      m_pattern(PATTERN_SCATTER)
+{}
+
+// -----------------------------------------------------------------------------
+unsigned long long SyntheticDataProvider::nextRandom()
+    throw ()
+{
+    // xorshift64, good enough to defeat compression
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 7;
+    m_state ^= m_state << 17;
+    return m_state;
+}
+
+// -----------------------------------------------------------------------------
+bool SyntheticDataProvider::isZeroChunk(unsigned long long chunk) const
+    throw ()
+{
+    if (m_zeroPercent == 0)
+        return false;
+
+    if (m_pattern == PATTERN_RUNS)
+        return (chunk % 100) < m_zeroPercent;
+
+    // splitmix64 of the chunk number, so the decision does not depend
+    // on how the data is read
+    unsigned long long z = m_seed + (chunk + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (z % 100) < m_zeroPercent;
+}
+
+// -----------------------------------------------------------------------------
+size_t SyntheticDataProvider::getData(char *buffer, size_t maxread)
+    throw (KError)
+{
+    size_t size = min((unsigned long long)maxread, m_size - m_currentPos);
+    size_t compressible = m_chunkSize * m_compressPercent / 100;
+
+    size_t done = 0;
+    while (done < size) {
+        unsigned long long chunk = m_currentPos / m_chunkSize;
+        size_t offset = m_currentPos % m_chunkSize;
+        size_t len = min(size - done, m_chunkSize - offset);
+        char *p = buffer + done;
+
+        if (isZeroChunk(chunk)) {
+            memset(p, 0, len);
+        } else {
+            size_t i = 0;
+            for ( ; i < len && offset + i < compressible; i++)
+                p[i] = 'K';
+            while (i < len) {
+                unsigned long long r = nextRandom();
+                for (int j = 0; j < 8 && i < len; j++, i++)
+                    p[i] = (char)(r >> (j * 8));
+            }
+        }
+
+        done += len;
+        m_currentPos += len;
+    }
+
+    if (getProgress())
+        getProgress()->progressed(m_currentPos, m_size);
+
+    return size;
+}
+
 //}}}
 //{{{ ProcessDataProvider ------------------------------------------------------
 
@@ -218,7 +305,7 @@ ProcessDataProvider::ProcessDataProvider(const char *pipe_cmdline,
                                          const char *direct_cmdline)
     throw ()
     : m_pipeCmdline(pipe_cmdline), m_directCmdline(direct_cmdline),
-      m_processFile(NULL)
+      m_processFile(NULL), m_pid(-1)
 {
     Debug::debug()->trace("ProcessDataProvider::ProcessDataProvider(%s, %s)",
         pipe_cmdline, direct_cmdline);
@@ -230,9 +317,37 @@ void ProcessDataProvider::prepare()
 {
     Debug::debug()->trace("ProcessDataProvider::prepare");
 
-    m_processFile = popen(m_pipeCmdline.c_str(), "r");
-    if (!m_processFile)
+    // like popen(3), but keep the PID for abort()
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) < 0)
         throw KSystemError("Could not start process " + m_pipeCmdline, errno);
+
+    m_pid = fork();
+    if (m_pid < 0) {
+        int err = errno;
+        close(pipefd[0]);
+        close(pipefd[1]);
+        throw KSystemError("Could not start process " + m_pipeCmdline, err);
+    } else if (m_pid == 0) {
+        // own process group, so that abort() also reaches the children
+        setpgid(0, 0);
+        dup2(pipefd[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", m_pipeCmdline.c_str(), (char *)NULL);
+        _exit(127);
+    }
+
+    // also here, or abort() may come before the child has done it
+    setpgid(m_pid, m_pid);
+    close(pipefd[1]);
+    m_processFile = fdopen(pipefd[0], "r");
+    if (!m_processFile) {
+        int err = errno;
+        close(pipefd[0]);
+        abort();
+        waitpid(m_pid, NULL, 0);
+        m_pid = -1;
+        throw KSystemError("Could not start process " + m_pipeCmdline, err);
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -258,14 +373,31 @@ void ProcessDataProvider::finish()
 {
     Debug::debug()->trace("ProcessDataProvider::finish");
 
-    int err = pclose(m_processFile);
-    m_processFile = NULL;
+    if (m_processFile) {
+        fclose(m_processFile);
+        m_processFile = NULL;
+    }
+
+    int err = 0;
+    if (m_pid > 0) {
+        while (waitpid(m_pid, &err, 0) < 0 && errno == EINTR)
+            ;
+        m_pid = -1;
+    }
 
     if (WEXITSTATUS(err) != 0)
         throw KError(m_pipeCmdline + " failed (" +
             Stringutil::number2string(WEXITSTATUS(err)) +").");
 }
 
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::abort()
+    throw ()
+{
+    if (m_pid > 0)
+        kill(-m_pid, SIGKILL);
+}
+
 // -----------------------------------------------------------------------------
 bool ProcessDataProvider::canSaveToFile() const
     throw ()
@@ -295,6 +427,444 @@ void ProcessDataProvider::saveToFile(const StringVector &targets)
             Stringutil::number2string(WEXITSTATUS(err)) +").");
 }
 
+//}}}
+//{{{ RateLimitedDataProvider --------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static double monotonic_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// -----------------------------------------------------------------------------
+static void sleep_seconds(double secs)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)secs;
+    ts.tv_nsec = (long)((secs - ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+// -----------------------------------------------------------------------------
+RateLimitedDataProvider::RateLimitedDataProvider(DataProvider *source,
+                                                 unsigned long long rate,
+                                                 unsigned long long burst,
+                                                 unsigned startDelay)
+    throw ()
+    : m_source(source), m_rate(rate),
+      m_burst(burst ? burst : rate), m_startDelay(startDelay),
+      m_tokens(0), m_last(0)
+{
+    Debug::debug()->trace("RateLimitedDataProvider::RateLimitedDataProvider"
+        "(%p, %llu, %llu, %u)", source, rate, burst, startDelay);
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::prepare()
+    throw (KError)
+{
+    Debug::debug()->trace("RateLimitedDataProvider::prepare");
+
+    // spread the start of many hosts that crashed at the same time
+    if (m_startDelay) {
+        unsigned seed;
+        FILE *fp = fopen("/dev/urandom", "r");
+        if (!fp || fread(&seed, sizeof seed, 1, fp) != 1)
+            seed = time(NULL) ^ getpid();
+        if (fp)
+            fclose(fp);
+
+        double delay = (double)rand_r(&seed) / RAND_MAX * m_startDelay;
+        Debug::debug()->info("Delaying transfer by %.1f seconds", delay);
+        sleep_seconds(delay);
+    }
+
+    m_source->prepare();
+    m_tokens = m_burst;
+    m_last = monotonic_seconds();
+}
+
+// -----------------------------------------------------------------------------
+bool RateLimitedDataProvider::canSaveToFile() const
+    throw ()
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::saveToFile(const StringVector &targets)
+    throw (KError)
+{
+    throw KError("A rate-limited DataProvider cannot save to a file.");
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::refill()
+    throw ()
+{
+    double now = monotonic_seconds();
+    m_tokens += (now - m_last) * m_rate;
+    if (m_tokens > m_burst)
+        m_tokens = m_burst;
+    m_last = now;
+}
+
+// -----------------------------------------------------------------------------
+size_t RateLimitedDataProvider::getData(char *buffer, size_t maxread)
+    throw (KError)
+{
+    if (m_rate <= 0)
+        return m_source->getData(buffer, maxread);
+
+    // never take more than the bucket can hold at once
+    if (maxread > m_burst)
+        maxread = (size_t)m_burst;
+    if (maxread == 0)
+        maxread = 1;
+
+    size_t size = m_source->getData(buffer, maxread);
+    if (size == 0)
+        return 0;
+
+    refill();
+    m_tokens -= size;
+    if (m_tokens < 0) {
+        sleep_seconds(-m_tokens / m_rate);
+        refill();
+    }
+
+    return size;
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::finish()
+    throw (KError)
+{
+    m_source->finish();
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::setError(bool error)
+    throw ()
+{
+    m_source->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::setProgress(Progress *progress)
+    throw ()
+{
+    m_source->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedDataProvider::abort()
+    throw ()
+{
+    m_source->abort();
+}
+
+//}}}
+//{{{ CountingDataProvider -----------------------------------------------------
+
+// -----------------------------------------------------------------------------
+CountingDataProvider::CountingDataProvider(DataProvider *source)
+    throw ()
+    : m_source(source), m_bytes(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::prepare()
+    throw (KError)
+{
+    m_source->prepare();
+}
+
+// -----------------------------------------------------------------------------
+bool CountingDataProvider::canSaveToFile() const
+    throw ()
+{
+    return m_source->canSaveToFile();
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::saveToFile(const StringVector &targets)
+    throw (KError)
+{
+    StringVector::const_iterator it;
+    for (it = targets.begin(); it != targets.end(); ++it)
+        TransferMetrics::metrics()->watchFile(*it);
+
+    m_source->saveToFile(targets);
+
+    for (it = targets.begin(); it != targets.end(); ++it) {
+        struct stat st;
+        if (stat(it->c_str(), &st) == 0)
+            m_bytes += st.st_size;
+    }
+}
+
+// -----------------------------------------------------------------------------
+size_t CountingDataProvider::getData(char *buffer, size_t maxread)
+    throw (KError)
+{
+    size_t size = m_source->getData(buffer, maxread);
+    m_bytes += size;
+    TransferMetrics::metrics()->addRead(size);
+    return size;
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::finish()
+    throw (KError)
+{
+    m_source->finish();
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::setError(bool error)
+    throw ()
+{
+    m_source->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::setProgress(Progress *progress)
+    throw ()
+{
+    m_source->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+void CountingDataProvider::abort()
+    throw ()
+{
+    m_source->abort();
+}
+
+//}}}
+//{{{ DeadlineDataProvider -----------------------------------------------------
+
+// how long to measure the throughput before predicting the end
+#define DEADLINE_GRACE      10.0
+
+/**
+ * Aborts the source of a DeadlineDataProvider at the deadline.
+ */
+class DeadlineDataProvider::Watchdog : public Thread {
+
+    public:
+        Watchdog(DeadlineDataProvider *provider)
+        throw ()
+            : m_provider(provider), m_stop(false)
+        {}
+
+        ~Watchdog()
+        throw ()
+        { stop(); }
+
+        /**
+         * Stops and joins the thread.
+         */
+        void stop()
+        throw ();
+
+    protected:
+        void run()
+        throw (KError);
+
+    private:
+        DeadlineDataProvider *m_provider;
+        Mutex m_lock;
+        Condition m_cond;
+        bool m_stop;
+};
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::Watchdog::stop()
+    throw ()
+{
+    m_lock.lock();
+    m_stop = true;
+    m_cond.signal();
+    m_lock.unlock();
+
+    try {
+        join();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Watchdog: %s", error.what());
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::Watchdog::run()
+    throw (KError)
+{
+    MutexLocker locker(m_lock);
+
+    while (!m_stop) {
+        double left = m_provider->m_deadline - monotonic_seconds();
+        if (left <= 0) {
+            m_provider->expire("The save deadline has passed.");
+            return;
+        }
+        m_cond.timedWait(m_lock, left);
+    }
+}
+
+// -----------------------------------------------------------------------------
+DeadlineDataProvider::DeadlineDataProvider(DataProvider *source,
+                                           double seconds,
+                                           unsigned long long expected)
+    throw ()
+    : m_source(source), m_deadline(monotonic_seconds() + seconds),
+      m_expected(expected), m_bytes(0), m_start(0), m_missed(false),
+      m_watchdog(NULL)
+{
+    Debug::debug()->trace("DeadlineDataProvider::DeadlineDataProvider"
+        "(%p, %.1f, %llu)", source, seconds, expected);
+}
+
+// -----------------------------------------------------------------------------
+DeadlineDataProvider::~DeadlineDataProvider()
+    throw ()
+{
+    stopWatchdog();
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::missed()
+    throw ()
+{
+    MutexLocker locker(m_lock);
+    return m_missed;
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::expire(const string &reason)
+    throw ()
+{
+    m_lock.lock();
+    if (!m_missed) {
+        m_missed = true;
+        m_reason = reason;
+    }
+    m_lock.unlock();
+
+    m_source->setError(true);
+    m_source->abort();
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::stopWatchdog()
+    throw ()
+{
+    if (m_watchdog) {
+        m_watchdog->stop();
+        delete m_watchdog;
+        m_watchdog = NULL;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::prepare()
+    throw (KError)
+{
+    Debug::debug()->trace("DeadlineDataProvider::prepare");
+
+    m_source->prepare();
+    m_start = monotonic_seconds();
+
+    m_watchdog = new Watchdog(this);
+    try {
+        m_watchdog->start();
+    } catch (...) {
+        delete m_watchdog;
+        m_watchdog = NULL;
+        throw;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool DeadlineDataProvider::canSaveToFile() const
+    throw ()
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::saveToFile(const StringVector &targets)
+    throw (KError)
+{
+    throw KError("A DataProvider with a deadline cannot save to a file.");
+}
+
+// -----------------------------------------------------------------------------
+size_t DeadlineDataProvider::getData(char *buffer, size_t maxread)
+    throw (KError)
+{
+    size_t size;
+    try {
+        size = m_source->getData(buffer, maxread);
+    } catch (const KError &error) {
+        if (missed())
+            throw KError(m_reason);
+        throw;
+    }
+    if (missed())
+        throw KError(m_reason);
+
+    m_bytes += size;
+    double now = monotonic_seconds();
+    double elapsed = now - m_start;
+    if (size && m_expected > m_bytes && elapsed >= DEADLINE_GRACE) {
+        double eta = (m_expected - m_bytes) * elapsed / m_bytes;
+        if (now + eta > m_deadline) {
+            expire("Saving needs about " +
+                Stringutil::number2string((unsigned long)eta) +
+                " more seconds, but only " +
+                Stringutil::number2string((unsigned long)(m_deadline - now)) +
+                " are left before the deadline.");
+            throw KError(m_reason);
+        }
+    }
+
+    return size;
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::finish()
+    throw (KError)
+{
+    stopWatchdog();
+    m_source->finish();
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::setError(bool error)
+    throw ()
+{
+    m_source->setError(error);
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::setProgress(Progress *progress)
+    throw ()
+{
+    m_source->setProgress(progress);
+}
+
+// -----------------------------------------------------------------------------
+void DeadlineDataProvider::abort()
+    throw ()
+{
+    m_source->abort();
+}
+
 //}}}
 
 
@@ -21,9 +21,11 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <sys/types.h>
 
 #include "global.h"
 #include "rootdirurl.h"
+#include "threads.h"
 
 class Progress;
 
@@ -115,6 +117,15 @@ class DataProvider {
          */
         virtual void setProgress(Progress *progress)
         throw () = 0;
+
+        /**
+         * Stops producing data as soon as possible, so that a blocked
+         * DataProvider::getData() call returns. This may be called from
+         * another thread. The default implementation does nothing.
+         */
+        virtual void abort()
+        throw ()
+        {}
 };
 
 //}}}
@@ -285,6 +296,104 @@ class BufferDataProvider : public AbstractDataProvider {
         unsigned long long m_currentPos;
 };
 
+//}}}
+//{{{ SyntheticDataProvider ----------------------------------------------------
+
+/**
+ * SyntheticDataProvider produces a given amount of generated data.
+ *
+ * The data is divided into chunks. A configurable share of the chunks is
+ * all zeros (like free pages in a dump); the other chunks start with a
+ * configurable share of a repeated byte, followed by pseudo-random data.
+ * By default, the data is entirely random and does not compress, so it
+ * can be used to measure the raw throughput of a dump target.
+ */
+class SyntheticDataProvider : public AbstractDataProvider {
+
+    public:
+
+        /**
+         * How the zero chunks are placed.
+         */
+        enum Pattern {
+            /** zero chunks are scattered at random */
+            PATTERN_SCATTER,
+            /** zero chunks form contiguous runs */
+            PATTERN_RUNS
+        };
+
+        /**
+         * Creates a new SyntheticDataProvider object.
+         *
+         * @param[in] size number of bytes to produce
+         * @param[in] seed seed of the pseudo-random generator
+         */
+        SyntheticDataProvider(unsigned long long size,
+                              unsigned long long seed = 1)
+        throw ();
+
+        /**
+         * Sets the chunk size (default is 4096 bytes).
+         *
+         * @param[in] size chunk size in bytes
+         */
+        void setChunkSize(size_t size)
+        throw ()
+        { m_chunkSize = size ? size : 1; }
+
+        /**
+         * Sets the share of chunks that contain only zeros.
+         *
+         * @param[in] percent share in percent (0-100)
+         */
+        void setZeroRatio(unsigned percent)
+        throw ()
+        { m_zeroPercent = percent > 100 ? 100 : percent; }
+
+        /**
+         * Sets the share of each non-zero chunk that is easily
+         * compressible.
+         *
+         * @param[in] percent share in percent (0-100)
+         */
+        void setCompressibility(unsigned percent)
+        throw ()
+        { m_compressPercent = percent > 100 ? 100 : percent; }
+
+        /**
+         * Sets how the zero chunks are placed.
+         *
+         * @param[in] pattern the pattern
+         */
+        void setPattern(Pattern pattern)
+        throw ()
+        { m_pattern = pattern; }
+
+        /**
+         * Provides the data.
+         *
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread)
+        throw (KError);
+
+    private:
+        unsigned long long m_size;
+        unsigned long long m_currentPos;
+        unsigned long long m_seed;
+        unsigned long long m_state;
+        size_t m_chunkSize;
+        unsigned m_zeroPercent;
+        unsigned m_compressPercent;
+        Pattern m_pattern;
+
+        bool isZeroChunk(unsigned long long chunk) const
+        throw ();
+
+        unsigned long long nextRandom()
+        throw ();
+};
+
 //}}}
 //{{{ ProcessDataProvider ------------------------------------------------------
 
@@ -349,10 +458,325 @@ class ProcessDataProvider : public AbstractDataProvider {
         virtual void finish()
         throw (KError);
 
+        /**
+         * Kills the process (and its children) started by prepare().
+         *
+         * @see DataProvider::abort()
+         */
+        void abort()
+        throw ();
+
     private:
         std::string m_pipeCmdline;
         std::string m_directCmdline;
         FILE *m_processFile;
+        pid_t m_pid;
+};
+
+//}}}
+//{{{ RateLimitedDataProvider --------------------------------------------------
+
+/**
+ * RateLimitedDataProvider passes the data of another DataProvider through
+ * a token bucket. Reading blocks as long as the average rate would exceed
+ * the limit; short bursts up to the bucket size are allowed.
+ *
+ * The data always goes through getData(), i.e. canSaveToFile() is
+ * @c false even if the source could save to a file directly.
+ */
+class RateLimitedDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Creates a new RateLimitedDataProvider object.
+         *
+         * @param[in] source the DataProvider that provides the data
+         * @param[in] rate maximum average rate in bytes per second
+         *            (0 means no limit)
+         * @param[in] burst bucket size in bytes (0 means one second
+         *            worth of data)
+         * @param[in] startDelay maximum random delay in seconds before
+         *            the data is read for the first time
+         */
+        RateLimitedDataProvider(DataProvider *source,
+                                unsigned long long rate,
+                                unsigned long long burst = 0,
+                                unsigned startDelay = 0)
+        throw ();
+
+        /**
+         * Waits for the start delay and prepares the source.
+         *
+         * @see DataProvider::prepare()
+         */
+        void prepare()
+        throw (KError);
+
+        /**
+         * Returns @c false.
+         *
+         * @see DataProvider::canSaveToFile()
+         */
+        bool canSaveToFile() const
+        throw ();
+
+        /**
+         * Throws a KError.
+         *
+         * @see DataProvider::saveToFile()
+         */
+        void saveToFile(const StringVector &targets)
+        throw (KError);
+
+        /**
+         * Reads data from the source and waits until the bucket has
+         * enough tokens for it.
+         *
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread)
+        throw (KError);
+
+        /**
+         * @see DataProvider::finish()
+         */
+        void finish()
+        throw (KError);
+
+        /**
+         * @see DataProvider::setError()
+         */
+        void setError(bool error)
+        throw ();
+
+        /**
+         * @see DataProvider::setProgress()
+         */
+        void setProgress(Progress *progress)
+        throw ();
+
+        /**
+         * @see DataProvider::abort()
+         */
+        void abort()
+        throw ();
+
+    private:
+        DataProvider *m_source;
+        double m_rate;
+        double m_burst;
+        unsigned m_startDelay;
+        double m_tokens;
+        double m_last;
+
+        void refill()
+        throw ();
+};
+
+//}}}
+//{{{ CountingDataProvider -----------------------------------------------------
+
+/**
+ * Counts the bytes that another DataProvider delivers. If the source
+ * saves directly to files, the sizes of those files are counted.
+ * The bytes are also reported to TransferMetrics, and the files are
+ * watched there while they are written.
+ */
+class CountingDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Creates a new CountingDataProvider object.
+         *
+         * @param[in] source the DataProvider that provides the data
+         */
+        CountingDataProvider(DataProvider *source)
+        throw ();
+
+        /**
+         * Returns the number of bytes counted so far.
+         */
+        unsigned long long getBytes() const
+        throw ()
+        { return m_bytes; }
+
+        /**
+         * @see DataProvider::prepare()
+         */
+        void prepare()
+        throw (KError);
+
+        /**
+         * @see DataProvider::canSaveToFile()
+         */
+        bool canSaveToFile() const
+        throw ();
+
+        /**
+         * Saves the data with the source and adds the file sizes.
+         *
+         * @see DataProvider::saveToFile()
+         */
+        void saveToFile(const StringVector &targets)
+        throw (KError);
+
+        /**
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread)
+        throw (KError);
+
+        /**
+         * @see DataProvider::finish()
+         */
+        void finish()
+        throw (KError);
+
+        /**
+         * @see DataProvider::setError()
+         */
+        void setError(bool error)
+        throw ();
+
+        /**
+         * @see DataProvider::setProgress()
+         */
+        void setProgress(Progress *progress)
+        throw ();
+
+        /**
+         * @see DataProvider::abort()
+         */
+        void abort()
+        throw ();
+
+    private:
+        DataProvider *m_source;
+        unsigned long long m_bytes;
+};
+
+//}}}
+//{{{ DeadlineDataProvider -----------------------------------------------------
+
+/**
+ * Stops another DataProvider when a deadline has passed, or as soon as
+ * its throughput shows that the expected number of bytes cannot be
+ * read before the deadline.
+ *
+ * A watchdog thread aborts the source at the deadline, even if
+ * getData() is blocked in the source. getData() then throws a KError
+ * and missed() returns @c true.
+ *
+ * Like RateLimitedDataProvider, the data always goes through getData(),
+ * because a process that saves to a file directly cannot be watched.
+ */
+class DeadlineDataProvider : public DataProvider {
+
+    public:
+
+        /**
+         * Creates a new DeadlineDataProvider object.
+         *
+         * @param[in] source the DataProvider that provides the data
+         * @param[in] seconds time left from now
+         * @param[in] expected expected number of bytes, or 0 if unknown
+         *            (then only the deadline itself is checked)
+         */
+        DeadlineDataProvider(DataProvider *source, double seconds,
+                             unsigned long long expected = 0)
+        throw ();
+
+        /**
+         * Stops the watchdog.
+         */
+        ~DeadlineDataProvider()
+        throw ();
+
+        /**
+         * Returns @c true if the source was stopped because of the
+         * deadline.
+         */
+        bool missed()
+        throw ();
+
+        /**
+         * Prepares the source and starts the watchdog.
+         *
+         * @see DataProvider::prepare()
+         */
+        void prepare()
+        throw (KError);
+
+        /**
+         * Returns @c false.
+         *
+         * @see DataProvider::canSaveToFile()
+         */
+        bool canSaveToFile() const
+        throw ();
+
+        /**
+         * Throws a KError.
+         *
+         * @see DataProvider::saveToFile()
+         */
+        void saveToFile(const StringVector &targets)
+        throw (KError);
+
+        /**
+         * Reads data from the source and checks the deadline.
+         *
+         * @see DataProvider::getData()
+         */
+        size_t getData(char *buffer, size_t maxread)
+        throw (KError);
+
+        /**
+         * Stops the watchdog and finishes the source.
+         *
+         * @see DataProvider::finish()
+         */
+        void finish()
+        throw (KError);
+
+        /**
+         * @see DataProvider::setError()
+         */
+        void setError(bool error)
+        throw ();
+
+        /**
+         * @see DataProvider::setProgress()
+         */
+        void setProgress(Progress *progress)
+        throw ();
+
+        /**
+         * @see DataProvider::abort()
+         */
+        void abort()
+        throw ();
+
+    private:
+        class Watchdog;
+
+        DataProvider *m_source;
+        double m_deadline;
+        unsigned long long m_expected;
+        unsigned long long m_bytes;
+        double m_start;
+        bool m_missed;
+        std::string m_reason;
+        Mutex m_lock;
+        Watchdog *m_watchdog;
+
+        void expire(const std::string &reason)
+        throw ();
+
+        void stopWatchdog()
+        throw ();
 };
 
 //}}}
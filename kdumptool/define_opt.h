@@ -22,12 +22,25 @@ DEFINE_OPT(MAKEDUMPFILE_OPTIONS, String, "", DUMP)
 DEFINE_OPT(KDUMP_IMMEDIATE_REBOOT, Bool, true, DUMP)
 DEFINE_OPT(KDUMP_TRANSFER, String, "", DUMP)
 DEFINE_OPT(KDUMP_SAVEDIR, String, "/var/log/dump", MKINITRD | DUMP)
+DEFINE_OPT(KDUMP_SPOOL, String, "", MKINITRD | DUMP)
+DEFINE_OPT(KDUMP_RECOMPRESS, String, "", DUMP)
+DEFINE_OPT(KDUMP_TARGET_PROBE, String, "", DUMP)
+DEFINE_OPT(KDUMP_TARGET_PROBE_SIZE, Int, 32, DUMP)
 DEFINE_OPT(KDUMP_KEEP_OLD_DUMPS, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_KEEP_SIZE, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_KEEP_DAYS, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_MAKE_ROOM, Bool, false, DUMP)
 DEFINE_OPT(KDUMP_FREE_DISK_SIZE, Int, 64, DUMP)
 DEFINE_OPT(KDUMP_VERBOSE, Int, 0, KEXEC | DUMP)
 DEFINE_OPT(KDUMP_DUMPLEVEL, Int, 31, DUMP)
 DEFINE_OPT(KDUMP_DUMPFORMAT, String, "compressed", DUMP)
 DEFINE_OPT(KDUMP_CONTINUE_ON_ERROR, Bool, true, DUMP)
+DEFINE_OPT(KDUMP_ANALYZE_SAMPLES, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_METRICS, String, "", DUMP)
+DEFINE_OPT(KDUMP_METRICS_INTERVAL, Int, 5, DUMP)
+DEFINE_OPT(KDUMP_BUFFER_MEMORY, Int, 10, DUMP)
+DEFINE_OPT(KDUMP_SAVE_DEADLINE, Int, 0, DUMP)
+DEFINE_OPT(KDUMP_TWO_STAGE, Bool, false, DUMP)
 DEFINE_OPT(KDUMP_REQUIRED_PROGRAMS, String, "", MKINITRD)
 DEFINE_OPT(KDUMP_PRESCRIPT, String, "", DUMP)
 DEFINE_OPT(KDUMP_POSTSCRIPT, String, "", DUMP)
@@ -22,7 +22,11 @@
 #include <memory>
 #include <sstream>
 #include <algorithm>
-#include <ext/algorithm>
+#include <vector>
+#include <ctime>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -37,6 +41,9 @@
 #include "stringutil.h"
 #include "vmcoreinfo.h"
 #include "deletedumps.h"
+#include "threads.h"
+#include "routable.h"
+#include "catalog.h"
 
 using std::string;
 using std::cout;
@@ -44,8 +51,6 @@ using std::endl;
 using std::auto_ptr;
 using std::stringstream;
 using std::cerr;
-using __gnu_cxx::copy_n;
-using std::back_inserter;
 
 //{{{ DeleteDumps --------------------------------------------------------------
 
@@ -82,7 +87,9 @@ void DeleteDumps::execute()
     int oldDumps = config->KDUMP_KEEP_OLD_DUMPS.value();
     Debug::debug()->dbg("keep %d old dumps", oldDumps);
 
-    if (oldDumps == 0) {
+    if (oldDumps == 0 && config->KDUMP_KEEP_SIZE.value() <= 0 &&
+            config->KDUMP_KEEP_DAYS.value() <= 0 &&
+            !config->KDUMP_MAKE_ROOM.value()) {
         cerr << "Deletion of old dumps disabled." << endl;
         return;
     }
@@ -95,12 +102,194 @@ void DeleteDumps::execute()
     }
 }
 
+//}}}
+//{{{ DumpDirJob ---------------------------------------------------------------
+
+// maximum number of threads that scan or delete dump directories
+#define DUMPDIR_THREADS     8
+
+/**
+ * Scans or deletes a list of dump directories with several threads.
+ * Both are dominated by metadata I/O, so several requests in flight
+ * help even with a single CPU.
+ */
+class DumpDirJob {
+
+    public:
+        enum Action {
+            SCAN,               /**< compute the disk usage */
+            DELETE              /**< delete the directories */
+        };
+
+        DumpDirJob(Action action, const FilePath &dir,
+                   const StringVector &names)
+        throw ()
+            : m_action(action), m_dir(dir), m_names(names),
+              m_sizes(names.size()), m_next(0)
+        {}
+
+        /**
+         * Runs the job and waits for it to finish. Errors of single
+         * directories do not stop the job.
+         *
+         * @exception KError if a thread cannot be started, or (after
+         *            all directories are done) the first error
+         */
+        void run()
+        throw (KError);
+
+        /**
+         * Returns the disk usage of each directory after a SCAN.
+         */
+        const std::vector<unsigned long long> &getSizes() const
+        throw ()
+        { return m_sizes; }
+
+    private:
+        class Worker;
+
+        Action m_action;
+        FilePath m_dir;
+        const StringVector &m_names;
+        std::vector<unsigned long long> m_sizes;
+        std::string m_error;
+        Mutex m_mutex;
+        size_t m_next;
+
+        void work()
+        throw ();
+};
+
+// -----------------------------------------------------------------------------
+class DumpDirJob::Worker : public Thread {
+
+    public:
+        Worker(DumpDirJob &job)
+        throw ()
+            : m_job(job)
+        {}
+
+        ~Worker()
+        throw ()
+        { joinQuietly(); }
+
+    protected:
+        void run()
+        throw (KError)
+        { m_job.work(); }
+
+    private:
+        DumpDirJob &m_job;
+};
+
+// -----------------------------------------------------------------------------
+void DumpDirJob::work()
+    throw ()
+{
+    while (true) {
+        size_t idx;
+        {
+            MutexLocker lock(m_mutex);
+            if (m_next >= m_names.size())
+                return;
+            idx = m_next++;
+        }
+
+        FilePath fp = m_dir;
+        fp.appendPath(m_names[idx]);
+        try {
+            if (m_action == SCAN)
+                m_sizes[idx] = fp.diskUsage();
+            else
+                fp.rmdir(true);
+        } catch (const KError &error) {
+            Debug::debug()->info("%s", error.what());
+            MutexLocker lock(m_mutex);
+            if (m_error.empty())
+                m_error = error.what();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DumpDirJob::run()
+    throw (KError)
+{
+    size_t nthreads = std::min(m_names.size(), size_t(DUMPDIR_THREADS));
+    std::vector<Worker *> workers;
+    try {
+        for (size_t i = 0; i < nthreads; ++i) {
+            workers.push_back(new Worker(*this));
+            workers.back()->start();
+        }
+    } catch (...) {
+        // stop the others and wait for them in the destructors
+        {
+            MutexLocker lock(m_mutex);
+            m_next = m_names.size();
+        }
+        for (size_t i = 0; i < workers.size(); ++i)
+            delete workers[i];
+        throw;
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->join();
+        delete workers[i];
+    }
+
+    if (!m_error.empty())
+        throw KError(m_error);
+}
+
+//}}}
+//{{{ DeleteDumps --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+// Selects the dumps beyond KDUMP_KEEP_OLD_DUMPS and those older than
+// KDUMP_KEEP_DAYS. The dumps must be sorted oldest first. Only the
+// complete dumps count for KDUMP_KEEP_OLD_DUMPS; incomplete dumps are
+// kept only if they are newer than the oldest dump that is kept.
+static void select_old_dumps(const StringVector &names,
+                             const std::vector<time_t> &times,
+                             const std::vector<bool> &complete,
+                             int oldDumps, std::vector<bool> &selected)
+    throw ()
+{
+    Configuration *config = Configuration::config();
+
+    // number of dumps
+    if (oldDumps == -1)
+        std::fill(selected.begin(), selected.end(), true);
+    else if (oldDumps > 0) {
+        int kept = 0;
+        for (size_t i = names.size(); i-- > 0; ) {
+            if (kept >= oldDumps)
+                selected[i] = true;
+            else if (complete[i])
+                ++kept;
+        }
+    }
+
+    // age
+    int keepDays = config->KDUMP_KEEP_DAYS.value();
+    if (keepDays > 0) {
+        time_t limit = time(NULL) - time_t(keepDays) * 24 * 60 * 60;
+        for (size_t i = 0; i < names.size(); ++i)
+            if (!selected[i] && times[i] < limit) {
+                Debug::debug()->dbg("%s is older than %d days",
+                    names[i].c_str(), keepDays);
+                selected[i] = true;
+            }
+    }
+}
+
 // -----------------------------------------------------------------------------
 void DeleteDumps::delete_one(const RootDirURL &url, int oldDumps)
     throw (KError)
 {
     if (url.getProtocol() != URLParser::PROT_FILE) {
-        cerr << "Deletion of old dump only on local disk." << endl;
+        delete_remote(url, oldDumps);
         return;
     }
 
@@ -112,29 +301,220 @@ void DeleteDumps::delete_one(const RootDirURL &url, int oldDumps)
         return;
     }
 
-    StringVector contents = dir.listDir(FilterKdumpDirs());
-    int deleteItems;
-    if (oldDumps == -1)
-        deleteItems = contents.size();
-    else if (oldDumps > int(contents.size())) {
+    Configuration *config = Configuration::config();
+    const unsigned long long MB = 1024ULL * 1024;
+
+    // the catalog provides the crash time and size of every dump, and
+    // one directory listing shows the dumps that it does not know yet
+    DumpCatalog catalog(dir);
+    if (!m_dryRun)
+        catalog.lock();
+    catalog.load();
+    bool changed = catalog.sync(false);
+
+    // oldest first; failed and incomplete dumps do not count for
+    // KDUMP_KEEP_OLD_DUMPS, but they are deleted like the others
+    const DumpCatalog::EntryVector &entries = catalog.getEntries();
+    StringVector contents;
+    std::vector<time_t> times;
+    std::vector<bool> complete;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        contents.push_back(entries[i].id);
+        times.push_back(entries[i].crashTime);
+        complete.push_back(catalog.isComplete(entries[i]));
+        if (!complete.back())
+            Debug::debug()->dbg("Not counting %s (%s)",
+                entries[i].id.c_str(), entries[i].status.c_str());
+    }
+    std::vector<bool> selected(contents.size(), false);
+    select_old_dumps(contents, times, complete, oldDumps, selected);
+
+    // size budget and room for the new dump
+    long long keepSize = config->KDUMP_KEEP_SIZE.value();
+    bool makeRoom = config->KDUMP_MAKE_ROOM.value();
+    if ((keepSize > 0 || makeRoom) && !contents.empty()) {
+        // only dumps that the catalog has not measured yet are scanned
+        StringVector unknown;
+        for (size_t i = 0; i < contents.size(); ++i)
+            if (catalog.find(contents[i])->size == DumpCatalog::UNKNOWN_SIZE)
+                unknown.push_back(contents[i]);
+        if (!unknown.empty()) {
+            DumpDirJob scan(DumpDirJob::SCAN, dir, unknown);
+            try {
+                scan.run();
+            } catch (const KError &error) {
+                cerr << "WARNING: " << error.what() << endl;
+            }
+            for (size_t i = 0; i < unknown.size(); ++i)
+                catalog.find(unknown[i])->size = scan.getSizes()[i];
+            changed = true;
+        }
+        std::vector<unsigned long long> sizes;
+        for (size_t i = 0; i < contents.size(); ++i)
+            sizes.push_back(catalog.find(contents[i])->size);
+
+        // the new dump will probably be as big as the recent complete
+        // ones
+        unsigned long long predicted = 0;
+        if (makeRoom) {
+            int n = 0;
+            for (size_t i = contents.size(); i-- > 0 && n < 3; )
+                if (complete[i]) {
+                    predicted = std::max(predicted, sizes[i]);
+                    ++n;
+                }
+            Debug::debug()->dbg("Predicted dump size: %llu bytes",
+                predicted);
+        }
+
+        unsigned long long kept = 0, freed = 0;
+        for (size_t i = 0; i < contents.size(); ++i)
+            if (selected[i])
+                freed += sizes[i];
+            else
+                kept += sizes[i];
+
+        unsigned long long avail = 0, needed = 0;
+        if (makeRoom) {
+            avail = dir.freeDiskSize();
+            needed = predicted + config->KDUMP_FREE_DISK_SIZE.value() * MB;
+        }
+
+        for (size_t i = 0; i < contents.size(); ++i) {
+            bool overBudget = keepSize > 0 &&
+                kept + predicted > (unsigned long long)keepSize * MB;
+            bool noRoom = makeRoom && avail + freed < needed;
+            if (!overBudget && !noRoom)
+                break;
+            if (selected[i])
+                continue;
+            Debug::debug()->dbg("Deleting %s to make room",
+                contents[i].c_str());
+            selected[i] = true;
+            kept -= sizes[i];
+            freed += sizes[i];
+        }
+    }
+
+    StringVector toDelete;
+    for (size_t i = 0; i < contents.size(); ++i)
+        if (selected[i]) {
+            Debug::debug()->info("Deleting %s.", contents[i].c_str());
+            toDelete.push_back(contents[i]);
+        }
+
+    if (m_dryRun)
+        return;
+
+    if (toDelete.empty())
         Debug::debug()->dbg("Nothing to delete.");
+    else {
+        DumpDirJob job(DumpDirJob::DELETE, dir, toDelete);
+        try {
+            job.run();
+        } catch (const KError &error) {
+            // some directories may be gone nevertheless
+            catalog.sync(false);
+            catalog.save();
+            throw;
+        }
+        for (StringVector::const_iterator it = toDelete.begin();
+                it != toDelete.end(); ++it)
+            catalog.remove(*it);
+        changed = true;
+    }
+
+    if (changed)
+        catalog.save();
+    catalog.unlock();
+
+    if (!toDelete.empty())
+        prune_kernel_cache(dir);
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::delete_remote(const RootDirURL &url, int oldDumps)
+    throw (KError)
+{
+    Configuration *config = Configuration::config();
+
+    if (config->KDUMP_KEEP_SIZE.value() > 0 || config->KDUMP_MAKE_ROOM.value())
+        Debug::debug()->info("KDUMP_KEEP_SIZE and KDUMP_MAKE_ROOM apply "
+            "only to local targets.");
+
+    // A dump server may keep the dumps of many hosts, so only the dumps
+    // of this host are considered (see SaveDump::dumpDirURL()).
+    Routable rt(url.getHostname());
+    if (!rt.check(config->KDUMP_NET_TIMEOUT.value())) {
+        cerr << "WARNING: Dump target not reachable; "
+             << "old dumps are not deleted." << endl;
         return;
-    } else
-        deleteItems = contents.size() - oldDumps;
+    }
+    string prefix = rt.prefsrc() + '-';
 
-    Debug::debug()->dbg("Deleting the oldest %d entries.", deleteItems);
+    auto_ptr<Transfer> transfer(
+        SaveDump::getTransfer(RootDirURLVector(1, url)));
+
+    // sorted by name, hence oldest first
+    StringVector names = transfer->listDirs();
+    StringVector contents;
+    std::vector<time_t> times;
+    for (StringVector::const_iterator it = names.begin();
+            it != names.end(); ++it) {
+        time_t t;
+        if (it->compare(0, prefix.size(), prefix) == 0 &&
+                DumpCatalog::parseTime(it->substr(prefix.size()), t)) {
+            contents.push_back(*it);
+            times.push_back(t);
+        }
+    }
+    Debug::debug()->dbg("%lu dumps of this host on %s",
+        (unsigned long)contents.size(), url.getURL().c_str());
+
+    std::vector<bool> selected(contents.size(), false);
+    select_old_dumps(contents, times,
+                     std::vector<bool>(contents.size(), true),
+                     oldDumps, selected);
 
     StringVector toDelete;
-    copy_n(contents.begin(), deleteItems, back_inserter(toDelete));
-
-    for (StringVector::const_iterator it = toDelete.begin();
-            it != toDelete.end(); ++it) {
-        Debug::debug()->info("Deleting %s.", (*it).c_str());
-        if (!m_dryRun) {
-            FilePath fp = dir;
-            fp.appendPath(*it);
-            fp.rmdir(true);
+    for (size_t i = 0; i < contents.size(); ++i)
+        if (selected[i]) {
+            Debug::debug()->info("Deleting %s.", contents[i].c_str());
+            toDelete.push_back(contents[i]);
         }
+
+    if (toDelete.empty() || m_dryRun)
+        return;
+    transfer->removeDirs(toDelete);
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::prune_kernel_cache(const FilePath &dir)
+    throw (KError)
+{
+    FilePath cache = dir;
+    cache.appendPath(KERNEL_CACHE_DIR);
+    if (!cache.exists())
+        return;
+
+    // Files that were cloned rather than hard-linked always have a link
+    // count of one, so they are removed, too. The next dump of the same
+    // kernel simply adds them again.
+    StringVector files = cache.listDir(FilterDots());
+    for (StringVector::const_iterator it = files.begin();
+            it != files.end(); ++it) {
+        FilePath fp = cache;
+        fp.appendPath(*it);
+
+        struct stat st;
+        if (lstat(fp.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+                st.st_nlink > 1)
+            continue;
+
+        Debug::debug()->info("Removing %s from the kernel cache.",
+            (*it).c_str());
+        if (unlink(fp.c_str()) != 0 && errno != ENOENT)
+            throw KSystemError("Cannot remove " + fp + ".", errno);
     }
 }
 
@@ -20,6 +20,7 @@
 #define DELETE_DUMP_H
 
 #include "subcommand.h"
+#include "fileutil.h"
 
 class Transfer;
 
@@ -69,6 +70,23 @@ class DeleteDumps : public Subcommand {
 	 */
 	void delete_one(const RootDirURL &url, int oldDumps)
 	throw (KError);
+
+	/**
+	 * Deletes old dumps of this host from a remote target.
+	 *
+	 * @throw KError on any error. No exception indicates success.
+	 */
+	void delete_remote(const RootDirURL &url, int oldDumps)
+	throw (KError);
+
+	/**
+	 * Removes files from the kernel cache of a local target that are
+	 * no longer linked from any dump directory.
+	 *
+	 * @throw KError on any error. No exception indicates success.
+	 */
+	void prune_kernel_cache(const FilePath &dir)
+	throw (KError);
 };
 
 //}}}
@@ -392,43 +392,127 @@ void FilePath::mkdir(bool recursive)
 }
 
 // -----------------------------------------------------------------------------
-void FilePath::rmdir(bool recursive)
+static DIR *opendir_at(int parentfd, const char *name)
     throw (KError)
 {
-    Debug::debug()->trace("FileUtil::rmdir(%s, %d)", c_str(), recursive);
+    int fd = openat(parentfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + string(name) + ".", errno);
+
+    DIR *dirptr = fdopendir(fd);
+    if (!dirptr) {
+        int err = errno;
+        close(fd);
+        throw KSystemError("Cannot opendir(" + string(name) + ").", err);
+    }
+    return dirptr;
+}
 
-    if (recursive) {
-        DIR *dirptr = opendir(c_str());
-        if (!dirptr)
-            throw KSystemError("Cannot opendir(" + *this + ").", errno);
+// -----------------------------------------------------------------------------
+static bool is_dir_at(int parentfd, const struct dirent *d)
+    throw ()
+{
+    if (d->d_type != DT_UNKNOWN)
+        return d->d_type == DT_DIR;
+
+    struct stat st;
+    return fstatat(parentfd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+        S_ISDIR(st.st_mode);
+}
+
+// -----------------------------------------------------------------------------
+static bool is_dot(const char *name)
+    throw ()
+{
+    return strcmp(name, ".") == 0 || strcmp(name, "..") == 0;
+}
+
+// -----------------------------------------------------------------------------
+// Removes a directory tree relative to an open directory, so that no
+// path names have to be built.
+static void rmtree_at(int parentfd, const char *name)
+    throw (KError)
+{
+    DIR *dirptr = opendir_at(parentfd, name);
+    int fd = dirfd(dirptr);
+    try {
         struct dirent *ptr;
-        try {
-            while ((ptr = readdir(dirptr)) != NULL) {
-                FilePath fn = *this;
-                if (strcmp(ptr->d_name, ".") == 0 ||
-                        strcmp(ptr->d_name, "..") == 0)
-                    continue;
-                if (ptr->d_type == DT_DIR)
-                    fn.appendPath(ptr->d_name).rmdir(true);
-                else {
-                    Debug::debug()->trace("Calling remove(%s)", ptr->d_name);
-                    int ret = ::remove(fn.appendPath(ptr->d_name).c_str());
-                    if (ret != 0)
-                        throw KSystemError("Cannot remove " +
-                            string(ptr->d_name) + ".", errno);
-                }
-            }
-        } catch (...) {
-            closedir(dirptr);
-            throw;
+        while ((ptr = readdir(dirptr)) != NULL) {
+            if (is_dot(ptr->d_name))
+                continue;
+            if (is_dir_at(fd, ptr))
+                rmtree_at(fd, ptr->d_name);
+            else if (unlinkat(fd, ptr->d_name, 0) != 0)
+                throw KSystemError("Cannot remove " +
+                    string(ptr->d_name) + ".", errno);
         }
+    } catch (...) {
         closedir(dirptr);
+        throw;
     }
+    closedir(dirptr);
+
+    if (unlinkat(parentfd, name, AT_REMOVEDIR) != 0)
+        throw KSystemError("Cannot rmdir(" + string(name) + ").", errno);
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long du_at(int parentfd, const char *name)
+    throw (KError)
+{
+    DIR *dirptr = opendir_at(parentfd, name);
+    int fd = dirfd(dirptr);
+    unsigned long long ret = 0;
+    try {
+        struct stat st;
+        if (fstat(fd, &st) == 0)
+            ret += (unsigned long long)st.st_blocks * 512;
+
+        struct dirent *ptr;
+        while ((ptr = readdir(dirptr)) != NULL) {
+            if (is_dot(ptr->d_name))
+                continue;
+            if (fstatat(fd, ptr->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                throw KSystemError("Cannot stat " +
+                    string(ptr->d_name) + ".", errno);
+            if (S_ISDIR(st.st_mode))
+                ret += du_at(fd, ptr->d_name);
+            else if (st.st_nlink == 1)
+                ret += (unsigned long long)st.st_blocks * 512;
+        }
+    } catch (...) {
+        closedir(dirptr);
+        throw;
+    }
+    closedir(dirptr);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void FilePath::rmdir(bool recursive)
+    throw (KError)
+{
+    Debug::debug()->trace("FileUtil::rmdir(%s, %d)", c_str(), recursive);
+
+    if (recursive) {
+        rmtree_at(AT_FDCWD, c_str());
+        return;
+    }
+
     int ret = ::rmdir(c_str());
     if (ret != 0)
         throw KSystemError("Cannot rmdir(" + *this + ").", errno);
 }
 
+// -----------------------------------------------------------------------------
+unsigned long long FilePath::diskUsage() const
+    throw (KError)
+{
+    Debug::debug()->trace("FilePath::diskUsage(%s)", c_str());
+
+    return du_at(AT_FDCWD, c_str());
+}
+
 //}}}
 
 //{{{ FilterDots ---------------------------------------------------------------
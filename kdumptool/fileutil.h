@@ -257,6 +257,17 @@ class FilePath : public KString {
         void rmdir(bool recursive)
         throw (KError);
 
+        /**
+         * Returns the disk space that would be freed by deleting the
+         * directory recursively, i.e. the space allocated for the
+         * directory and everything below it. Files that have more than
+         * one hard link are not counted.
+         *
+         * @exception KError if the directory cannot be read
+         */
+        unsigned long long diskUsage() const
+        throw (KError);
+
 };
 
 //}}}
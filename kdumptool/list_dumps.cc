@@ -0,0 +1,162 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "subcommand.h"
+#include "debug.h"
+#include "list_dumps.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "stringutil.h"
+#include "catalog.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::setw;
+
+// -----------------------------------------------------------------------------
+static string format_size(unsigned long long size)
+{
+    if (size == DumpCatalog::UNKNOWN_SIZE)
+        return "-";
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << double(size) / (1024 * 1024) << "M";
+    return ss.str();
+}
+
+//{{{ ListDumps ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+ListDumps::ListDumps()
+    throw ()
+    : m_rebuild(false)
+{
+    Debug::debug()->trace("ListDumps::ListDumps()");
+
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+    m_options.push_back(new FlagOption("rebuild", 'b', &m_rebuild,
+        "Rebuild the catalog from the dump directories"));
+}
+
+// -----------------------------------------------------------------------------
+const char *ListDumps::getName() const
+    throw ()
+{
+    return "list_dumps";
+}
+
+// -----------------------------------------------------------------------------
+void ListDumps::execute()
+    throw (KError)
+{
+    Debug::debug()->trace("ListDumps::execute()");
+    Debug::debug()->dbg("Using root dir %s, rebuild: %d",
+        m_rootdir.c_str(), m_rebuild);
+
+    Configuration *config = Configuration::config();
+
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    string elem;
+    bool first = true;
+    while (iss >> elem) {
+        RootDirURL url(elem, m_rootdir);
+        if (url.getProtocol() != URLParser::PROT_FILE) {
+            cerr << "Skipping " << url.getURL()
+                 << ": only local targets have a catalog." << endl;
+            continue;
+        }
+
+        if (first)
+            first = false;
+        else
+            cout << endl;
+        list_one(url.getRealPath());
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ListDumps::list_one(const FilePath &dir)
+    throw (KError)
+{
+    Debug::debug()->trace("ListDumps::list_one(%s)", dir.c_str());
+
+    cout << "Target: " << dir << endl;
+    if (!dir.exists()) {
+        cout << "No dumps." << endl;
+        return;
+    }
+
+    // normally a single read of the catalog
+    DumpCatalog catalog(dir);
+    if (m_rebuild || !catalog.load()) {
+        Debug::debug()->info("Building the catalog of %s.", dir.c_str());
+        catalog.lock();
+        if (!m_rebuild)
+            catalog.load();
+        catalog.sync(true);
+        catalog.save();
+        catalog.unlock();
+    }
+
+    const DumpCatalog::EntryVector &entries = catalog.getEntries();
+    if (entries.empty()) {
+        cout << "No dumps." << endl;
+        return;
+    }
+
+    cout << std::left
+         << setw(24) << "ID" << " "
+         << setw(16) << "CRASH TIME" << " "
+         << setw(24) << "KERNEL" << " "
+         << setw(16) << "HOST" << " "
+         << setw(10) << "FORMAT" << " "
+         << std::right << setw(5) << "LEVEL" << " "
+         << setw(10) << "SIZE" << " "
+         << std::left << "STATUS" << endl;
+    for (DumpCatalog::EntryVector::const_iterator it = entries.begin();
+            it != entries.end(); ++it) {
+        cout << std::left
+             << setw(24) << it->id << " "
+             << setw(16)
+             << Stringutil::formatUnixTime("%Y-%m-%d %H:%M", it->crashTime)
+             << " "
+             << setw(24) << (it->kernel.empty() ? "-" : it->kernel) << " "
+             << setw(16) << (it->host.empty() ? "-" : it->host) << " "
+             << setw(10) << (it->format.empty() ? "-" : it->format) << " "
+             << std::right << setw(5);
+        if (it->dumpLevel >= 0)
+            cout << it->dumpLevel;
+        else
+            cout << "-";
+        cout << " " << setw(10) << format_size(it->size) << " "
+             << std::left << it->status << endl;
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
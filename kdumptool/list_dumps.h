@@ -0,0 +1,75 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef LIST_DUMPS_H
+#define LIST_DUMPS_H
+
+#include "subcommand.h"
+#include "fileutil.h"
+
+//{{{ ListDumps ----------------------------------------------------------------
+
+/**
+ * Subcommand to list the dumps in the local targets. The list comes
+ * from the catalog of each target (see DumpCatalog), which is built
+ * first if it does not exist yet.
+ */
+class ListDumps : public Subcommand {
+
+    public:
+        /**
+         * Creates a new ListDumps object.
+         */
+        ListDumps()
+        throw ();
+
+    public:
+        /**
+         * Returns the name of the subcommand (list_dumps).
+         */
+        const char *getName() const
+        throw ();
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute()
+        throw (KError);
+
+    protected:
+        /**
+         * Lists the dumps of one target.
+         *
+         * @param[in] dir the directory of the target
+         * @exception KError if the catalog cannot be read or built
+         */
+        void list_one(const FilePath &dir)
+        throw (KError);
+
+    private:
+        std::string m_rootdir;
+        bool m_rebuild;
+};
+
+//}}}
+
+#endif /* LIST_DUMPS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -28,17 +28,22 @@
 #include "stringutil.h"
 
 // Subcommand initialization
+#include "analyze_vmcore.h"
+#include "bench_transfer.h"
 #include "deletedumps.h"
 #include "dumpconfig.h"
 #include "findkernel.h"
 #include "identifykernel.h"
 #include "ledblink.h"
+#include "list_dumps.h"
 #include "multipath.h"
 #include "print_target.h"
 #include "read_ikconfig.h"
 #include "read_vmcoreinfo.h"
+#include "recompress.h"
 #include "savedump.h"
 #include "calibrate.h"
+#include "upload_pending.h"
 
 using std::cerr;
 using std::cout;
@@ -52,17 +57,22 @@ int main(int argc, char *argv[])
     bool exception = false;
 
     try {
+        kdt.addSubcommand(new AnalyzeVmcore);
+        kdt.addSubcommand(new BenchTransfer);
         kdt.addSubcommand(new DeleteDumps);
         kdt.addSubcommand(new DumpConfig);
         kdt.addSubcommand(new FindKernel);
         kdt.addSubcommand(new IdentifyKernel);
         kdt.addSubcommand(new LedBlink);
+        kdt.addSubcommand(new ListDumps);
         kdt.addSubcommand(new Multipath);
         kdt.addSubcommand(new PrintTarget);
         kdt.addSubcommand(new ReadIKConfig);
         kdt.addSubcommand(new ReadVmcoreinfo);
+        kdt.addSubcommand(new Recompress);
         kdt.addSubcommand(new SaveDump);
         kdt.addSubcommand(new Calibrate);
+        kdt.addSubcommand(new UploadPending);
 
         kdt.parseCommandline(argc, argv);
         kdt.readConfiguration();
@@ -0,0 +1,508 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "global.h"
+#include "debug.h"
+#include "metrics.h"
+#include "stringutil.h"
+
+using std::string;
+using std::ostringstream;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+static double monotonic_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//{{{ TransferMetrics ----------------------------------------------------------
+
+TransferMetrics *TransferMetrics::m_instance = NULL;
+
+// -----------------------------------------------------------------------------
+TransferMetrics *TransferMetrics::metrics()
+    throw ()
+{
+    if (!m_instance)
+        m_instance = new TransferMetrics();
+    return m_instance;
+}
+
+// -----------------------------------------------------------------------------
+TransferMetrics::TransferMetrics()
+    throw ()
+    : m_totalRead(0), m_fileRead(0), m_expected(0), m_beginTime(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void TransferMetrics::begin(const string &file, unsigned long long expected)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    m_file = file;
+    m_fileRead = 0;
+    m_expected = expected;
+    m_beginTime = monotonic_now();
+    m_targets.clear();
+}
+
+// -----------------------------------------------------------------------------
+void TransferMetrics::addRead(unsigned long long bytes)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    m_totalRead += bytes;
+    m_fileRead += bytes;
+}
+
+// -----------------------------------------------------------------------------
+unsigned TransferMetrics::addTarget(const string &name)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    for (unsigned i = 0; i < m_targets.size(); ++i)
+        if (m_targets[i].name == name)
+            return i;
+
+    Target target;
+    target.name = name;
+    target.written = 0;
+    target.queued = 0;
+    target.watched = false;
+    m_targets.push_back(target);
+    return m_targets.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+void TransferMetrics::watchFile(const string &path)
+    throw ()
+{
+    unsigned id = addTarget(path);
+
+    MutexLocker locker(m_lock);
+    m_targets[id].watched = true;
+}
+
+// -----------------------------------------------------------------------------
+void TransferMetrics::addWritten(unsigned id, unsigned long long bytes)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    if (id < m_targets.size())
+        m_targets[id].written += bytes;
+}
+
+// -----------------------------------------------------------------------------
+void TransferMetrics::setQueued(unsigned id, unsigned long queued)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    if (id < m_targets.size())
+        m_targets[id].queued = queued;
+}
+
+// -----------------------------------------------------------------------------
+TransferMetrics::Sample TransferMetrics::sample() const
+    throw ()
+{
+    Sample ret;
+    std::vector<bool> watched;
+    {
+        MutexLocker locker(m_lock);
+
+        ret.file = m_file;
+        ret.totalRead = m_totalRead;
+        ret.progress = m_fileRead;
+        ret.expected = m_expected;
+        ret.elapsed = m_beginTime ? monotonic_now() - m_beginTime : 0.0;
+
+        std::vector<Target>::const_iterator it;
+        for (it = m_targets.begin(); it != m_targets.end(); ++it) {
+            TargetSample target;
+            target.name = it->name;
+            target.written = it->written;
+            target.queued = it->queued;
+            ret.targets.push_back(target);
+            watched.push_back(it->watched);
+        }
+    }
+
+    // stat() outside of the lock; the file may not exist yet
+    unsigned long long written = 0;
+    for (size_t i = 0; i < ret.targets.size(); ++i) {
+        TargetSample &target = ret.targets[i];
+        struct stat st;
+        if (watched[i] && stat(target.name.c_str(), &st) == 0)
+            target.written = st.st_size;
+        written += target.written;
+    }
+
+    // files written by another process: nothing has been read
+    if (!ret.progress)
+        ret.progress = written;
+
+    return ret;
+}
+
+//}}}
+//{{{ MetricsSink --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+MetricsSink::MetricsSink(const string &destination, const string &host,
+                         double interval)
+    throw (KError)
+    : m_host(host), m_interval(interval > 0 ? interval : 1), m_socket(-1),
+      m_stop(false), m_lastElapsed(0), m_lastProgress(0)
+{
+    string::size_type colon = destination.find(':');
+    if (colon == string::npos)
+        throw KError("Invalid metrics destination: " + destination);
+
+    string format = destination.substr(0, colon);
+    m_path = destination.substr(colon + 1);
+    if (m_path.empty())
+        throw KError("Invalid metrics destination: " + destination);
+
+    if (format == "prometheus")
+        m_format = FORMAT_PROMETHEUS;
+    else if (format == "json")
+        m_format = FORMAT_JSON;
+    else if (format == "udp")
+        m_format = FORMAT_UDP;
+    else
+        throw KError("Unknown metrics format: " + format);
+
+    if (m_format != FORMAT_UDP)
+        return;
+
+    // HOST:PORT, with IPv6 addresses in brackets
+    string::size_type portsep = m_path.rfind(':');
+    if (portsep == string::npos || portsep == 0)
+        throw KError("Missing port in metrics destination: " + destination);
+    string hostname = m_path.substr(0, portsep);
+    string port = m_path.substr(portsep + 1);
+    if (hostname.size() > 1 && hostname[0] == '[' &&
+        hostname[hostname.size() - 1] == ']')
+        hostname = hostname.substr(1, hostname.size() - 2);
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int err = getaddrinfo(hostname.c_str(), port.c_str(), &hints, &res);
+    if (err != 0)
+        throw KError("Cannot resolve " + hostname + ": " + gai_strerror(err));
+
+    m_socket = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (m_socket < 0 || connect(m_socket, res->ai_addr, res->ai_addrlen)) {
+        err = errno;
+        freeaddrinfo(res);
+        if (m_socket >= 0)
+            close(m_socket);
+        throw KSystemError("Cannot create the metrics socket.", err);
+    }
+    freeaddrinfo(res);
+}
+
+// -----------------------------------------------------------------------------
+MetricsSink::~MetricsSink()
+    throw ()
+{
+    try {
+        stop();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+    if (m_socket >= 0)
+        close(m_socket);
+}
+
+// -----------------------------------------------------------------------------
+void MetricsSink::stop()
+    throw (KError)
+{
+    {
+        MutexLocker locker(m_lock);
+        if (m_stop)
+            return;
+        m_stop = true;
+        m_cond.signal();
+    }
+
+    join();
+    emit(true);
+}
+
+// -----------------------------------------------------------------------------
+void MetricsSink::run()
+    throw (KError)
+{
+    MutexLocker locker(m_lock);
+
+    while (!m_stop) {
+        if (m_cond.timedWait(m_lock, m_interval) || m_stop)
+            continue;
+
+        // an unreachable collector must not stop the dump
+        try {
+            emit(false);
+        } catch (const KError &error) {
+            Debug::debug()->dbg("Exporting metrics: %s", error.what());
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void MetricsSink::emit(bool done)
+    throw (KError)
+{
+    TransferMetrics::Sample sample = TransferMetrics::metrics()->sample();
+
+    if (sample.file != m_lastFile || sample.elapsed < m_lastElapsed) {
+        m_lastFile = sample.file;
+        m_lastElapsed = 0;
+        m_lastProgress = 0;
+    }
+
+    Rates rates;
+    double interval = sample.elapsed - m_lastElapsed;
+    rates.current = interval > 0
+        ? (sample.progress - m_lastProgress) / interval
+        : 0.0;
+    rates.average = sample.elapsed > 0
+        ? sample.progress / sample.elapsed
+        : 0.0;
+    rates.eta = -1.0;
+    if (done || (sample.expected && sample.progress >= sample.expected))
+        rates.eta = 0.0;
+    else if (sample.expected && rates.average > 0)
+        rates.eta = (sample.expected - sample.progress) / rates.average;
+
+    m_lastElapsed = sample.elapsed;
+    m_lastProgress = sample.progress;
+
+    switch (m_format) {
+        case FORMAT_PROMETHEUS:
+            writeFile(formatPrometheus(sample, rates, done), false);
+            break;
+
+        case FORMAT_JSON:
+            writeFile(formatJSON(sample, rates, done) + "\n", true);
+            break;
+
+        case FORMAT_UDP: {
+            string data = formatJSON(sample, rates, done);
+            if (send(m_socket, data.c_str(), data.size(), 0) < 0)
+                throw KSystemError("Cannot send metrics.", errno);
+            break;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+string MetricsSink::formatJSON(const TransferMetrics::Sample &sample,
+                               const Rates &rates, bool done) const
+    throw ()
+{
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+
+    ss << "{\"time\": " << time(NULL)
+       << ", \"host\": " << Stringutil::quoteJSON(m_host)
+       << ", \"file\": " << Stringutil::quoteJSON(sample.file)
+       << ", \"done\": " << (done ? "true" : "false")
+       << ", \"read\": " << sample.totalRead
+       << ", \"progress\": " << sample.progress
+       << ", \"expected\": " << sample.expected
+       << ", \"rate\": " << rates.current
+       << ", \"average_rate\": " << rates.average
+       << ", \"eta\": ";
+    if (rates.eta < 0)
+        ss << "null";
+    else
+        ss << rates.eta;
+
+    ss << ", \"targets\": [";
+    std::vector<TransferMetrics::TargetSample>::const_iterator it;
+    for (it = sample.targets.begin(); it != sample.targets.end(); ++it) {
+        if (it != sample.targets.begin())
+            ss << ", ";
+        ss << "{\"name\": " << Stringutil::quoteJSON(it->name)
+           << ", \"written\": " << it->written
+           << ", \"queued\": " << it->queued << "}";
+    }
+    ss << "]}";
+
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static string prometheus_label(const string &value)
+{
+    string ret;
+    for (string::const_iterator it = value.begin(); it != value.end(); ++it) {
+        if (*it == '\\' || *it == '"')
+            ret += '\\';
+        if (*it == '\n')
+            ret += "\\n";
+        else
+            ret += *it;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static void prometheus_head(ostringstream &ss, const char *name,
+                            const char *type, const char *help)
+{
+    ss << "# HELP " << name << " " << help << endl;
+    ss << "# TYPE " << name << " " << type << endl;
+}
+
+// -----------------------------------------------------------------------------
+string MetricsSink::formatPrometheus(const TransferMetrics::Sample &sample,
+                                     const Rates &rates, bool done) const
+    throw ()
+{
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+
+    string host = "host=\"" + prometheus_label(m_host) + "\"";
+    string file = host + ",file=\"" + prometheus_label(sample.file) + "\"";
+
+    prometheus_head(ss, "kdump_save_done", "gauge",
+        "1 if kdumptool has finished saving the dump.");
+    ss << "kdump_save_done{" << host << "} " << (done ? 1 : 0) << endl;
+
+    prometheus_head(ss, "kdump_save_timestamp_seconds", "gauge",
+        "Time of the last update.");
+    ss << "kdump_save_timestamp_seconds{" << host << "} " << time(NULL)
+       << endl;
+
+    prometheus_head(ss, "kdump_save_read_bytes_total", "counter",
+        "Bytes read from all data sources.");
+    ss << "kdump_save_read_bytes_total{" << host << "} " << sample.totalRead
+       << endl;
+
+    prometheus_head(ss, "kdump_save_file_bytes", "gauge",
+        "Bytes of the current file saved so far.");
+    ss << "kdump_save_file_bytes{" << file << "} " << sample.progress << endl;
+
+    if (sample.expected) {
+        prometheus_head(ss, "kdump_save_file_expected_bytes", "gauge",
+            "Expected size of the current file.");
+        ss << "kdump_save_file_expected_bytes{" << file << "} "
+           << sample.expected << endl;
+    }
+
+    prometheus_head(ss, "kdump_save_rate_bytes_per_second", "gauge",
+        "Throughput since the last update.");
+    ss << "kdump_save_rate_bytes_per_second{" << file << "} "
+       << rates.current << endl;
+
+    prometheus_head(ss, "kdump_save_average_rate_bytes_per_second", "gauge",
+        "Average throughput of the current file.");
+    ss << "kdump_save_average_rate_bytes_per_second{" << file << "} "
+       << rates.average << endl;
+
+    if (rates.eta >= 0) {
+        prometheus_head(ss, "kdump_save_eta_seconds", "gauge",
+            "Estimated time until the current file is saved.");
+        ss << "kdump_save_eta_seconds{" << file << "} " << rates.eta << endl;
+    }
+
+    if (!sample.targets.empty()) {
+        std::vector<TransferMetrics::TargetSample>::const_iterator it;
+
+        prometheus_head(ss, "kdump_save_target_written_bytes", "gauge",
+            "Bytes of the current file written to a target.");
+        for (it = sample.targets.begin(); it != sample.targets.end(); ++it)
+            ss << "kdump_save_target_written_bytes{" << host
+               << ",target=\"" << prometheus_label(it->name) << "\"} "
+               << it->written << endl;
+
+        prometheus_head(ss, "kdump_save_target_queue_depth", "gauge",
+            "Blocks waiting to be written to a target.");
+        for (it = sample.targets.begin(); it != sample.targets.end(); ++it)
+            ss << "kdump_save_target_queue_depth{" << host
+               << ",target=\"" << prometheus_label(it->name) << "\"} "
+               << it->queued << endl;
+    }
+
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+void MetricsSink::writeFile(const string &data, bool append) const
+    throw (KError)
+{
+    // a textfile collector must never see a partial file
+    string path = append ? m_path : m_path + ".tmp";
+    int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + path + ".", errno);
+
+    const char *p = data.c_str();
+    size_t remaining = data.size();
+    while (remaining) {
+        ssize_t ret = write(fd, p, remaining);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            int err = errno;
+            close(fd);
+            throw KSystemError("Cannot write " + path + ".", err);
+        }
+        p += ret;
+        remaining -= ret;
+    }
+    if (close(fd) != 0)
+        throw KSystemError("Cannot write " + path + ".", errno);
+
+    if (!append && rename(path.c_str(), m_path.c_str()) != 0)
+        throw KSystemError("Cannot rename " + path + ".", errno);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
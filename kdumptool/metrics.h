@@ -0,0 +1,247 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "threads.h"
+
+//{{{ TransferMetrics ----------------------------------------------------------
+
+/**
+ * Counters of the running transfer, shared by the data providers, the
+ * transfer loops and MetricsSink.
+ *
+ * A transfer has a number of targets, e.g. the files written by
+ * FileTransfer or the children of CompositeTransfer. For each target,
+ * the bytes written and the number of blocks waiting in its queue are
+ * counted. Files that another process writes (e.g. makedumpfile) can
+ * be watched instead; their size counts as written.
+ *
+ * All methods are thread-safe.
+ */
+class TransferMetrics {
+
+    public:
+        /**
+         * Counters of one target.
+         */
+        struct TargetSample {
+            std::string name;
+            unsigned long long written;
+            unsigned long queued;
+        };
+
+        /**
+         * Snapshot of all counters.
+         */
+        struct Sample {
+            /** name of the file that is being saved */
+            std::string file;
+            /** bytes read from all data providers so far */
+            unsigned long long totalRead;
+            /** bytes of the current file read or written so far */
+            unsigned long long progress;
+            /** expected size of the current file (0 if unknown) */
+            unsigned long long expected;
+            /** seconds since the current file was started */
+            double elapsed;
+            std::vector<TargetSample> targets;
+        };
+
+        /**
+         * Returns the only instance.
+         */
+        static TransferMetrics *metrics()
+        throw ();
+
+        /**
+         * Starts a new file. The targets of the previous file are
+         * removed.
+         *
+         * @param[in] file name of the file
+         * @param[in] expected expected size of the file, or 0
+         */
+        void begin(const std::string &file, unsigned long long expected = 0)
+        throw ();
+
+        /**
+         * Counts bytes read from a data provider.
+         */
+        void addRead(unsigned long long bytes)
+        throw ();
+
+        /**
+         * Registers a target. A target that has been registered
+         * already keeps its counters.
+         *
+         * @param[in] name name of the target
+         * @return the id for addWritten() and setQueued()
+         */
+        unsigned addTarget(const std::string &name)
+        throw ();
+
+        /**
+         * Registers a file that is written by another process.
+         */
+        void watchFile(const std::string &path)
+        throw ();
+
+        /**
+         * Counts bytes written to a target.
+         */
+        void addWritten(unsigned id, unsigned long long bytes)
+        throw ();
+
+        /**
+         * Sets the number of blocks queued for a target.
+         */
+        void setQueued(unsigned id, unsigned long queued)
+        throw ();
+
+        /**
+         * Returns a snapshot of all counters. Watched files are
+         * checked with stat().
+         */
+        Sample sample() const
+        throw ();
+
+    private:
+        struct Target {
+            std::string name;
+            unsigned long long written;
+            unsigned long queued;
+            bool watched;
+        };
+
+        TransferMetrics()
+        throw ();
+
+        mutable Mutex m_lock;
+        std::string m_file;
+        unsigned long long m_totalRead;
+        unsigned long long m_fileRead;
+        unsigned long long m_expected;
+        double m_beginTime;
+        std::vector<Target> m_targets;
+
+        static TransferMetrics *m_instance;
+};
+
+//}}}
+//{{{ MetricsSink --------------------------------------------------------------
+
+/**
+ * Periodically exports TransferMetrics in a background thread.
+ *
+ * The destination is given as "format:where":
+ *
+ *   - prometheus:PATH  a Prometheus textfile, replaced atomically
+ *   - json:PATH        one JSON object per line, appended to PATH
+ *   - udp:HOST:PORT    one JSON object per UDP datagram
+ */
+class MetricsSink : public Thread {
+
+    public:
+        /**
+         * Creates a new sink. Call start() to start exporting.
+         *
+         * @param[in] destination see above
+         * @param[in] host host name for the exported data
+         * @param[in] interval seconds between two exports
+         * @exception KError if @p destination is invalid or the UDP
+         *            socket cannot be created
+         */
+        MetricsSink(const std::string &destination, const std::string &host,
+                    double interval)
+        throw (KError);
+
+        /**
+         * Stops the thread (see stop()) and closes the socket.
+         */
+        ~MetricsSink()
+        throw ();
+
+        /**
+         * Exports the final state (marked as done) and stops the
+         * thread.
+         *
+         * @exception KError if the last export failed
+         */
+        void stop()
+        throw (KError);
+
+    protected:
+        void run()
+        throw (KError);
+
+    private:
+        enum Format {
+            FORMAT_PROMETHEUS,
+            FORMAT_JSON,
+            FORMAT_UDP
+        };
+
+        struct Rates {
+            double current;
+            double average;
+            double eta;         // < 0: unknown
+        };
+
+        void emit(bool done)
+        throw (KError);
+
+        std::string formatJSON(const TransferMetrics::Sample &sample,
+                               const Rates &rates, bool done) const
+        throw ();
+
+        std::string formatPrometheus(const TransferMetrics::Sample &sample,
+                                     const Rates &rates, bool done) const
+        throw ();
+
+        void writeFile(const std::string &data, bool append) const
+        throw (KError);
+
+        Format m_format;
+        std::string m_path;
+        std::string m_host;
+        double m_interval;
+        int m_socket;
+
+        Mutex m_lock;
+        Condition m_cond;
+        bool m_stop;
+
+        std::string m_lastFile;
+        double m_lastElapsed;
+        unsigned long long m_lastProgress;
+
+        // non-copyable
+        MetricsSink(const MetricsSink &);
+        MetricsSink &operator=(const MetricsSink &);
+};
+
+//}}}
+
+#endif /* METRICS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
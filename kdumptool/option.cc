@@ -93,6 +93,35 @@ void StringOption::setValue(const char *arg)
     m_value->assign(arg);
 }
 
+//}}}
+//{{{ StringListOption ---------------------------------------------------------
+
+/* -------------------------------------------------------------------------- */
+StringListOption::StringListOption(const string &name, char letter,
+                                   std::vector<string> *value,
+                                   const string &description)
+    : Option(name, letter, description), m_value(value)
+{}
+
+/* -------------------------------------------------------------------------- */
+string StringListOption::getoptArgs(struct option *opt)
+{
+    opt->name = getLongName().c_str();
+    opt->has_arg = 1;
+    opt->flag = 0;
+    opt->val = getLetter();
+
+    char optstring[] = { getLetter(), ':', 0 };
+    return string(optstring);
+}
+
+/* -------------------------------------------------------------------------- */
+void StringListOption::setValue(const char *arg)
+{
+    m_isSet = true;
+    m_value->push_back(arg);
+}
+
 //}}}
 //{{{ IntOption ----------------------------------------------------------------
 
@@ -100,7 +129,7 @@ void StringOption::setValue(const char *arg)
 IntOption::IntOption(const string &name, char letter,
                      int *value,
                      const string &description)
-    : Option(name, letter, description)
+    : Option(name, letter, description), m_value(value)
 {}
 
 /* -------------------------------------------------------------------------- */
@@ -21,6 +21,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 //{{{ Option -------------------------------------------------------------------
 
@@ -144,6 +145,36 @@ class StringOption : public Option {
         std::string *m_value;
 };
 
+//}}}
+//{{{ StringListOption ---------------------------------------------------------
+
+/**
+ * Option which takes a string as argument and may be given more than
+ * once. Each value is appended to the list.
+ */
+class StringListOption : public Option {
+    public:
+        StringListOption(const std::string &name, char letter,
+                         std::vector<std::string> *value,
+                         const std::string &description = "");
+
+        virtual const char *getPlaceholder(void) const
+            throw ()
+            { return "<STRING>"; }
+
+        virtual std::string getoptArgs(struct option *opt);
+
+        /**
+         * Append a value.
+         *
+         * @param[in] arg option value as a C-style string
+         */
+        virtual void setValue(const char *arg);
+
+    private:
+        std::vector<std::string> *m_value;
+};
+
 //}}}
 //{{{ IntOption ----------------------------------------------------------------
 
@@ -0,0 +1,226 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <exception>
+#include <ctime>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "global.h"
+#include "phasereport.h"
+#include "stringutil.h"
+
+using std::string;
+using std::ostringstream;
+using std::ifstream;
+using std::endl;
+using std::setw;
+
+//{{{ ProcessUsage -------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static double timeval_seconds(const struct timeval &tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// -----------------------------------------------------------------------------
+void ProcessUsage::sample()
+    throw ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    wall = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    user = timeval_seconds(ru.ru_utime);
+    system = timeval_seconds(ru.ru_stime);
+    maxrss = ru.ru_maxrss;
+
+    getrusage(RUSAGE_CHILDREN, &ru);
+    childUser = timeval_seconds(ru.ru_utime);
+    childSystem = timeval_seconds(ru.ru_stime);
+
+    // system call counters of the whole thread group
+    readCalls = writeCalls = 0;
+    ifstream fin("/proc/self/io");
+    string key;
+    unsigned long long value;
+    while (fin >> key >> value) {
+        if (key == "syscr:")
+            readCalls = value;
+        else if (key == "syscw:")
+            writeCalls = value;
+    }
+}
+
+//}}}
+//{{{ PhaseReport --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+static void set_difference(PhaseReport::Phase &phase,
+                           const ProcessUsage &start, const ProcessUsage &end)
+{
+    phase.wall = end.wall - start.wall;
+    phase.user = end.user - start.user;
+    phase.system = end.system - start.system;
+    phase.childUser = end.childUser - start.childUser;
+    phase.childSystem = end.childSystem - start.childSystem;
+}
+
+// -----------------------------------------------------------------------------
+PhaseReport::PhaseReport()
+    throw ()
+    : m_running(false)
+{
+}
+
+// -----------------------------------------------------------------------------
+void PhaseReport::begin(const string &name)
+    throw ()
+{
+    end();
+
+    m_start.sample();
+    if (m_phases.empty())
+        m_first = m_start;
+
+    m_current.name = name;
+    m_current.ok = true;
+    m_current.bytes = 0;
+    m_running = true;
+}
+
+// -----------------------------------------------------------------------------
+void PhaseReport::end(bool ok)
+    throw ()
+{
+    if (!m_running)
+        return;
+
+    m_last.sample();
+    set_difference(m_current, m_start, m_last);
+    m_current.ok = ok;
+    m_phases.push_back(m_current);
+    m_running = false;
+}
+
+// -----------------------------------------------------------------------------
+void PhaseReport::addBytes(unsigned long long bytes)
+    throw ()
+{
+    if (m_running)
+        m_current.bytes += bytes;
+}
+
+// -----------------------------------------------------------------------------
+PhaseReport::Phase PhaseReport::getTotal() const
+    throw ()
+{
+    Phase total;
+    total.name = "total";
+    total.ok = true;
+    total.bytes = 0;
+    total.wall = total.user = total.system = 0.0;
+    total.childUser = total.childSystem = 0.0;
+    if (m_phases.empty())
+        return total;
+
+    set_difference(total, m_first, m_last);
+    PhaseVector::const_iterator it;
+    for (it = m_phases.begin(); it != m_phases.end(); ++it) {
+        total.ok = total.ok && it->ok;
+        total.bytes += it->bytes;
+    }
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+static void phase_json(ostringstream &ss, const PhaseReport::Phase &phase)
+{
+    ss << "{\"name\": " << Stringutil::quoteJSON(phase.name)
+       << ", \"ok\": " << (phase.ok ? "true" : "false")
+       << ", \"wall\": " << phase.wall
+       << ", \"user\": " << phase.user
+       << ", \"system\": " << phase.system
+       << ", \"children_user\": " << phase.childUser
+       << ", \"children_system\": " << phase.childSystem
+       << ", \"bytes\": " << phase.bytes << "}";
+}
+
+// -----------------------------------------------------------------------------
+string PhaseReport::toJSON(const string &indent) const
+    throw ()
+{
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+
+    ss << "[";
+    PhaseVector::const_iterator it;
+    for (it = m_phases.begin(); it != m_phases.end(); ++it) {
+        ss << (it == m_phases.begin() ? "\n" : ",\n") << indent << " ";
+        phase_json(ss, *it);
+    }
+    ss << "\n" << indent << "]";
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static void phase_line(ostringstream &ss, const PhaseReport::Phase &phase)
+{
+    ss << std::left << setw(16) << phase.name << std::right
+       << setw(10) << phase.wall
+       << setw(10) << phase.user + phase.system
+       << setw(10) << phase.childUser + phase.childSystem
+       << setw(10) << phase.bytes / 1048576.0
+       << (phase.ok ? "" : "  failed") << endl;
+}
+
+// -----------------------------------------------------------------------------
+string PhaseReport::summary() const
+    throw ()
+{
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+
+    ss << "Phase             Time (s)   CPU (s) Child (s)       MiB" << endl;
+    PhaseVector::const_iterator it;
+    for (it = m_phases.begin(); it != m_phases.end(); ++it)
+        phase_line(ss, *it);
+    phase_line(ss, getTotal());
+    return ss.str();
+}
+
+//}}}
+//{{{ PhaseScope ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+PhaseScope::~PhaseScope()
+    throw ()
+{
+    m_report.end(!std::uncaught_exception());
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,172 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef PHASEREPORT_H
+#define PHASEREPORT_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+
+//{{{ ProcessUsage -------------------------------------------------------------
+
+/**
+ * Snapshot of the resources used by this process.
+ */
+struct ProcessUsage {
+    /** monotonic clock in seconds */
+    double wall;
+    /** user and system CPU time of this process */
+    double user;
+    double system;
+    /** user and system CPU time of waited-for child processes */
+    double childUser;
+    double childSystem;
+    /** peak resident set size in KiB */
+    long maxrss;
+    /** system call counters of the whole thread group */
+    unsigned long long readCalls;
+    unsigned long long writeCalls;
+
+    void sample()
+    throw ();
+};
+
+//}}}
+//{{{ PhaseReport --------------------------------------------------------------
+
+/**
+ * Collects the wall-clock time, the CPU time and the number of bytes
+ * saved for each phase of a run, e.g. of save_dump.
+ *
+ * Phases do not nest; starting a phase ends the running one.
+ */
+class PhaseReport {
+
+    public:
+
+        /**
+         * Measurements of one phase.
+         */
+        struct Phase {
+            std::string name;
+            bool ok;
+            double wall;
+            double user;
+            double system;
+            double childUser;
+            double childSystem;
+            unsigned long long bytes;
+        };
+
+        typedef std::vector<Phase> PhaseVector;
+
+        PhaseReport()
+        throw ();
+
+        /**
+         * Starts a phase.
+         *
+         * @param[in] name the name of the phase
+         */
+        void begin(const std::string &name)
+        throw ();
+
+        /**
+         * Ends the running phase (if any).
+         *
+         * @param[in] ok @c false if the phase failed
+         */
+        void end(bool ok = true)
+        throw ();
+
+        /**
+         * Adds to the byte counter of the running phase.
+         */
+        void addBytes(unsigned long long bytes)
+        throw ();
+
+        /**
+         * Returns the finished phases in the order they were started.
+         */
+        const PhaseVector &getPhases() const
+        throw ()
+        { return m_phases; }
+
+        /**
+         * Returns the totals from the first begin() to the last end().
+         * The name of the returned phase is "total".
+         */
+        Phase getTotal() const
+        throw ();
+
+        /**
+         * Formats the phases as a JSON array.
+         *
+         * @param[in] indent prefix of each line
+         */
+        std::string toJSON(const std::string &indent = "") const
+        throw ();
+
+        /**
+         * Formats the phases as a table for the log.
+         */
+        std::string summary() const
+        throw ();
+
+    private:
+        PhaseVector m_phases;
+        Phase m_current;
+        bool m_running;
+        ProcessUsage m_first;
+        ProcessUsage m_start;
+        ProcessUsage m_last;
+};
+
+//}}}
+//{{{ PhaseScope ---------------------------------------------------------------
+
+/**
+ * Times a phase for the lifetime of the object. The phase is recorded
+ * as failed if the scope is left by an exception.
+ */
+class PhaseScope {
+
+    public:
+        PhaseScope(PhaseReport &report, const std::string &name)
+        throw ()
+            : m_report(report)
+        { m_report.begin(name); }
+
+        ~PhaseScope()
+        throw ();
+
+    private:
+        PhaseReport &m_report;
+
+        // non-copyable
+        PhaseScope(const PhaseScope &);
+        PhaseScope &operator=(const PhaseScope &);
+};
+
+//}}}
+
+#endif /* PHASEREPORT_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
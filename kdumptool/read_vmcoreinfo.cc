@@ -39,21 +39,71 @@
 #include "read_vmcoreinfo.h"
 #include "vmcoreinfo.h"
 #include "util.h"
+#include "stringutil.h"
+#include "calibrate.h"
+#include "threads.h"
 
 using std::string;
 using std::cout;
 using std::cerr;
 using std::endl;
 
-//{{{ ReadVmcoreinfo -----------------------------------------------------------------
+//{{{ ReadVmcoreinfo::Worker ---------------------------------------------------
+
+/**
+ * Reads dumps from a shared list until the list is exhausted.
+ */
+class ReadVmcoreinfo::Worker : public Thread {
+
+    public:
+        Worker(const ReadVmcoreinfo &owner, ResultVector &results,
+               Mutex &lock, size_t &next)
+        throw ()
+            : m_owner(owner), m_results(results), m_lock(lock), m_next(next)
+        {}
+
+        ~Worker()
+        throw ()
+        { joinQuietly(); }
+
+    protected:
+        void run()
+        throw (KError)
+        {
+            for (;;) {
+                size_t idx;
+                {
+                    MutexLocker locker(m_lock);
+                    idx = m_next++;
+                }
+                if (idx >= m_results.size())
+                    break;
+                m_owner.readDump(m_owner.m_dumps[idx], m_results[idx]);
+            }
+        }
+
+    private:
+        const ReadVmcoreinfo &m_owner;
+        ResultVector &m_results;
+        Mutex &m_lock;
+        size_t &m_next;
+};
+
+//}}}
+//{{{ ReadVmcoreinfo -----------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 ReadVmcoreinfo::ReadVmcoreinfo()
     throw ()
-    : m_file(DEFAULT_DUMP)
+    : m_jobs(0)
 {
-    m_options.push_back(new StringOption("dump", 'u', &m_file,
-        "Use the specified dump instead of " DEFAULT_DUMP));
+    m_options.push_back(new StringListOption("dump", 'u', &m_dumps,
+        "Use the specified dump instead of " DEFAULT_DUMP
+        " (may be given more than once)"));
+    m_options.push_back(new StringOption("format", 'f', &m_format,
+        "Output format: text (default), tsv or json"));
+    m_options.push_back(new IntOption("jobs", 'j', &m_jobs,
+        "Number of dumps read in parallel (default: online CPUs)"));
 }
 
 // -----------------------------------------------------------------------------
@@ -63,40 +113,228 @@ const char *ReadVmcoreinfo::getName() const
     return "read_vmcoreinfo";
 }
 
+// -----------------------------------------------------------------------------
+bool ReadVmcoreinfo::needsConfigfile() const
+    throw ()
+{
+    return false;
+}
+
 // -----------------------------------------------------------------------------
 void ReadVmcoreinfo::parseArgs(const StringVector &args)
     throw (KError)
 {
     Debug::debug()->trace(__FUNCTION__);
 
-    if (args.size() == 1)
-        m_option = args[0];
+    m_keys = args;
+    if (m_dumps.empty())
+        m_dumps.push_back(DEFAULT_DUMP);
+    if (m_format.empty())
+        m_format = "text";
+    if (m_format != "text" && m_format != "tsv" && m_format != "json")
+        throw KError("Invalid output format: " + m_format + ".");
 
-    Debug::debug()->dbg("file=%s, option=%s", m_file.c_str(), m_option.c_str());
+    Debug::debug()->dbg("dumps=%s, keys=%s, format=%s",
+        Stringutil::join(m_dumps, ' ').c_str(),
+        Stringutil::join(m_keys, ' ').c_str(), m_format.c_str());
 }
 
 // -----------------------------------------------------------------------------
 void ReadVmcoreinfo::execute()
     throw (KError)
 {
-    Vmcoreinfo vm;
-    vm.readFromELF(m_file.c_str());
+    ResultVector results(m_dumps.size());
+
+    unsigned long jobs = m_jobs > 0 ? m_jobs : SystemCPU().numOnline();
+    if (jobs > m_dumps.size())
+        jobs = m_dumps.size();
 
-    if (vm.isXenVmcoreinfo()) {
-        cerr << "VMCOREINFO_XEN:" << endl;
+    if (jobs <= 1) {
+        for (size_t i = 0; i < m_dumps.size(); ++i)
+            readDump(m_dumps[i], results[i]);
     } else {
-        cerr << "VMCOREINFO:" << endl;
+        Debug::debug()->dbg("Reading %zu dumps with %lu threads",
+            m_dumps.size(), jobs);
+
+        Mutex lock;
+        size_t next = 0;
+        std::vector<Worker *> workers;
+        try {
+            for (unsigned long i = 0; i < jobs; ++i) {
+                workers.push_back(new Worker(*this, results, lock, next));
+                workers.back()->start();
+            }
+        } catch (...) {
+            // the destructor joins the threads that have been started
+            for (size_t i = 0; i < workers.size(); ++i)
+                delete workers[i];
+            throw;
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->join();
+            delete workers[i];
+        }
     }
 
-    if (m_option.size() > 0) {
-        Debug::debug()->dbg("Printing value of %s", m_option.c_str());
-        cout << vm.getStringValue(m_option.c_str()) << endl;
-    } else {
-        StringList keys = vm.getKeys();
-        for (StringList::const_iterator it = keys.begin();
-                it != keys.end(); ++it)
-            cout << *it << "=" << vm.getStringValue((*it).c_str()) << endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (!results[i].ok) {
+            cerr << m_dumps[i] << ": " << results[i].error << endl;
+            setErrorCode(1);
+        }
+    }
+
+    if (m_format == "tsv")
+        printTSV(results);
+    else if (m_format == "json")
+        printJSON(results);
+    else
+        printText(results);
+}
+
+// -----------------------------------------------------------------------------
+void ReadVmcoreinfo::readDump(const string &dump, Result &result) const
+    throw ()
+{
+    result.ok = false;
+    result.xen = false;
+
+    try {
+        Vmcoreinfo vm;
+        vm.readFromELF(dump.c_str());
+        result.xen = vm.isXenVmcoreinfo();
+
+        if (m_keys.empty()) {
+            StringList keys = vm.getKeys();
+            result.keys.assign(keys.begin(), keys.end());
+        } else
+            result.keys = m_keys;
+
+        for (StringVector::const_iterator it = result.keys.begin();
+                it != result.keys.end(); ++it) {
+            string value;
+            bool found = true;
+            try {
+                value = vm.getStringValue(it->c_str());
+            } catch (const KError &) {
+                found = false;
+            }
+            result.values.push_back(value);
+            result.found.push_back(found);
+        }
+        result.ok = true;
+    } catch (const KError &error) {
+        result.error = error.what();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ReadVmcoreinfo::printText(const ResultVector &results)
+    throw (KError)
+{
+    // one dump and one key: print just the value
+    if (results.size() == 1 && m_keys.size() == 1) {
+        const Result &result = results[0];
+        if (!result.ok)
+            return;
+
+        cerr << (result.xen ? "VMCOREINFO_XEN:" : "VMCOREINFO:") << endl;
+        if (!result.found[0])
+            throw KError("Vmcoreinfo: key " + m_keys[0] + " not found.");
+        cout << result.values[0] << endl;
+        return;
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        if (!result.ok)
+            continue;
+
+        string prefix;
+        if (results.size() > 1)
+            prefix = m_dumps[i] + ": ";
+        else
+            cerr << (result.xen ? "VMCOREINFO_XEN:" : "VMCOREINFO:") << endl;
+
+        for (size_t k = 0; k < result.keys.size(); ++k) {
+            if (result.found[k])
+                cout << prefix << result.keys[k] << "="
+                     << result.values[k] << endl;
+            else {
+                cerr << m_dumps[i] << ": key " << result.keys[k]
+                     << " not found." << endl;
+                setErrorCode(1);
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Escapes tabs, newlines and backslashes in a TSV field.
+ */
+static string escapeTSV(const string &field)
+{
+    string ret;
+    for (string::const_iterator it = field.begin(); it != field.end(); ++it) {
+        switch (*it) {
+            case '\t': ret += "\\t"; break;
+            case '\n': ret += "\\n"; break;
+            case '\r': ret += "\\r"; break;
+            case '\\': ret += "\\\\"; break;
+            default:   ret += *it;
+        }
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void ReadVmcoreinfo::printTSV(const ResultVector &results)
+    throw ()
+{
+    cout << "dump\tkey\tvalue" << endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        if (!result.ok)
+            continue;
+
+        string dump = escapeTSV(m_dumps[i]);
+        for (size_t k = 0; k < result.keys.size(); ++k)
+            if (result.found[k])
+                cout << dump << '\t' << escapeTSV(result.keys[k]) << '\t'
+                     << escapeTSV(result.values[k]) << '\n';
+    }
+    cout.flush();
+}
+
+// -----------------------------------------------------------------------------
+void ReadVmcoreinfo::printJSON(const ResultVector &results)
+    throw ()
+{
+    cout << "[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+
+        cout << (i ? ",\n " : "\n ") << "{\"dump\": "
+             << Stringutil::quoteJSON(m_dumps[i]);
+        if (!result.ok) {
+            cout << ", \"error\": " << Stringutil::quoteJSON(result.error)
+                 << "}";
+            continue;
+        }
+
+        cout << ", \"xen\": " << (result.xen ? "true" : "false")
+             << ", \"vmcoreinfo\": {";
+        for (size_t k = 0; k < result.keys.size(); ++k) {
+            cout << (k ? ", " : "") << Stringutil::quoteJSON(result.keys[k])
+                 << ": ";
+            if (result.found[k])
+                cout << Stringutil::quoteJSON(result.values[k]);
+            else
+                cout << "null";
+        }
+        cout << "}}";
     }
+    cout << "\n]" << endl;
 }
 
 //}}}
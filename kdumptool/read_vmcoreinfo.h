@@ -19,12 +19,19 @@
 #ifndef READ_VMCOREINFO_H
 #define READ_VMCOREINFO_H
 
+#include <string>
+#include <vector>
+
 #include "subcommand.h"
 
 //{{{ ReadVmcoreinfo -----------------------------------------------------------
 
 /**
  * Subcommand to read the Vmcoreinfo.
+ *
+ * Several dumps can be given, in which case they are read in parallel
+ * by a pool of worker threads. Only the ELF headers and notes of each
+ * dump are read.
  */
 class ReadVmcoreinfo : public Subcommand {
 
@@ -37,11 +44,17 @@ class ReadVmcoreinfo : public Subcommand {
 
     public:
         /**
-         * Returns the name of the subcommand (identify_kernel).
+         * Returns the name of the subcommand (read_vmcoreinfo).
          */
         const char *getName() const
         throw ();
 
+        /**
+         * The configuration file is not used.
+         */
+        bool needsConfigfile() const
+        throw ();
+
         /**
          * Parses the non-option arguments from the command line.
          */
@@ -57,8 +70,37 @@ class ReadVmcoreinfo : public Subcommand {
         throw (KError);
 
     private:
-        std::string m_file;
-        std::string m_option;
+        /**
+         * VMCOREINFO of one dump.
+         */
+        struct Result {
+            bool ok;
+            std::string error;
+            bool xen;
+            StringVector keys;
+            StringVector values;
+            std::vector<bool> found;
+        };
+        typedef std::vector<Result> ResultVector;
+
+        class Worker;
+
+        StringVector m_dumps;
+        StringVector m_keys;
+        std::string m_format;
+        int m_jobs;
+
+        void readDump(const std::string &dump, Result &result) const
+        throw ();
+
+        void printText(const ResultVector &results)
+        throw (KError);
+
+        void printTSV(const ResultVector &results)
+        throw ();
+
+        void printJSON(const ResultVector &results)
+        throw ();
 };
 
 //}}}
@@ -0,0 +1,448 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "subcommand.h"
+#include "debug.h"
+#include "recompress.h"
+#include "configuration.h"
+#include "rootdirurl.h"
+#include "process.h"
+#include "savedump.h"
+#include "stringutil.h"
+#include "calibrate.h"
+#include "catalog.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::ofstream;
+using std::ostringstream;
+
+// signatures at the start of the dump file
+#define ELF_MAGIC           "\177ELF"
+#define KDUMP_SIGNATURE     "KDUMP   "
+#define FLATTENED_SIGNATURE "makedumpfile"
+
+#define README_FLATTENED    "This dump was saved in makedumpfile flattened format."
+
+// -----------------------------------------------------------------------------
+static const char *format_option(const string &format)
+{
+    if (strcasecmp(format.c_str(), "compressed") == 0)
+        return "-c";
+    if (strcasecmp(format.c_str(), "lzo") == 0)
+        return "-l";
+    if (strcasecmp(format.c_str(), "snappy") == 0)
+        return "-p";
+    if (strcasecmp(format.c_str(), "zstd") == 0)
+        return "-z";
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+static string read_file(const string &path)
+{
+    ifstream fin(path.c_str(), std::ios::binary);
+    ostringstream ss;
+    ss << fin.rdbuf();
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+static void sync_path(const string &path)
+    throw (KError)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + path + ".", errno);
+    int err = fsync(fd) ? errno : 0;
+    close(fd);
+    if (err)
+        throw KSystemError("Cannot sync " + path + ".", err);
+}
+
+//{{{ Recompress ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Recompress::Recompress()
+    throw ()
+    : m_jobs(0), m_dumplevel(0), m_dryRun(false), m_unflattened(false)
+{
+    Debug::debug()->trace("Recompress::Recompress()");
+
+    m_options.push_back(new StringOption("format", 'f', &m_format,
+        "Target format: compressed, lzo, snappy or zstd "
+        "(default: KDUMP_RECOMPRESS)"));
+    m_options.push_back(new IntOption("jobs", 'j', &m_jobs,
+        "Number of CPUs (default: online CPUs)"));
+    m_options.push_back(new IntOption("dumplevel", 'd', &m_dumplevel,
+        "Exclude more pages with this dump level (default: 0)"));
+    m_options.push_back(new FlagOption("dry-run", 'y', &m_dryRun,
+        "Don't recompress, just print out what to recompress"));
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Recompress::getName() const
+    throw ()
+{
+    return "recompress";
+}
+
+// -----------------------------------------------------------------------------
+void Recompress::parseArgs(const StringVector &args)
+    throw (KError)
+{
+    Debug::debug()->trace(__FUNCTION__);
+
+    m_dirs = args;
+
+    if (m_dumplevel < 0 || m_dumplevel > 31)
+        throw KError("The dump level must be between 0 and 31.");
+}
+
+// -----------------------------------------------------------------------------
+void Recompress::execute()
+    throw (KError)
+{
+    Debug::debug()->trace("Recompress::execute()");
+
+    Configuration *config = Configuration::config();
+
+    if (m_format.empty())
+        m_format = config->KDUMP_RECOMPRESS.value();
+    if (m_format.empty()) {
+        cerr << "KDUMP_RECOMPRESS is not set." << endl;
+        return;
+    }
+    if (!format_option(m_format))
+        throw KError("Invalid format: " + m_format + ".");
+    std::transform(m_format.begin(), m_format.end(), m_format.begin(),
+                   ::tolower);
+
+    // by default, all dumps in the local targets
+    StringVector dirs = m_dirs;
+    if (dirs.empty()) {
+        std::istringstream iss(config->KDUMP_SAVEDIR.value());
+        string elem;
+        while (iss >> elem) {
+            RootDirURL url(elem, m_rootdir);
+            if (url.getProtocol() != URLParser::PROT_FILE)
+                continue;
+
+            FilePath dir = url.getRealPath();
+            if (!dir.exists())
+                continue;
+            StringVector contents = dir.listDir(FilterKdumpDirs());
+            for (StringVector::const_iterator it = contents.begin();
+                 it != contents.end(); ++it) {
+                FilePath dump = dir;
+                dirs.push_back(dump.appendPath(*it));
+            }
+        }
+    }
+
+    for (StringVector::const_iterator it = dirs.begin();
+         it != dirs.end(); ++it) {
+        try {
+            recompress_dir(*it);
+        } catch (const KError &error) {
+            cerr << "Recompressing " << *it << " failed: " << error.what()
+                 << endl;
+            setErrorCode(1);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void Recompress::recompress_dir(const FilePath &dir)
+    throw (KError)
+{
+    Debug::debug()->trace("Recompress::recompress_dir(%s)", dir.c_str());
+
+    FilePath part = dir;
+    if (part.appendPath("vmcore1").exists()) {
+        cout << dir << ": split dumps cannot be recompressed." << endl;
+        return;
+    }
+
+    // the format that save_dump has recorded
+    FilePath readme = dir;
+    readme.appendPath(README_FILE);
+    string info = readme.exists() ? read_file(readme) : string();
+    string::size_type pos = info.find(README_FORMAT);
+    m_oldFormat.clear();
+    if (pos != string::npos) {
+        pos += strlen(README_FORMAT);
+        m_oldFormat = info.substr(pos, info.find('\n', pos) - pos);
+    }
+    m_unflattened = false;
+
+    bool changed = false;
+    const char *names[] = { "vmcore", FIRST_STAGE_FILE };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        FilePath path = dir;
+        if (path.appendPath(names[i]).exists() &&
+            recompress_one(dir, names[i]))
+            changed = true;
+    }
+    if (!changed || info.empty())
+        return;
+
+    FilePath tmp = readme;
+    tmp += ".tmp";
+    {
+        ofstream fout(tmp.c_str(), std::ios::binary);
+        fout << updateReadme(info, m_format, m_oldFormat, m_dumplevel,
+                             m_unflattened, time(NULL));
+        fout.close();
+        if (!fout)
+            throw KError("Cannot write " + tmp + ".");
+    }
+    if (rename(tmp.c_str(), readme.c_str()) != 0)
+        throw KSystemError("Cannot rename " + tmp + ".", errno);
+
+    // the dumps can be read directly now
+    if (m_unflattened) {
+        const char *obsolete[] = { "rearrange.sh", "makedumpfile-R.pl" };
+        for (size_t i = 0; i < sizeof(obsolete) / sizeof(obsolete[0]); ++i) {
+            FilePath path = dir;
+            unlink(path.appendPath(obsolete[i]).c_str());
+        }
+    }
+
+    // the format and the size have changed
+    FilePath catalog = dir.dirName();
+    if (catalog.appendPath(CATALOG_FILE).exists()) {
+        try {
+            DumpCatalog(dir.dirName()).record(DumpCatalog::scan(dir, true));
+        } catch (const KError &error) {
+            cerr << "WARNING: Cannot update the dump catalog: "
+                 << error.what() << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+string Recompress::updateReadme(const string &info, const string &format,
+                                const string &oldFormat, int dumplevel,
+                                bool unflattened, time_t now)
+    throw ()
+{
+    // keep everything that has not changed
+    ostringstream ss;
+    std::istringstream iss(info);
+    string line;
+    bool skipNote = false;
+    while (std::getline(iss, line)) {
+        if (line.compare(0, strlen(README_FORMAT), README_FORMAT) == 0) {
+            ss << README_FORMAT << format << endl;
+            ss << "Recompressed   : "
+               << Stringutil::formatUnixTime("%Y-%m-%d %H:%M (%z)", now)
+               << " from "
+               << (oldFormat.empty() ? "unknown" : oldFormat) << endl;
+            continue;
+        }
+        if (dumplevel &&
+            line.compare(0, strlen(README_LEVEL), README_LEVEL) == 0) {
+            int level = Stringutil::string2number(
+                line.substr(strlen(README_LEVEL)));
+            ss << README_LEVEL << (level | dumplevel) << endl;
+            continue;
+        }
+
+        // the note about the flattened format is obsolete
+        if (unflattened && line == "NOTE:" && iss.peek() != EOF) {
+            std::streampos next = iss.tellg();
+            string following;
+            std::getline(iss, following);
+            if (following == README_FLATTENED) {
+                skipNote = true;
+                continue;
+            }
+            iss.seekg(next);
+        }
+        if (skipNote) {
+            if (line.empty())
+                skipNote = false;
+            continue;
+        }
+        ss << line << endl;
+    }
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+bool Recompress::recompress_one(const FilePath &dir, const string &name)
+    throw (KError)
+{
+    FilePath path = dir;
+    path.appendPath(name);
+
+    Debug::debug()->trace("Recompress::recompress_one(%s)", path.c_str());
+
+    char header[16];
+    memset(header, 0, sizeof header);
+    ifstream fin(path.c_str(), std::ios::binary);
+    fin.read(header, sizeof header);
+    fin.close();
+
+    bool flattened = memcmp(header, FLATTENED_SIGNATURE,
+                            strlen(FLATTENED_SIGNATURE)) == 0;
+    bool compressed = memcmp(header, KDUMP_SIGNATURE,
+                             strlen(KDUMP_SIGNATURE)) == 0;
+    bool elf = memcmp(header, ELF_MAGIC, strlen(ELF_MAGIC)) == 0;
+    if (!flattened && !compressed && !elf)
+        throw KError(path + " is not a dump.");
+
+    // a flattened dump may be ELF, but that makes no difference
+    if (!flattened && compressed && !m_dumplevel &&
+        strcasecmp(m_oldFormat.c_str(), m_format.c_str()) == 0) {
+        Debug::debug()->dbg("%s is already in %s format.",
+            path.c_str(), m_format.c_str());
+        return false;
+    }
+
+    cout << "Recompressing " << path << " ("
+         << (m_oldFormat.empty() ? "unknown" : m_oldFormat) << " -> "
+         << m_format << ")" << endl;
+    if (m_dryRun)
+        return false;
+
+    FilePath input = path;
+    FilePath unflattened = path + ".unflattened";
+    FilePath tmp = path + ".recompress";
+    FilePath oldDmesg = path + ".dmesg-old";
+    FilePath newDmesg = path + ".dmesg-new";
+
+    // makedumpfile does not overwrite files
+    const FilePath *scratch[] = { &unflattened, &tmp, &oldDmesg, &newDmesg };
+    const size_t nscratch = sizeof(scratch) / sizeof(scratch[0]);
+    for (size_t i = 0; i < nscratch; ++i)
+        unlink(scratch[i]->c_str());
+
+    unsigned long long oldSize = path.fileSize();
+    unsigned long long newSize;
+    try {
+        StringVector args;
+        if (flattened) {
+            args.push_back("-R");
+            args.push_back(unflattened);
+            makedumpfile(args, path);
+            input = unflattened;
+            args.clear();
+        }
+
+        // one CPU for the main thread of makedumpfile
+        unsigned long cpus = m_jobs > 0 ? m_jobs : SystemCPU().numOnline();
+        if (cpus > 1) {
+            args.push_back("--num-threads");
+            args.push_back(Stringutil::number2string(cpus - 1));
+        }
+        args.push_back("-d");
+        args.push_back(Stringutil::number2string(m_dumplevel));
+        args.push_back(format_option(m_format));
+        args.push_back(input);
+        args.push_back(tmp);
+        makedumpfile(args);
+
+        // the kernel log must be readable from the new dump, and the same
+        args.clear();
+        args.push_back("--dump-dmesg");
+        args.push_back(input);
+        args.push_back(oldDmesg);
+        makedumpfile(args);
+        args[1] = tmp;
+        args[2] = newDmesg;
+        makedumpfile(args);
+        if (read_file(oldDmesg) != read_file(newDmesg))
+            throw KError("Verification failed: the kernel log differs.");
+
+        // a flattened dump is replaced in any case to save rearrange.sh
+        newSize = tmp.fileSize();
+        if (!flattened && newSize >= oldSize) {
+            cout << path << ": the new dump is not smaller, keeping the "
+                "original." << endl;
+            for (size_t i = 0; i < nscratch; ++i)
+                unlink(scratch[i]->c_str());
+            return false;
+        }
+
+        sync_path(tmp);
+        if (rename(tmp.c_str(), path.c_str()) != 0)
+            throw KSystemError("Cannot rename " + tmp + ".", errno);
+        sync_path(dir);
+    } catch (...) {
+        for (size_t i = 0; i < nscratch; ++i)
+            unlink(scratch[i]->c_str());
+        throw;
+    }
+    for (size_t i = 0; i < nscratch; ++i)
+        unlink(scratch[i]->c_str());
+
+    if (flattened)
+        m_unflattened = true;
+    cout << path << ": " << (oldSize >> 20) << " MiB -> "
+         << (newSize >> 20) << " MiB" << endl;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void Recompress::makedumpfile(const StringVector &args, const string &input)
+    throw (KError)
+{
+    ProcessFilter p;
+    ostringstream stderrStream;
+    p.setStderr(&stderrStream);
+
+    ifstream fin;
+    if (!input.empty()) {
+        fin.open(input.c_str(), std::ios::binary);
+        if (!fin)
+            throw KError("Cannot open " + input + ".");
+        p.setStdin(&fin);
+    }
+
+    int ret = p.execute("makedumpfile", args);
+    Debug::debug()->dbg("makedumpfile: %d", ret);
+    if (ret != 0) {
+        KString error = stderrStream.str();
+        throw KError("makedumpfile failed: " + error.trim() + ".");
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,134 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef RECOMPRESS_H
+#define RECOMPRESS_H
+
+#include <string>
+#include <ctime>
+
+#include "subcommand.h"
+#include "fileutil.h"
+
+//{{{ Recompress ---------------------------------------------------------------
+
+/**
+ * Subcommand to convert saved dumps to a denser kdump-compressed format
+ * after reboot. makedumpfile reads the saved dump (ELF, flattened or
+ * kdump-compressed) and writes the new format with all CPUs. The new
+ * dump is verified before it replaces the original.
+ */
+class Recompress : public Subcommand {
+
+    public:
+        /**
+         * Creates a new Recompress object.
+         */
+        Recompress()
+        throw ();
+
+    public:
+        /**
+         * Returns the name of the subcommand (recompress).
+         */
+        const char *getName() const
+        throw ();
+
+        /**
+         * Parses the non-option arguments (the dump directories).
+         */
+        void parseArgs(const StringVector &args)
+        throw (KError);
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute()
+        throw (KError);
+
+        /**
+         * Returns README.txt with the new format (and the dump level, if
+         * more pages are excluded), a note about the recompression and
+         * without the note about the flattened format if the dump has
+         * been unflattened. The other lines are kept.
+         *
+         * @param[in] info the old README.txt
+         * @param[in] format the new format
+         * @param[in] oldFormat the old format (empty if unknown)
+         * @param[in] dumplevel the additional dump level
+         * @param[in] unflattened whether a flattened dump was converted
+         * @param[in] now time of the recompression
+         */
+        static std::string updateReadme(const std::string &info,
+                                        const std::string &format,
+                                        const std::string &oldFormat,
+                                        int dumplevel, bool unflattened,
+                                        time_t now)
+        throw ();
+
+    protected:
+        /**
+         * Recompresses the dumps in one dump directory and updates
+         * README.txt.
+         *
+         * @param[in] dir the dump directory
+         * @exception KError if a dump cannot be recompressed
+         */
+        void recompress_dir(const FilePath &dir)
+        throw (KError);
+
+        /**
+         * Recompresses one dump file.
+         *
+         * @param[in] dir the dump directory
+         * @param[in] name the file name of the dump
+         * @return @c false if the dump was left alone
+         * @exception KError if the dump cannot be recompressed
+         */
+        bool recompress_one(const FilePath &dir, const std::string &name)
+        throw (KError);
+
+        /**
+         * Runs makedumpfile.
+         *
+         * @param[in] args the arguments
+         * @param[in] input file for standard input, or empty
+         * @exception KError if makedumpfile fails
+         */
+        void makedumpfile(const StringVector &args,
+                          const std::string &input = std::string())
+        throw (KError);
+
+    private:
+        StringVector m_dirs;
+        std::string m_rootdir;
+        std::string m_format;
+        std::string m_oldFormat;
+        int m_jobs;
+        int m_dumplevel;
+        bool m_dryRun;
+        bool m_unflattened;
+};
+
+//}}}
+
+#endif /* RECOMPRESS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -31,10 +31,14 @@
 #include <poll.h>
 #include <time.h>
 
+#include <map>
+#include <vector>
+
 #include "global.h"
 #include "routable.h"
 #include "stringutil.h"
 #include "debug.h"
+#include "threads.h"
 
 //{{{ NetLink ------------------------------------------------------------------
 
@@ -47,9 +51,18 @@ class NetLink {
 
 	~NetLink();
 
+	/**
+	 * Set the timeout (in seconds) for all following receive
+	 * operations together, i.e. the deadline is computed now.
+	 * A negative value means no timeout.
+	 */
 	void setTimeout(int timeout)
 	throw ()
-	{ m_timeout = timeout; }
+	{
+	    m_timeout = timeout;
+	    clock_gettime(CLOCK_MONOTONIC, &m_deadline);
+	    m_deadline.tv_sec += timeout;
+	}
 
 	int getTimeout(void) const
 	throw ()
@@ -98,6 +111,7 @@ class NetLink {
 
     private:
 	int m_timeout;
+	struct timespec m_deadline;
 
 	int m_fd;
 	struct sockaddr_nl m_local;
@@ -187,7 +201,7 @@ int NetLink::receive(const RecvCheck &rc)
     struct iovec iov;
     struct msghdr msg;
     struct pollfd pd;
-    struct timespec tsnow, tsend;
+    struct timespec tsnow;
 
     m_message = NULL;
 
@@ -199,9 +213,6 @@ int NetLink::receive(const RecvCheck &rc)
     pd.fd = m_fd;
     pd.events = POLLIN;
 
-    clock_gettime(CLOCK_MONOTONIC, &tsend);
-    tsend.tv_sec += m_timeout;
-
     while (1) {
 	struct nlmsghdr *nh;
 	ssize_t len;
@@ -210,8 +221,8 @@ int NetLink::receive(const RecvCheck &rc)
 
 	if (m_timeout >= 0) {
 	    clock_gettime(CLOCK_MONOTONIC, &tsnow);
-	    timeout = (tsend.tv_sec - tsnow.tv_sec) * 1000;
-	    timeout += (tsend.tv_nsec - tsnow.tv_nsec) / 1000000L;
+	    timeout = (m_deadline.tv_sec - tsnow.tv_sec) * 1000;
+	    timeout += (m_deadline.tv_nsec - tsnow.tv_nsec) / 1000000L;
 	    if (timeout < 0)
 		return -ETIME;
 	} else
@@ -428,6 +439,43 @@ int NetLink::parseAttrs(const struct rtattr *rta, size_t len)
 
 //{{{ Routable -----------------------------------------------------------------
 
+/**
+ * Result of a reachability check.
+ */
+struct RouteResult {
+    bool reachable;
+    std::string prefsrc;
+};
+
+typedef std::map<std::string, RouteResult> RouteResultMap;
+
+// results by host name; shared by all threads
+static RouteResultMap routeCache;
+static Mutex routeCacheLock;
+
+// -----------------------------------------------------------------------------
+static bool cachedRoute(const std::string &host, RouteResult &result)
+{
+    MutexLocker locker(routeCacheLock);
+
+    RouteResultMap::const_iterator it = routeCache.find(host);
+    if (it == routeCache.end())
+        return false;
+    result = it->second;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static void storeRoute(const std::string &host, bool reachable,
+                       const std::string &prefsrc)
+{
+    MutexLocker locker(routeCacheLock);
+
+    RouteResult &result = routeCache[host];
+    result.reachable = reachable;
+    result.prefsrc = prefsrc;
+}
+
 // -----------------------------------------------------------------------------
 Routable::~Routable()
 {
@@ -471,6 +519,7 @@ bool Routable::resolve(void)
 
     if (m_ai)
 	freeaddrinfo(m_ai);
+    m_ai = NULL;
 
     memset(&hints, 0, sizeof hints);
     hints.ai_family = AF_UNSPEC;
@@ -482,6 +531,8 @@ bool Routable::resolve(void)
     if (res == 0)
 	return true;
 
+    m_ai = NULL;
+
     if (res == EAI_SYSTEM)
 	throw KSystemError("Name resolution failed", errno);
 
@@ -494,18 +545,110 @@ bool Routable::resolve(void)
 // -----------------------------------------------------------------------------
 bool Routable::check(int timeout)
 {
-    NetLink nl(RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE);
-    nl.setTimeout(timeout);
+    RouteResult result;
 
-    while (!resolve())
-	if (nl.waitRouteChange() != 0)
-	    return false;
+    if (!cachedRoute(m_host, result)) {
+        checkAll(StringVector(1, m_host), timeout);
+        cachedRoute(m_host, result);
+    }
 
-    while (!hasRoute())
-	if (nl.waitRouteChange() != 0)
-	    return false;
+    m_prefsrc = result.prefsrc;
+    return result.reachable;
+}
 
-    return true;
+// -----------------------------------------------------------------------------
+unsigned Routable::checkAll(const StringVector &hosts, int timeout,
+			    bool first)
+{
+    std::vector<Routable *> pending;
+    unsigned reachable = 0;
+
+    Debug::debug()->trace("Routable::checkAll(%s, %d, %d)",
+        Stringutil::vector2string(hosts).c_str(), timeout, int(first));
+
+    StringVector::const_iterator hit;
+    for (hit = hosts.begin(); hit != hosts.end(); ++hit) {
+        RouteResult result;
+        if (cachedRoute(*hit, result)) {
+            if (result.reachable)
+                ++reachable;
+            continue;
+        }
+
+        std::vector<Routable *>::const_iterator it;
+        for (it = pending.begin(); it != pending.end(); ++it)
+            if ((*it)->m_host == *hit)
+                break;
+        if (it == pending.end())
+            pending.push_back(new Routable(*hit));
+    }
+
+    try {
+        // one event loop and one deadline for all targets
+        NetLink nl(RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE);
+        nl.setTimeout(timeout);
+
+        while (!pending.empty()) {
+            std::vector<Routable *>::iterator it = pending.begin();
+            while (it != pending.end()) {
+                Routable *rt = *it;
+                bool done;
+                try {
+                    done = (rt->m_ai || rt->resolve()) && rt->hasRoute();
+                    if (done) {
+                        Debug::debug()->dbg("%s is reachable",
+                                            rt->m_host.c_str());
+                        storeRoute(rt->m_host, true, rt->m_prefsrc);
+                        ++reachable;
+                    }
+                } catch (const KError &error) {
+                    Debug::debug()->info("Cannot check %s: %s",
+                                         rt->m_host.c_str(), error.what());
+                    storeRoute(rt->m_host, false, std::string());
+                    done = true;
+                }
+
+                if (done) {
+                    delete rt;
+                    it = pending.erase(it);
+                } else
+                    ++it;
+            }
+
+            if (first && reachable)
+                break;
+            if (!pending.empty() && nl.waitRouteChange() != 0)
+                break;
+        }
+    } catch (...) {
+        std::vector<Routable *>::iterator it;
+        for (it = pending.begin(); it != pending.end(); ++it)
+            delete *it;
+        throw;
+    }
+
+    // the check of the remaining hosts was cut short, which says
+    // nothing about them unless the timeout has expired
+    std::vector<Routable *>::iterator it;
+    for (it = pending.begin(); it != pending.end(); ++it) {
+        if (first && reachable)
+            Debug::debug()->dbg("%s has not been checked",
+                                (*it)->m_host.c_str());
+        else {
+            Debug::debug()->dbg("%s is not reachable", (*it)->m_host.c_str());
+            storeRoute((*it)->m_host, false, std::string());
+        }
+        delete *it;
+    }
+
+    return reachable;
+}
+
+// -----------------------------------------------------------------------------
+bool Routable::isReachable(const std::string &host)
+{
+    RouteResult result;
+    return cachedRoute(host, result) && result.reachable;
 }
 
 //}}}
@@ -40,8 +40,44 @@ class Routable {
 
 	~Routable();
 
+	/**
+	 * Wait until the target is reachable. The result is cached, so
+	 * only the first check of a host waits.
+	 *
+	 * @param[in] timeout maximum time to wait (in seconds)
+	 * @return @c true if the target is reachable
+	 */
 	bool check(int timeout);
 
+	/**
+	 * Check several targets at once. All targets are watched from one
+	 * netlink event loop with a common deadline, so unreachable targets
+	 * do not add up their timeouts. The results are cached for
+	 * subsequent check() calls.
+	 *
+	 * With @p first, the check stops as soon as one host is reachable.
+	 * The hosts that have not been checked to the end are not cached,
+	 * so a later check() waits for them again; use isReachable() to
+	 * leave them out instead.
+	 *
+	 * @param[in] hosts the host names
+	 * @param[in] timeout maximum time to wait (in seconds)
+	 * @param[in] first stop at the first reachable host
+	 * @return number of reachable hosts
+	 */
+	static unsigned checkAll(const StringVector &hosts, int timeout,
+				 bool first = false);
+
+	/**
+	 * Checks whether an earlier check found the host reachable. Does
+	 * not wait.
+	 *
+	 * @param[in] host the host name
+	 * @return @c true if the host is known to be reachable, @c false
+	 *         if it is unreachable or has not been checked
+	 */
+	static bool isReachable(const std::string &host);
+
         const std::string& prefsrc(void) const
         throw ()
         { return m_prefsrc; }
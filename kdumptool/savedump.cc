@@ -23,7 +23,13 @@
 #include <cerrno>
 #include <memory>
 #include <sstream>
+#include <iomanip>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -38,10 +44,18 @@
 #include "progress.h"
 #include "stringutil.h"
 #include "vmcoreinfo.h"
+#include "vmcoreimage.h"
+#include "vmcoreanalyzer.h"
+#include "phasereport.h"
+#include "upload_pending.h"
+#include "metrics.h"
 #include "identifykernel.h"
 #include "email.h"
 #include "routable.h"
 #include "calibrate.h"
+#include "threads.h"
+#include "sha256.h"
+#include "catalog.h"
 
 using std::string;
 using std::list;
@@ -55,14 +69,34 @@ using std::ifstream;
 
 #define KERNELCOMMANDLINE "/proc/cmdline"
 
+// pages sampled for KDUMP_DUMPFORMAT="auto" if KDUMP_ANALYZE_SAMPLES is 0
+#define AUTO_FORMAT_SAMPLES 1024
+
+// seconds of KDUMP_SAVE_DEADLINE kept for dmesg, VMCOREINFO and README
+#define DEADLINE_RESERVE    10
+
+// dump level of the first stage of KDUMP_TWO_STAGE
+#define FIRST_STAGE_LEVEL   31
+
+// -----------------------------------------------------------------------------
+static double monotonic_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 //{{{ SaveDump -----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 SaveDump::SaveDump()
     throw ()
-    : m_dump(DEFAULT_DUMP), m_transfer(NULL), m_usedDirectSave(false),
-      m_useMakedumpfile(false), m_split(0), m_threads(0), m_crashtime(0),
-      m_nomail(false)
+    : m_dump(DEFAULT_DUMP), m_image(NULL), m_analyzer(NULL), m_transfer(NULL),
+      m_metrics(NULL), m_memory(NULL), m_usedDirectSave(false),
+      m_useMakedumpfile(false), m_split(0), m_threads(0),
+      m_formatChosen(false), m_bandwidth(0), m_weighted(false),
+      m_dumplevel(0), m_deadline(0),
+      m_firstStageFlattened(false), m_crashtime(0), m_nomail(false)
 {
     Debug::debug()->trace("SaveDump::SaveDump()");
 
@@ -84,7 +118,11 @@ SaveDump::~SaveDump()
 {
     Debug::debug()->trace("SaveDump::~SaveDump()");
 
+    delete m_metrics;
+    delete m_memory;
     delete m_transfer;
+    delete m_analyzer;
+    delete m_image;
 }
 
 // -----------------------------------------------------------------------------
@@ -110,7 +148,52 @@ void SaveDump::execute()
     if (!m_dump.exists())
         throw KError("The dump file " + m_dump + " does not exist.");
 
+    startMetrics();
+
+    // the peak memory usage helps calibrate the crash kernel size
+    m_memory = new MemoryMonitor();
+    try {
+        m_memory->start();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot monitor memory: %s", error.what());
+    }
+
+    // the report, the metrics and the catalog also cover failed saves
+    RootDirURLVector urlv;
+    try {
+        saveToTargets(urlv);
+    } catch (...) {
+        setErrorCode(1);
+        finish(urlv, "failed");
+        throw;
+    }
+
+    finish(urlv, getErrorCode() ? "failed" :
+           config->KDUMP_SPOOL.value().empty() ? "ok" : "pending");
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveToTargets(RootDirURLVector &urlv)
+    throw (KError)
+{
+    Debug::debug()->trace("SaveDump::saveToTargets()");
+
+    Configuration *config = Configuration::config();
+
+    // the deadline counts from now
+    if (config->KDUMP_SAVE_DEADLINE.value() > 0)
+        m_deadline = monotonic_seconds() + config->KDUMP_SAVE_DEADLINE.value();
+
+    m_dumplevel = config->KDUMP_DUMPLEVEL.value();
+    if (m_dumplevel < 0 || m_dumplevel > 31) {
+        Debug::debug()->info("Dumplevel %d is invalid. Using 0.", m_dumplevel);
+        m_dumplevel = 0;
+    }
+
+    // parse the ELF headers only once for all consumers below
     try {
+        PhaseScope phase(m_report, "vmcoreinfo");
+        m_image = new VmcoreImage(m_dump);
         fillVmcoreinfo();
     } catch (const KError &error) {
         Debug::debug()->dbg("Error when reading VMCOREINFO: %s", error.what());
@@ -119,36 +202,134 @@ void SaveDump::execute()
 
     // build the transfer object
     // prepend a time stamp to the save dir
+    m_report.begin("targets");
     string subdir = Stringutil::formatUnixTime(ISO_DATETIME, m_crashtime);
-    RootDirURLVector urlv;
-    std::istringstream iss(config->KDUMP_SAVEDIR.value());
-    FilePath elem;
-    while (iss >> elem) {
-        RootDirURL url(elem, m_rootdir);
-        if (url.getProtocol() != URLParser::PROT_FILE) {
-            Routable rt(url.getHostname());
-            if (!rt.check(config->KDUMP_NET_TIMEOUT.value())) {
-                cerr << "WARNING: Dump target not reachable" << endl;
-                elem.appendPath(string("unknown-") + subdir);
-            } else
-                elem.appendPath(rt.prefsrc() + '-' + subdir);
-        } else
-            elem.appendPath(subdir);
-        urlv.push_back(RootDirURL(elem, m_rootdir));
+
+    // KDUMP_SPOOL: save locally, upload_pending does the rest after reboot
+    const string &spool = config->KDUMP_SPOOL.value();
+    string savedir = config->KDUMP_SAVEDIR.value();
+    if (!spool.empty()) {
+        cout << "Saving the dump to the spool " << spool << endl;
+        savedir = "file://" + spool;
+    }
+    std::istringstream iss(savedir);
+    RootDirURLVector targets;
+    StringVector hosts;
+    string target;
+    while (iss >> target) {
+        targets.push_back(RootDirURL(target, m_rootdir));
+        if (targets.back().getProtocol() != URLParser::PROT_FILE)
+            hosts.push_back(targets.back().getHostname());
     }
 
+    // probe all network targets at once; the results are cached, and
+    // saving starts as soon as one of them is reachable without the
+    // network targets that are not reachable by then
+    if (!hosts.empty() &&
+        Routable::checkAll(hosts, config->KDUMP_NET_TIMEOUT.value(), true)) {
+        RootDirURLVector usable;
+        RootDirURLVector::const_iterator it;
+        for (it = targets.begin(); it != targets.end(); ++it)
+            if (it->getProtocol() == URLParser::PROT_FILE ||
+                Routable::isReachable(it->getHostname()))
+                usable.push_back(*it);
+            else
+                cerr << "WARNING: Dump target " << it->getURL()
+                     << " not reachable; skipped." << endl;
+        targets = usable;
+    }
+
+    // measure the throughput of the targets if requested
+    const string &probe = config->KDUMP_TARGET_PROBE.value();
+    bool probeFastest = strcasecmp(probe.c_str(), "fastest") == 0;
+    bool probeWeighted = strcasecmp(probe.c_str(), "weighted") == 0;
+    std::vector<unsigned> weights;
+    if (!probe.empty() && strcasecmp(probe.c_str(), "none") != 0 &&
+        !probeFastest && !probeWeighted)
+        cerr << "WARNING: Unknown KDUMP_TARGET_PROBE value: "
+             << probe << endl;
+    else if ((probeFastest || probeWeighted) && targets.size() > 1) {
+        probeTargets(targets, weights);
+        if (probeFastest && !weights.empty()) {
+            size_t best = 0;
+            for (size_t i = 1; i < weights.size(); ++i)
+                if (weights[i] > weights[best])
+                    best = i;
+            cout << "Using fastest target " << targets[best].getURL()
+                 << endl;
+            m_bandwidth = weights[best] * 1024ULL;
+            RootDirURL fastest = targets[best];
+            targets = RootDirURLVector(1, fastest);
+            weights.clear();
+        } else {
+            // the parts are distributed over all targets
+            for (size_t i = 0; i < weights.size(); ++i)
+                m_bandwidth += weights[i] * 1024ULL;
+        }
+    }
+
+    // "auto" needs the bandwidth; the slowest target limits the dump
+    m_dumpformat = config->KDUMP_DUMPFORMAT.value();
+    bool autoFormat = strcasecmp(m_dumpformat.c_str(), "auto") == 0;
+    if (autoFormat && !m_bandwidth && !targets.empty() &&
+        strcasecmp(probe.c_str(), "none") != 0) {
+        RootDirURLVector probed(targets);
+        std::vector<unsigned> speeds;
+        probeTargets(probed, speeds);
+        for (size_t i = 0; i < speeds.size(); ++i)
+            if (!m_bandwidth || speeds[i] * 1024ULL < m_bandwidth)
+                m_bandwidth = speeds[i] * 1024ULL;
+    }
+
+    RootDirURLVector::const_iterator tit;
+    for (tit = targets.begin(); tit != targets.end(); ++tit)
+        urlv.push_back(dumpDirURL(*tit, subdir, m_rootdir));
+
     m_transfer = getTransfer(urlv);
+    if (!weights.empty()) {
+        Transfer *transfer = m_transfer;
+        RateLimitedTransfer *limited =
+            dynamic_cast<RateLimitedTransfer *>(transfer);
+        if (limited)
+            transfer = limited->getTransfer();
+        // only the local file systems distribute the parts
+        URLTransfer *urltransfer = NULL;
+        if (dynamic_cast<FileTransfer *>(transfer) ||
+            dynamic_cast<MountTransfer *>(transfer))
+            urltransfer = static_cast<URLTransfer *>(transfer);
+        if (urltransfer && weights.size() == urlv.size()) {
+            urltransfer->setWeights(weights);
+            m_weighted = true;
+        } else
+            cerr << "WARNING: KDUMP_TARGET_PROBE=\"weighted\" only works "
+                    "with local or mounted dump targets; weights ignored."
+                 << endl;
+    }
+
+    m_report.end();
+
+    if (autoFormat) {
+        PhaseScope phase(m_report, "format");
+        chooseDumpFormat();
+    }
 
     // save the dump
     try {
+        if (config->KDUMP_ANALYZE_SAMPLES.value() > 0) {
+            PhaseScope phase(m_report, "analyze");
+            analyzeDump(urlv);
+        }
         saveDump(urlv);
     } catch (const KError &error) {
         setErrorCode(1);
 
+        m_report.begin("notification");
         sendNotification(true, urlv);
+        m_report.end();
 
         // run checkAndDelete() in any case
         try {
+            PhaseScope phase(m_report, "check");
             checkAndDelete(urlv);
         } catch (const KError &error) {
             cout << error.what() << endl;
@@ -161,12 +342,15 @@ void SaveDump::execute()
     }
 
     // send the email afterwards
+    m_report.begin("notification");
     sendNotification(false, urlv);
+    m_report.end();
 
     // because we don't know the file size in advance, check
     // afterwards if the disk space is not sufficient and delete
     // the dump again
     try {
+        PhaseScope phase(m_report, "check");
         checkAndDelete(urlv);
     } catch (const KError &error) {
         setErrorCode(1);
@@ -178,8 +362,11 @@ void SaveDump::execute()
 
     // copy the makedumpfile-R.pl
     try {
-        if (!m_usedDirectSave && m_useMakedumpfile)
+        if ((!m_usedDirectSave && m_useMakedumpfile) ||
+            m_firstStageFlattened) {
+            PhaseScope phase(m_report, "makedumpfile-R");
             copyMakedumpfile();
+        }
     } catch (const KError &error) {
         setErrorCode(1);
         if (config->KDUMP_CONTINUE_ON_ERROR.value())
@@ -201,6 +388,7 @@ void SaveDump::execute()
 
     // generate the README file
     try {
+        PhaseScope phase(m_report, "readme");
         generateInfo();
     } catch (const KError &error) {
         setErrorCode(1);
@@ -213,8 +401,14 @@ void SaveDump::execute()
     // copy kernel
     if (m_crashrelease.size() > 0) {
         try {
-            if (config->KDUMP_COPY_KERNEL.value())
+            if (config->KDUMP_COPY_KERNEL.value() &&
+                m_deadline && timeLeft() <= 0) {
+                cout << "Not copying the kernel: KDUMP_SAVE_DEADLINE "
+                    "has passed." << endl;
+            } else if (config->KDUMP_COPY_KERNEL.value()) {
+                PhaseScope phase(m_report, "kernel");
                 copyKernel();
+            }
         } catch (const KError &error) {
             setErrorCode(1);
             if (config->KDUMP_CONTINUE_ON_ERROR.value())
@@ -226,20 +420,138 @@ void SaveDump::execute()
         Debug::debug()->info("Don't copy the kernel and System.map because of missing "
             "crash kernel release.");
     }
+
+    // mark the dump for upload_pending last, so that it does not
+    // upload a dump that is still being saved
+    if (!spool.empty()) {
+        try {
+            markUploadPending();
+        } catch (const KError &error) {
+            setErrorCode(1);
+            cout << error.what() << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::finish(const RootDirURLVector &urlv, const string &status)
+    throw ()
+{
+    Debug::debug()->trace("SaveDump::finish(%s)", status.c_str());
+
+    if (m_metrics) {
+        try {
+            m_metrics->stop();
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+        }
+    }
+
+    recordMemory();
+    updateCatalog(urlv, status);
+    writeReport();
 }
 
 // -----------------------------------------------------------------------------
-void SaveDump::saveDump(const RootDirURLVector &urlv)
+void SaveDump::markUploadPending()
     throw (KError)
+{
+    Debug::debug()->trace("SaveDump::markUploadPending()");
+
+    ostringstream ss;
+    ss << "Saved to the spool by kdumptool save_dump at "
+       << Stringutil::formatUnixTime("%Y-%m-%d %H:%M (%z)", time(NULL))
+       << "." << endl;
+    ss << "kdumptool upload_pending uploads it to KDUMP_SAVEDIR." << endl;
+
+    ByteVector bv = Stringutil::str2bytes(ss.str());
+    BufferDataProvider provider(bv);
+    cout << "Marking the dump for upload" << endl;
+    perform(&provider, UPLOAD_PENDING_FILE, NULL);
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::startMetrics()
+    throw ()
 {
     Configuration *config = Configuration::config();
+    string destination = config->KDUMP_METRICS.value();
+    if (destination.empty())
+        return;
+
+    // the default interval also applies to nonsense values
+    int interval = config->KDUMP_METRICS_INTERVAL.value();
+    if (interval <= 0)
+        interval = 5;
+
+    string host = m_hostname;
+    if (host.empty()) {
+        try {
+            host = Util::getHostDomain();
+        } catch (const KError &error) {
+            Debug::debug()->dbg("%s", error.what());
+        }
+    }
+
+    // live metrics are informational: never fail the dump because of them
+    try {
+        m_metrics = new MetricsSink(destination, host, interval);
+        m_metrics->start();
+    } catch (const KError &error) {
+        cerr << "WARNING: Cannot export metrics: " << error.what() << endl;
+        delete m_metrics;
+        m_metrics = NULL;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::recordMemory()
+    throw ()
+{
+    Debug::debug()->trace("SaveDump::recordMemory()");
+
+    if (!m_memory)
+        return;
+    try {
+        m_memory->stop();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+
+    MemoryMonitor::Usage usage = m_memory->getUsage();
+    Debug::debug()->dbg("Peak memory usage: %llu of %llu KiB",
+        MemoryMonitor::peak(usage), usage.ram);
+
+    // elsewhere, the usage says nothing about the crash kernel area
+    if (!FilePath("/proc/vmcore").exists()) {
+        Debug::debug()->dbg("Not running in the kdump kernel.");
+        return;
+    }
 
-    // build the data provider object
-    int dumplevel = config->KDUMP_DUMPLEVEL.value();
-    if (dumplevel < 0 || dumplevel > 31) {
-        Debug::debug()->info("Dumplevel %d is invalid. Using 0.", dumplevel);
-        dumplevel = 0;
+    try {
+        Configuration *config = Configuration::config();
+        MemoryHistory::Sample sample;
+        sample.time = time(NULL);
+        sample.usage = usage;
+        sample.cpus = SystemCPU().numOnline();
+        sample.network = config->needsNetwork();
+        sample.makedumpfile = config->needsMakedumpfile();
+        sample.kernel = Util::getKernelRelease();
+
+        FilePath path = m_rootdir;
+        path.appendPath(MEMORY_HISTORY_FILE);
+        MemoryHistory(path).append(sample);
+    } catch (const KError &error) {
+        cerr << "WARNING: Cannot record the memory usage: "
+             << error.what() << endl;
     }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveDump(RootDirURLVector &urlv)
+    throw (KError)
+{
+    Configuration *config = Configuration::config();
 
     // check if the vmcore file does exist and has a size of > 0
     if (!m_dump.exists()) {
@@ -249,10 +561,113 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
         throw KError("Zero size vmcore (" + m_dump + ").");
     }
 
+    // Save a copy of dmesg
+    saveDmesg();
+
+    bool noDump = strcasecmp(m_dumpformat.c_str(), "none") == 0;
+    bool useElf = strcasecmp(m_dumpformat.c_str(), "elf") == 0;
+
+    if (noDump)
+	return;			// nothing to be done
+
+    // with KDUMP_DUMPFORMAT="auto", chooseDumpFormat() has decided already
+    unsigned long cpus = dumpCpus();
+    if (!m_formatChosen && !config->kdumptoolContainsFlag("SINGLE") &&
+        cpus > 1) {
+
+        /* The check for NOSPLIT is for backward compatibility */
+        bool split = config->kdumptoolContainsFlag("SPLIT") &&
+            !config->kdumptoolContainsFlag("NOSPLIT");
+        if (split && dynamic_cast<CompositeTransfer *>(m_transfer)) {
+            cerr << "Splitting is not supported with mixed dump targets."
+                 << endl;
+            split = false;
+        }
+        if (split && dynamic_cast<RateLimitedTransfer *>(m_transfer)) {
+            cerr << "Splitting is not supported with rate-limited dump "
+                "targets." << endl;
+            split = false;
+        }
+        if (split && m_deadline) {
+            cerr << "Splitting is not supported with KDUMP_SAVE_DEADLINE."
+                 << endl;
+            split = false;
+        }
+
+        if (split) {
+            if (!useElf)
+                m_split = cpus;
+            else
+                cerr << "Splitting ELF dumps is not supported." << endl;
+        } else {
+            if (!useElf)
+                m_threads = cpus - 1;
+            else
+                cerr << "Multithreading is unavailable for ELF dumps" << endl;
+        }
+    }
+
+    // the weights distribute split files, so they need a split dump
+    if (m_weighted && !m_split)
+        cerr << "WARNING: KDUMP_TARGET_PROBE=\"weighted\" has no effect, "
+                "because the dump is not split." << endl;
+
+    // KDUMP_TWO_STAGE: save the most important pages first
+    if (config->KDUMP_TWO_STAGE.value() && m_dumplevel != FIRST_STAGE_LEVEL)
+        saveFirstStage(m_deadline ? timeLeft() - DEADLINE_RESERVE : 0);
+
+    if (!m_deadline) {
+        bool missed;
+        saveVmcore("vmcore", 0, missed);
+        return;
+    }
+
+    // the first stage is what the degradation steps would produce,
+    // so the second stage gets only one attempt
+    if (!m_firstStage.empty()) {
+        double left = timeLeft() - DEADLINE_RESERVE;
+        double predicted = predictDumpSeconds();
+        bool missed = true;
+        if (left > 0 && predicted <= left)
+            saveVmcore("vmcore", left, missed);
+        if (missed)
+            sacrifice("second stage not saved, only " FIRST_STAGE_FILE);
+        return;
+    }
+
+    // KDUMP_SAVE_DEADLINE: fall back to cheaper settings until the dump
+    // can be saved in time
+    while (timeLeft() > DEADLINE_RESERVE) {
+        double left = timeLeft() - DEADLINE_RESERVE;
+        double predicted = predictDumpSeconds();
+        if (predicted > left) {
+            cout << "Saving the dump would take "
+                 << ((m_dumplevel & ~1) ? "up to " : "about ")
+                 << (unsigned long)predicted << " seconds, but only "
+                 << (unsigned long)left << " are left." << endl;
+        } else {
+            bool missed;
+            saveVmcore("vmcore", left, missed);
+            if (!missed)
+                return;
+        }
+
+        if (timeLeft() <= DEADLINE_RESERVE || !degrade(urlv))
+            break;
+    }
+
+    saveMinimal();
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveDmesg()
+    throw ()
+{
+    Configuration *config = Configuration::config();
     Terminal terminal;
 
-    // Save a copy of dmesg
     try {
+        PhaseScope phase(m_report, "dmesg");
         string directCmdline = "makedumpfile --dump-dmesg " + m_dump;
 	string pipeCmdline = "makedumpfile --dump-dmesg -F " + m_dump;
 	ProcessDataProvider logProvider(
@@ -266,60 +681,204 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
             logProvider.setProgress(&logProgress);
         else
             cout << "Saving dmesg ..." << endl;
-        m_transfer->perform(&logProvider, "dmesg.txt", NULL);
+        perform(&logProvider, "dmesg.txt", NULL);
 	terminal.printLine();
     } catch (const KError &error) {
 	cout << error.what() << endl;
     } catch (...) {
 	cout << "Extracting failed." << endl;
     }
+}
 
-    // dump format
-    const string &dumpformat = config->KDUMP_DUMPFORMAT.value();
-    DataProvider *provider;
+// -----------------------------------------------------------------------------
+double SaveDump::timeLeft() const
+    throw ()
+{
+    return m_deadline - monotonic_seconds();
+}
 
-    bool noDump = strcasecmp(dumpformat.c_str(), "none") == 0;
-    bool useElf = strcasecmp(dumpformat.c_str(), "elf") == 0;
-    bool useCompressed = strcasecmp(dumpformat.c_str(), "compressed") == 0;
-    bool useLZO = strcasecmp(dumpformat.c_str(), "lzo") == 0;
-    bool useSnappy = strcasecmp(dumpformat.c_str(), "snappy") == 0;
+// -----------------------------------------------------------------------------
+double SaveDump::predictDumpSeconds()
+    throw ()
+{
+    // the analyzer only knows about zero pages, so with other dump level
+    // bits this is an upper bound; better to degrade a step too early
+    // than to start a dump that cannot finish in time
+    VmcoreAnalyzer::Format format;
+    if (!VmcoreAnalyzer::parseFormat(m_dumpformat, format))
+        return 0;
+
+    unsigned long workers = m_split ? m_split : (m_threads ? m_threads : 1);
+    try {
+        return getAnalyzer()->predictSeconds(format, m_dumplevel, workers,
+                                             targetBandwidth());
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot predict the save time: %s",
+            error.what());
+        return 0;
+    }
+}
 
-    if (noDump)
-	return;			// nothing to be done
+// -----------------------------------------------------------------------------
+void SaveDump::sacrifice(const string &what)
+    throw ()
+{
+    cout << "KDUMP_SAVE_DEADLINE: " << what << endl;
+    m_sacrificed.push_back(what);
+}
 
-    unsigned long cpus = config->KDUMP_CPUS.value();
-    unsigned long online_cpus = 0;
-    if (cpus) {
-        SystemCPU syscpu;
-        online_cpus = syscpu.numOnline();
-        /* Limit kdump cpus to online cpus if (KDUMP_CPUS > online cpus) */
-        if (cpus > online_cpus)
-            cpus = online_cpus;
+// -----------------------------------------------------------------------------
+bool SaveDump::degrade(RootDirURLVector &urlv)
+    throw (KError)
+{
+    Debug::debug()->trace("SaveDump::degrade()");
+
+    Configuration *config = Configuration::config();
+
+    // exclude everything that makedumpfile can exclude
+    if (m_dumplevel != 31) {
+        sacrifice("dump level raised from " +
+            Stringutil::number2string(m_dumplevel) + " to 31");
+        m_dumplevel = 31;
+        return true;
     }
-    if (!config->kdumptoolContainsFlag("SINGLE") &&
-        cpus > 1) {
 
-        /* The check for NOSPLIT is for backward compatibility */
-        if (config->kdumptoolContainsFlag("SPLIT") &&
-            !config->kdumptoolContainsFlag("NOSPLIT")) {
-            if (!useElf)
-                m_split = cpus;
-            else
-                cerr << "Splitting ELF dumps is not supported." << endl;
-        } else {
-            if (!useElf)
-                m_threads = cpus - 1;
-            else
-                cerr << "Multithreading is unavailable for ELF dumps" << endl;
+    // switch to the fastest compression
+    VmcoreAnalyzer::Format format;
+    VmcoreAnalyzer::Format fastest = VmcoreAnalyzer::FORMAT_MAX;
+    if (VmcoreAnalyzer::isAvailable(VmcoreAnalyzer::FORMAT_SNAPPY))
+        fastest = VmcoreAnalyzer::FORMAT_SNAPPY;
+    else if (VmcoreAnalyzer::isAvailable(VmcoreAnalyzer::FORMAT_LZO))
+        fastest = VmcoreAnalyzer::FORMAT_LZO;
+    if (fastest != VmcoreAnalyzer::FORMAT_MAX &&
+        VmcoreAnalyzer::parseFormat(m_dumpformat, format) &&
+        (format == VmcoreAnalyzer::FORMAT_ELF ||
+         format == VmcoreAnalyzer::FORMAT_ZLIB)) {
+        string name = VmcoreAnalyzer::formatName(fastest);
+        sacrifice("dump format changed from " + m_dumpformat + " to " + name);
+        m_dumpformat = name;
+
+        // ELF dumps are saved single-threaded
+        unsigned long cpus = dumpCpus();
+        if (!m_split && !m_threads && cpus > 1 &&
+            !config->kdumptoolContainsFlag("SINGLE"))
+            m_threads = cpus - 1;
+        return true;
+    }
+
+    // save to the local targets only
+    RootDirURLVector local;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it)
+        if (it->getProtocol() == URLParser::PROT_FILE)
+            local.push_back(*it);
+    if (!local.empty() && local.size() < urlv.size()) {
+        Transfer *transfer = getTransfer(local);
+        sacrifice("remote dump targets dropped");
+        delete m_transfer;
+        m_transfer = transfer;
+        urlv = local;
+
+        // the remote targets have the only copy
+        saveDmesg();
+        return true;
+    }
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveMinimal()
+    throw (KError)
+{
+    Debug::debug()->trace("SaveDump::saveMinimal()");
+
+    sacrifice("vmcore not saved, only dmesg.txt and vmcoreinfo.txt");
+    m_dumpformat = "none";
+    m_useMakedumpfile = false;
+    m_split = 0;
+    m_threads = 0;
+
+    if (!m_image)
+        return;
+
+    const VmcoreImage::Note *note = m_image->findNote("VMCOREINFO");
+    if (!note)
+        note = m_image->findNote("VMCOREINFO_XEN");
+    if (!note) {
+        cout << "VMCOREINFO not found." << endl;
+        return;
+    }
+
+    ByteVector data = m_image->getNoteData(*note);
+    while (!data.empty() && data.back() == '\0')
+        data.pop_back();
+
+    PhaseScope phase(m_report, "minimal");
+    BufferDataProvider provider(data);
+    cout << "Saving vmcoreinfo.txt" << endl;
+    perform(&provider, "vmcoreinfo.txt");
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveFirstStage(double seconds)
+    throw ()
+{
+    Debug::debug()->trace("SaveDump::saveFirstStage(%.0f)", seconds);
+
+    if (m_deadline && seconds <= 0)
+        return;
+
+    // the second stage is saved with the configured settings
+    int dumplevel = m_dumplevel;
+    unsigned long split = m_split;
+    bool useMakedumpfile = m_useMakedumpfile;
+    bool usedDirectSave = m_usedDirectSave;
+    m_dumplevel = FIRST_STAGE_LEVEL;
+    m_split = 0;
+
+    cout << "Saving the first stage (dump level " << FIRST_STAGE_LEVEL
+         << ") as " FIRST_STAGE_FILE << endl;
+    try {
+        bool missed;
+        saveVmcore(FIRST_STAGE_FILE, seconds, missed);
+        if (!missed) {
+            m_firstStage = FIRST_STAGE_FILE;
+            m_firstStageFlattened = m_useMakedumpfile && !m_usedDirectSave;
         }
+    } catch (const KError &error) {
+        cout << "Saving the first stage failed: " << error.what() << endl;
     }
 
+    m_dumplevel = dumplevel;
+    m_split = split;
+    m_useMakedumpfile = useMakedumpfile;
+    m_usedDirectSave = usedDirectSave;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::saveVmcore(const string &target, double seconds, bool &missed)
+    throw (KError)
+{
+    Configuration *config = Configuration::config();
+    Terminal terminal;
+
+    const string &dumpformat = m_dumpformat;
+    DataProvider *provider;
+
+    bool useElf = strcasecmp(dumpformat.c_str(), "elf") == 0;
+    bool useCompressed = strcasecmp(dumpformat.c_str(), "compressed") == 0;
+    bool useLZO = strcasecmp(dumpformat.c_str(), "lzo") == 0;
+    bool useSnappy = strcasecmp(dumpformat.c_str(), "snappy") == 0;
+
+    missed = false;
+
     bool excludeDomU = false;
     if (!config->kdumptoolContainsFlag("XENALLDOMAINS") &&
-	Util::isXenCoreDump(m_dump.c_str()))
+	(m_image ? m_image->isXen() : Util::isXenCoreDump(m_dump.c_str())))
       excludeDomU = true;
 
-    if (useElf && dumplevel == 0 && !excludeDomU) {
+    if (useElf && m_dumplevel == 0 && !excludeDomU) {
         // use file source?
         provider = new FileDataProvider(m_dump.c_str());
         m_useMakedumpfile = false;
@@ -334,7 +893,7 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
             cmdline << "--num-threads " << m_threads << " ";
         }
         cmdline << config->MAKEDUMPFILE_OPTIONS.value() << " ";
-        cmdline << "-d " << config->KDUMP_DUMPLEVEL.value() << " ";
+        cmdline << "-d " << m_dumplevel << " ";
 	if (excludeDomU)
 	    cmdline << "-X ";
         if (useElf)
@@ -355,6 +914,25 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
         m_useMakedumpfile = true;
     }
 
+    // expected size of the dump for the progress in live metrics
+    unsigned long long expected = 0;
+    VmcoreAnalyzer::Format format;
+    if (!m_useMakedumpfile)
+        expected = m_dump.fileSize();
+    else if (m_analyzer && VmcoreAnalyzer::parseFormat(m_dumpformat, format))
+        expected = m_analyzer->estimate(format, m_dumplevel).size;
+
+    // the estimate is an upper bound if other pages than zero pages
+    // are excluded, so only use it to predict the end in time
+    DeadlineDataProvider *deadline = NULL;
+    if (seconds > 0) {
+        bool exact = !m_useMakedumpfile || (m_dumplevel & ~1) == 0;
+        deadline = new DeadlineDataProvider(provider, seconds,
+                                            exact ? expected : 0);
+    }
+
+    PhaseScope phase(m_report,
+        target == FIRST_STAGE_FILE ? "first-stage" : "dump");
     try {
         if (m_useMakedumpfile) {
             cout << "Saving dump using makedumpfile" << endl;
@@ -373,16 +951,36 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
 		ss << "vmcore" << i;
 		targets.push_back(ss.str());
 	    }
-	    m_transfer->perform(provider, targets, &m_usedDirectSave);
+	    perform(provider, targets, &m_usedDirectSave, expected);
+	} else if (deadline) {
+	    perform(deadline, target, &m_usedDirectSave, expected);
 	} else {
-	    m_transfer->perform(provider, "vmcore", &m_usedDirectSave);
+	    perform(provider, target, &m_usedDirectSave, expected);
 	}
         if (m_useMakedumpfile)
             terminal.printLine();
+    } catch (const KError &error) {
+        missed = deadline && deadline->missed();
+        delete deadline;
+        delete provider;
+        if (!missed)
+            throw;
+
+        m_report.end(false);
+        cout << error.what() << endl;
+        try {
+            m_transfer->remove(target);
+        } catch (const KError &error) {
+            Debug::debug()->dbg("%s", error.what());
+        }
+        return;
     } catch (...) {
+        delete deadline;
         delete provider;
         throw;
     }
+    delete deadline;
+    delete provider;
 }
 
 // -----------------------------------------------------------------------------
@@ -420,7 +1018,7 @@ void SaveDump::copyMakedumpfile()
         provider.setProgress(&progress);
     else
         cout << "Saving makedumpfile-R.pl ..." << endl;
-    m_transfer->perform(&provider, "makedumpfile-R.pl", NULL);
+    perform(&provider, "makedumpfile-R.pl", NULL);
 
     generateRearrange();
 }
@@ -434,17 +1032,28 @@ void SaveDump::generateRearrange()
     // and also generate a "rearrange" script
     ostringstream ss;
 
+    StringVector flattened;
+    if (!m_usedDirectSave && m_useMakedumpfile)
+        flattened.push_back("vmcore");
+    if (m_firstStageFlattened)
+        flattened.push_back(m_firstStage);
+
     ss << "#!/bin/sh" << endl;
     ss << endl;
-    ss << "# rename the flattened vmcore" << endl;
-    ss << "mv vmcore vmcore.flattened || exit 1" << endl;
-    ss << endl;
-    ss << "# unflatten" << endl;
-    ss << "perl makedumpfile-R.pl vmcore < vmcore.flattened || exit 1 " << endl;
-    ss << endl;
-    ss << "# delete the original dump" << endl;
-    ss << "rm vmcore.flattened || exit 1 " << endl;
-    ss << endl;
+    for (StringVector::const_iterator it = flattened.begin();
+         it != flattened.end(); ++it) {
+        const string &name = *it;
+        ss << "# rename the flattened " << name << endl;
+        ss << "mv " << name << " " << name << ".flattened || exit 1" << endl;
+        ss << endl;
+        ss << "# unflatten" << endl;
+        ss << "perl makedumpfile-R.pl " << name << " < " << name
+           << ".flattened || exit 1 " << endl;
+        ss << endl;
+        ss << "# delete the original dump" << endl;
+        ss << "rm " << name << ".flattened || exit 1 " << endl;
+        ss << endl;
+    }
     ss << "# delete the perl script" << endl;
     ss << "rm makedumpfile-R.pl || exit 1 " << endl;
     ss << endl;
@@ -462,7 +1071,7 @@ void SaveDump::generateRearrange()
         provider2.setProgress(&progress2);
     else
         cout << "Generating rearrange script" << endl;
-    m_transfer->perform(&provider2, "rearrange.sh", NULL);
+    perform(&provider2, "rearrange.sh", NULL);
 }
 
 // -----------------------------------------------------------------------------
@@ -470,8 +1079,8 @@ void SaveDump::fillVmcoreinfo()
     throw (KError)
 {
     Vmcoreinfo vm;
-    vm.readFromELF(m_dump.c_str());
-    m_crashtime = vm.getLLongValue("CRASHTIME");
+    vm.readFromImage(*m_image);
+    m_crashtime = vm.getValue(Vmcoreinfo::ID_CRASHTIME);
 
     // don't overwrite m_crashrelease from command line
     if (m_crashrelease.size() == 0)
@@ -504,14 +1113,40 @@ void SaveDump::generateInfo()
         ss << "Kernel version : " << m_crashrelease << endl;
     ss << "Host           : " << m_hostname << endl;
     ss << "Dump level     : "
-       << Stringutil::number2string(config->KDUMP_DUMPLEVEL.value()) << endl;
-    ss << "Dump format    : " << config->KDUMP_DUMPFORMAT.value() << endl;
+       << Stringutil::number2string(m_dumplevel) << endl;
+    ss << "Dump format    : " << m_dumpformat << endl;
     if (m_split && m_usedDirectSave)
         ss << "Split parts    : " << m_split << endl;
+    if (!m_firstStage.empty())
+        ss << "First stage    : " << m_firstStage << " (dump level "
+           << FIRST_STAGE_LEVEL << ")" << endl;
     ss << endl;
 
+    if (!m_firstStage.empty()) {
+        ss << "NOTE:" << endl;
+        ss << "The dump was saved in two stages. " << m_firstStage
+           << " contains only the kernel" << endl;
+        ss << "pages and is enough for backtraces. vmcore contains all "
+           << "pages of dump" << endl;
+        ss << "level " << m_dumplevel << ", including those of "
+           << m_firstStage << ", and may be missing" << endl;
+        ss << "or incomplete if saving failed." << endl;
+        ss << endl;
+    }
+
 
-    if (m_useMakedumpfile && !m_usedDirectSave) {
+    if (!m_sacrificed.empty()) {
+        ss << "NOTE:" << endl;
+        ss << "To save the dump within KDUMP_SAVE_DEADLINE ("
+           << config->KDUMP_SAVE_DEADLINE.value() << " seconds), "
+           << "the following was given up:" << endl;
+        StringVector::const_iterator it;
+        for (it = m_sacrificed.begin(); it != m_sacrificed.end(); ++it)
+            ss << "  - " << *it << endl;
+        ss << endl;
+    }
+
+    if ((m_useMakedumpfile && !m_usedDirectSave) || m_firstStageFlattened) {
         ss << "NOTE:" << endl;
         ss << "This dump was saved in makedumpfile flattened format." << endl;
         ss << "To read the dump with crash, run \"sh rearrange.sh\" before."
@@ -527,7 +1162,144 @@ void SaveDump::generateInfo()
         provider.setProgress(&progress);
     else
         cout << "Generating README" << endl;
-    m_transfer->perform(&provider, "README.txt", NULL);
+    perform(&provider, "README.txt", NULL);
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::writeReport()
+    throw ()
+{
+    Debug::debug()->trace("SaveDump::writeReport");
+
+    m_report.end();
+    PhaseReport::Phase total = m_report.getTotal();
+
+    cout << "Time spent in each phase:" << endl;
+    cout << m_report.summary();
+
+    ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{" << endl;
+    ss << " \"dump\": " << Stringutil::quoteJSON(m_dump) << "," << endl;
+    ss << " \"crashtime\": " << m_crashtime << "," << endl;
+    ss << " \"kernel\": " << Stringutil::quoteJSON(m_crashrelease) << ","
+       << endl;
+    ss << " \"dumplevel\": " << m_dumplevel << "," << endl;
+    ss << " \"format\": " << Stringutil::quoteJSON(m_dumpformat) << ","
+       << endl;
+    ss << " \"split\": " << m_split << "," << endl;
+    ss << " \"threads\": " << m_threads << "," << endl;
+    ss << " \"first_stage\": " << Stringutil::quoteJSON(m_firstStage) << ","
+       << endl;
+    ss << " \"sacrificed\": [";
+    for (size_t i = 0; i < m_sacrificed.size(); ++i)
+        ss << (i ? ", " : "") << Stringutil::quoteJSON(m_sacrificed[i]);
+    ss << "]," << endl;
+    ss << " \"ok\": " << (getErrorCode() == 0 ? "true" : "false") << ","
+       << endl;
+    ss << " \"wall\": " << total.wall << "," << endl;
+    ss << " \"user\": " << total.user << "," << endl;
+    ss << " \"system\": " << total.system << "," << endl;
+    ss << " \"children_user\": " << total.childUser << "," << endl;
+    ss << " \"children_system\": " << total.childSystem << "," << endl;
+    ss << " \"bytes\": " << total.bytes << "," << endl;
+    if (m_memory) {
+        MemoryMonitor::Usage usage = m_memory->getUsage();
+        ss << " \"memory_kib\": {\"ram\": " << usage.ram
+           << ", \"mem_total\": " << usage.memTotal
+           << ", \"min_available\": " << usage.minAvailable
+           << ", \"cgroup_peak\": " << usage.cgroupPeak
+           << ", \"peak\": " << MemoryMonitor::peak(usage) << "},"
+           << endl;
+    }
+    ss << " \"phases\": " << m_report.toJSON(" ") << endl;
+    ss << "}" << endl;
+
+    // failed before the targets were known
+    if (!m_transfer)
+        return;
+
+    try {
+        ByteVector bv = Stringutil::str2bytes(ss.str());
+        BufferDataProvider provider(bv);
+        cout << "Saving " REPORT_FILE << endl;
+        m_transfer->perform(&provider, REPORT_FILE, NULL);
+    } catch (const KError &error) {
+        cout << error.what() << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::updateCatalog(const RootDirURLVector &urlv,
+                             const string &status)
+    throw ()
+{
+    Debug::debug()->trace("SaveDump::updateCatalog(%s)", status.c_str());
+
+    DumpCatalog::Entry entry;
+    entry.crashTime = m_crashtime;
+    entry.kernel = m_crashrelease;
+    entry.host = m_hostname;
+    if (entry.host.empty()) {
+        try {
+            entry.host = Util::getHostDomain();
+        } catch (const KError &error) {
+            Debug::debug()->dbg("%s", error.what());
+        }
+    }
+    entry.format = m_dumpformat;
+    entry.dumpLevel = m_dumplevel;
+    entry.status = status;
+
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        if (it->getProtocol() != URLParser::PROT_FILE)
+            continue;
+
+        // checkAndDelete() may have removed the dump
+        FilePath dumpdir = it->getRealPath();
+        if (!dumpdir.exists())
+            continue;
+
+        // a dump without vmcore is not complete, whatever happened
+        FilePath vmcore = dumpdir;
+        if (!vmcore.appendPath("vmcore").exists())
+            entry.status = "failed";
+
+        try {
+            entry.id = dumpdir.baseName();
+            entry.size = dumpdir.diskUsage();
+            DumpCatalog(dumpdir.dirName()).record(entry);
+        } catch (const KError &error) {
+            cerr << "WARNING: Cannot update the dump catalog: "
+                 << error.what() << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::perform(DataProvider *provider, const StringVector &targets,
+                       bool *directSave, unsigned long long expected)
+    throw (KError)
+{
+    TransferMetrics::metrics()->begin(Stringutil::join(targets, ' '),
+                                      expected);
+    CountingDataProvider counter(provider);
+    try {
+        m_transfer->perform(&counter, targets, directSave);
+    } catch (...) {
+        m_report.addBytes(counter.getBytes());
+        throw;
+    }
+    m_report.addBytes(counter.getBytes());
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::perform(DataProvider *provider, const string &target,
+                       bool *directSave, unsigned long long expected)
+    throw (KError)
+{
+    perform(provider, StringVector(1, target), directSave, expected);
 }
 
 // -----------------------------------------------------------------------------
@@ -536,32 +1308,65 @@ void SaveDump::copyKernel()
 {
     Debug::debug()->trace("SaveDump::copyKernel()");
 
+    copyKernelFile(findMapfile(), "System.map");
+    copyKernelFile(findKernel(), "kernel");
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::copyKernelFile(const FilePath &file, const string &what)
+    throw (KError)
+{
+    Debug::debug()->trace("SaveDump::copyKernelFile(%s, %s)",
+        file.c_str(), what.c_str());
+
     Configuration *config = Configuration::config();
 
-    FilePath mapfile = findMapfile();
-    FilePath kernel = findKernel();
     FilePath fp;
+    (fp = m_rootdir).appendPath(file);
+    string name = file.baseName();
 
-    // mapfile
-    TerminalProgress mapProgress("Copying System.map");
-    (fp = m_rootdir).appendPath(mapfile);
-    FileDataProvider mapProvider(fp.c_str());
-    if (config->KDUMP_VERBOSE.value()
-	& Configuration::VERB_PROGRESS)
-        mapProvider.setProgress(&mapProgress);
-    else
-        cout << "Copying System.map" << endl;
-    m_transfer->perform(&mapProvider, mapfile.baseName().c_str());
+    // The same kernel is usually saved many times, so the files are
+    // stored once per target under their digest and linked into the
+    // dump directory. Transfers that cannot link fall back to a copy.
+    FilePath cached;
+    try {
+        string digest = Sha256::fileDigest(fp);
+        (cached = "..").appendPath(KERNEL_CACHE_DIR);
+        cached.appendPath(digest);
+        if (m_transfer->exists(cached)) {
+            m_transfer->link(cached, name);
+            cout << "Linking " << what << " from the kernel cache" << endl;
+            return;
+        }
+    } catch (const KError &error) {
+        Debug::debug()->info("Kernel cache not used for %s: %s",
+            name.c_str(), error.what());
+    }
 
-    TerminalProgress kernelProgress("Copying kernel");
-    (fp = m_rootdir).appendPath(kernel);
-    FileDataProvider kernelProvider(fp.c_str());
+    // never write through a link into the cache
+    try {
+        m_transfer->remove(name);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+
+    TerminalProgress progress("Copying " + what);
+    FileDataProvider provider(fp.c_str());
     if (config->KDUMP_VERBOSE.value()
 	& Configuration::VERB_PROGRESS)
-        kernelProvider.setProgress(&kernelProgress);
+        provider.setProgress(&progress);
     else
-        cout << "Copying kernel" << endl;
-    m_transfer->perform(&kernelProvider, kernel.baseName().c_str());
+        cout << "Copying " << what << endl;
+    perform(&provider, name);
+
+    if (cached.empty())
+        return;
+    try {
+        m_transfer->link(name, cached);
+    } catch (const KError &error) {
+        Debug::debug()->info("Cannot add %s to the kernel cache: %s",
+            name.c_str(), error.what());
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -633,6 +1438,174 @@ string SaveDump::findMapfile()
     throw KError("No System.map found in " + fp);
 }
 
+// -----------------------------------------------------------------------------
+unsigned long SaveDump::dumpCpus() const
+    throw ()
+{
+    Configuration *config = Configuration::config();
+
+    unsigned long cpus = config->KDUMP_CPUS.value();
+    if (cpus) {
+        SystemCPU syscpu;
+        unsigned long online_cpus = syscpu.numOnline();
+        /* Limit kdump cpus to online cpus if (KDUMP_CPUS > online cpus) */
+        if (cpus > online_cpus)
+            cpus = online_cpus;
+    }
+    return cpus;
+}
+
+// -----------------------------------------------------------------------------
+const VmcoreAnalyzer *SaveDump::getAnalyzer()
+    throw (KError)
+{
+    if (m_analyzer)
+        return m_analyzer;
+    if (!m_image)
+        throw KError("The ELF headers of the dump could not be read.");
+
+    Configuration *config = Configuration::config();
+
+    unsigned long pageSize = sysconf(_SC_PAGESIZE);
+    Vmcoreinfo vm;
+    vm.readFromImage(*m_image);
+    if (vm.hasValue(Vmcoreinfo::ID_PAGESIZE))
+        pageSize = vm.getValue(Vmcoreinfo::ID_PAGESIZE);
+
+    int samples = config->KDUMP_ANALYZE_SAMPLES.value();
+    unsigned long cpus = dumpCpus();
+
+    auto_ptr<VmcoreAnalyzer> analyzer(new VmcoreAnalyzer(*m_image, pageSize));
+    analyzer->setSamples(samples > 0 ? samples : AUTO_FORMAT_SAMPLES);
+    analyzer->setThreads(cpus ? cpus : 1);
+    analyzer->analyze();
+    m_analyzer = analyzer.release();
+    return m_analyzer;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::chooseDumpFormat()
+    throw ()
+{
+    Debug::debug()->trace("SaveDump::chooseDumpFormat()");
+
+    Configuration *config = Configuration::config();
+
+    int dumplevel = m_dumplevel;
+
+    // NOSPLIT is the deprecated alias of SINGLE
+    unsigned long cpus = dumpCpus();
+    if (config->kdumptoolContainsFlag("SINGLE") ||
+        config->kdumptoolContainsFlag("NOSPLIT") || !cpus)
+        cpus = 1;
+
+    unsigned long long bandwidth = targetBandwidth();
+
+    // a split makedumpfile cannot be stopped at the deadline
+    bool canSplit = !dynamic_cast<RateLimitedTransfer *>(m_transfer) &&
+        !dynamic_cast<CompositeTransfer *>(m_transfer) && !m_deadline;
+
+    // fall back to the default format
+    m_dumpformat = "compressed";
+    try {
+        VmcoreAnalyzer::Plan plan =
+            getAnalyzer()->choose(dumplevel, cpus, bandwidth, canSplit);
+        m_dumpformat = VmcoreAnalyzer::formatName(plan.format);
+        m_split = plan.split;
+        m_threads = plan.threads;
+        m_formatChosen = true;
+
+        cout << "Dump format: " << m_dumpformat;
+        if (m_split)
+            cout << ", split into " << m_split << " parts";
+        else if (m_threads)
+            cout << ", " << m_threads << " threads";
+        cout << " (predicted " << (unsigned long)(plan.seconds + 0.5)
+             << " s";
+        if (!bandwidth)
+            cout << ", target bandwidth unknown";
+        cout << ")" << endl;
+    } catch (const KError &error) {
+        cerr << "WARNING: Cannot analyze the dump: " << error.what()
+             << endl;
+        cerr << "Using the " << m_dumpformat << " dump format." << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long SaveDump::targetBandwidth() const
+    throw ()
+{
+    unsigned long long bandwidth = m_bandwidth;
+    RateLimitedTransfer *limited =
+        dynamic_cast<RateLimitedTransfer *>(m_transfer);
+    if (limited && limited->getRate() &&
+        (!bandwidth || limited->getRate() < bandwidth))
+        bandwidth = limited->getRate();
+    return bandwidth;
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::analyzeDump(const RootDirURLVector &urlv)
+    throw (KError)
+{
+    Debug::debug()->trace("SaveDump::analyzeDump(%p)", &urlv);
+
+    VmcoreAnalyzer::Format format;
+    int dumplevel = m_dumplevel;
+    if (!VmcoreAnalyzer::parseFormat(m_dumpformat, format))
+        return;
+
+    unsigned long cpus = dumpCpus();
+    if (!cpus)
+        cpus = 1;
+
+    VmcoreAnalyzer::Estimate est;
+    double seconds;
+    try {
+        const VmcoreAnalyzer *analyzer = getAnalyzer();
+        est = analyzer->estimate(format, dumplevel);
+        seconds = analyzer->predictSeconds(format, dumplevel, cpus);
+    } catch (const KError &error) {
+        cerr << "WARNING: Cannot analyze the dump: " << error.what() << endl;
+        return;
+    }
+    if (!est.available)
+        return;
+
+    cout << "Predicted dump size: " << bytes_to_megabytes(est.size)
+         << " MiB (" << VmcoreAnalyzer::formatName(format) << "), about "
+         << (unsigned long)(seconds + 0.5) << " s of CPU time" << endl;
+
+    // the check only makes sense if all of the dump goes to local disks;
+    // every target gets a copy, so the one with least space counts
+    unsigned long long freeSize = ~0ULL;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        if (it->getProtocol() != URLParser::PROT_FILE)
+            return;
+        // the dump directory does not exist yet
+        FilePath path = it->getRealPath();
+        while (!path.exists() && path != "/")
+            path = path.dirName();
+        freeSize = std::min(freeSize, path.freeDiskSize());
+    }
+
+    if (est.size <= freeSize)
+        return;
+
+    string msg = "Predicted size " +
+        Stringutil::number2string(bytes_to_megabytes(est.size)) +
+        " MiB, free space " +
+        Stringutil::number2string(bytes_to_megabytes(freeSize)) + " MiB.";
+
+    // only the zero pages can be counted exactly; with other page types
+    // excluded, the estimate is an upper bound and the dump may still fit
+    if ((dumplevel & ~1) == 0)
+        throw KError("Dump too large. " + msg);
+    cerr << "WARNING: Dump may be too large. " << msg << endl;
+}
+
 // -----------------------------------------------------------------------------
 void SaveDump::checkAndDelete(const RootDirURLVector &urlv)
     throw (KError)
@@ -781,34 +1754,237 @@ Transfer *SaveDump::getTransfer(const RootDirURLVector &urlv)
     if (urlv.size() == 0)
 	throw KError("No target specified!");
 
+    // group the targets by protocol, keeping the configured order
+    std::vector<RootDirURLVector> groups;
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        std::vector<RootDirURLVector>::iterator git;
+        for (git = groups.begin(); git != groups.end(); ++git)
+            if (git->front().getProtocol() == it->getProtocol())
+                break;
+        if (git == groups.end())
+            groups.push_back(RootDirURLVector(1, *it));
+        else
+            git->push_back(*it);
+    }
+
+    if (groups.size() == 1)
+        return getProtocolTransfer(groups.front());
+
+    // mixed protocols: a target that cannot be set up is skipped
+    std::vector<Transfer *> children;
+    StringVector names;
+    std::vector<RootDirURLVector>::const_iterator git;
+    for (git = groups.begin(); git != groups.end(); ++git) {
+        try {
+            children.push_back(getProtocolTransfer(*git));
+            names.push_back(git->front().getProtocolAsString());
+        } catch (const KError &error) {
+            cerr << "WARNING: Skipping " << git->front().getProtocolAsString()
+                 << " targets: " << error.what() << endl;
+        }
+    }
+
+    if (children.empty())
+        throw KError("No usable dump target.");
+    if (children.size() == 1)
+        return children.front();
+
+    Debug::debug()->dbg("Returning CompositeTransfer");
+    return new CompositeTransfer(children, names);
+}
+
+// -----------------------------------------------------------------------------
+RootDirURL SaveDump::dumpDirURL(const RootDirURL &url, const string &subdir,
+                                const string &rootdir)
+    throw (KError)
+{
+    Configuration *config = Configuration::config();
+
+    FilePath elem = url.getBaseURL();
+    if (url.getProtocol() != URLParser::PROT_FILE) {
+        Routable rt(url.getHostname());
+        if (!rt.check(config->KDUMP_NET_TIMEOUT.value())) {
+            cerr << "WARNING: Dump target not reachable" << endl;
+            elem.appendPath(string("unknown-") + subdir);
+        } else
+            elem.appendPath(rt.prefsrc() + '-' + subdir);
+    } else
+        elem.appendPath(subdir);
+    // keep the transfer parameters behind the new path
+    if (!url.getQuery().empty())
+        elem += "?" + url.getQuery();
+    return RootDirURL(elem, rootdir);
+}
+
+// -----------------------------------------------------------------------------
+Transfer *SaveDump::getProtocolTransfer(const RootDirURLVector &urlv)
+    throw (KError)
+{
+    URLTransfer *transfer;
+
     switch (urlv.begin()->getProtocol()) {
         case URLParser::PROT_FILE:
             Debug::debug()->dbg("Returning FileTransfer");
-            return new FileTransfer(urlv);
+            transfer = new FileTransfer(urlv);
+            break;
 
         case URLParser::PROT_FTP:
             Debug::debug()->dbg("Returning FTPTransfer");
-            return new FTPTransfer(urlv);
+            transfer = new FTPTransfer(urlv);
+            break;
 
         case URLParser::PROT_SFTP:
             Debug::debug()->dbg("Returning SFTPTransfer");
-            return new SFTPTransfer(urlv);
+            transfer = new SFTPTransfer(urlv);
+            break;
 
         case URLParser::PROT_SSH:
 	    Debug::debug()->dbg("Returning SSHTransfer");
-	    return new SSHTransfer(urlv);
+	    transfer = new SSHTransfer(urlv);
+	    break;
 
         case URLParser::PROT_NFS:
             Debug::debug()->dbg("Returning NFSTransfer");
-            return new NFSTransfer(urlv);
+            transfer = new NFSTransfer(urlv);
+            break;
 
         case URLParser::PROT_CIFS:
             Debug::debug()->dbg("Returning CIFSTransfer");
-            return new CIFSTransfer(urlv);
+            transfer = new CIFSTransfer(urlv);
+            break;
 
         default:
             throw KError("Unknown protocol.");
     }
+
+    return RateLimitedTransfer::wrap(transfer, urlv);
+}
+
+// -----------------------------------------------------------------------------
+class SaveDump::ProbeThread : public Thread {
+
+    public:
+        ProbeThread(const RootDirURL &url, unsigned long long size)
+        throw ()
+            : m_url(url), m_size(size), m_speed(0)
+        {}
+
+        ~ProbeThread()
+        throw ()
+        { joinQuietly(); }
+
+        /**
+         * Returns the measured throughput in bytes per second.
+         */
+        double speed() const
+        throw ()
+        { return m_speed; }
+
+    protected:
+        void run()
+        throw (KError)
+        {
+            auto_ptr<Transfer> transfer(SaveDump::getProtocolTransfer(
+                RootDirURLVector(1, m_url)));
+            RateLimitedTransfer *limited =
+                dynamic_cast<RateLimitedTransfer *>(transfer.get());
+            if (limited)
+                limited->setStartDelay(0);
+            SyntheticDataProvider provider(m_size);
+
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            transfer->perform(&provider, PROBE_FILE, NULL);
+
+            // make sure that the data has left the page cache
+            if (m_url.getProtocol() == URLParser::PROT_FILE) {
+                FilePath fp = m_url.getRealPath();
+                fp.appendPath(PROBE_FILE);
+                int fd = open(fp.c_str(), O_RDONLY);
+                if (fd >= 0) {
+                    fsync(fd);
+                    close(fd);
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            double secs = (end.tv_sec - start.tv_sec) +
+                (end.tv_nsec - start.tv_nsec) / 1e9;
+            m_speed = m_size / (secs > 1e-6 ? secs : 1e-6);
+
+            try {
+                transfer->remove(PROBE_FILE);
+            } catch (const KError &error) {
+                cerr << "WARNING: Cannot remove probe file from "
+                     << m_url.getURL() << ": " << error.what() << endl;
+            }
+        }
+
+    private:
+        static const char PROBE_FILE[];
+
+        RootDirURL m_url;
+        unsigned long long m_size;
+        double m_speed;
+};
+
+const char SaveDump::ProbeThread::PROBE_FILE[] = ".kdump-probe";
+
+// -----------------------------------------------------------------------------
+void SaveDump::probeTargets(RootDirURLVector &targets,
+                            std::vector<unsigned> &weights)
+    throw (KError)
+{
+    Debug::debug()->trace("SaveDump::probeTargets(%p)", &targets);
+
+    Configuration *config = Configuration::config();
+    int sizemb = config->KDUMP_TARGET_PROBE_SIZE.value();
+    if (sizemb <= 0)
+        sizemb = 1;
+    unsigned long long size = (unsigned long long)sizemb << 20;
+
+    cout << "Probing " << targets.size() << " dump targets" << endl;
+
+    std::vector<ProbeThread *> threads;
+    RootDirURLVector::const_iterator it;
+    try {
+        for (it = targets.begin(); it != targets.end(); ++it) {
+            threads.push_back(new ProbeThread(*it, size));
+            threads.back()->start();
+        }
+    } catch (...) {
+        for (size_t i = 0; i < threads.size(); ++i)
+            delete threads[i];
+        throw;
+    }
+
+    RootDirURLVector usable;
+    weights.clear();
+    for (size_t i = 0; i < threads.size(); ++i) {
+        try {
+            threads[i]->join();
+            double speed = threads[i]->speed();
+            ostringstream ss;
+            ss << std::fixed << std::setprecision(1) << speed / (1 << 20);
+            cout << targets[i].getURL() << ": " << ss.str() << " MB/s"
+                 << endl;
+            usable.push_back(targets[i]);
+            unsigned kbps = (unsigned)(speed / 1024);
+            weights.push_back(kbps ? kbps : 1);
+        } catch (const KError &error) {
+            cerr << "WARNING: Probing " << targets[i].getURL()
+                 << " failed: " << error.what() << endl;
+        }
+        delete threads[i];
+    }
+
+    if (usable.empty()) {
+        cerr << "WARNING: No dump target passed the probe; using all."
+             << endl;
+        return;
+    }
+    targets = usable;
 }
 
 //}}}
@@ -19,12 +19,38 @@
 #ifndef SAVE_DUMP_H
 #define SAVE_DUMP_H
 
+#include <vector>
+
 #include "fileutil.h"
 #include "subcommand.h"
 #include "urlparser.h"
 #include "rootdirurl.h"
+#include "phasereport.h"
 
 class Transfer;
+class DataProvider;
+class VmcoreImage;
+class VmcoreAnalyzer;
+class MetricsSink;
+class MemoryMonitor;
+
+// file name of the first stage of KDUMP_TWO_STAGE
+#define FIRST_STAGE_FILE "vmcore.stage1"
+
+// README.txt of a dump and the lines that describe it
+#define README_FILE         "README.txt"
+#define README_TIME         "Crash time     : "
+#define README_KERNEL       "Kernel version : "
+#define README_HOST         "Host           : "
+#define README_LEVEL        "Dump level     : "
+#define README_FORMAT       "Dump format    : "
+
+// timing report, saved next to README.txt
+#define REPORT_FILE "save-report.json"
+
+// directory next to the dump directories where KDUMP_COPY_KERNEL stores
+// the kernel files under their SHA-256 digest
+#define KERNEL_CACHE_DIR ".kernels"
 
 //{{{ SaveDump -----------------------------------------------------------------
 
@@ -61,16 +87,257 @@ class SaveDump : public Subcommand {
         void execute()
         throw (KError);
 
+        /**
+         * Returns a Transfer object suitable for the provided URL.
+         * If the URLs use different protocols, a CompositeTransfer
+         * is returned that saves to all of them at once.
+         *
+         * @param[in] url the URL
+         * @return the Transfer object
+         *
+         * @exception KError if parsing the URL failed or there's no
+         *            implementation for that class.
+         */
+	static Transfer *getTransfer(const RootDirURLVector &urlv)
+	throw (KError);
+
+        /**
+         * Returns a Transfer object for URLs that all use the same
+         * protocol.
+         *
+         * @param[in] urlv the URLs
+         * @return the Transfer object
+         *
+         * @exception KError if there's no implementation for the protocol
+         *            or the Transfer cannot be created
+         */
+	static Transfer *getProtocolTransfer(const RootDirURLVector &urlv)
+	throw (KError);
+
+        /**
+         * Returns the URL of the directory for one dump below a target.
+         * On network targets, the directory name is prefixed with the
+         * source address that is used to reach the target.
+         *
+         * @param[in] url the target (KDUMP_SAVEDIR element)
+         * @param[in] subdir the dump directory name (crash time)
+         * @param[in] rootdir the root directory for local targets
+         * @return the URL, with the query of @p url
+         *
+         * @exception KError if the URL cannot be parsed
+         */
+        static RootDirURL dumpDirURL(const RootDirURL &url,
+                                     const std::string &subdir,
+                                     const std::string &rootdir)
+        throw (KError);
+
     protected:
-        void saveDump(const RootDirURLVector &urlv)
+        /**
+         * Saves dmesg and the dump. With KDUMP_SAVE_DEADLINE, cheaper
+         * settings are tried until the dump is saved in time (see
+         * degrade()), and if nothing helps, only dmesg and VMCOREINFO
+         * are saved.
+         *
+         * @param[in,out] urlv the dump targets; remote targets are
+         *                removed if they are given up for the deadline
+         */
+        void saveDump(RootDirURLVector &urlv)
         throw (KError);
 
+        /**
+         * Saves the output of makedumpfile --dump-dmesg as dmesg.txt.
+         * Errors are only logged.
+         */
+        void saveDmesg()
+        throw ();
+
+        /**
+         * Saves the dump with the current settings.
+         *
+         * @param[in] target file name of the dump (split parts are
+         *            always called vmcore1, vmcore2, ...)
+         * @param[in] seconds time left for saving, 0 for no limit
+         * @param[out] missed @c true if saving was stopped because
+         *             the time ran out (the partial dump is removed)
+         * @exception KError if saving failed for another reason
+         */
+        void saveVmcore(const std::string &target, double seconds,
+                        bool &missed)
+        throw (KError);
+
+        /**
+         * Saves the first stage of KDUMP_TWO_STAGE: a dump with dump
+         * level 31 that is never split. Errors are only logged, so
+         * the second stage is attempted in any case.
+         *
+         * @param[in] seconds time left for saving, 0 for no limit
+         */
+        void saveFirstStage(double seconds)
+        throw ();
+
+        /**
+         * Switches to the next cheaper settings for KDUMP_SAVE_DEADLINE:
+         * dump level 31, then the fastest compression, then only the
+         * local targets.
+         *
+         * @param[in,out] urlv the dump targets
+         * @return @c false if there is nothing left to give up
+         * @exception KError if the local targets cannot be used
+         */
+        bool degrade(RootDirURLVector &urlv)
+        throw (KError);
+
+        /**
+         * Saves only VMCOREINFO (dmesg has been saved before), as the
+         * last resort for KDUMP_SAVE_DEADLINE.
+         */
+        void saveMinimal()
+        throw (KError);
+
+        /**
+         * Records a concession made for KDUMP_SAVE_DEADLINE.
+         */
+        void sacrifice(const std::string &what)
+        throw ();
+
+        /**
+         * Returns the seconds left until KDUMP_SAVE_DEADLINE.
+         */
+        double timeLeft() const
+        throw ();
+
+        /**
+         * Predicts the seconds needed to save the dump with the current
+         * settings, or 0 if that cannot be predicted. If the dump level
+         * excludes more than zero pages, the prediction is an upper
+         * bound.
+         */
+        double predictDumpSeconds()
+        throw ();
+
+        /**
+         * Returns the measured or configured bandwidth of the dump
+         * targets in bytes per second, or 0 if unknown.
+         */
+        unsigned long long targetBandwidth() const
+        throw ();
+
         void copyMakedumpfile()
         throw (KError);
 
+        /**
+         * Samples the dump and prints the predicted size and save time
+         * for the configured dump format (see KDUMP_ANALYZE_SAMPLES).
+         *
+         * @param[in] urlv the dump targets
+         * @exception KError if the dump does not fit on the local
+         *            targets
+         */
+        void analyzeDump(const RootDirURLVector &urlv)
+        throw (KError);
+
+        /**
+         * Chooses the dump format and the number of threads or split
+         * parts for KDUMP_DUMPFORMAT="auto". Falls back to the
+         * "compressed" format if the dump cannot be analyzed.
+         */
+        void chooseDumpFormat()
+        throw ();
+
+        /**
+         * Returns the sampled dump, analyzing it on first use.
+         *
+         * @exception KError if the dump cannot be read
+         */
+        const VmcoreAnalyzer *getAnalyzer()
+        throw (KError);
+
+        /**
+         * Returns KDUMP_CPUS, limited to the number of online CPUs.
+         */
+        unsigned long dumpCpus() const
+        throw ();
+
         void generateInfo()
         throw (KError);
 
+        /**
+         * Does the work of execute() once the monitoring is running:
+         * sets up the targets and saves the dump and the files that
+         * go with it.
+         *
+         * @param[out] urlv the dump directories, as far as known
+         * @exception KError on any error
+         */
+        void saveToTargets(RootDirURLVector &urlv)
+        throw (KError);
+
+        /**
+         * Stops the metrics and the memory monitor, records the dump
+         * in the catalog and writes the report. This runs whether
+         * saving has succeeded or not.
+         *
+         * @param[in] urlv the dump directories
+         * @param[in] status the status of the dump for the catalog
+         */
+        void finish(const RootDirURLVector &urlv, const std::string &status)
+        throw ();
+
+        /**
+         * Logs the time spent in each phase and saves it as a JSON
+         * report next to README.txt.
+         */
+        void writeReport()
+        throw ();
+
+        /**
+         * Records the dump in the catalog of every local target.
+         *
+         * @param[in] urlv the dump directories
+         * @param[in] status the status of the dump (see DumpCatalog)
+         */
+        void updateCatalog(const RootDirURLVector &urlv,
+                           const std::string &status)
+        throw ();
+
+        /**
+         * Saves data with m_transfer and adds the number of bytes to
+         * the running phase.
+         *
+         * @param[in] expected expected number of bytes for the live
+         *            metrics (0: unknown)
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *provider, const StringVector &targets,
+                     bool *directSave = NULL,
+                     unsigned long long expected = 0)
+        throw (KError);
+
+        void perform(DataProvider *provider, const std::string &target,
+                     bool *directSave = NULL,
+                     unsigned long long expected = 0)
+        throw (KError);
+
+        /**
+         * Writes the marker file that makes upload_pending upload the
+         * dump from KDUMP_SPOOL.
+         */
+        void markUploadPending()
+        throw (KError);
+
+        /**
+         * Starts exporting live metrics if KDUMP_METRICS is set.
+         */
+        void startMetrics()
+        throw ();
+
+        /**
+         * Stops measuring the memory usage. In the kdump kernel, the
+         * peak usage is appended to the memory history for calibrate.
+         */
+        void recordMemory()
+        throw ();
+
         void generateRearrange()
         throw (KError);
 
@@ -80,6 +347,9 @@ class SaveDump : public Subcommand {
         void copyKernel()
         throw (KError);
 
+        void copyKernelFile(const FilePath &file, const std::string &what)
+        throw (KError);
+
         std::string findKernel()
         throw (KError);
 
@@ -96,32 +366,51 @@ class SaveDump : public Subcommand {
         throw (KError);
 
         /**
-         * Returns a Transfer object suitable for the provided URL.
+         * Measures the write throughput of each target in parallel
+         * (see KDUMP_TARGET_PROBE). Targets that fail the probe are
+         * removed from @p targets, unless all of them fail.
          *
-         * @param[in] url the URL
-         * @return the Transfer object
+         * @param[in,out] targets the dump targets
+         * @param[out] weights throughput of the remaining targets in
+         *             KiB/s, in the order of @p targets
          *
-         * @exception KError if parsing the URL failed or there's no
-         *            implementation for that class.
+         * @exception KError if the threads cannot be started
          */
-	Transfer *getTransfer(const RootDirURLVector &urlv)
-	throw (KError);
+        void probeTargets(RootDirURLVector &targets,
+                          std::vector<unsigned> &weights)
+        throw (KError);
 
     private:
         FilePath m_dump;
+        VmcoreImage *m_image;
+        VmcoreAnalyzer *m_analyzer;
         Transfer *m_transfer;
+        MetricsSink *m_metrics;
+        MemoryMonitor *m_memory;
         bool m_usedDirectSave;
         bool m_useMakedumpfile;
 	unsigned long m_split;
 	unsigned long m_threads;
+        std::string m_dumpformat;
+        bool m_formatChosen;
+        unsigned long long m_bandwidth;
+        bool m_weighted;
+        int m_dumplevel;
+        double m_deadline;
+        StringVector m_sacrificed;
+        std::string m_firstStage;
+        bool m_firstStageFlattened;
         unsigned long long m_crashtime;
         std::string m_crashrelease;
         std::string m_rootdir;
         std::string m_hostname;
         bool m_nomail;
+        PhaseReport m_report;
 
         void check_one(const RootDirURL &parser)
         throw (KError);
+
+        class ProbeThread;
 };
 
 //}}}
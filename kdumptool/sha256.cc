@@ -0,0 +1,213 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "sha256.h"
+
+using std::string;
+
+// size of one read() in fileDigest()
+#define SHA256_READSIZE     (64*1024)
+
+//{{{ Sha256 -------------------------------------------------------------------
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, unsigned n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+// -----------------------------------------------------------------------------
+Sha256::Sha256()
+    throw ()
+{
+    reset();
+}
+
+// -----------------------------------------------------------------------------
+void Sha256::reset()
+    throw ()
+{
+    m_state[0] = 0x6a09e667;
+    m_state[1] = 0xbb67ae85;
+    m_state[2] = 0x3c6ef372;
+    m_state[3] = 0xa54ff53a;
+    m_state[4] = 0x510e527f;
+    m_state[5] = 0x9b05688c;
+    m_state[6] = 0x1f83d9ab;
+    m_state[7] = 0x5be0cd19;
+    m_length = 0;
+    m_used = 0;
+}
+
+// -----------------------------------------------------------------------------
+void Sha256::transform(const unsigned char *block)
+    throw ()
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+        w[i] = (uint32_t(block[4*i]) << 24) |
+            (uint32_t(block[4*i + 1]) << 16) |
+            (uint32_t(block[4*i + 2]) << 8) |
+            uint32_t(block[4*i + 3]);
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = ror(w[i-15], 7) ^ ror(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ror(w[i-2], 17) ^ ror(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t s1 = ror(e, 6) ^ ror(e, 11) ^ ror(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + K[i] + w[i];
+        uint32_t s0 = ror(a, 2) ^ ror(a, 13) ^ ror(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+// -----------------------------------------------------------------------------
+void Sha256::update(const void *data, size_t len)
+    throw ()
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    m_length += len;
+
+    if (m_used) {
+        size_t n = sizeof m_block - m_used;
+        if (n > len)
+            n = len;
+        memcpy(m_block + m_used, p, n);
+        m_used += n;
+        p += n;
+        len -= n;
+        if (m_used < sizeof m_block)
+            return;
+        transform(m_block);
+        m_used = 0;
+    }
+
+    while (len >= sizeof m_block) {
+        transform(p);
+        p += sizeof m_block;
+        len -= sizeof m_block;
+    }
+
+    memcpy(m_block, p, len);
+    m_used = len;
+}
+
+// -----------------------------------------------------------------------------
+string Sha256::hexDigest()
+    throw ()
+{
+    static const char hex[] = "0123456789abcdef";
+    uint64_t bits = m_length * 8;
+
+    unsigned char pad[72];
+    size_t padlen = (m_used < 56 ? 56 : 120) - m_used;
+    memset(pad, 0, sizeof pad);
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; ++i)
+        pad[padlen + i] = (unsigned char)(bits >> (56 - 8*i));
+    update(pad, padlen + 8);
+
+    string ret;
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 24; j >= 0; j -= 8) {
+            unsigned char byte = (m_state[i] >> j) & 0xff;
+            ret += hex[byte >> 4];
+            ret += hex[byte & 0x0f];
+        }
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+string Sha256::fileDigest(const string &filename)
+    throw (KError)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + filename + ".", errno);
+
+    Sha256 sha;
+    char buffer[SHA256_READSIZE];
+    ssize_t len;
+    while ((len = read(fd, buffer, sizeof buffer)) != 0) {
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            int err = errno;
+            close(fd);
+            throw KSystemError("Cannot read " + filename + ".", err);
+        }
+        sha.update(buffer, len);
+    }
+    close(fd);
+
+    return sha.hexDigest();
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
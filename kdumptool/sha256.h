@@ -0,0 +1,96 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <string>
+#include <stdint.h>
+
+#include "global.h"
+
+//{{{ Sha256 -------------------------------------------------------------------
+
+/**
+ * Streaming SHA-256 (FIPS 180-4).
+ *
+ * kdumptool must not depend on a crypto library in the kdump kernel,
+ * so this is a small self-contained implementation. It is only used
+ * to name content-addressed files, not for anything security related.
+ */
+class Sha256 {
+
+    public:
+        /**
+         * Length of the digest in bytes.
+         */
+        static const size_t DIGEST_LENGTH = 32;
+
+        /**
+         * Creates a new hash context.
+         */
+        Sha256()
+        throw ();
+
+        /**
+         * Starts a new hash.
+         */
+        void reset()
+        throw ();
+
+        /**
+         * Adds data to the hash.
+         *
+         * @param[in] data the data
+         * @param[in] len number of bytes in @p data
+         */
+        void update(const void *data, size_t len)
+        throw ();
+
+        /**
+         * Finishes the hash and returns the digest as lowercase hex
+         * digits. The context must be reset() before it is used again.
+         */
+        std::string hexDigest()
+        throw ();
+
+        /**
+         * Computes the digest of a file.
+         *
+         * @param[in] filename the file
+         * @return the digest as lowercase hex digits
+         * @exception KError if the file cannot be read
+         */
+        static std::string fileDigest(const std::string &filename)
+        throw (KError);
+
+    private:
+        uint32_t m_state[8];
+        uint64_t m_length;
+        unsigned char m_block[64];
+        size_t m_used;
+
+        void transform(const unsigned char *block)
+        throw ();
+};
+
+//}}}
+
+#endif /* SHA256_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -17,11 +17,16 @@
  * 02110-1301, USA.
  */
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <algorithm>
+#include <stdexcept>
 #include <cstdlib>
 #include <cerrno>
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "global.h"
 #include "debug.h"
@@ -32,11 +37,26 @@
 #include "socket.h"
 #include "sshtransfer.h"
 #include "routable.h"
+#include "bufferpool.h"
+#include "quotedstring.h"
 
 using std::string;
 using std::cerr;
 using std::endl;
 
+// preferred size of one write to the ssh pipe (see BufferPool)
+#define SSH_IOSIZE          (256*1024)
+
+// largest SSH_FXP_WRITE that fits into the 34000 byte packets every server
+// should accept (draft-ietf-secsh-filexfer-02, section 3)
+#define SFTP_MAX_WRITE      32768
+
+// number of SFTP requests in flight in SFTPTransfer::checkStatus()
+#define SFTP_PIPELINE       32
+
+// number of directories removed by one ssh command
+#define SSH_RMDIR_BATCH     64
+
 //{{{ SSHTransfer -------------------------------------------------------------
 
 /* -------------------------------------------------------------------------- */
@@ -106,17 +126,20 @@ void SSHTransfer::perform(DataProvider *dataprovider,
 
     int fd = p.getPipeFD(STDIN_FILENO);
     try {
+        PoolBuffer buffer(SSH_IOSIZE, BUFSIZ);
+
         dataprovider->prepare();
         prepared = true;
 
         while (true) {
-            size_t read_data = dataprovider->getData(m_buffer, BUFSIZ);
+            size_t read_data = dataprovider->getData(buffer.data(),
+                                                     buffer.size());
 
             // finished?
             if (read_data == 0)
                 break;
 
-	    char *p = m_buffer;
+	    char *p = buffer.data();
 	    while (read_data) {
 		ssize_t ret = write(fd, p, read_data);
 
@@ -142,6 +165,150 @@ void SSHTransfer::perform(DataProvider *dataprovider,
 		     " with status " + Stringutil::number2string(status));
 }
 
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::remove(const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("SSHTransfer::remove(%s)", target_file.c_str());
+
+    FilePath fp = getURLVector().front().getPath();
+    fp.appendPath(target_file);
+
+    string script;
+    script.assign("rm -f ").append(ShellQuotedString(fp).quoted());
+    string remote = "sh -c " + ShellQuotedString(script).quoted();
+
+    SubProcess p;
+    p.spawn("ssh", makeArgs(remote));
+    int status = p.wait();
+    if (status != 0)
+	throw KError("SSHTransfer::remove: ssh command failed"
+		     " with status " + Stringutil::number2string(status));
+}
+
+/* -------------------------------------------------------------------------- */
+bool SSHTransfer::exists(const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("SSHTransfer::exists(%s)", target_file.c_str());
+
+    FilePath fp = getURLVector().front().getPath();
+    fp.appendPath(target_file);
+
+    string script;
+    script.assign("test -e ").append(ShellQuotedString(fp).quoted());
+    string remote = "sh -c " + ShellQuotedString(script).quoted();
+
+    SubProcess p;
+    p.spawn("ssh", makeArgs(remote));
+    int status = p.wait();
+    if (status == 0)
+	return true;
+    // test(1) exits with 1 if the file does not exist, ssh with 255
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 1)
+	return false;
+    throw KError("SSHTransfer::exists: ssh command failed"
+		 " with status " + Stringutil::number2string(status));
+}
+
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::link(const std::string &source_file,
+		       const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("SSHTransfer::link(%s, %s)",
+			  source_file.c_str(), target_file.c_str());
+
+    const RootDirURL &target = getURLVector().front();
+    FilePath src = target.getPath();
+    src.appendPath(source_file);
+    FilePath dst = target.getPath();
+    dst.appendPath(target_file);
+
+    string qsrc = ShellQuotedString(src).quoted();
+    string qdst = ShellQuotedString(dst).quoted();
+    string qtmp = ShellQuotedString(dst + ".tmp").quoted();
+
+    // hard link if possible, otherwise copy
+    string script;
+    script.assign("mkdir -p ")
+	.append(ShellQuotedString(dst.dirName()).quoted())
+	.append(" || exit 1; ln -f ").append(qsrc).append(" ").append(qdst)
+	.append(" 2>/dev/null && exit 0; cp --reflink=auto ").append(qsrc)
+	.append(" ").append(qtmp).append(" && mv -f ").append(qtmp)
+	.append(" ").append(qdst);
+    string remote = "sh -c " + ShellQuotedString(script).quoted();
+
+    SubProcess p;
+    p.spawn("ssh", makeArgs(remote));
+    int status = p.wait();
+    if (status != 0)
+	throw KError("SSHTransfer::link: ssh command failed"
+		     " with status " + Stringutil::number2string(status));
+}
+
+/* -------------------------------------------------------------------------- */
+StringVector SSHTransfer::listDirs()
+    throw (KError)
+{
+    Debug::debug()->trace("SSHTransfer::listDirs()");
+
+    FilePath fp = getURLVector().front().getPath();
+
+    // the login shell of the remote user need not be a Bourne shell
+    string script;
+    script.assign("cd ").append(ShellQuotedString(fp).quoted())
+	.append(" || exit 1; for d in */; do test -d \"$d\" &&"
+		" echo \"${d%/}\"; done; exit 0");
+    string remote = "sh -c " + ShellQuotedString(script).quoted();
+
+    ProcessFilter p;
+    std::ostringstream out;
+    p.setStdout(&out);
+    int status = p.execute("ssh", makeArgs(remote));
+    if (status != 0)
+	throw KError("SSHTransfer::listDirs: ssh command failed"
+		     " with status " + Stringutil::number2string(status));
+
+    StringVector ret;
+    std::istringstream iss(out.str());
+    string line;
+    while (std::getline(iss, line))
+	if (!line.empty() && line[0] != '.')
+	    ret.push_back(line);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    Debug::debug()->trace("SSHTransfer::removeDirs(%lu)",
+			  (unsigned long)dirs.size());
+
+    FilePath fp = getURLVector().front().getPath();
+    string error;
+    StringVector::const_iterator it = dirs.begin();
+    while (it != dirs.end()) {
+	string script;
+	script.assign("cd ").append(ShellQuotedString(fp).quoted())
+	    .append(" && rm -rf --");
+	for (int n = 0; n < SSH_RMDIR_BATCH && it != dirs.end(); ++n, ++it)
+	    script.append(" ").append(ShellQuotedString(*it).quoted());
+	string remote = "sh -c " + ShellQuotedString(script).quoted();
+
+	SubProcess p;
+	p.spawn("ssh", makeArgs(remote));
+	int status = p.wait();
+	if (status != 0 && error.empty())
+	    error = "SSHTransfer::removeDirs: ssh command failed"
+		" with status " + Stringutil::number2string(status);
+    }
+    if (!error.empty())
+	throw KError(error);
+}
+
 StringVector SSHTransfer::makeArgs(std::string const &remote)
 {
     const RootDirURL &target = getURLVector().front();
@@ -335,7 +502,10 @@ void SFTPPacket::addString(KString const &val)
 std::string SFTPPacket::getString(void)
 {
     unsigned long len = getInt32();
+    if (len > m_vector.size() - m_gpos)
+	throw std::out_of_range("SFTPPacket::getString");
     ByteVector::iterator it = m_vector.begin() + m_gpos;
+    m_gpos += len;
     return string(it, it + len);
 }
 
@@ -432,7 +602,7 @@ void SFTPTransfer::perform(DataProvider *dataprovider,
     string handle = createfile(fp);
     try {
 	dataprovider->prepare();
-	ByteVector buffer(BUFSIZ);
+	ByteVector buffer(SFTP_MAX_WRITE);
 	off_t off = 0;
 	try {
 	    while (true) {
@@ -462,9 +632,136 @@ void SFTPTransfer::perform(DataProvider *dataprovider,
 }
 
 /* -------------------------------------------------------------------------- */
-bool SFTPTransfer::exists(const string &file)
+void SFTPTransfer::remove(const std::string &target_file)
+    throw (KError)
+{
+    FilePath fp = getURLVector().front().getPath();
+    fp.appendPath(target_file);
+    removefile(fp);
+}
+
+/* -------------------------------------------------------------------------- */
+bool SFTPTransfer::exists(const std::string &target_file)
+    throw (KError)
 {
-    Debug::debug()->trace("SFTPTransfer::exists(%s)", file.c_str());
+    FilePath fp = getURLVector().front().getPath();
+    fp.appendPath(target_file);
+    return existsPath(fp);
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::link(const std::string &source_file,
+			const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("SFTPTransfer::link(%s, %s)",
+			  source_file.c_str(), target_file.c_str());
+
+    const RootDirURL &target = getURLVector().front();
+    FilePath src = target.getPath();
+    src.appendPath(source_file);
+    FilePath dst = target.getPath();
+    dst.appendPath(target_file);
+
+    mkpath(dst.dirName());
+    if (existsPath(dst))
+	removefile(dst);
+
+    SFTPPacket pkt;
+    pkt.addByte(SSH_FXP_EXTENDED);
+    pkt.addInt32(nextId());
+    pkt.addString("hardlink@openssh.com");
+    pkt.addString(src);
+    pkt.addString(dst);
+    sendPacket(pkt);
+
+    recvPacket(pkt);
+    unsigned char type = pkt.getByte();
+    unsigned long id = pkt.getInt32();
+    if (id != m_lastid)
+	throw KError("SFTP request/reply id mismatch");
+
+    if (type != SSH_FXP_STATUS)
+	throw KError("Invalid response to SSH_FXP_EXTENDED: type " +
+		     Stringutil::number2string(unsigned(type)));
+
+    unsigned long errcode = pkt.getInt32();
+    if (errcode != SSH_FX_OK)
+	throw KSFTPError("link failed on " + dst, errcode);
+}
+
+/* -------------------------------------------------------------------------- */
+StringVector SFTPTransfer::listDirs()
+    throw (KError)
+{
+    Debug::debug()->trace("SFTPTransfer::listDirs()");
+
+    StringVector files, dirs, ret;
+    readdir(getURLVector().front().getPath(), files, dirs);
+    for (StringVector::const_iterator it = dirs.begin();
+	 it != dirs.end(); ++it)
+	if ((*it)[0] != '.')
+	    ret.push_back(*it);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    Debug::debug()->trace("SFTPTransfer::removeDirs(%lu)",
+			  (unsigned long)dirs.size());
+
+    const RootDirURL &target = getURLVector().front();
+    StringVector files, rmdirs;
+    string error;
+
+    for (StringVector::const_iterator it = dirs.begin();
+	 it != dirs.end(); ++it) {
+	FilePath top = target.getPath();
+	top.appendPath(*it);
+	try {
+	    if (!existsPath(top))
+		continue;
+
+	    // subdirectories are appended while the list is walked
+	    StringVector queue(1, top);
+	    for (size_t i = 0; i < queue.size(); ++i) {
+		StringVector f, d;
+		readdir(queue[i], f, d);
+		StringVector::const_iterator nit;
+		for (nit = f.begin(); nit != f.end(); ++nit) {
+		    FilePath fp = queue[i];
+		    files.push_back(fp.appendPath(*nit));
+		}
+		for (nit = d.begin(); nit != d.end(); ++nit) {
+		    FilePath fp = queue[i];
+		    queue.push_back(fp.appendPath(*nit));
+		}
+	    }
+	    // children before their parents
+	    rmdirs.insert(rmdirs.end(), queue.rbegin(), queue.rend());
+	} catch (const KError &kerror) {
+	    if (error.empty())
+		error = kerror.what();
+	}
+    }
+
+    string rmerror = checkStatus("remove", files, SSH_FXP_REMOVE);
+    if (error.empty())
+	error = rmerror;
+    rmerror = checkStatus("rmdir", rmdirs, SSH_FXP_RMDIR);
+    if (error.empty())
+	error = rmerror;
+    if (!error.empty())
+	throw KError(error);
+}
+
+/* -------------------------------------------------------------------------- */
+bool SFTPTransfer::existsPath(const string &file)
+{
+    Debug::debug()->trace("SFTPTransfer::existsPath(%s)", file.c_str());
 
     SFTPPacket pkt;
     pkt.addByte(SSH_FXP_STAT);
@@ -497,7 +794,7 @@ void SFTPTransfer::mkpath(const std::string &path)
 {
     Debug::debug()->trace("SFTPTransfer::mkpath(%s)", path.c_str());
 
-    if (!exists(path)) {
+    if (!existsPath(path)) {
 	KString dir = path;
 	dir.rtrim(PATH_SEPARATOR);
 	KString::size_type pos = dir.rfind(PATH_SEPARATOR);
@@ -585,6 +882,167 @@ void SFTPTransfer::closefile(const std::string &handle)
 	throw KSFTPError("close failed on " + handle, errcode);
 }
 
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::removefile(const std::string &file)
+{
+    Debug::debug()->trace("SFTPTransfer::removefile(%s)", file.c_str());
+
+    SFTPPacket pkt;
+    pkt.addByte(SSH_FXP_REMOVE);
+    pkt.addInt32(nextId());
+    pkt.addString(file);
+    sendPacket(pkt);
+
+    recvPacket(pkt);
+    unsigned char type = pkt.getByte();
+    unsigned long id = pkt.getInt32();
+    if (id != m_lastid)
+	throw KError("SFTP request/reply id mismatch");
+
+    if (type != SSH_FXP_STATUS)
+	throw KError("Invalid response to SSH_FXP_REMOVE: type " +
+		     Stringutil::number2string(unsigned(type)));
+
+    unsigned long errcode = pkt.getInt32();
+    if (errcode != SSH_FX_OK && errcode != SSH_FX_NO_SUCH_FILE)
+	throw KSFTPError("remove failed on " + file, errcode);
+}
+
+/* -------------------------------------------------------------------------- */
+void SFTPTransfer::readdir(const std::string &dir, StringVector &files,
+			   StringVector &dirs)
+{
+    Debug::debug()->trace("SFTPTransfer::readdir(%s)", dir.c_str());
+
+    SFTPPacket pkt;
+    pkt.addByte(SSH_FXP_OPENDIR);
+    pkt.addInt32(nextId());
+    pkt.addString(dir);
+    sendPacket(pkt);
+
+    recvPacket(pkt);
+    unsigned char type = pkt.getByte();
+    unsigned long id = pkt.getInt32();
+    if (id != m_lastid)
+	throw KError("SFTP request/reply id mismatch");
+
+    if (type == SSH_FXP_STATUS)
+	throw KSFTPError("opendir failed on " + dir, pkt.getInt32());
+    if (type != SSH_FXP_HANDLE)
+	throw KError("Invalid response to SSH_FXP_OPENDIR: type " +
+		     Stringutil::number2string(unsigned(type)));
+    string handle = pkt.getString();
+
+    try {
+	while (true) {
+	    SFTPPacket pkt;
+	    pkt.addByte(SSH_FXP_READDIR);
+	    pkt.addInt32(nextId());
+	    pkt.addString(handle);
+	    sendPacket(pkt);
+
+	    recvPacket(pkt);
+	    type = pkt.getByte();
+	    id = pkt.getInt32();
+	    if (id != m_lastid)
+		throw KError("SFTP request/reply id mismatch");
+
+	    if (type == SSH_FXP_STATUS) {
+		unsigned long errcode = pkt.getInt32();
+		if (errcode == SSH_FX_EOF)
+		    break;
+		throw KSFTPError("readdir failed on " + dir, errcode);
+	    }
+	    if (type != SSH_FXP_NAME)
+		throw KError("Invalid response to SSH_FXP_READDIR: type " +
+			     Stringutil::number2string(unsigned(type)));
+
+	    unsigned long count = pkt.getInt32();
+	    while (count--) {
+		string name = pkt.getString();
+		pkt.getString();	// longname
+		unsigned long flags = pkt.getInt32();
+		unsigned long perms = 0;
+		if (flags & SSH_FILEXFER_ATTR_SIZE)
+		    pkt.getInt64();
+		if (flags & SSH_FILEXFER_ATTR_UIDGID) {
+		    pkt.getInt32();
+		    pkt.getInt32();
+		}
+		if (flags & SSH_FILEXFER_ATTR_PERMISSIONS)
+		    perms = pkt.getInt32();
+		if (flags & SSH_FILEXFER_ATTR_ACMODTIME) {
+		    pkt.getInt32();
+		    pkt.getInt32();
+		}
+		if (flags & SSH_FILEXFER_ATTR_EXTENDED) {
+		    unsigned long n = pkt.getInt32();
+		    while (n--) {
+			pkt.getString();
+			pkt.getString();
+		    }
+		}
+
+		if (name == "." || name == "..")
+		    continue;
+		if ((flags & SSH_FILEXFER_ATTR_PERMISSIONS) && S_ISDIR(perms))
+		    dirs.push_back(name);
+		else
+		    files.push_back(name);
+	    }
+	}
+    } catch (...) {
+	closefile(handle);
+	throw;
+    }
+    closefile(handle);
+}
+
+/* -------------------------------------------------------------------------- */
+std::string SFTPTransfer::checkStatus(const std::string &what,
+				      const StringVector &paths,
+				      unsigned char type)
+{
+    Debug::debug()->trace("SFTPTransfer::checkStatus(%s, %lu)",
+			  what.c_str(), (unsigned long)paths.size());
+
+    // keep several requests in flight, but not so many that the server
+    // blocks on its replies while we block on the next request
+    const unsigned long mask = (1UL << 32) - 1;
+    unsigned long first = (m_lastid + 1) & mask;
+    size_t sent = 0, received = 0;
+    string error;
+    while (received < paths.size()) {
+	while (sent < paths.size() && sent - received < SFTP_PIPELINE) {
+	    SFTPPacket pkt;
+	    pkt.addByte(type);
+	    pkt.addInt32(nextId());
+	    pkt.addString(paths[sent]);
+	    sendPacket(pkt);
+	    ++sent;
+	}
+
+	SFTPPacket pkt;
+	recvPacket(pkt);
+	unsigned char rtype = pkt.getByte();
+	unsigned long idx = (pkt.getInt32() - first) & mask;
+	if (idx >= sent)
+	    throw KError("SFTP request/reply id mismatch");
+	++received;
+
+	if (rtype != SSH_FXP_STATUS)
+	    throw KError("Invalid response to SFTP " + what + ": type " +
+			 Stringutil::number2string(unsigned(rtype)));
+
+	unsigned long errcode = pkt.getInt32();
+	if (errcode != SSH_FX_OK && errcode != SSH_FX_NO_SUCH_FILE &&
+	    error.empty())
+	    error = KSFTPError(what + " failed on " + paths[idx],
+			       errcode).what();
+    }
+    return error;
+}
+
 /* -------------------------------------------------------------------------- */
 void SFTPTransfer::writefile(const std::string &handle, off_t off,
 			     const ByteVector &data)
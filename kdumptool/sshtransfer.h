@@ -60,9 +60,51 @@ class SSHTransfer : public URLTransfer {
                      bool *directSave)
         throw (KError);
 
-    private:
-        char m_buffer[BUFSIZ];
+        /**
+         * Removes the file on the remote host.
+         *
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Checks the file on the remote host.
+         *
+         * @see Transfer::exists()
+         */
+        bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Hard-links the file on the remote host. If that fails, the
+         * file is copied on the remote host (as a reflink where the
+         * file system supports it), so the data is not sent again.
+         *
+         * @see Transfer::link()
+         */
+        void link(const std::string &source_file,
+                  const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Lists the target directory on the remote host.
+         *
+         * @see Transfer::listDirs()
+         */
+        StringVector listDirs()
+        throw (KError);
+
+        /**
+         * Removes the directories on the remote host, many of them
+         * with each ssh command.
+         *
+         * @see Transfer::removeDirs()
+         */
+        void removeDirs(const StringVector &dirs)
+        throw (KError);
 
+    private:
 	StringVector makeArgs(std::string const &remote);
 };
 
@@ -125,11 +167,17 @@ enum {
     SSH_FXP_OPEN	=   3,
     SSH_FXP_CLOSE	=   4,
     SSH_FXP_WRITE	=   6,
+    SSH_FXP_OPENDIR	=  11,
+    SSH_FXP_READDIR	=  12,
+    SSH_FXP_REMOVE	=  13,
     SSH_FXP_MKDIR	=  14,
+    SSH_FXP_RMDIR	=  15,
     SSH_FXP_STAT	=  17,
     SSH_FXP_STATUS	= 101,
     SSH_FXP_HANDLE	= 102,
+    SSH_FXP_NAME	= 104,
     SSH_FXP_ATTRS	= 105,
+    SSH_FXP_EXTENDED	= 200,
 };
 
 /**
@@ -144,6 +192,17 @@ enum {
     SSH_FXF_EXCL	= 0x00000020,
 };
 
+/**
+ * Attribute flags (protocol version 3)
+ */
+enum {
+    SSH_FILEXFER_ATTR_SIZE		= 0x00000001,
+    SSH_FILEXFER_ATTR_UIDGID		= 0x00000002,
+    SSH_FILEXFER_ATTR_PERMISSIONS	= 0x00000004,
+    SSH_FILEXFER_ATTR_ACMODTIME		= 0x00000008,
+    SSH_FILEXFER_ATTR_EXTENDED		= 0x80000000,
+};
+
 /**
  * Encode/decode an SFTP packet.
  */
@@ -224,13 +283,63 @@ class SFTPTransfer : public URLTransfer {
                      bool *directSave)
         throw (KError);
 
+        /**
+         * Removes the file on the remote host.
+         *
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Checks the file on the remote host.
+         *
+         * @see Transfer::exists()
+         */
+        bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Hard-links the file on the remote host, using the
+         * hardlink@openssh.com extension.
+         *
+         * @see Transfer::link()
+         */
+        void link(const std::string &source_file,
+                  const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Lists the target directory on the remote host.
+         *
+         * @see Transfer::listDirs()
+         */
+        StringVector listDirs()
+        throw (KError);
+
+        /**
+         * Lists the directories and removes their contents. The
+         * SSH_FXP_REMOVE and SSH_FXP_RMDIR requests are pipelined, so
+         * many files are removed per round trip.
+         *
+         * @see Transfer::removeDirs()
+         */
+        void removeDirs(const StringVector &dirs)
+        throw (KError);
+
     protected:
 	static const int MY_PROTO_VER = 3; // our advertised version
 
-        bool exists(const std::string &file);
+        bool existsPath(const std::string &file);
         void mkpath(const std::string &path);
 	std::string createfile(const std::string &file);
 	void closefile(const std::string &handle);
+	void removefile(const std::string &file);
+	void readdir(const std::string &dir, StringVector &files,
+		     StringVector &dirs);
+	std::string checkStatus(const std::string &what,
+				const StringVector &paths,
+				unsigned char type);
 	void writefile(const std::string &handle, off_t off,
 		       const ByteVector &data);
 
@@ -23,6 +23,7 @@
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <cstdio>
 
 #include "stringutil.h"
 #include "global.h"
@@ -196,6 +197,37 @@ string Stringutil::join(const StringVector &stringvector, char joinchar)
     return result;
 }
 
+// -----------------------------------------------------------------------------
+string Stringutil::quoteJSON(const string &string)
+    throw ()
+{
+    std::string result("\"");
+
+    for (std::string::const_iterator it = string.begin();
+            it != string.end(); ++it) {
+        unsigned char c = *it;
+        switch (c) {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[7];
+                    snprintf(buf, sizeof buf, "\\u%04x", c);
+                    result += buf;
+                } else
+                    result += c;
+        }
+    }
+
+    result += '"';
+    return result;
+}
+
 // -----------------------------------------------------------------------------
 string Stringutil::formatUnixTime(const char *formatstring, time_t value)
     throw ()
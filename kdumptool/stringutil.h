@@ -163,6 +163,16 @@ class Stringutil {
         static std::string join(const StringVector &stringvector,
                                 char joinchar)
         throw ();
+
+        /**
+         * Quotes a string for use as a JSON string value.
+         *
+         * @param[in] string the raw string
+         * @return the string in double quotes, with special characters
+         *         escaped
+         */
+        static std::string quoteJSON(const std::string &string)
+        throw ();
          
 
         /**
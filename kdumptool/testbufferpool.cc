@@ -0,0 +1,130 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <stdexcept>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "configuration.h"
+#include "bufferpool.h"
+#include "debug.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+static int errors;
+
+// -----------------------------------------------------------------------------
+static void check(bool ok, const string &what)
+{
+    if (!ok) {
+        cout << "FAILED: " << what << endl;
+        ++errors;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static bool aligned(const char *buffer)
+{
+    return (uintptr_t)buffer % sysconf(_SC_PAGESIZE) == 0;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3) {
+        cerr << "Usage: " << argv[0] << " configfile [budget]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+    try {
+        Configuration::config()->readFile(argv[1]);
+
+        BufferPool *pool = BufferPool::pool();
+        unsigned long long budget = pool->getBudget();
+        unsigned long long avail = pool->getMemAvailable();
+        if (avail >= 100)
+            cout << "budget: " << budget / (avail / 100) << "%" << endl;
+        if (argc == 3)
+            return EXIT_SUCCESS;
+
+        // more than the whole budget
+        size_t maximum = 4096;
+        while (maximum < 4 * budget)
+            maximum *= 2;
+
+        size_t size = pool->bufferSize(maximum, 4096);
+        check(size <= budget && 2 * size > budget,
+              "one buffer is halved until it fits");
+        size = pool->bufferSize(maximum, 4096, 4);
+        check(4 * size <= budget && 8 * size > budget,
+              "four buffers are halved until they fit");
+        check(pool->bufferSize(maximum, maximum) == maximum,
+              "the minimum is returned if nothing fits");
+        check(pool->bufferSize(4096, 512) == 4096,
+              "the maximum is returned if it fits");
+
+        // allocations reduce the rest of the budget
+        size = pool->bufferSize(maximum, 4096, 2);
+        char *first = pool->allocate(size);
+        check(aligned(first), "buffers are page-aligned");
+        first[0] = first[size - 1] = 'x';
+        check(pool->getUsed() >= size, "allocated bytes are counted");
+        size_t rest = pool->bufferSize(maximum, 4096);
+        check(rest <= budget - pool->getUsed() || rest == 4096,
+              "allocated bytes are not available any more");
+        char *second = pool->allocate(4096);
+        check(aligned(second), "small buffers are page-aligned");
+
+        // releasing gives the memory back
+        pool->release(first);
+        pool->release(first);
+        pool->release(NULL);
+        check(pool->getUsed() >= 4096 && pool->getUsed() < size,
+              "releasing a buffer twice is harmless");
+        pool->release(second);
+        check(pool->getUsed() == 0, "all buffers are released");
+
+        size = pool->bufferSize(maximum, 4096);
+        {
+            PoolBuffer buffer(maximum, 4096);
+            check(buffer.size() == size, "PoolBuffer uses the budget");
+            check(aligned(buffer.data()), "PoolBuffer is page-aligned");
+            check(pool->getUsed() >= buffer.size(),
+                  "PoolBuffer is counted");
+        }
+        check(pool->getUsed() == 0, "PoolBuffer is released");
+
+        cout << "used: " << pool->getUsed() << endl;
+
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
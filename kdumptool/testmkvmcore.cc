@@ -0,0 +1,207 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Writes a fake ELF vmcore: a PT_NOTE segment with VMCOREINFO and a
+ * number of PT_LOAD segments filled with generated data (half of the
+ * pages are zero, like in a real dump).
+ *
+ * If a CPU count is given, a separate PT_NOTE segment with one
+ * NT_PRSTATUS note per CPU is put before the VMCOREINFO segment.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <elf.h>
+
+#include "global.h"
+#include "dataprovider.h"
+#include "stringutil.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::ofstream;
+
+#define PAGE_SIZE       4096
+#define PRSTATUS_SIZE   336
+#define LOAD_VADDR      0xffff880000000000ULL
+
+#if defined(__x86_64__)
+# define HOST_MACHINE   EM_X86_64
+#elif defined(__aarch64__)
+# define HOST_MACHINE   EM_AARCH64
+#elif defined(__powerpc64__)
+# define HOST_MACHINE   EM_PPC64
+#elif defined(__s390x__)
+# define HOST_MACHINE   EM_S390
+#else
+# define HOST_MACHINE   EM_NONE
+#endif
+
+// -----------------------------------------------------------------------------
+static unsigned long long align(unsigned long long value,
+                                unsigned long long alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// -----------------------------------------------------------------------------
+static void appendNote(std::vector<char> &buf, const string &name,
+                       unsigned type, const string &desc)
+{
+    Elf64_Nhdr nhdr;
+    nhdr.n_namesz = name.size() + 1;
+    nhdr.n_descsz = desc.size();
+    nhdr.n_type = type;
+
+    const char *p = reinterpret_cast<const char *>(&nhdr);
+    buf.insert(buf.end(), p, p + sizeof nhdr);
+    buf.insert(buf.end(), name.begin(), name.end());
+    buf.resize(align(buf.size() + 1, 4), '\0');
+    buf.insert(buf.end(), desc.begin(), desc.end());
+    buf.resize(align(buf.size(), 4), '\0');
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 4 || argc > 7) {
+        cerr << "Usage: " << argv[0]
+             << " vmcore osrelease crashtime [loads [pages [cpus]]]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string osrelease(argv[2]);
+    string crashtime(argv[3]);
+    unsigned loads = argc > 4 ? atoi(argv[4]) : 4;
+    unsigned pages = argc > 5 ? atoi(argv[5]) : 64;
+    unsigned cpus = argc > 6 ? atoi(argv[6]) : 0;
+
+    std::vector<char> cpunotes;
+    for (unsigned i = 0; i < cpus; ++i)
+        appendNote(cpunotes, "CORE", NT_PRSTATUS,
+                   string(PRSTATUS_SIZE, '\0'));
+    unsigned nnotes = cpus ? 2 : 1;
+
+    std::vector<char> notes;
+    appendNote(notes, "VMCOREINFO", 0,
+        "OSRELEASE=" + osrelease + "\n"
+        "PAGESIZE=" + Stringutil::number2string(PAGE_SIZE) + "\n"
+        "CRASHTIME=" + crashtime + "\n"
+        "SYMBOL(swapper_pg_dir)=ffffffff82a0a000\n"
+        "SYMBOL(init_top_pgt)=ffffffff82a0a000\n"
+        "SIZE(page)=64\n"
+        "OFFSET(page.flags)=0\n"
+        "OFFSET(page.lru)=8\n"
+        "LENGTH(mem_section)=2048\n"
+        "NUMBER(PG_lru)=4\n"
+        "NUMBER(PAGE_BUDDY_MAPCOUNT_VALUE)=-129\n"
+        "KERNELOFFSET=3c000000\n");
+
+    Elf64_Ehdr ehdr;
+    memset(&ehdr, 0, sizeof ehdr);
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+#else
+    ehdr.e_ident[EI_DATA] = ELFDATA2MSB;
+#endif
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_CORE;
+    ehdr.e_machine = HOST_MACHINE;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_phoff = sizeof ehdr;
+    ehdr.e_ehsize = sizeof ehdr;
+    ehdr.e_phentsize = sizeof(Elf64_Phdr);
+    ehdr.e_phnum = nnotes + loads;
+
+    std::vector<Elf64_Phdr> phdrs(nnotes + loads);
+    memset(&phdrs[0], 0, phdrs.size() * sizeof(Elf64_Phdr));
+
+    unsigned long long offset = sizeof ehdr + phdrs.size() * sizeof(Elf64_Phdr);
+    if (cpus) {
+        phdrs[0].p_type = PT_NOTE;
+        phdrs[0].p_offset = offset;
+        phdrs[0].p_filesz = cpunotes.size();
+        offset += cpunotes.size();
+    }
+    phdrs[nnotes - 1].p_type = PT_NOTE;
+    phdrs[nnotes - 1].p_offset = offset;
+    phdrs[nnotes - 1].p_filesz = notes.size();
+    offset = align(offset + notes.size(), PAGE_SIZE);
+
+    unsigned long long segsize = (unsigned long long)pages * PAGE_SIZE;
+    for (unsigned i = 0; i < loads; ++i) {
+        Elf64_Phdr &phdr = phdrs[nnotes + i];
+        phdr.p_type = PT_LOAD;
+        phdr.p_flags = PF_R | PF_W | PF_X;
+        phdr.p_offset = offset;
+        // leave a hole between the segments
+        phdr.p_paddr = (unsigned long long)i * 2 * segsize;
+        phdr.p_vaddr = LOAD_VADDR + phdr.p_paddr;
+        phdr.p_filesz = phdr.p_memsz = segsize;
+        offset += segsize;
+    }
+
+    ofstream out(argv[1], std::ios::binary | std::ios::trunc);
+    if (!out) {
+        cerr << "Cannot create " << argv[1] << endl;
+        return EXIT_FAILURE;
+    }
+
+    out.write(reinterpret_cast<const char *>(&ehdr), sizeof ehdr);
+    out.write(reinterpret_cast<const char *>(&phdrs[0]),
+              phdrs.size() * sizeof(Elf64_Phdr));
+    if (cpus)
+        out.write(&cpunotes[0], cpunotes.size());
+    out.write(&notes[0], notes.size());
+    out.seekp(loads ? phdrs[nnotes].p_offset : offset);
+
+    try {
+        SyntheticDataProvider provider(segsize * loads);
+        provider.setChunkSize(PAGE_SIZE);
+        provider.setZeroRatio(50);
+        provider.setCompressibility(50);
+
+        char buf[PAGE_SIZE];
+        size_t n;
+        while ((n = provider.getData(buf, sizeof buf)) > 0)
+            out.write(buf, n);
+    } catch (const KError &error) {
+        cerr << error.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    out.close();
+    if (!out) {
+        cerr << "Writing " << argv[1] << " failed." << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
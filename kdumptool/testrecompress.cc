@@ -0,0 +1,57 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include "global.h"
+#include "recompress.h"
+#include "stringutil.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc != 7) {
+        cerr << "Usage: " << argv[0] << " readme format oldformat "
+             << "dumplevel unflattened time" << endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream fin(argv[1]);
+    if (!fin) {
+        cerr << "Cannot open " << argv[1] << endl;
+        return EXIT_FAILURE;
+    }
+    std::ostringstream info;
+    info << fin.rdbuf();
+
+    cout << Recompress::updateReadme(info.str(), argv[2], argv[3],
+        Stringutil::string2number(argv[4]),
+        Stringutil::string2number(argv[5]) != 0,
+        Stringutil::string2number(argv[6]));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <map>
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+
+#include "global.h"
+#include "debug.h"
+#include "rootdirurl.h"
+#include "sshtransfer.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// names returned by one SSH_FXP_NAME reply, so that readdir needs
+// several requests
+#define NAMES_PER_REPLY		2
+
+//{{{ Fake SFTP server ---------------------------------------------------------
+
+/*
+ * Just enough of an SFTP server (protocol version 3) on stdin/stdout to
+ * let SFTPTransfer list and remove directories below the current
+ * directory. Requests that are not understood end the session, like
+ * a confused sftp-server that never replies.
+ */
+
+// -----------------------------------------------------------------------------
+static bool read_all(unsigned char *buf, size_t len)
+{
+    while (len) {
+        ssize_t ret = read(STDIN_FILENO, buf, len);
+        if (ret <= 0)
+            return false;
+        buf += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static bool read_request(SFTPPacket &pkt)
+{
+    ByteVector buf(sizeof(uint32_t));
+    if (!read_all(buf.data(), buf.size()))
+        return false;
+    pkt.setData(buf);
+    size_t length = pkt.getInt32();
+
+    buf.resize(length);
+    if (length && !read_all(buf.data(), length))
+        return false;
+    pkt.addByteVector(buf);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static void send_reply(SFTPPacket &pkt)
+{
+    const ByteVector &bv = pkt.update();
+    const unsigned char *p = bv.data();
+    size_t len = bv.size();
+    while (len) {
+        ssize_t ret = write(STDOUT_FILENO, p, len);
+        if (ret <= 0)
+            _exit(EXIT_FAILURE);
+        p += ret;
+        len -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void send_status(unsigned long id, unsigned long code)
+{
+    SFTPPacket pkt;
+    pkt.addByte(SSH_FXP_STATUS);
+    pkt.addInt32(id);
+    pkt.addInt32(code);
+    pkt.addString("");          // message
+    pkt.addString("");          // language tag
+    send_reply(pkt);
+}
+
+// -----------------------------------------------------------------------------
+static void send_errno(unsigned long id, int err)
+{
+    send_status(id, err == ENOENT ? SSH_FX_NO_SUCH_FILE : SSH_FX_FAILURE);
+}
+
+// -----------------------------------------------------------------------------
+static string resolve(const string &path)
+{
+    return path[0] == '/' ? "." + path : path;
+}
+
+// -----------------------------------------------------------------------------
+static int serve()
+{
+    std::map<string, DIR *> handles;
+    unsigned long nexthandle = 0;
+    SFTPPacket req;
+
+    if (!read_request(req) || req.getByte() != SSH_FXP_INIT) {
+        cerr << "testsftpremove: no SSH_FXP_INIT" << endl;
+        return EXIT_FAILURE;
+    }
+    SFTPPacket version;
+    version.addByte(SSH_FXP_VERSION);
+    version.addInt32(3);
+    send_reply(version);
+
+    while (read_request(req)) {
+        unsigned char type = req.getByte();
+        unsigned long id = req.getInt32();
+
+        switch (type) {
+            case SSH_FXP_STAT: {
+                struct stat st;
+                if (stat(resolve(req.getString()).c_str(), &st) != 0) {
+                    send_errno(id, errno);
+                    break;
+                }
+                SFTPPacket pkt;
+                pkt.addByte(SSH_FXP_ATTRS);
+                pkt.addInt32(id);
+                pkt.addInt32(SSH_FILEXFER_ATTR_PERMISSIONS);
+                pkt.addInt32(st.st_mode);
+                send_reply(pkt);
+                break;
+            }
+
+            case SSH_FXP_MKDIR:
+                if (mkdir(resolve(req.getString()).c_str(), 0755) != 0)
+                    send_errno(id, errno);
+                else
+                    send_status(id, SSH_FX_OK);
+                break;
+
+            case SSH_FXP_OPENDIR: {
+                string path = resolve(req.getString());
+                DIR *dir = opendir(path.c_str());
+                if (!dir) {
+                    send_errno(id, errno);
+                    break;
+                }
+                std::ostringstream ss;
+                ss << "dir" << nexthandle++;
+                handles[ss.str()] = dir;
+
+                SFTPPacket pkt;
+                pkt.addByte(SSH_FXP_HANDLE);
+                pkt.addInt32(id);
+                pkt.addString(ss.str());
+                send_reply(pkt);
+                break;
+            }
+
+            case SSH_FXP_READDIR: {
+                std::map<string, DIR *>::iterator it =
+                    handles.find(req.getString());
+                if (it == handles.end()) {
+                    send_status(id, SSH_FX_FAILURE);
+                    break;
+                }
+
+                SFTPPacket names;
+                unsigned long count = 0;
+                struct dirent *d;
+                while (count < NAMES_PER_REPLY &&
+                       (d = readdir(it->second)) ) {
+                    struct stat st;
+                    if (fstatat(dirfd(it->second), d->d_name, &st,
+                                AT_SYMLINK_NOFOLLOW) != 0)
+                        continue;
+                    names.addString(d->d_name);
+                    names.addString(d->d_name);         // longname
+                    names.addInt32(SSH_FILEXFER_ATTR_SIZE |
+                                   SSH_FILEXFER_ATTR_PERMISSIONS);
+                    names.addInt64(st.st_size);
+                    names.addInt32(st.st_mode);
+                    ++count;
+                }
+                if (!count) {
+                    send_status(id, SSH_FX_EOF);
+                    break;
+                }
+
+                // names starts with an empty length field
+                const ByteVector &body = names.data();
+                SFTPPacket pkt;
+                pkt.addByte(SSH_FXP_NAME);
+                pkt.addInt32(id);
+                pkt.addInt32(count);
+                pkt.addByteVector(ByteVector(body.begin() + sizeof(uint32_t),
+                                             body.end()));
+                send_reply(pkt);
+                break;
+            }
+
+            case SSH_FXP_CLOSE: {
+                std::map<string, DIR *>::iterator it =
+                    handles.find(req.getString());
+                if (it == handles.end()) {
+                    send_status(id, SSH_FX_FAILURE);
+                    break;
+                }
+                closedir(it->second);
+                handles.erase(it);
+                send_status(id, SSH_FX_OK);
+                break;
+            }
+
+            case SSH_FXP_REMOVE:
+                if (unlink(resolve(req.getString()).c_str()) != 0)
+                    send_errno(id, errno);
+                else
+                    send_status(id, SSH_FX_OK);
+                break;
+
+            case SSH_FXP_RMDIR:
+                if (rmdir(resolve(req.getString()).c_str()) != 0)
+                    send_errno(id, errno);
+                else
+                    send_status(id, SSH_FX_OK);
+                break;
+
+            default:
+                cerr << "testsftpremove: unknown message "
+                     << unsigned(type) << endl;
+                return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+//}}}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    // started by SFTPTransfer through a symbolic link named ssh
+    string self(argv[0]);
+    string::size_type slash = self.rfind('/');
+    if (self.substr(slash == string::npos ? 0 : slash + 1) == "ssh")
+        return serve();
+
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " rootdir targetdir list|dirs "
+             << "[name...]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string mode(argv[3]);
+    if (mode != "list" && mode != "dirs") {
+        cerr << "Mode must be one of: 'list', 'dirs'" << endl;
+        return EXIT_FAILURE;
+    }
+
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+
+    // the server inherits the working directory
+    if (chdir(argv[1]) != 0) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        RootDirURLVector urlv;
+        urlv.push_back(RootDirURL(string("sftp://test@127.0.0.1/") +
+                                  argv[2], string()));
+
+        SFTPTransfer transfer(urlv);
+        if (mode == "list") {
+            StringVector dirs = transfer.listDirs();
+            for (size_t i = 0; i < dirs.size(); ++i)
+                cout << dirs[i] << endl;
+        } else
+            transfer.removeDirs(StringVector(argv + 4, argv + argc));
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "global.h"
+#include "sha256.h"
+#include "debug.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Debug::debug()->setStderrLevel(Debug::DL_TRACE);
+
+    try {
+	if (argc < 2) {
+	    Sha256 sha;
+	    char buffer[4096];
+	    ssize_t len;
+	    while ((len = read(STDIN_FILENO, buffer, sizeof buffer)) > 0)
+		sha.update(buffer, len);
+	    cout << sha.hexDigest() << "  -" << endl;
+	}
+
+	for (int i = 1; i < argc; ++i)
+	    cout << Sha256::fileDigest(argv[i]) << "  " << argv[i] << endl;
+
+    } catch(const std::exception &ex) {
+	cerr << "Fatal exception: " << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
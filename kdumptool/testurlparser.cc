@@ -59,6 +59,11 @@ int main(int argc, char *argv[])
         cout << "Pass\t"    << urlp.getPassword() << endl;
         cout << "Path\t"    << urlp.getPath() << endl;
 
+        const StringStringMap &params = urlp.getParameters();
+        StringStringMap::const_iterator it;
+        for (it = params.begin(); it != params.end(); ++it)
+            cout << "Param\t" << it->first << "=" << it->second << endl;
+
     } catch (const std::exception &ex) {
         cerr << "Fatal exception: " << ex.what() << endl;
         return EXIT_FAILURE;
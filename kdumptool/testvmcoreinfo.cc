@@ -0,0 +1,105 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include "global.h"
+#include "debug.h"
+#include "vmcoreinfo.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::hex;
+using std::dec;
+
+// -----------------------------------------------------------------------------
+static void printId(const Vmcoreinfo &vm, const char *key, Vmcoreinfo::Id id,
+                    bool hexadecimal = false)
+{
+    cout << key << "=";
+    if (!vm.hasValue(id))
+        cout << "(missing)";
+    else if (hexadecimal)
+        cout << hex << vm.getValue(id) << dec;
+    else
+        cout << (long long)vm.getValue(id);
+    cout << endl;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    static const char *const types[Vmcoreinfo::NTYPES] = {
+        "PLAIN", "SYMBOL", "OFFSET", "SIZE", "LENGTH", "NUMBER"
+    };
+
+    if (argc < 2 || argc % 2 != 0) {
+        cerr << "Usage: " << argv[0] << " vmcore [type name]..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Vmcoreinfo vm;
+        vm.readFromELF(argv[1]);
+
+        // well-known entries
+        printId(vm, "PAGESIZE", Vmcoreinfo::ID_PAGESIZE);
+        printId(vm, "CRASHTIME", Vmcoreinfo::ID_CRASHTIME);
+        printId(vm, "KERNELOFFSET", Vmcoreinfo::ID_KERNELOFFSET, true);
+        printId(vm, "SYMBOL(swapper_pg_dir)",
+                Vmcoreinfo::ID_SYMBOL_swapper_pg_dir, true);
+        printId(vm, "SIZE(page)", Vmcoreinfo::ID_SIZE_page);
+        printId(vm, "OFFSET(page.flags)", Vmcoreinfo::ID_OFFSET_page_flags);
+        printId(vm, "OFFSET(page.lru)", Vmcoreinfo::ID_OFFSET_page_lru);
+        printId(vm, "LENGTH(mem_section)",
+                Vmcoreinfo::ID_LENGTH_mem_section);
+        printId(vm, "NUMBER(PG_lru)", Vmcoreinfo::ID_NUMBER_PG_lru);
+        printId(vm, "NUMBER(PG_slab)", Vmcoreinfo::ID_NUMBER_PG_slab);
+        printId(vm, "NUMBER(PAGE_BUDDY_MAPCOUNT_VALUE)",
+                Vmcoreinfo::ID_NUMBER_PAGE_BUDDY_MAPCOUNT_VALUE);
+
+        // lookups by name
+        for (int i = 2; i < argc; i += 2) {
+            int type;
+            for (type = 0; type < Vmcoreinfo::NTYPES; ++type)
+                if (strcmp(argv[i], types[type]) == 0)
+                    break;
+            if (type == Vmcoreinfo::NTYPES) {
+                cerr << "Invalid type: " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+
+            unsigned long long value;
+            cout << argv[i] << " " << argv[i + 1] << "=";
+            if (vm.findValue(Vmcoreinfo::Type(type), argv[i + 1], value))
+                cout << hex << value << dec << endl;
+            else
+                cout << "(missing)" << endl;
+        }
+    } catch(const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,193 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <ctime>
+#include <cerrno>
+#include <cassert>
+#include <pthread.h>
+
+#include "global.h"
+#include "debug.h"
+#include "threads.h"
+
+using std::string;
+
+//{{{ Mutex --------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Mutex::Mutex()
+    throw ()
+{
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+// -----------------------------------------------------------------------------
+Mutex::~Mutex()
+    throw ()
+{
+    pthread_mutex_destroy(&m_mutex);
+}
+
+// -----------------------------------------------------------------------------
+void Mutex::lock()
+    throw ()
+{
+    pthread_mutex_lock(&m_mutex);
+}
+
+// -----------------------------------------------------------------------------
+void Mutex::unlock()
+    throw ()
+{
+    pthread_mutex_unlock(&m_mutex);
+}
+
+//}}}
+//{{{ Condition ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Condition::Condition()
+    throw ()
+{
+    pthread_cond_init(&m_cond, NULL);
+}
+
+// -----------------------------------------------------------------------------
+Condition::~Condition()
+    throw ()
+{
+    pthread_cond_destroy(&m_cond);
+}
+
+// -----------------------------------------------------------------------------
+void Condition::wait(Mutex &mutex)
+    throw ()
+{
+    pthread_cond_wait(&m_cond, mutex.native());
+}
+
+// -----------------------------------------------------------------------------
+bool Condition::timedWait(Mutex &mutex, double seconds)
+    throw ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long nsec = ts.tv_nsec + (long long)(seconds * 1e9);
+    ts.tv_sec += nsec / 1000000000;
+    ts.tv_nsec = nsec % 1000000000;
+
+    return pthread_cond_timedwait(&m_cond, mutex.native(), &ts) != ETIMEDOUT;
+}
+
+// -----------------------------------------------------------------------------
+void Condition::signal()
+    throw ()
+{
+    pthread_cond_signal(&m_cond);
+}
+
+// -----------------------------------------------------------------------------
+void Condition::broadcast()
+    throw ()
+{
+    pthread_cond_broadcast(&m_cond);
+}
+
+//}}}
+//{{{ Thread -------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Thread::Thread()
+    throw ()
+    : m_started(false), m_failed(false)
+{
+}
+
+// -----------------------------------------------------------------------------
+Thread::~Thread()
+    throw ()
+{
+    // too late to join: the derived object is gone already
+    assert(!m_started);
+}
+
+// -----------------------------------------------------------------------------
+void *Thread::threadFunc(void *arg)
+{
+    Thread *self = static_cast<Thread *>(arg);
+
+    try {
+        self->run();
+    } catch (const KError &error) {
+        self->m_failed = true;
+        self->m_error = error.what();
+    } catch (...) {
+        self->m_failed = true;
+        self->m_error = "Unknown error in worker thread.";
+    }
+
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+void Thread::start()
+    throw (KError)
+{
+    if (m_started)
+        throw KError("Thread already started.");
+
+    m_failed = false;
+    m_error.clear();
+
+    int err = pthread_create(&m_thread, NULL, threadFunc, this);
+    if (err != 0)
+        throw KSystemError("Cannot create thread.", err);
+    m_started = true;
+}
+
+// -----------------------------------------------------------------------------
+void Thread::join()
+    throw (KError)
+{
+    if (!m_started)
+        return;
+
+    int err = pthread_join(m_thread, NULL);
+    m_started = false;
+    if (err != 0)
+        throw KSystemError("Cannot join thread.", err);
+
+    if (m_failed)
+        throw KError(m_error);
+}
+
+// -----------------------------------------------------------------------------
+void Thread::joinQuietly()
+    throw ()
+{
+    try {
+        join();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Thread: %s", error.what());
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,235 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <string>
+#include <pthread.h>
+
+#include "global.h"
+
+//{{{ Mutex --------------------------------------------------------------------
+
+/**
+ * Thin wrapper around a POSIX mutex.
+ */
+class Mutex {
+
+    public:
+        /**
+         * Creates a new (unlocked) mutex.
+         */
+        Mutex()
+        throw ();
+
+        /**
+         * Destroys the mutex. The mutex must not be locked.
+         */
+        ~Mutex()
+        throw ();
+
+        /**
+         * Locks the mutex.
+         */
+        void lock()
+        throw ();
+
+        /**
+         * Unlocks the mutex.
+         */
+        void unlock()
+        throw ();
+
+        /**
+         * Returns the underlying POSIX object.
+         */
+        pthread_mutex_t *native()
+        throw ()
+        { return &m_mutex; }
+
+    private:
+        pthread_mutex_t m_mutex;
+
+        // non-copyable
+        Mutex(const Mutex &);
+        Mutex &operator=(const Mutex &);
+};
+
+//}}}
+//{{{ MutexLocker --------------------------------------------------------------
+
+/**
+ * Locks a mutex for the lifetime of the object.
+ */
+class MutexLocker {
+
+    public:
+        MutexLocker(Mutex &mutex)
+        throw ()
+            : m_mutex(mutex)
+        { m_mutex.lock(); }
+
+        ~MutexLocker()
+        throw ()
+        { m_mutex.unlock(); }
+
+    private:
+        Mutex &m_mutex;
+
+        // non-copyable
+        MutexLocker(const MutexLocker &);
+        MutexLocker &operator=(const MutexLocker &);
+};
+
+//}}}
+//{{{ Condition ----------------------------------------------------------------
+
+/**
+ * Thin wrapper around a POSIX condition variable.
+ */
+class Condition {
+
+    public:
+        Condition()
+        throw ();
+
+        ~Condition()
+        throw ();
+
+        /**
+         * Waits for the condition. The mutex must be locked by the caller.
+         *
+         * @param[in] mutex the mutex that protects the condition
+         */
+        void wait(Mutex &mutex)
+        throw ();
+
+        /**
+         * Waits for the condition, but not longer than @p seconds.
+         *
+         * @param[in] mutex the mutex that protects the condition
+         * @param[in] seconds the timeout
+         * @return @c false if the timeout expired
+         */
+        bool timedWait(Mutex &mutex, double seconds)
+        throw ();
+
+        /**
+         * Wakes up one waiter.
+         */
+        void signal()
+        throw ();
+
+        /**
+         * Wakes up all waiters.
+         */
+        void broadcast()
+        throw ();
+
+    private:
+        pthread_cond_t m_cond;
+
+        // non-copyable
+        Condition(const Condition &);
+        Condition &operator=(const Condition &);
+};
+
+//}}}
+//{{{ Thread -------------------------------------------------------------------
+
+/**
+ * Base class for a worker thread. Subclasses implement run().
+ *
+ * A KError thrown by run() is caught in the thread and re-thrown
+ * by join(), so errors propagate to the thread that waits for the
+ * worker.
+ *
+ * The thread runs virtual methods of the derived object, so it must
+ * be joined before that object is destroyed. Every subclass must join
+ * the thread in its own destructor (e.g. with joinQuietly()); the
+ * destructor of this class cannot do it any more.
+ */
+class Thread {
+
+    public:
+        Thread()
+        throw ();
+
+        /**
+         * Destroys the thread object. The thread must have been joined
+         * by the destructor of the subclass.
+         */
+        virtual ~Thread()
+        throw ();
+
+        /**
+         * Starts the thread.
+         *
+         * @exception KError if the thread cannot be created
+         */
+        void start()
+        throw (KError);
+
+        /**
+         * Waits for the thread to finish.
+         *
+         * @exception KError if run() failed
+         */
+        void join()
+        throw (KError);
+
+        /**
+         * Checks whether the thread has been started and not joined yet.
+         */
+        bool isRunning() const
+        throw ()
+        { return m_started; }
+
+    protected:
+        /**
+         * The thread body.
+         */
+        virtual void run()
+        throw (KError) = 0;
+
+        /**
+         * Waits for the thread to finish like join(), but only logs
+         * an error. For the destructors of subclasses.
+         */
+        void joinQuietly()
+        throw ();
+
+    private:
+        static void *threadFunc(void *arg);
+
+        pthread_t m_thread;
+        bool m_started;
+        bool m_failed;
+        std::string m_error;
+
+        // non-copyable
+        Thread(const Thread &);
+        Thread &operator=(const Thread &);
+};
+
+//}}}
+
+#endif /* THREADS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
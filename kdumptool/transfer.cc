@@ -21,9 +21,20 @@
 #include <cstdarg>
 #include <cerrno>
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <cstring>
+#include <cctype>
+#include <linux/fs.h>
 
 #include <curl/curl.h>
 
@@ -37,6 +48,9 @@
 #include "stringutil.h"
 #include "configuration.h"
 #include "routable.h"
+#include "threads.h"
+#include "metrics.h"
+#include "bufferpool.h"
 
 using std::fopen;
 using std::fread;
@@ -49,6 +63,67 @@ using std::endl;
 
 #define DEFAULT_MOUNTPOINT "/mnt"
 
+// rsize/wsize used for "auto"; the server clamps it to its own maximum
+#define NFS_AUTO_IOSIZE     (1024*1024)
+
+// preferred size of one read/write in FileTransfer (see BufferPool)
+#define FILE_IOSIZE         (1024*1024)
+// maximum number of connections supported by the Linux NFS client
+#define NFS_MAX_NCONNECT    16
+
+// file in a target directory that advertises the maximum client rate
+#define RATE_FILE           ".kdump-rate"
+
+// -----------------------------------------------------------------------------
+/**
+ * Parses a rate or size with an optional binary suffix (K, M or G).
+ *
+ * @param[in] value the string to parse, e.g. "10M"
+ * @param[in] what description of the value for the error message
+ * @return the number of bytes
+ * @exception KError if @p value is not a valid number
+ */
+static unsigned long long parseRate(const string &value, const string &what)
+    throw (KError)
+{
+    // strtoull() would silently negate a leading '-'
+    const char *start = value.c_str();
+    while (isspace(static_cast<unsigned char>(*start)))
+        ++start;
+
+    char *end;
+    errno = 0;
+    unsigned long long ret = strtoull(start, &end, 10);
+    if (end == start || *start == '-')
+        throw KError("Invalid " + what + ": " + value + ".");
+    if (errno == ERANGE)
+        throw KError("Too large " + what + ": " + value + ".");
+
+    unsigned shift = 0;
+    switch (*end) {
+        case 'g': case 'G':
+            shift += 10;
+            /* fall through */
+        case 'm': case 'M':
+            shift += 10;
+            /* fall through */
+        case 'k': case 'K':
+            shift += 10;
+            ++end;
+            /* fall through */
+        case '\0':
+            break;
+        default:
+            throw KError("Invalid " + what + ": " + value + ".");
+    }
+    if (*end)
+        throw KError("Invalid " + what + ": " + value + ".");
+
+    if (ret > (~0ULL >> shift))
+        throw KError("Too large " + what + ": " + value + ".");
+    return ret << shift;
+}
+
 //{{{ Transfer -----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -61,6 +136,46 @@ void Transfer::perform(DataProvider *dataprovider,
     perform(dataprovider, target_files, directSave);
 }
 
+// -----------------------------------------------------------------------------
+void Transfer::remove(const std::string &target_file)
+    throw (KError)
+{
+    throw KError("Cannot remove " + target_file +
+                 ": not supported by this transfer.");
+}
+
+// -----------------------------------------------------------------------------
+bool Transfer::exists(const std::string &target_file)
+    throw (KError)
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void Transfer::link(const std::string &source_file,
+                    const std::string &target_file)
+    throw (KError)
+{
+    throw KError("Cannot link " + target_file +
+                 ": not supported by this transfer.");
+}
+
+// -----------------------------------------------------------------------------
+StringVector Transfer::listDirs()
+    throw (KError)
+{
+    throw KError("Cannot list the target directory: "
+                 "not supported by this transfer.");
+}
+
+// -----------------------------------------------------------------------------
+void Transfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    throw KError("Cannot remove directories: "
+                 "not supported by this transfer.");
+}
+
 //{{{ URLTransfer --------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -70,13 +185,364 @@ URLTransfer::URLTransfer(const RootDirURLVector &urlv)
 {
 }
 
+//}}}
+//{{{ PositionedWriter ---------------------------------------------------------
+
+/**
+ * Writes blocks to one or more files from several threads with pwrite(2).
+ *
+ * The producer takes an empty buffer with getBuffer(), fills it and
+ * hands parts of it over with submit(). When it is done with the
+ * buffer, it calls release(). The writer threads of every file write
+ * each part at the given offset, and the buffer goes back on the free
+ * list when the producer and all writers are done with it. The number
+ * of buffers is limited, so the producer blocks if the writers cannot
+ * keep up.
+ *
+ * A write error only stops the writers of that file; the remaining
+ * files are still written. The transfer fails when no file is left.
+ */
+class PositionedWriter {
+
+    public:
+        /**
+         * @param[in] fds the files to write to
+         * @param[in] names the names of the files (for TransferMetrics)
+         * @param[in] bufferSize size of one block
+         * @param[in] writers number of writer threads per file
+         */
+        PositionedWriter(const std::vector<int> &fds,
+                         const StringVector &names, size_t bufferSize,
+                         unsigned writers)
+        throw (KError);
+
+        ~PositionedWriter()
+        throw ();
+
+        /**
+         * Returns an empty buffer, waiting for one if necessary.
+         *
+         * @exception KError if writing has failed for all files
+         */
+        char *getBuffer()
+        throw (KError);
+
+        /**
+         * Queues a part of a filled buffer for writing to all files
+         * that have not failed.
+         *
+         * @param[in] buffer the buffer from getBuffer()
+         * @param[in] start start of the part in @p buffer
+         * @param[in] length length of the part
+         * @param[in] offset file offset of the part
+         */
+        void submit(char *buffer, size_t start, size_t length, off_t offset)
+        throw ();
+
+        /**
+         * Gives up the producer's reference to a buffer.
+         */
+        void release(char *buffer)
+        throw ();
+
+        /**
+         * Writes all queued buffers and stops the writer threads.
+         *
+         * @exception KError if writing has failed for all files
+         */
+        void finish()
+        throw (KError);
+
+        /**
+         * Returns whether writing the file with index @p index has failed.
+         * The error has already been reported then.
+         */
+        bool failed(unsigned index) const
+        throw ()
+        { return m_targetFailed[index]; }
+
+    private:
+        struct Chunk {
+            char *buffer;
+            size_t start;
+            size_t length;
+            off_t offset;
+        };
+
+        class Worker : public Thread {
+            public:
+                Worker(PositionedWriter *writer, unsigned index)
+                throw ()
+                    : m_writer(writer), m_index(index)
+                {}
+
+                ~Worker()
+                throw ()
+                { joinQuietly(); }
+
+            protected:
+                void run()
+                throw (KError)
+                { m_writer->work(m_index); }
+
+            private:
+                PositionedWriter *m_writer;
+                unsigned m_index;
+        };
+        friend class Worker;
+
+        void work(unsigned index)
+        throw (KError);
+
+        void stop()
+        throw ();
+
+        void unref(char *buffer)
+        throw ();
+
+        std::vector<int> m_fds;
+        std::vector<unsigned> m_metricIds;
+        std::vector<char *> m_buffers;
+        std::vector<char *> m_free;
+        std::map<char *, unsigned> m_pending;
+        std::vector< std::deque<Chunk> > m_queues;
+        std::vector<Worker *> m_workers;
+        Mutex m_lock;
+        Condition m_freeCond;
+        Condition m_workCond;
+        bool m_done;
+        bool m_failed;
+        std::string m_error;
+        std::vector<bool> m_targetFailed;
+        StringVector m_names;
+};
+
+// -----------------------------------------------------------------------------
+PositionedWriter::PositionedWriter(const std::vector<int> &fds,
+                                   const StringVector &names,
+                                   size_t bufferSize, unsigned writers)
+    throw (KError)
+    : m_fds(fds), m_queues(fds.size()), m_done(false), m_failed(false),
+      m_targetFailed(fds.size(), false), m_names(names)
+{
+    for (size_t i = 0; i < names.size(); ++i)
+        m_metricIds.push_back(TransferMetrics::metrics()->addTarget(names[i]));
+
+    unsigned threads = writers * fds.size();
+    Debug::debug()->dbg("Writing %lu file(s) with %u threads, "
+                        "%lu bytes per block", (unsigned long)fds.size(),
+                        threads, (unsigned long)bufferSize);
+
+    try {
+        // two buffers per writer keep the producer busy while writing
+        for (unsigned i = 0; i < 2 * threads; ++i) {
+            m_buffers.push_back(BufferPool::pool()->allocate(bufferSize));
+            m_free.push_back(m_buffers.back());
+        }
+
+        for (unsigned i = 0; i < threads; ++i) {
+            m_workers.push_back(new Worker(this, i % fds.size()));
+            m_workers.back()->start();
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+// -----------------------------------------------------------------------------
+PositionedWriter::~PositionedWriter()
+    throw ()
+{
+    stop();
+}
+
+// -----------------------------------------------------------------------------
+void PositionedWriter::stop()
+    throw ()
+{
+    m_lock.lock();
+    if (!m_done) {
+        m_done = true;
+        m_failed = true;
+        m_error = "Transfer aborted.";
+    }
+    m_workCond.broadcast();
+    m_lock.unlock();
+
+    std::vector<Worker *>::iterator it;
+    for (it = m_workers.begin(); it != m_workers.end(); ++it) {
+        try {
+            (*it)->join();
+        } catch (const KError &error) {
+            Debug::debug()->dbg("Writer thread: %s", error.what());
+        }
+        delete *it;
+    }
+    m_workers.clear();
+
+    std::vector<char *>::iterator bit;
+    for (bit = m_buffers.begin(); bit != m_buffers.end(); ++bit)
+        BufferPool::pool()->release(*bit);
+    m_buffers.clear();
+    m_free.clear();
+}
+
+// -----------------------------------------------------------------------------
+char *PositionedWriter::getBuffer()
+    throw (KError)
+{
+    MutexLocker locker(m_lock);
+
+    while (m_free.empty() && !m_failed)
+        m_freeCond.wait(m_lock);
+    if (m_failed)
+        throw KError(m_error);
+
+    char *ret = m_free.back();
+    m_free.pop_back();
+    m_pending[ret] = 1;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void PositionedWriter::submit(char *buffer, size_t start, size_t length,
+                              off_t offset)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    Chunk chunk;
+    chunk.buffer = buffer;
+    chunk.start = start;
+    chunk.length = length;
+    chunk.offset = offset;
+    for (unsigned i = 0; i < m_queues.size(); ++i) {
+        if (m_targetFailed[i])
+            continue;
+        m_queues[i].push_back(chunk);
+        ++m_pending[buffer];
+        TransferMetrics::metrics()->setQueued(m_metricIds[i],
+                                              m_queues[i].size());
+    }
+    m_workCond.broadcast();
+}
+
+// -----------------------------------------------------------------------------
+void PositionedWriter::release(char *buffer)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    unref(buffer);
+}
+
+// -----------------------------------------------------------------------------
+void PositionedWriter::unref(char *buffer)
+    throw ()
+{
+    if (--m_pending[buffer] == 0) {
+        m_pending.erase(buffer);
+        m_free.push_back(buffer);
+        m_freeCond.signal();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void PositionedWriter::finish()
+    throw (KError)
+{
+    m_lock.lock();
+    m_done = true;
+    m_workCond.broadcast();
+    m_lock.unlock();
+
+    std::vector<Worker *>::iterator it;
+    for (it = m_workers.begin(); it != m_workers.end(); ++it)
+        (*it)->join();
+
+    if (m_failed)
+        throw KError(m_error);
+}
+
+// -----------------------------------------------------------------------------
+void PositionedWriter::work(unsigned index)
+    throw (KError)
+{
+    std::deque<Chunk> &queue = m_queues[index];
+    int fd = m_fds[index];
+
+    while (true) {
+        Chunk chunk;
+
+        m_lock.lock();
+        while (queue.empty() && !m_done && !m_failed)
+            m_workCond.wait(m_lock);
+        if (m_failed || m_targetFailed[index] || queue.empty()) {
+            m_lock.unlock();
+            return;
+        }
+        chunk = queue.front();
+        queue.pop_front();
+        TransferMetrics::metrics()->setQueued(m_metricIds[index],
+                                              queue.size());
+        m_lock.unlock();
+
+        char *p = chunk.buffer + chunk.start;
+        size_t remaining = chunk.length;
+        off_t offset = chunk.offset;
+        while (remaining) {
+            ssize_t ret = pwrite(fd, p, remaining, offset);
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret <= 0) {
+                KSystemError error("FileTransfer::perform: pwrite() to " +
+                    m_names[index] + " failed at offset " +
+                    Stringutil::number2string(offset) + ".",
+                    ret < 0 ? errno : ENOSPC);
+
+                MutexLocker locker(m_lock);
+                if (!m_targetFailed[index]) {
+                    cerr << "WARNING: " << error.what() << endl;
+                    m_targetFailed[index] = true;
+                }
+
+                // nobody else writes these chunks now
+                unref(chunk.buffer);
+                while (!queue.empty()) {
+                    unref(queue.front().buffer);
+                    queue.pop_front();
+                }
+                TransferMetrics::metrics()->setQueued(m_metricIds[index], 0);
+
+                if (std::find(m_targetFailed.begin(), m_targetFailed.end(),
+                              false) == m_targetFailed.end()) {
+                    m_failed = true;
+                    m_error = "Writing has failed for all targets.";
+                    m_freeCond.broadcast();
+                }
+                m_workCond.broadcast();
+                return;
+            }
+            p += ret;
+            remaining -= ret;
+            offset += ret;
+        }
+        TransferMetrics::metrics()->addWritten(m_metricIds[index],
+                                               chunk.length);
+
+        MutexLocker locker(m_lock);
+        unref(chunk.buffer);
+    }
+}
+
 //}}}
 //{{{ FileTransfer -------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 FileTransfer::FileTransfer(const RootDirURLVector &urlv)
     throw (KError)
-    : URLTransfer(urlv), m_bufferSize(0), m_buffer(NULL)
+    : URLTransfer(urlv), m_blockSize(0), m_writers(1)
 {
     RootDirURLVector::const_iterator it;
     for (it = urlv.begin(); it != urlv.end(); ++it)
@@ -89,27 +555,44 @@ FileTransfer::FileTransfer(const RootDirURLVector &urlv)
         dir.mkdir(true);
     }
 
-    // try to get the buffer size
+    // try to get the block size (smallest buffer and sparse granularity)
     for (it = urlv.begin(); it != urlv.end(); ++it) {
 	struct stat mystat;
 	int err = stat(it->getRealPath().c_str(), &mystat);
-	if (err == 0 && (size_t)mystat.st_blksize > m_bufferSize)
-	    m_bufferSize = mystat.st_blksize;
+	if (err == 0 && (size_t)mystat.st_blksize > m_blockSize)
+	    m_blockSize = mystat.st_blksize;
     }
 
-    if (m_bufferSize == 0) {
+    if (m_blockSize == 0) {
         Debug::debug()->dbg("Cannot determine block size. Using %d.", BUFSIZ);
-        m_bufferSize = BUFSIZ;
+        m_blockSize = BUFSIZ;
     }
-
-    m_buffer = new char[m_bufferSize];
 }
 
 // -----------------------------------------------------------------------------
 FileTransfer::~FileTransfer()
     throw ()
 {
-    delete[] m_buffer;
+}
+
+// -----------------------------------------------------------------------------
+size_t FileTransfer::nextRun(const char *buffer, size_t length,
+                             bool sparse, bool &hole) const
+    throw ()
+{
+    size_t pos = 0;
+
+    hole = sparse && length >= m_blockSize && Util::isZero(buffer, m_blockSize);
+    while (pos < length) {
+        size_t left = length - pos;
+        bool zero = sparse && left >= m_blockSize &&
+            Util::isZero(buffer + pos, m_blockSize);
+        if (zero != hole)
+            break;
+        pos += std::min(left, m_blockSize);
+    }
+
+    return pos;
 }
 
 // -----------------------------------------------------------------------------
@@ -126,24 +609,242 @@ void FileTransfer::perform(DataProvider *dataprovider,
     StringVector::const_iterator it;
     RootDirURLVector &urlv = getURLVector();
     RootDirURLVector::const_iterator itv = urlv.begin();
-    for (it = target_files.begin(); it != target_files.end(); ++it) {
-        FilePath fp = itv->getRealPath();
-        full_targets.push_back(fp.appendPath(*it));
-	if (++itv == urlv.end())
-	    itv = urlv.begin();
+    const std::vector<unsigned> &weights = getWeights();
+    if (weights.size() == urlv.size()) {
+        // smooth weighted round-robin, so that faster targets get
+        // proportionally more files without clustering them
+        std::vector<long> current(urlv.size(), 0);
+        long total = 0;
+        for (size_t i = 0; i < weights.size(); ++i)
+            total += weights[i];
+        for (it = target_files.begin(); it != target_files.end(); ++it) {
+            size_t best = 0;
+            for (size_t i = 0; i < urlv.size(); ++i) {
+                current[i] += weights[i];
+                if (current[i] > current[best])
+                    best = i;
+            }
+            current[best] -= total;
+            FilePath fp = urlv[best].getRealPath();
+            full_targets.push_back(fp.appendPath(*it));
+        }
+    } else {
+        for (it = target_files.begin(); it != target_files.end(); ++it) {
+            FilePath fp = itv->getRealPath();
+            full_targets.push_back(fp.appendPath(*it));
+            if (++itv == urlv.end())
+                itv = urlv.begin();
+        }
     }
 
-    if (dataprovider->canSaveToFile()) {
+    // a direct save cannot make copies, so it is only used if every
+    // target gets its own part (or there is only one target)
+    if (dataprovider->canSaveToFile() &&
+        (target_files.size() > 1 || urlv.size() == 1)) {
 	performFile(dataprovider, full_targets);
         if (directSave)
             *directSave = true;
     } else {
-        performPipe(dataprovider, full_targets);
+        if (target_files.size() > 1)
+            cerr << "WARNING: First dump target used; rest ignored." << endl;
+
+        // the data cannot be split, so every target gets a copy
+        StringVector copies;
+        for (itv = urlv.begin(); itv != urlv.end(); ++itv) {
+            FilePath fp = itv->getRealPath();
+            copies.push_back(fp.appendPath(target_files.front()));
+        }
+
+        performPipe(dataprovider, copies);
         if (directSave)
             *directSave = false;
     }
 }
 
+// -----------------------------------------------------------------------------
+void FileTransfer::remove(const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("FileTransfer::remove(%s)", target_file.c_str());
+
+    RootDirURLVector &urlv = getURLVector();
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        FilePath fp = it->getRealPath();
+        fp.appendPath(target_file);
+        if (unlink(fp.c_str()) != 0 && errno != ENOENT)
+            throw KSystemError("Cannot remove " + fp + ".", errno);
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool FileTransfer::exists(const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("FileTransfer::exists(%s)", target_file.c_str());
+
+    RootDirURLVector &urlv = getURLVector();
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        FilePath fp = it->getRealPath();
+        fp.appendPath(target_file);
+        if (!fp.exists())
+            return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static void clone_file(const FilePath &source, const FilePath &target)
+    throw (KError)
+{
+#ifdef FICLONE
+    int srcfd = open(source.c_str(), O_RDONLY);
+    if (srcfd < 0)
+        throw KSystemError("Cannot open " + source + ".", errno);
+
+    FilePath tmp = target + ".tmp";
+    int dstfd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dstfd < 0) {
+        int err = errno;
+        close(srcfd);
+        throw KSystemError("Cannot create " + tmp + ".", err);
+    }
+
+    int ret = ioctl(dstfd, FICLONE, srcfd);
+    int err = errno;
+    close(dstfd);
+    close(srcfd);
+    if (ret == 0 && rename(tmp.c_str(), target.c_str()) == 0)
+        return;
+    if (ret == 0)
+        err = errno;
+
+    unlink(tmp.c_str());
+    throw KSystemError("Cannot clone " + source + " to " + target + ".",
+                       err);
+#else
+    throw KError("Cannot clone " + source + " to " + target +
+                 ": FICLONE is not supported.");
+#endif
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::link(const std::string &source_file,
+                        const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("FileTransfer::link(%s, %s)",
+        source_file.c_str(), target_file.c_str());
+
+    RootDirURLVector &urlv = getURLVector();
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        FilePath source = it->getRealPath();
+        source.appendPath(source_file);
+        FilePath target = it->getRealPath();
+        target.appendPath(target_file);
+
+        FilePath(target.dirName()).mkdir(true);
+        if (unlink(target.c_str()) != 0 && errno != ENOENT)
+            throw KSystemError("Cannot remove " + target + ".", errno);
+
+        if (::link(source.c_str(), target.c_str()) == 0)
+            continue;
+
+        int err = errno;
+        if (err != EXDEV && err != EPERM && err != EMLINK &&
+            err != EOPNOTSUPP)
+            throw KSystemError("Cannot link " + source + " to " +
+                               target + ".", err);
+
+        Debug::debug()->dbg("Hard link failed, trying FICLONE");
+        clone_file(source, target);
+    }
+}
+
+// -----------------------------------------------------------------------------
+StringVector FileTransfer::listDirs()
+    throw (KError)
+{
+    Debug::debug()->trace("FileTransfer::listDirs()");
+
+    StringVector ret;
+    RootDirURLVector &urlv = getURLVector();
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        FilePath dir = it->getRealPath();
+        if (!dir.exists())
+            continue;
+        StringVector names = dir.listDir(FilterDotsAndNondirs());
+        for (StringVector::const_iterator nit = names.begin();
+                nit != names.end(); ++nit)
+            if ((*nit)[0] != '.')
+                ret.push_back(*nit);
+    }
+
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    Debug::debug()->trace("FileTransfer::removeDirs(%lu)",
+        (unsigned long)dirs.size());
+
+    string error;
+    RootDirURLVector &urlv = getURLVector();
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        StringVector::const_iterator dit;
+        for (dit = dirs.begin(); dit != dirs.end(); ++dit) {
+            FilePath fp = it->getRealPath();
+            fp.appendPath(*dit);
+            if (!fp.exists())
+                continue;
+            try {
+                fp.rmdir(true);
+            } catch (const KError &kerror) {
+                if (error.empty())
+                    error = kerror.what();
+            }
+        }
+    }
+    if (!error.empty())
+        throw KError(error);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long FileTransfer::getAdvertisedRate()
+    throw ()
+{
+    unsigned long long rate = 0;
+
+    RootDirURLVector &urlv = getURLVector();
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        FilePath fp = it->getRealPath();
+        fp.appendPath(RATE_FILE);
+
+        std::ifstream fin(fp.c_str());
+        string value;
+        if (!(fin >> value))
+            continue;
+        try {
+            unsigned long long r = parseRate(value, fp);
+            if (r && (!rate || r < rate))
+                rate = r;
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+        }
+    }
+
+    return rate;
+}
+
 // -----------------------------------------------------------------------------
 void FileTransfer::performFile(DataProvider *dataprovider,
 			       const StringVector &target_files)
@@ -165,9 +866,12 @@ void FileTransfer::performPipe(DataProvider *dataprovider,
         dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
-    if (target_files.size() > 1)
-	cerr << "WARNING: First dump target used; rest ignored." << endl;
+    if (target_files.size() > 1 || m_writers > 1) {
+        performPipeParallel(dataprovider, target_files);
+        return;
+    }
 
+    PoolBuffer buffer(FILE_IOSIZE, m_blockSize);
     FILE *fp = open(target_files.front().c_str());
     bool sparse = !Configuration::config()->kdumptoolContainsFlag("NOSPARSE");
     if (!sparse)
@@ -175,6 +879,8 @@ void FileTransfer::performPipe(DataProvider *dataprovider,
             "configuration.");
 
     bool prepared = false;
+    unsigned metricId =
+        TransferMetrics::metrics()->addTarget(target_files.front());
 
     bool last_was_sparse = false;
     try {
@@ -182,26 +888,33 @@ void FileTransfer::performPipe(DataProvider *dataprovider,
         prepared = true;
 
         while (true) {
-            size_t read_data = dataprovider->getData(m_buffer, m_bufferSize);
+            size_t read_data = dataprovider->getData(buffer.data(),
+                                                     buffer.size());
 
             // finished?
             if (read_data == 0)
                 break;
 
-            // sparse files
-            if (sparse && read_data == m_bufferSize &&
-                    Util::isZero(m_buffer, m_bufferSize)) {
-                int ret = fseek(fp, m_bufferSize, SEEK_CUR);
-                if (ret != 0)
-                    throw KSystemError("FileTransfer::perform: fseek() failed.",
-                        errno);
-                last_was_sparse = true;
-            } else {
-                size_t ret = fwrite(m_buffer, 1, read_data, fp);
-                if (ret != read_data)
-                    throw KSystemError("FileTransfer::perform: fwrite() failed"
-                        " with " + Stringutil::number2string(ret) +  ".", errno);
-                last_was_sparse = false;
+            // sparse files: seek over zero blocks
+            for (size_t pos = 0; pos < read_data; ) {
+                bool hole;
+                char *data = buffer.data() + pos;
+                size_t len = nextRun(data, read_data - pos, sparse, hole);
+                if (hole) {
+                    int ret = fseek(fp, len, SEEK_CUR);
+                    if (ret != 0)
+                        throw KSystemError("FileTransfer::perform: "
+                            "fseek() failed.", errno);
+                } else {
+                    size_t ret = fwrite(data, 1, len, fp);
+                    if (ret != len)
+                        throw KSystemError("FileTransfer::perform: fwrite() "
+                            "failed with " + Stringutil::number2string(ret) +
+                            ".", errno);
+                    TransferMetrics::metrics()->addWritten(metricId, len);
+                }
+                last_was_sparse = hole;
+                pos += len;
             }
         }
 
@@ -231,6 +944,103 @@ void FileTransfer::performPipe(DataProvider *dataprovider,
     dataprovider->finish();
 }
 
+// -----------------------------------------------------------------------------
+void FileTransfer::performPipeParallel(DataProvider *dataprovider,
+                                       const StringVector &target_files)
+    throw (KError)
+{
+    Debug::debug()->trace("FileTransfer::performPipeParallel(%p, [ \"%s\"%s ])",
+        dataprovider, target_files.front().c_str(),
+	target_files.size() > 1 ? ", ..." : "");
+
+    std::vector<int> fds;
+    StringVector::const_iterator it;
+    for (it = target_files.begin(); it != target_files.end(); ++it) {
+        int fd = ::open(it->c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            int err = errno;
+            for (size_t i = 0; i < fds.size(); ++i)
+                ::close(fds[i]);
+            throw KSystemError("Error in open for " + *it, err);
+        }
+        fds.push_back(fd);
+    }
+
+    bool sparse = !Configuration::config()->kdumptoolContainsFlag("NOSPARSE");
+    if (!sparse)
+        Debug::debug()->info("Creation of sparse files disabled in "
+            "configuration.");
+
+    bool prepared = false;
+    try {
+        // two buffers per writer thread, see PositionedWriter
+        size_t bufferSize = BufferPool::pool()->bufferSize(FILE_IOSIZE,
+            m_blockSize, 2 * m_writers * fds.size());
+        PositionedWriter writer(fds, target_files, bufferSize, m_writers);
+        off_t offset = 0;
+
+        dataprovider->prepare();
+        prepared = true;
+
+        while (true) {
+            char *buffer = writer.getBuffer();
+            size_t read_data = dataprovider->getData(buffer, bufferSize);
+
+            // finished?
+            if (read_data == 0) {
+                writer.release(buffer);
+                break;
+            }
+
+            // sparse files: holes are simply not written
+            for (size_t pos = 0; pos < read_data; ) {
+                bool hole;
+                size_t len = nextRun(buffer + pos, read_data - pos, sparse,
+                                     hole);
+                if (!hole)
+                    writer.submit(buffer, pos, len, offset + pos);
+                pos += len;
+            }
+            writer.release(buffer);
+            offset += read_data;
+        }
+
+        writer.finish();
+
+        // set the size in case the file ends with a hole; a partial
+        // copy is worse than none, so remove those that failed
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (writer.failed(i)) {
+                cerr << "WARNING: Removing incomplete " << target_files[i]
+                     << "." << endl;
+                unlink(target_files[i].c_str());
+            } else if (ftruncate(fds[i], offset) != 0)
+                throw KSystemError("Unable to set the size of " +
+                    target_files[i] + ".", errno);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < fds.size(); ++i)
+            ::close(fds[i]);
+        if (prepared) {
+            dataprovider->setError(true);
+            dataprovider->finish();
+        }
+        throw;
+    }
+
+    for (size_t i = 0; i < fds.size(); ++i) {
+        if (::close(fds[i]) != 0) {
+            int err = errno;
+            for (size_t j = i + 1; j < fds.size(); ++j)
+                ::close(fds[j]);
+            dataprovider->setError(true);
+            dataprovider->finish();
+            throw KSystemError("Error in close for " + target_files[i], err);
+        }
+    }
+    dataprovider->finish();
+}
+
 // -----------------------------------------------------------------------------
 FILE *FileTransfer::open(const string &target_file)
     throw (KError)
@@ -266,6 +1076,15 @@ static size_t curl_readfunction(void *buffer, size_t size, size_t nmemb,
     return dataprovider->getData((char *)buffer, size * nmemb);
 }
 
+// -----------------------------------------------------------------------------
+static size_t curl_writefunction(void *buffer, size_t size, size_t nmemb,
+                                 void *data)
+{
+    string *output = reinterpret_cast<string *>(data);
+    output->append((const char *)buffer, size * nmemb);
+    return size * nmemb;
+}
+
 // -----------------------------------------------------------------------------
 static int curl_debug(CURL *curl, curl_infotype info, char *buffer,
                       size_t bufsiz,  void *data)
@@ -421,7 +1240,7 @@ void FTPTransfer::open(DataProvider *dataprovider,
 	cerr << "WARNING: Dump target not reachable" << endl;
 
     // set the URL
-    FilePath full_url = parser.getURL();
+    FilePath full_url = parser.getBaseURL();
     full_url.appendPath(target_file);
     err = curl_easy_setopt(m_curl, CURLOPT_URL, full_url.c_str());
     if (err != CURLE_OK)
@@ -433,57 +1252,211 @@ void FTPTransfer::open(DataProvider *dataprovider,
         throw KError(string("CURL error: ") + m_curlError);
 }
 
-//}}}
-//{{{ NFSTransfer --------------------------------------------------------------
+// -----------------------------------------------------------------------------
+StringVector FTPTransfer::nlst(const std::string &dir,
+                               struct curl_slist *postquote)
+    throw (KError)
+{
+    Debug::debug()->trace("FTPTransfer::nlst(%s)", dir.c_str());
+
+    const RootDirURL &parser = getURLVector().front();
+    FilePath url = parser.getBaseURL();
+    if (!dir.empty())
+        url.appendPath(dir);
+    url += '/';
+
+    // a directory listing instead of an upload, then back again
+    string output;
+    CURLcode err = curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(m_curl, CURLOPT_UPLOAD, 0L);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(m_curl, CURLOPT_DIRLISTONLY, 1L);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION,
+                               curl_writefunction);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &output);
+    if (err == CURLE_OK)
+        err = curl_easy_setopt(m_curl, CURLOPT_POSTQUOTE, postquote);
+    if (err == CURLE_OK)
+        err = curl_easy_perform(m_curl);
+
+    curl_easy_setopt(m_curl, CURLOPT_POSTQUOTE, NULL);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, NULL);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, NULL);
+    curl_easy_setopt(m_curl, CURLOPT_DIRLISTONLY, 0L);
+    curl_easy_setopt(m_curl, CURLOPT_UPLOAD, 1L);
+
+    if (err != CURLE_OK)
+        throw KError(string("CURL error: ") + m_curlError);
+
+    StringVector ret;
+    std::istringstream iss(output);
+    string line;
+    while (std::getline(iss, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        // some servers return the path as given
+        string::size_type pos = line.rfind('/');
+        if (pos != string::npos)
+            line.erase(0, pos + 1);
+        if (!line.empty() && line != "." && line != "..")
+            ret.push_back(line);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
 
 // -----------------------------------------------------------------------------
-NFSTransfer::NFSTransfer(const RootDirURLVector &urlv)
+StringVector FTPTransfer::listDirs()
     throw (KError)
-    : URLTransfer(urlv), m_mountpoint(""), m_fileTransfer(NULL)
 {
-    RootDirURLVector file_urlv;
-    RootDirURLVector::const_iterator it;
-    for (it = urlv.begin(); it != urlv.end(); ++it)
-	file_urlv.push_back(translate(*it));
-    m_fileTransfer = new FileTransfer(file_urlv);
+    Debug::debug()->trace("FTPTransfer::listDirs()");
+
+    StringVector names = nlst(string());
+    StringVector ret;
+    for (StringVector::const_iterator it = names.begin();
+            it != names.end(); ++it)
+        if ((*it)[0] != '.')
+            ret.push_back(*it);
+    return ret;
 }
 
 // -----------------------------------------------------------------------------
-RootDirURL NFSTransfer::translate(const RootDirURL &parser)
+void FTPTransfer::remove(const std::string &target_file)
     throw (KError)
 {
-    // mount the NFS share
-    StringVector options;
-    options.push_back("nolock");
+    Debug::debug()->trace("FTPTransfer::remove(%s)", target_file.c_str());
 
-    // Check network status
-    Configuration *config = Configuration::config();
-    Routable rt(parser.getHostname());
-    if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
-	cerr << "WARNING: Dump target not reachable" << endl;
+    FilePath fp = target_file;
+    string dir = target_file.find('/') == string::npos
+        ? string() : fp.dirName();
+    string name = fp.baseName();
 
-    FilePath path = parser.getPath();
-    string mountedDir = path.dirName();
-    string rest = path.baseName();
+    // DELE fails for a missing file, which is not an error here
+    StringVector names = nlst(dir);
+    if (!std::binary_search(names.begin(), names.end(), name))
+        return;
+
+    // runs in dir after listing it again
+    struct curl_slist *cmds = curl_slist_append(NULL,
+        ("DELE " + name).c_str());
+    try {
+        nlst(dir, cmds);
+    } catch (...) {
+        curl_slist_free_all(cmds);
+        throw;
+    }
+    curl_slist_free_all(cmds);
+}
+
+// -----------------------------------------------------------------------------
+void FTPTransfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    Debug::debug()->trace("FTPTransfer::removeDirs(%lu)",
+        (unsigned long)dirs.size());
+
+    if (dirs.empty())
+        return;
+
+    // The commands are sent after the listing of the target directory,
+    // on the same control connection. A '*' makes curl go on if one
+    // of them fails; the result is checked with another listing, because
+    // the first one is taken before any of them runs.
+    struct curl_slist *cmds = NULL;
+    string error;
+    StringVector::const_iterator it;
+    for (it = dirs.begin(); it != dirs.end(); ++it) {
+        try {
+            StringVector files = nlst(*it);
+            StringVector::const_iterator fit;
+            for (fit = files.begin(); fit != files.end(); ++fit) {
+                FilePath fp = *it;
+                fp.appendPath(*fit);
+                cmds = curl_slist_append(cmds, ("*DELE " + fp).c_str());
+            }
+            cmds = curl_slist_append(cmds, ("*RMD " + *it).c_str());
+        } catch (const KError &kerror) {
+            if (error.empty())
+                error = kerror.what();
+        }
+    }
+
+    try {
+        nlst(string(), cmds);
+    } catch (...) {
+        curl_slist_free_all(cmds);
+        throw;
+    }
+    curl_slist_free_all(cmds);
+
+    StringVector left = nlst(string());
+
+    for (it = dirs.begin(); it != dirs.end(); ++it)
+        if (std::binary_search(left.begin(), left.end(), *it) &&
+                error.empty())
+            error = "Cannot remove " + *it + " from the FTP server.";
+    if (!error.empty())
+        throw KError(error);
+}
+
+//}}}
+//{{{ MountTransfer ------------------------------------------------------------
 
-    m_mountpoint = DEFAULT_MOUNTPOINT;
-    m_mountpoint.appendPath(parser.getHostname()).appendPath(mountedDir);
-    m_mountpoint.mkdir(true);
-    Debug::debug()->dbg("Path: %s, Mountpoint: %s, Rest: %s",
-        path.c_str(), m_mountpoint.c_str(), rest.c_str());
+/**
+ * Checks the route to the server and mounts one file system.
+ */
+class MountTransfer::MountThread : public Thread {
+
+    public:
+        MountThread(MountTransfer *transfer, MountInfo *mount)
+        throw ()
+            : m_transfer(transfer), m_mount(mount)
+        {}
+
+        ~MountThread()
+        throw ()
+        { joinQuietly(); }
+
+    protected:
+        void run()
+        throw (KError)
+        {
+            // Check network status
+            Configuration *config = Configuration::config();
+            Routable rt(m_mount->host);
+            if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
+                cerr << "WARNING: Dump target not reachable" << endl;
+
+            m_mount->mountpoint.mkdir(true);
+            m_transfer->doMount(*m_mount);
+            m_mount->mounted = true;
+        }
+
+    private:
+        MountTransfer *m_transfer;
+        MountInfo *m_mount;
+};
 
-    FileUtil::nfsmount(parser.getHostname(), mountedDir,
-        m_mountpoint, options);
+static Mutex s_mountCounterLock;
+static unsigned s_mountCounter;
 
-    return RootDirURL("file://" + m_mountpoint + PATH_SEPARATOR + rest, "");
+// -----------------------------------------------------------------------------
+MountTransfer::MountTransfer(const RootDirURLVector &urlv)
+    throw (KError)
+    : URLTransfer(urlv), m_fileTransfer(NULL)
+{
 }
 
 // -----------------------------------------------------------------------------
-NFSTransfer::~NFSTransfer()
+MountTransfer::~MountTransfer()
     throw ()
 {
-    Debug::debug()->trace("NFSTransfer::~NFSTransfer()");
+    Debug::debug()->trace("MountTransfer::~MountTransfer()");
 
+    delete m_fileTransfer;
     try {
         close();
     } catch (const KError &kerror) {
@@ -492,22 +1465,271 @@ NFSTransfer::~NFSTransfer()
 }
 
 // -----------------------------------------------------------------------------
-void NFSTransfer::perform(DataProvider *dataprovider,
-                          const StringVector &target_files,
-                          bool *directSave)
+void MountTransfer::mountAll()
+    throw (KError)
+{
+    RootDirURLVector &urlv = getURLVector();
+    StringVector rests;
+    std::vector<size_t> mountidx;
+
+    // assign mountpoints
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        MountInfo mount;
+        rests.push_back(describe(*it, mount));
+
+        size_t idx;
+        for (idx = 0; idx < m_mounts.size(); ++idx)
+            if (m_mounts[idx].device == mount.device &&
+                m_mounts[idx].fstype == mount.fstype &&
+                m_mounts[idx].options == mount.options)
+                break;
+
+        // flat names, so that no mountpoint is inside another mount;
+        // the number is unique in the process, because several
+        // MountTransfer objects may exist at the same time
+        if (idx == m_mounts.size()) {
+            unsigned num;
+            {
+                MutexLocker lock(s_mountCounterLock);
+                num = s_mountCounter++;
+            }
+            mount.mountpoint = DEFAULT_MOUNTPOINT;
+            mount.mountpoint.appendPath(mount.fstype +
+                Stringutil::number2string(num));
+            m_mounts.push_back(mount);
+        }
+        mountidx.push_back(idx);
+
+        Debug::debug()->dbg("URL %s: Mountpoint: %s, Rest: %s",
+            it->getURL().c_str(), m_mounts[idx].mountpoint.c_str(),
+            rests.back().c_str());
+    }
+
+    // mount everything in parallel
+    std::vector<MountThread *> threads;
+    std::string error;
+    for (size_t i = 0; i < m_mounts.size(); ++i) {
+        threads.push_back(new MountThread(this, &m_mounts[i]));
+        try {
+            threads.back()->start();
+        } catch (const KError &kerror) {
+            if (error.empty())
+                error = kerror.what();
+        }
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        try {
+            threads[i]->join();
+        } catch (const KError &kerror) {
+            if (error.empty())
+                error = kerror.what();
+        }
+        delete threads[i];
+    }
+    if (!error.empty()) {
+        try {
+            close();
+        } catch (const KError &kerror) {
+            Debug::debug()->info("Error: %s", kerror.what());
+        }
+        throw KError(error);
+    }
+
+    RootDirURLVector file_urlv;
+    unsigned writers = 1;
+    for (size_t i = 0; i < urlv.size(); ++i) {
+        const MountInfo &mount = m_mounts[mountidx[i]];
+        FilePath path = mount.mountpoint;
+        path.appendPath(rests[i]);
+        file_urlv.push_back(RootDirURL("file://" + path, ""));
+        if (mount.writers > writers)
+            writers = mount.writers;
+    }
+    m_fileTransfer = new FileTransfer(file_urlv);
+    m_fileTransfer->setWriters(writers);
+}
+
+// -----------------------------------------------------------------------------
+void MountTransfer::doMount(MountInfo &mount)
+    throw (KError)
+{
+    FileUtil::mount(mount.device, mount.mountpoint, mount.fstype,
+        mount.options);
+}
+
+// -----------------------------------------------------------------------------
+void MountTransfer::perform(DataProvider *dataprovider,
+                            const StringVector &target_files,
+                            bool *directSave)
     throw (KError)
 {
     m_fileTransfer->perform(dataprovider, target_files, directSave);
 }
 
 // -----------------------------------------------------------------------------
-void NFSTransfer::close()
+void MountTransfer::remove(const std::string &target_file)
+    throw (KError)
+{
+    m_fileTransfer->remove(target_file);
+}
+
+// -----------------------------------------------------------------------------
+bool MountTransfer::exists(const std::string &target_file)
+    throw (KError)
+{
+    return m_fileTransfer->exists(target_file);
+}
+
+// -----------------------------------------------------------------------------
+void MountTransfer::link(const std::string &source_file,
+                         const std::string &target_file)
+    throw (KError)
+{
+    m_fileTransfer->link(source_file, target_file);
+}
+
+// -----------------------------------------------------------------------------
+StringVector MountTransfer::listDirs()
+    throw (KError)
+{
+    return m_fileTransfer->listDirs();
+}
+
+// -----------------------------------------------------------------------------
+void MountTransfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    m_fileTransfer->removeDirs(dirs);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long MountTransfer::getAdvertisedRate()
+    throw ()
+{
+    return m_fileTransfer->getAdvertisedRate();
+}
+
+// -----------------------------------------------------------------------------
+void MountTransfer::setWeights(const std::vector<unsigned> &weights)
+    throw ()
+{
+    URLTransfer::setWeights(weights);
+    m_fileTransfer->setWeights(weights);
+}
+
+// -----------------------------------------------------------------------------
+void MountTransfer::close()
+    throw (KError)
+{
+    Debug::debug()->trace("MountTransfer::close()");
+
+    std::string error;
+    std::vector<MountInfo>::reverse_iterator it;
+    for (it = m_mounts.rbegin(); it != m_mounts.rend(); ++it) {
+        if (!it->mounted)
+            continue;
+        try {
+            FileUtil::umount(it->mountpoint);
+            it->mounted = false;
+        } catch (const KError &kerror) {
+            if (error.empty())
+                error = kerror.what();
+        }
+    }
+    if (!error.empty())
+        throw KError(error);
+}
+
+//}}}
+//{{{ NFSTransfer --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+NFSTransfer::NFSTransfer(const RootDirURLVector &urlv)
+    throw (KError)
+    : MountTransfer(urlv)
+{
+    mountAll();
+}
+
+// -----------------------------------------------------------------------------
+StringVector NFSTransfer::mountOptions(const RootDirURL &parser,
+                                       unsigned *nconnect)
+    throw (KError)
+{
+    StringVector options;
+    options.push_back("nolock");
+    *nconnect = 1;
+
+    const StringStringMap &params = parser.getParameters();
+    StringStringMap::const_iterator it;
+    for (it = params.begin(); it != params.end(); ++it) {
+        const string &name = it->first;
+        KString value = it->second;
+
+        if (name == "wsize" || name == "rsize") {
+            if (value.empty() || value == "auto")
+                value = Stringutil::number2string(NFS_AUTO_IOSIZE);
+            else if (!value.isNumber())
+                throw KError("Invalid NFS " + name + ": " + value + ".");
+            options.push_back(name + "=" + value);
+        } else if (name == "nconnect") {
+            int n = value.isNumber() ? Stringutil::string2number(value) : 0;
+            if (n < 1 || n > NFS_MAX_NCONNECT)
+                throw KError("Invalid NFS nconnect: " + value + ".");
+            *nconnect = n;
+            if (n > 1)
+                options.push_back("nconnect=" + value);
+        } else if (name == "timeo" || name == "retrans") {
+            if (value.empty() || !value.isNumber())
+                throw KError("Invalid NFS " + name + ": " + value + ".");
+            options.push_back(name + "=" + value);
+        } else if (name == "proto" || name == "vers" || name == "nfsvers") {
+            options.push_back(name + "=" + value);
+        } else if (name == "rate" || name == "burst" ||
+                   name == "startdelay") {
+            // handled by RateLimitedTransfer
+        } else
+            cerr << "WARNING: Unknown NFS parameter \"" << name
+                 << "\" ignored." << endl;
+    }
+
+    return options;
+}
+
+// -----------------------------------------------------------------------------
+string NFSTransfer::describe(const RootDirURL &parser, MountInfo &mount)
+    throw (KError)
+{
+    FilePath path = parser.getPath();
+    string mountedDir = path.dirName();
+
+    mount.host = parser.getHostname();
+    mount.device = parser.getHostname() + ":" + mountedDir;
+    mount.fstype = "nfs";
+    mount.options = mountOptions(parser, &mount.writers);
+
+    return path.baseName();
+}
+
+// -----------------------------------------------------------------------------
+void NFSTransfer::doMount(MountInfo &mount)
     throw (KError)
 {
-    Debug::debug()->trace("NFSTransfer::close()");
-    if (!m_mountpoint.empty()) {
-        FileUtil::umount(m_mountpoint);
-        m_mountpoint.clear();
+    try {
+        MountTransfer::doMount(mount);
+    } catch (const KError &error) {
+        // kernels before 5.3 reject the nconnect option
+        if (mount.writers <= 1)
+            throw;
+        cerr << "WARNING: " << error.what()
+             << " Retrying without nconnect." << endl;
+        mount.options.erase(std::remove(mount.options.begin(),
+            mount.options.end(),
+            "nconnect=" + Stringutil::number2string(mount.writers)),
+            mount.options.end());
+        mount.writers = 1;
+        MountTransfer::doMount(mount);
     }
 }
 
@@ -517,93 +1739,673 @@ void NFSTransfer::close()
 // -----------------------------------------------------------------------------
 CIFSTransfer::CIFSTransfer(const RootDirURLVector &urlv)
     throw (KError)
-    : URLTransfer(urlv), m_mountpoint(""), m_fileTransfer(NULL)
+    : MountTransfer(urlv)
 {
-    RootDirURLVector file_urlv;
-    RootDirURLVector::const_iterator it;
-    for (it = urlv.begin(); it != urlv.end(); ++it)
-	file_urlv.push_back(translate(*it));
-    m_fileTransfer = new FileTransfer(file_urlv);
+    mountAll();
 }
 
 // -----------------------------------------------------------------------------
-RootDirURL CIFSTransfer::translate(const RootDirURL &parser)
+string CIFSTransfer::describe(const RootDirURL &parser, MountInfo &mount)
     throw (KError)
 {
-    // Check network status
-    Configuration *config = Configuration::config();
-    Routable rt(parser.getHostname());
-    if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
-	cerr << "WARNING: Dump target not reachable" << endl;
-
     KString share = parser.getPath();
     share.ltrim("/");
     string::size_type first_slash = share.find("/");
     if (first_slash == string::npos)
         throw KError("Path ("+ parser.getPath() +") must contain a \"/\".");
+    string rest = share.substr(first_slash);
     share = share.substr(0, first_slash);
 
-    StringVector options;
+    mount.host = parser.getHostname();
+    mount.device = "//" + parser.getHostname() + "/" + share;
+    mount.fstype = "cifs";
     if (parser.getUsername().size() > 0) {
-        options.push_back("user=" + parser.getUsername());
+        mount.options.push_back("user=" + parser.getUsername());
         if (parser.getPassword().size() > 0)
-            options.push_back("password=" + parser.getPassword());
+            mount.options.push_back("password=" + parser.getPassword());
     }
     if (parser.getPort() != -1) {
-        options.push_back("port=" + Stringutil::number2string(parser.getPort()));
+        mount.options.push_back("port=" +
+            Stringutil::number2string(parser.getPort()));
     }
 
-    FileUtil::mount("//" + parser.getHostname() + "/" + share,
-        DEFAULT_MOUNTPOINT, "cifs", options);
-    m_mountpoint = DEFAULT_MOUNTPOINT;
+    return rest;
+}
+
+//}}}
 
-    string rest = parser.getPath();
-    string::size_type shareBegin = rest.find(share);
-    if (shareBegin == string::npos) {
-        close();
-        throw KError("Internal error in CIFSTransfer::CIFSTransfer.");
+//{{{ CompositeTransfer --------------------------------------------------------
+
+// preferred and smallest size, and number of the blocks shared by all
+// children (see BufferPool)
+#define COMPOSITE_BLOCK_SIZE    (256*1024)
+#define COMPOSITE_MIN_BLOCK     (16*1024)
+#define COMPOSITE_BLOCKS        16
+
+/**
+ * Blocks shared between the source and the children of one
+ * CompositeTransfer::perform() call.
+ *
+ * Every filled block is queued for each active child and goes back to
+ * the free list when the last child has consumed it. A child that stops
+ * is detached and its queued blocks are released, so that it does not
+ * hold up the others.
+ */
+class CompositeTransfer::Fanout {
+
+    public:
+        struct Block {
+            char *data;
+            size_t length;
+            unsigned refs;
+        };
+
+        /**
+         * @param[in] names the names of the children (for
+         *            TransferMetrics)
+         * @exception KError if the blocks cannot be allocated
+         */
+        Fanout(const StringVector &names)
+        throw (KError);
+
+        ~Fanout()
+        throw ();
+
+        /**
+         * Returns an empty block, waiting for one if necessary.
+         *
+         * @return the block, or @c NULL if there is no active child left
+         */
+        Block *getFree()
+        throw ();
+
+        /**
+         * Queues a filled block for all active children. An empty block
+         * goes back to the free list.
+         */
+        void publish(Block *block)
+        throw ();
+
+        /**
+         * Signals the end of data.
+         *
+         * @param[in] error @c true if reading the source failed
+         */
+        void close(bool error)
+        throw ();
+
+        /**
+         * Returns the next block for a child, waiting if necessary.
+         *
+         * @return the block, or @c NULL at the end of data
+         * @exception KError if reading the source failed
+         */
+        Block *next(unsigned child)
+        throw (KError);
+
+        /**
+         * Marks a block as consumed by one child.
+         */
+        void release(Block *block)
+        throw ();
+
+        /**
+         * Removes a child. Its queued blocks are released.
+         */
+        void detach(unsigned child)
+        throw ();
+
+        /**
+         * Counts bytes consumed by a child.
+         */
+        void consumed(unsigned child, size_t length)
+        throw ()
+        { TransferMetrics::metrics()->addWritten(m_metricIds[child], length); }
+
+        /**
+         * Returns the size of a block.
+         */
+        size_t getBlockSize() const
+        throw ()
+        { return m_blockSize; }
+
+    private:
+        void unref(Block *block)
+        throw ();
+
+        Mutex m_lock;
+        Condition m_cond;
+        size_t m_blockSize;
+        std::vector<Block> m_blocks;
+        std::vector<Block *> m_free;
+        std::vector< std::deque<Block *> > m_queues;
+        std::vector<unsigned> m_metricIds;
+        std::vector<bool> m_active;
+        unsigned m_numActive;
+        bool m_closed;
+        bool m_sourceFailed;
+};
+
+// -----------------------------------------------------------------------------
+CompositeTransfer::Fanout::Fanout(const StringVector &names)
+    throw (KError)
+    : m_blockSize(BufferPool::pool()->bufferSize(COMPOSITE_BLOCK_SIZE,
+                                                 COMPOSITE_MIN_BLOCK,
+                                                 COMPOSITE_BLOCKS)),
+      m_blocks(COMPOSITE_BLOCKS), m_queues(names.size()),
+      m_active(names.size(), true), m_numActive(names.size()),
+      m_closed(false), m_sourceFailed(false)
+{
+    for (size_t i = 0; i < names.size(); ++i)
+        m_metricIds.push_back(TransferMetrics::metrics()->addTarget(names[i]));
+
+    std::vector<Block>::iterator it;
+    for (it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+        it->data = NULL;
+        it->length = 0;
+        it->refs = 0;
     }
-    rest = rest.substr(shareBegin + share.size());
-    FilePath prefix = m_mountpoint;
-    prefix.appendPath(rest);
+    try {
+        for (it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+            it->data = BufferPool::pool()->allocate(m_blockSize);
+            m_free.push_back(&*it);
+        }
+    } catch (...) {
+        for (it = m_blocks.begin(); it != m_blocks.end(); ++it)
+            BufferPool::pool()->release(it->data);
+        throw;
+    }
+}
 
-    Debug::debug()->dbg("Mountpoint: %s, Rest: %s, Prefix: %s",
-        m_mountpoint.c_str(), rest.c_str(), prefix.c_str());
+// -----------------------------------------------------------------------------
+CompositeTransfer::Fanout::~Fanout()
+    throw ()
+{
+    std::vector<Block>::iterator it;
+    for (it = m_blocks.begin(); it != m_blocks.end(); ++it)
+        BufferPool::pool()->release(it->data);
+}
+
+// -----------------------------------------------------------------------------
+CompositeTransfer::Fanout::Block *CompositeTransfer::Fanout::getFree()
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    while (m_free.empty() && m_numActive)
+        m_cond.wait(m_lock);
+    if (!m_numActive)
+        return NULL;
+
+    Block *ret = m_free.back();
+    m_free.pop_back();
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::Fanout::publish(Block *block)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    block->refs = 0;
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        if (m_active[i] && block->length) {
+            m_queues[i].push_back(block);
+            ++block->refs;
+            TransferMetrics::metrics()->setQueued(m_metricIds[i],
+                                                  m_queues[i].size());
+        }
+    }
+    if (!block->refs)
+        m_free.push_back(block);
+    m_cond.broadcast();
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::Fanout::close(bool error)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    m_closed = true;
+    m_sourceFailed = error;
+    m_cond.broadcast();
+}
+
+// -----------------------------------------------------------------------------
+CompositeTransfer::Fanout::Block *CompositeTransfer::Fanout::next(
+    unsigned child)
+    throw (KError)
+{
+    MutexLocker locker(m_lock);
+
+    std::deque<Block *> &queue = m_queues[child];
+    while (queue.empty() && !m_closed)
+        m_cond.wait(m_lock);
+    if (m_sourceFailed)
+        throw KError("Reading the dump data failed.");
+    if (queue.empty())
+        return NULL;
+
+    Block *ret = queue.front();
+    queue.pop_front();
+    TransferMetrics::metrics()->setQueued(m_metricIds[child], queue.size());
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::Fanout::release(Block *block)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    unref(block);
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::Fanout::detach(unsigned child)
+    throw ()
+{
+    MutexLocker locker(m_lock);
+
+    if (!m_active[child])
+        return;
+
+    m_active[child] = false;
+    --m_numActive;
+
+    std::deque<Block *> &queue = m_queues[child];
+    while (!queue.empty()) {
+        unref(queue.front());
+        queue.pop_front();
+    }
+    m_cond.broadcast();
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::Fanout::unref(Block *block)
+    throw ()
+{
+    if (--block->refs == 0) {
+        m_free.push_back(block);
+        m_cond.broadcast();
+    }
+}
 
-    return RootDirURL("file://" + prefix, "");
+/**
+ * Runs one child Transfer in a thread and serves its data from the
+ * Fanout queue.
+ */
+class CompositeTransfer::Child : public Thread, public AbstractDataProvider {
+
+    public:
+        Child(Transfer *transfer, Fanout *fanout, unsigned index,
+              const StringVector &target_files)
+        throw ()
+            : m_transfer(transfer), m_fanout(fanout), m_index(index),
+              m_targets(target_files), m_current(NULL), m_offset(0)
+        {}
+
+        ~Child()
+        throw ()
+        { joinQuietly(); }
+
+        size_t getData(char *buffer, size_t maxread)
+        throw (KError);
+
+    protected:
+        void run()
+        throw (KError);
+
+    private:
+        Transfer *m_transfer;
+        Fanout *m_fanout;
+        unsigned m_index;
+        StringVector m_targets;
+        Fanout::Block *m_current;
+        size_t m_offset;
+};
+
+// -----------------------------------------------------------------------------
+size_t CompositeTransfer::Child::getData(char *buffer, size_t maxread)
+    throw (KError)
+{
+    size_t done = 0;
+
+    while (done < maxread) {
+        if (!m_current) {
+            m_current = m_fanout->next(m_index);
+            m_offset = 0;
+            if (!m_current)
+                break;
+        }
+
+        size_t len = std::min(maxread - done, m_current->length - m_offset);
+        memcpy(buffer + done, m_current->data + m_offset, len);
+        done += len;
+        m_offset += len;
+        m_fanout->consumed(m_index, len);
+
+        if (m_offset == m_current->length) {
+            m_fanout->release(m_current);
+            m_current = NULL;
+        }
+    }
+
+    return done;
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::Child::run()
+    throw (KError)
+{
+    try {
+        m_transfer->perform(this, m_targets, NULL);
+    } catch (...) {
+        if (m_current)
+            m_fanout->release(m_current);
+        m_current = NULL;
+        m_fanout->detach(m_index);
+        throw;
+    }
+
+    if (m_current)
+        m_fanout->release(m_current);
+    m_current = NULL;
+    m_fanout->detach(m_index);
 }
 
 // -----------------------------------------------------------------------------
-CIFSTransfer::~CIFSTransfer()
+CompositeTransfer::CompositeTransfer(const std::vector<Transfer *> &children,
+                                     const StringVector &names)
     throw ()
+    : m_children(children), m_names(names)
 {
-    Debug::debug()->trace("CIFSTransfer::~CIFSTransfer()");
+    for (size_t i = m_names.size(); i < m_children.size(); ++i)
+        m_names.push_back("target " + Stringutil::number2string(i + 1));
+}
 
+// -----------------------------------------------------------------------------
+CompositeTransfer::~CompositeTransfer()
+    throw ()
+{
+    std::vector<Transfer *>::iterator it;
+    for (it = m_children.begin(); it != m_children.end(); ++it)
+        delete *it;
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::perform(DataProvider *dataprovider,
+                                const StringVector &target_files,
+                                bool *directSave)
+    throw (KError)
+{
+    Debug::debug()->trace("CompositeTransfer::perform(%p, [ \"%s\"%s ])",
+	dataprovider, target_files.front().c_str(),
+	target_files.size() > 1 ? ", ..." : "");
+
+    if (directSave)
+        *directSave = false;
+
+    Fanout fanout(m_names);
+    std::vector<Child *> children;
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        children.push_back(new Child(m_children[i], &fanout, i, target_files));
+        try {
+            children.back()->start();
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+            fanout.detach(i);
+        }
+    }
+
+    bool prepared = false;
+    bool failed = false;
+    std::string error;
     try {
-        close();
+        dataprovider->prepare();
+        prepared = true;
+
+        while (true) {
+            Fanout::Block *block = fanout.getFree();
+            if (!block)
+                break;          // all children failed
+            block->length = dataprovider->getData(block->data,
+                                                  fanout.getBlockSize());
+            fanout.publish(block);
+
+            // finished?
+            if (block->length == 0)
+                break;
+        }
+        fanout.close(false);
     } catch (const KError &kerror) {
-        Debug::debug()->info("Error: %s", kerror.what());
+        fanout.close(true);
+        failed = true;
+        error = kerror.what();
+    }
+
+    // collect the results of all children
+    unsigned succeeded = 0;
+    std::string childError;
+    for (size_t i = 0; i < children.size(); ++i) {
+        try {
+            if (children[i]->isRunning()) {
+                children[i]->join();
+                ++succeeded;
+            }
+        } catch (const KError &kerror) {
+            if (!failed)
+                cerr << "WARNING: Dump target failed: " << kerror.what()
+                     << endl;
+            if (childError.empty())
+                childError = kerror.what();
+        }
+        delete children[i];
+    }
+
+    if (prepared) {
+        if (failed || !succeeded)
+            dataprovider->setError(true);
+        try {
+            dataprovider->finish();
+        } catch (const KError &kerror) {
+            if (!failed) {
+                failed = true;
+                error = kerror.what();
+            }
+        }
     }
+
+    if (failed)
+        throw KError(error);
+    if (!succeeded)
+        throw KError(childError.empty() ?
+            "Saving failed on all dump targets." : childError);
 }
 
 // -----------------------------------------------------------------------------
-void CIFSTransfer::perform(DataProvider *dataprovider,
-                          const StringVector &target_files,
-                          bool *directSave)
+void CompositeTransfer::remove(const std::string &target_file)
     throw (KError)
 {
-    m_fileTransfer->perform(dataprovider, target_files, directSave);
+    Debug::debug()->trace("CompositeTransfer::remove(%s)",
+        target_file.c_str());
+
+    std::string error;
+    std::vector<Transfer *>::iterator it;
+    for (it = m_children.begin(); it != m_children.end(); ++it) {
+        try {
+            (*it)->remove(target_file);
+        } catch (const KError &kerror) {
+            if (error.empty())
+                error = kerror.what();
+        }
+    }
+    if (!error.empty())
+        throw KError(error);
 }
 
 // -----------------------------------------------------------------------------
-void CIFSTransfer::close()
+bool CompositeTransfer::exists(const std::string &target_file)
     throw (KError)
 {
-    Debug::debug()->trace("CIFSTransfer::close()");
-    if (m_mountpoint.size() > 0) {
-        FileUtil::umount(m_mountpoint);
-        m_mountpoint.clear();
+    Debug::debug()->trace("CompositeTransfer::exists(%s)",
+        target_file.c_str());
+
+    std::vector<Transfer *>::iterator it;
+    for (it = m_children.begin(); it != m_children.end(); ++it)
+        if (!(*it)->exists(target_file))
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void CompositeTransfer::link(const std::string &source_file,
+                             const std::string &target_file)
+    throw (KError)
+{
+    Debug::debug()->trace("CompositeTransfer::link(%s, %s)",
+        source_file.c_str(), target_file.c_str());
+
+    std::string error;
+    std::vector<Transfer *>::iterator it;
+    for (it = m_children.begin(); it != m_children.end(); ++it) {
+        try {
+            (*it)->link(source_file, target_file);
+        } catch (const KError &kerror) {
+            if (error.empty())
+                error = kerror.what();
+        }
     }
+    if (!error.empty())
+        throw KError(error);
+}
+
+//}}}
+//{{{ RateLimitedTransfer ------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+RateLimitedTransfer::RateLimitedTransfer(Transfer *transfer,
+                                         unsigned long long rate,
+                                         unsigned long long burst,
+                                         unsigned startDelay)
+    throw ()
+    : m_transfer(transfer), m_rate(rate), m_burst(burst),
+      m_startDelay(startDelay)
+{
+    Debug::debug()->trace("RateLimitedTransfer::RateLimitedTransfer"
+        "(%p, %llu, %llu, %u)", transfer, rate, burst, startDelay);
+}
+
+// -----------------------------------------------------------------------------
+RateLimitedTransfer::~RateLimitedTransfer()
+    throw ()
+{
+    delete m_transfer;
+}
+
+// -----------------------------------------------------------------------------
+Transfer *RateLimitedTransfer::wrap(URLTransfer *transfer,
+                                    const RootDirURLVector &urlv)
+    throw (KError)
+{
+    unsigned long long rate = 0, burst = 0;
+    unsigned startDelay = 0;
+
+    try {
+        RootDirURLVector::const_iterator it;
+        for (it = urlv.begin(); it != urlv.end(); ++it) {
+            if (it->hasParameter("rate")) {
+                unsigned long long r =
+                    parseRate(it->getParameter("rate"), "rate");
+                if (r && (!rate || r < rate))
+                    rate = r;
+            }
+            if (it->hasParameter("burst")) {
+                unsigned long long b =
+                    parseRate(it->getParameter("burst"), "burst");
+                if (b && (!burst || b < burst))
+                    burst = b;
+            }
+            if (it->hasParameter("startdelay")) {
+                KString value = it->getParameter("startdelay");
+                if (!value.isNumber())
+                    throw KError("Invalid startdelay: " + value + ".");
+                unsigned d = Stringutil::string2number(value);
+                if (d > startDelay)
+                    startDelay = d;
+            }
+        }
+    } catch (...) {
+        delete transfer;
+        throw;
+    }
+
+    unsigned long long advertised = transfer->getAdvertisedRate();
+    if (advertised && (!rate || advertised < rate)) {
+        Debug::debug()->info("Using rate %llu advertised by the target",
+            advertised);
+        rate = advertised;
+    }
+
+    if (!rate && !startDelay)
+        return transfer;
+
+    return new RateLimitedTransfer(transfer, rate, burst, startDelay);
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedTransfer::perform(DataProvider *dataprovider,
+                                  const StringVector &target_files,
+                                  bool *directSave)
+    throw (KError)
+{
+    Debug::debug()->trace("RateLimitedTransfer::perform(%p, [ \"%s\"%s ])",
+	dataprovider, target_files.front().c_str(),
+	target_files.size() > 1 ? ", ..." : "");
+
+    // only the first transfer is delayed
+    RateLimitedDataProvider limited(dataprovider, m_rate, m_burst,
+                                    m_startDelay);
+    m_startDelay = 0;
+    m_transfer->perform(&limited, target_files, directSave);
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedTransfer::remove(const std::string &target_file)
+    throw (KError)
+{
+    m_transfer->remove(target_file);
+}
+
+// -----------------------------------------------------------------------------
+bool RateLimitedTransfer::exists(const std::string &target_file)
+    throw (KError)
+{
+    return m_transfer->exists(target_file);
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedTransfer::link(const std::string &source_file,
+                               const std::string &target_file)
+    throw (KError)
+{
+    m_transfer->link(source_file, target_file);
+}
+
+// -----------------------------------------------------------------------------
+StringVector RateLimitedTransfer::listDirs()
+    throw (KError)
+{
+    return m_transfer->listDirs();
+}
+
+// -----------------------------------------------------------------------------
+void RateLimitedTransfer::removeDirs(const StringVector &dirs)
+    throw (KError)
+{
+    m_transfer->removeDirs(dirs);
 }
 
 //}}}
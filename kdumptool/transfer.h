@@ -81,6 +81,69 @@ class Transfer {
 		     const std::string &target_file,
 		     bool *directSave=NULL)
 	throw (KError);
+
+        /**
+         * Removes a file that has been transferred before. Missing files
+         * are not an error.
+         *
+         * @param[in] target_file the file name on the target
+         * @exception KError if the file cannot be removed or the transfer
+         *            does not support removing files
+         */
+        virtual void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Checks whether a file exists on the target. The default
+         * implementation cannot check and always returns @c false.
+         *
+         * @param[in] target_file the file name on the target
+         * @return @c true if the file exists (on all targets)
+         * @exception KError if the check fails
+         */
+        virtual bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Makes @p target_file refer to the same content as
+         * @p source_file without transferring the data again, e.g. with
+         * a hard link. Both names are relative to the target directory
+         * and may refer to other directories on the target. Missing
+         * parent directories of @p target_file are created, and an
+         * existing @p target_file is replaced.
+         *
+         * @param[in] source_file an existing file on the target
+         * @param[in] target_file the new file name on the target
+         * @exception KError if the file cannot be linked or the transfer
+         *            does not support linking files
+         */
+        virtual void link(const std::string &source_file,
+                          const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Lists the subdirectories of the target directory. Names that
+         * start with a dot are left out. Targets that cannot tell files
+         * from directories (FTP) return the names of files, too.
+         *
+         * @return the sorted names
+         * @exception KError if the directory cannot be read or the
+         *            transfer does not support listing directories
+         */
+        virtual StringVector listDirs()
+        throw (KError);
+
+        /**
+         * Removes subdirectories of the target directory with all their
+         * contents. All directories are tried; the first error is
+         * re-thrown afterwards. Missing directories are not an error.
+         *
+         * @param[in] dirs names of the directories
+         * @exception KError if a directory cannot be removed or the
+         *            transfer does not support removing directories
+         */
+        virtual void removeDirs(const StringVector &dirs)
+        throw (KError);
 };
 
 //}}}
@@ -117,8 +180,39 @@ class URLTransfer : public Transfer {
         throw ()
 	{ return m_urlVector; }
 
+        /**
+         * Sets the relative weight of each target URL. When several
+         * files are transferred at once, they are distributed among the
+         * targets in proportion to these weights. An empty vector (the
+         * default) distributes the files evenly.
+         *
+         * @param[in] weights one weight per URL, in URL vector order
+         */
+        virtual void setWeights(const std::vector<unsigned> &weights)
+        throw ()
+        { m_weights = weights; }
+
+        /**
+         * Returns the weights set by setWeights().
+         */
+        const std::vector<unsigned> &getWeights() const
+        throw ()
+        { return m_weights; }
+
+        /**
+         * Returns the transfer rate that the target asks its clients not
+         * to exceed. The default implementation returns 0, i.e. the
+         * protocol cannot advertise a rate.
+         *
+         * @return the rate in bytes per second, or 0 if there is no limit
+         */
+        virtual unsigned long long getAdvertisedRate()
+        throw ()
+        { return 0; }
+
     private:
         RootDirURLVector m_urlVector;
+        std::vector<unsigned> m_weights;
 };
 
 //}}}
@@ -149,6 +243,11 @@ class FileTransfer : public URLTransfer {
         /**
          * Transfers the file.
          *
+         * Split files are spread over the target directories. A single
+         * file is copied to every target directory instead; it is piped
+         * through kdumptool then, even if the data provider could save
+         * it directly, because the direct save writes only one file.
+         *
          * @see Transfer::perform()
          */
         void perform(DataProvider *dataprovider,
@@ -156,6 +255,72 @@ class FileTransfer : public URLTransfer {
                      bool *directSave)
         throw (KError);
 
+        /**
+         * Sets the number of threads that write each target file
+         * concurrently when the data is piped through kdumptool.
+         * With more than one writer, blocks are written with pwrite(2)
+         * at their final offsets, so that they can be in flight on
+         * several connections of a network file system at once.
+         *
+         * @param[in] writers number of writer threads (default is 1)
+         */
+        void setWriters(unsigned writers)
+        throw ()
+        { m_writers = writers ? writers : 1; }
+
+        /**
+         * Removes the file from all target directories.
+         *
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Checks the file in all target directories.
+         *
+         * @see Transfer::exists()
+         */
+        bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Hard-links the file in all target directories. If that is not
+         * possible (e.g. the file system does not support hard links),
+         * the file is cloned with the FICLONE ioctl, which shares the
+         * data blocks on file systems that support reflinks.
+         *
+         * @see Transfer::link()
+         */
+        void link(const std::string &source_file,
+                  const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Lists the subdirectories of all target directories.
+         *
+         * @see Transfer::listDirs()
+         */
+        StringVector listDirs()
+        throw (KError);
+
+        /**
+         * Removes the directories from all target directories.
+         *
+         * @see Transfer::removeDirs()
+         */
+        void removeDirs(const StringVector &dirs)
+        throw (KError);
+
+        /**
+         * Reads the rate from a file called ".kdump-rate" in the target
+         * directories. If there are several, the lowest rate is used.
+         *
+         * @see URLTransfer::getAdvertisedRate()
+         */
+        unsigned long long getAdvertisedRate()
+        throw ();
+
     protected:
 
         void performFile(DataProvider *dataprovider,
@@ -166,15 +331,33 @@ class FileTransfer : public URLTransfer {
 			 const StringVector &target_files)
         throw (KError);
 
+        void performPipeParallel(DataProvider *dataprovider,
+                                 const StringVector &target_files)
+        throw (KError);
+
         FILE *open(const std::string &target_file)
         throw (KError);
 
         void close(FILE *fp)
         throw ();
 
+        /**
+         * Returns the length of the run of blocks at the start of
+         * @p buffer that are either all zero (a hole) or all data.
+         * A partial block at the end is data.
+         *
+         * @param[in] buffer the data
+         * @param[in] length length of @p buffer
+         * @param[in] sparse @c false if holes must not be created
+         * @param[out] hole @c true if the run is a hole
+         */
+        size_t nextRun(const char *buffer, size_t length, bool sparse,
+                       bool &hole) const
+        throw ();
+
     private:
-        size_t m_bufferSize;
-        char *m_buffer;
+        size_t m_blockSize;
+        unsigned m_writers;
 };
 
 //}}}
@@ -211,12 +394,41 @@ class FTPTransfer : public URLTransfer {
                      bool *directSave)
         throw (KError);
 
+        /**
+         * Lists the target directory with NLST.
+         *
+         * @see Transfer::listDirs()
+         */
+        StringVector listDirs()
+        throw (KError);
+
+        /**
+         * Removes the file with DELE.
+         *
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Lists each directory with NLST and then removes all of them
+         * with DELE and RMD commands in a single batch.
+         *
+         * @see Transfer::removeDirs()
+         */
+        void removeDirs(const StringVector &dirs)
+        throw (KError);
+
     protected:
 
         void open(DataProvider *dataprovider,
 		  const std::string &target_file)
         throw (KError);
 
+        StringVector nlst(const std::string &dir,
+                          struct curl_slist *postquote = NULL)
+        throw (KError);
+
     private:
         char m_curlError[CURL_ERROR_SIZE];
         static bool curl_global_inititalised;
@@ -224,27 +436,31 @@ class FTPTransfer : public URLTransfer {
 };
 
 //}}}
-//{{{ NFSTransfer -------------------------------------------------------------
+//{{{ MountTransfer ------------------------------------------------------------
 
 /**
- * Transfers a file over NFS.
+ * Base class for transfers that mount network file systems and save
+ * the files with a FileTransfer.
+ *
+ * Every share gets its own mountpoint below DEFAULT_MOUNTPOINT. Targets
+ * that refer to the same share with the same options use one mount.
+ * All file systems are mounted in parallel.
  */
-class NFSTransfer : public URLTransfer {
+class MountTransfer : public URLTransfer {
 
     public:
 
         /**
-         * Creates a NFSTransfer object.
-         *
-         * @exception KError when mounting the share failes
+         * Creates a MountTransfer object. Subclasses must call mountAll()
+         * from their constructor.
          */
-        NFSTransfer(const RootDirURLVector &urlv)
+        MountTransfer(const RootDirURLVector &urlv)
         throw (KError);
 
         /**
-         * Destroys a SFTPTransfer object.
+         * Unmounts all file systems.
          */
-        ~NFSTransfer()
+        virtual ~MountTransfer()
         throw ();
 
         /**
@@ -257,31 +473,162 @@ class NFSTransfer : public URLTransfer {
                      bool *directSave)
         throw (KError);
 
+        /**
+         * Removes the file from the mounted file systems.
+         *
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * @see FileTransfer::exists()
+         */
+        bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * @see FileTransfer::link()
+         */
+        void link(const std::string &source_file,
+                  const std::string &target_file)
+        throw (KError);
+
+        /**
+         * @see FileTransfer::listDirs()
+         */
+        StringVector listDirs()
+        throw (KError);
+
+        /**
+         * @see FileTransfer::removeDirs()
+         */
+        void removeDirs(const StringVector &dirs)
+        throw (KError);
+
+        /**
+         * @see URLTransfer::setWeights()
+         */
+        void setWeights(const std::vector<unsigned> &weights)
+        throw ();
+
+        /**
+         * @see FileTransfer::getAdvertisedRate()
+         */
+        unsigned long long getAdvertisedRate()
+        throw ();
+
     protected:
-        void close()
+
+        /**
+         * Description of one mount.
+         */
+        struct MountInfo {
+            std::string host;           /**< server (for the route check) */
+            std::string device;         /**< device argument of mount */
+            std::string fstype;         /**< file system type */
+            StringVector options;       /**< mount options */
+            FilePath mountpoint;        /**< set by mountAll() */
+            unsigned writers;           /**< writer threads for this mount */
+            bool mounted;               /**< set after a successful mount */
+
+            MountInfo()
+                : writers(1), mounted(false)
+            {}
+        };
+
+        /**
+         * Describe the mount needed for a URL.
+         *
+         * @param[in] url the target URL
+         * @param[out] mount the mount (without the mountpoint)
+         * @return the target path relative to the mountpoint
+         * @exception KError if the URL is invalid
+         */
+        virtual std::string describe(const RootDirURL &url, MountInfo &mount)
+        throw (KError) = 0;
+
+        /**
+         * Mount one file system. Called from a separate thread for each
+         * mount. The default implementation runs mount(8).
+         *
+         * @param[in,out] mount the mount to perform
+         * @exception KError if mounting fails
+         */
+        virtual void doMount(MountInfo &mount)
         throw (KError);
 
         /**
-	 * Translate a NFS URL into a file URL
-	 *
-	 * @return RootDirurl
-	 */
-	RootDirURL translate(const RootDirURL &url)
-	throw (KError);
+         * Mount all targets and create the underlying FileTransfer.
+         *
+         * @exception KError if any mount fails; all other file systems
+         *            are unmounted again
+         */
+        void mountAll()
+        throw (KError);
 
+        /**
+         * Unmount all mounted file systems.
+         *
+         * @exception KError if unmounting fails (all file systems are
+         *            still tried)
+         */
+        void close()
+        throw (KError);
 
     private:
-        FilePath m_mountpoint;
+        class MountThread;
+
+        std::vector<MountInfo> m_mounts;
         FileTransfer *m_fileTransfer;
 };
 
+//}}}
+//{{{ NFSTransfer -------------------------------------------------------------
+
+/**
+ * Transfers a file over NFS.
+ */
+class NFSTransfer : public MountTransfer {
+
+    public:
+
+        /**
+         * Creates a NFSTransfer object.
+         *
+         * @exception KError when mounting the share failes
+         */
+        NFSTransfer(const RootDirURLVector &urlv)
+        throw (KError);
+
+    protected:
+
+        std::string describe(const RootDirURL &url, MountInfo &mount)
+        throw (KError);
+
+        void doMount(MountInfo &mount)
+        throw (KError);
+
+        /**
+         * Build the mount options from the URL query parameters.
+         *
+         * @param[in] url the NFS URL
+         * @param[out] nconnect number of connections requested
+         * @return the mount options
+         * @exception KError if a parameter value is invalid
+         */
+        static StringVector mountOptions(const RootDirURL &url,
+                                         unsigned *nconnect)
+        throw (KError);
+};
+
 //}}}
 //{{{ CIFSTransfer -------------------------------------------------------------
 
 /**
  * Transfers a file over CIFS (SMB).
  */
-class CIFSTransfer : public URLTransfer {
+class CIFSTransfer : public MountTransfer {
 
     public:
 
@@ -293,14 +640,49 @@ class CIFSTransfer : public URLTransfer {
         CIFSTransfer(const RootDirURLVector &urlv)
         throw (KError);
 
+    protected:
+
+        std::string describe(const RootDirURL &url, MountInfo &mount)
+        throw (KError);
+};
+
+//}}}
+
+//{{{ CompositeTransfer --------------------------------------------------------
+
+/**
+ * Transfers a file to targets that use different protocols at once.
+ *
+ * The DataProvider is read only once. Every block is handed to all
+ * children through per-child queues, and each child Transfer runs in
+ * its own thread. A failing child is dropped without affecting the
+ * others; the transfer fails only if all children fail.
+ */
+class CompositeTransfer : public Transfer {
+
+    public:
+
         /**
-         * Destroys a CIFSTransfer object.
+         * Creates a CompositeTransfer object.
+         *
+         * @param[in] children the transfers to feed; the new object
+         *            takes ownership of them
+         * @param[in] names names of the children for TransferMetrics
+         *            (default: "target N")
          */
-        ~CIFSTransfer()
+        CompositeTransfer(const std::vector<Transfer *> &children,
+                          const StringVector &names = StringVector())
         throw ();
 
         /**
-         * Transfers the file.
+         * Destroys the CompositeTransfer object and all children.
+         */
+        ~CompositeTransfer()
+        throw ();
+
+        /**
+         * Transfers the file to all children. The data is always piped,
+         * i.e. @p directSave is set to @c false.
          *
          * @see Transfer::perform()
          */
@@ -309,21 +691,161 @@ class CIFSTransfer : public URLTransfer {
                      bool *directSave)
         throw (KError);
 
-    protected:
-        void close()
+        /**
+         * Removes the file from all children. All children are tried;
+         * the first error is re-thrown afterwards.
+         *
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
         throw (KError);
 
         /**
-	 * Translate a CIFS URL into a file URL
-	 *
-	 * @return RootDirurl
-	 */
-	RootDirURL translate(const RootDirURL &url)
-	throw (KError);
+         * Checks whether the file exists on all children.
+         *
+         * @see Transfer::exists()
+         */
+        bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * Links the file on all children. All children are tried;
+         * the first error is re-thrown afterwards.
+         *
+         * @see Transfer::link()
+         */
+        void link(const std::string &source_file,
+                  const std::string &target_file)
+        throw (KError);
 
     private:
-        std::string m_mountpoint;
-        FileTransfer *m_fileTransfer;
+        class Fanout;
+        class Child;
+
+        std::vector<Transfer *> m_children;
+        StringVector m_names;
+};
+
+//}}}
+//{{{ RateLimitedTransfer ------------------------------------------------------
+
+/**
+ * Limits the bandwidth of another Transfer with a token bucket
+ * (see RateLimitedDataProvider).
+ *
+ * The limits are taken from the URL parameters "rate", "burst" and
+ * "startdelay" and from the rate advertised by the target.
+ */
+class RateLimitedTransfer : public Transfer {
+
+    public:
+
+        /**
+         * Creates a RateLimitedTransfer object.
+         *
+         * @param[in] transfer the Transfer to limit; the new object takes
+         *            ownership of it
+         * @param[in] rate maximum rate in bytes per second
+         * @param[in] burst bucket size in bytes (0 means one second)
+         * @param[in] startDelay maximum random delay in seconds before
+         *            the first transfer
+         */
+        RateLimitedTransfer(Transfer *transfer, unsigned long long rate,
+                            unsigned long long burst, unsigned startDelay)
+        throw ();
+
+        /**
+         * Destroys the RateLimitedTransfer object and the wrapped Transfer.
+         */
+        ~RateLimitedTransfer()
+        throw ();
+
+        /**
+         * Wraps @p transfer in a RateLimitedTransfer if any of the URLs
+         * or the target asks for a limit. If several URLs set a rate,
+         * the lowest one is used, because the same data goes to all of
+         * them. @p transfer is deleted if an exception is thrown.
+         *
+         * @param[in] transfer the Transfer for @p urlv
+         * @param[in] urlv the target URLs
+         * @return @p transfer or a new RateLimitedTransfer
+         * @exception KError if a URL parameter is invalid
+         */
+        static Transfer *wrap(URLTransfer *transfer,
+                              const RootDirURLVector &urlv)
+        throw (KError);
+
+        /**
+         * Transfers the file at the limited rate. The data is always piped,
+         * i.e. @p directSave is set to @c false.
+         *
+         * @see Transfer::perform()
+         */
+        void perform(DataProvider *dataprovider,
+                     const StringVector &target_files,
+                     bool *directSave)
+        throw (KError);
+
+        /**
+         * @see Transfer::remove()
+         */
+        void remove(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * @see Transfer::exists()
+         */
+        bool exists(const std::string &target_file)
+        throw (KError);
+
+        /**
+         * @see Transfer::link()
+         */
+        void link(const std::string &source_file,
+                  const std::string &target_file)
+        throw (KError);
+
+        /**
+         * @see Transfer::listDirs()
+         */
+        StringVector listDirs()
+        throw (KError);
+
+        /**
+         * @see Transfer::removeDirs()
+         */
+        void removeDirs(const StringVector &dirs)
+        throw (KError);
+
+        /**
+         * Returns the wrapped Transfer.
+         */
+        Transfer *getTransfer() const
+        throw ()
+        { return m_transfer; }
+
+        /**
+         * Returns the maximum rate in bytes per second.
+         */
+        unsigned long long getRate() const
+        throw ()
+        { return m_rate; }
+
+        /**
+         * Sets the maximum random delay before the next transfer starts.
+         * The delay is applied only once.
+         *
+         * @param[in] startDelay maximum delay in seconds
+         */
+        void setStartDelay(unsigned startDelay)
+        throw ()
+        { m_startDelay = startDelay; }
+
+    private:
+        Transfer *m_transfer;
+        unsigned long long m_rate;
+        unsigned long long m_burst;
+        unsigned m_startDelay;
 };
 
 //}}}
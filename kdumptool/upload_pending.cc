@@ -0,0 +1,329 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <set>
+#include <cstring>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "subcommand.h"
+#include "debug.h"
+#include "upload_pending.h"
+#include "configuration.h"
+#include "dataprovider.h"
+#include "progress.h"
+#include "routable.h"
+#include "savedump.h"
+#include "transfer.h"
+#include "catalog.h"
+#include "stringutil.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::auto_ptr;
+using std::ifstream;
+using std::ofstream;
+
+// line in UPLOAD_PENDING_FILE for every target that has the dump
+#define UPLOADED_TO     "Uploaded to "
+
+//{{{ FilterUploadFiles --------------------------------------------------------
+
+/**
+ * Lists the regular files of a dump directory, except the marker.
+ */
+class FilterUploadFiles : public FilterDots {
+
+    public:
+        bool test(int dirfd, const struct dirent *d) const;
+};
+
+// -----------------------------------------------------------------------------
+bool FilterUploadFiles::test(int dirfd, const struct dirent *d) const
+{
+    if (!FilterDots::test(dirfd, d))
+        return false;
+    if (strcmp(d->d_name, UPLOAD_PENDING_FILE) == 0)
+        return false;
+
+    struct stat mystat;
+    if (fstatat(dirfd, d->d_name, &mystat, AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+    return S_ISREG(mystat.st_mode);
+}
+
+//}}}
+// -----------------------------------------------------------------------------
+// Moves the catalog entry of an uploaded dump from the spool to the local
+// targets. Errors are not fatal, because the dump has been uploaded.
+static void move_catalog_entry(const FilePath &dir,
+                               const RootDirURLVector &urlv,
+                               DumpCatalog::Entry entry)
+{
+    entry.status = "ok";
+
+    RootDirURLVector::const_iterator it;
+    for (it = urlv.begin(); it != urlv.end(); ++it) {
+        if (it->getProtocol() != URLParser::PROT_FILE)
+            continue;
+        try {
+            FilePath dumpdir = it->getRealPath();
+            entry.id = dumpdir.baseName();
+            DumpCatalog(dumpdir.dirName()).record(entry);
+        } catch (const KError &error) {
+            cerr << "WARNING: Cannot update the dump catalog: "
+                 << error.what() << endl;
+        }
+    }
+
+    try {
+        DumpCatalog catalog(dir.dirName());
+        catalog.lock();
+        if (catalog.load() && catalog.remove(dir.baseName()))
+            catalog.save();
+    } catch (const KError &error) {
+        cerr << "WARNING: Cannot update the dump catalog: "
+             << error.what() << endl;
+    }
+}
+
+//{{{ UploadPending ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+UploadPending::UploadPending()
+    throw ()
+    : m_dryRun(false), m_retries(3), m_retryDelay(30)
+{
+    Debug::debug()->trace("UploadPending::UploadPending()");
+
+    m_options.push_back(new StringOption("root", 'R', &m_rootdir,
+        "Use the specified root directory instead of /"));
+    m_options.push_back(new FlagOption("dry-run", 'y', &m_dryRun,
+        "Don't upload, just print out what to upload"));
+    m_options.push_back(new IntOption("retries", 'r', &m_retries,
+        "Number of retries if an upload fails (default: 3)"));
+    m_options.push_back(new IntOption("retry-delay", 'w', &m_retryDelay,
+        "Seconds before the first retry, doubled for each retry "
+        "(default: 30)"));
+}
+
+// -----------------------------------------------------------------------------
+const char *UploadPending::getName() const
+    throw ()
+{
+    return "upload_pending";
+}
+
+// -----------------------------------------------------------------------------
+void UploadPending::execute()
+    throw (KError)
+{
+    Debug::debug()->trace("UploadPending::execute()");
+    Debug::debug()->dbg("Using root dir %s, dry run: %d",
+        m_rootdir.c_str(), m_dryRun);
+
+    Configuration *config = Configuration::config();
+
+    const string &spool = config->KDUMP_SPOOL.value();
+    if (spool.empty()) {
+        cerr << "KDUMP_SPOOL is not set." << endl;
+        return;
+    }
+
+    FilePath dir = RootDirURL("file://" + spool, m_rootdir).getRealPath();
+    if (!dir.exists()) {
+        cerr << "Nothing to upload in " + dir + "." << endl;
+        return;
+    }
+
+    StringVector pending;
+    StringVector contents = dir.listDir(FilterDotsAndNondirs());
+    for (StringVector::const_iterator it = contents.begin();
+         it != contents.end(); ++it) {
+        FilePath marker = dir;
+        marker.appendPath(*it).appendPath(UPLOAD_PENDING_FILE);
+        if (marker.exists())
+            pending.push_back(*it);
+    }
+    if (pending.empty()) {
+        cerr << "Nothing to upload in " + dir + "." << endl;
+        return;
+    }
+
+    RootDirURLVector targets;
+    StringVector hosts;
+    std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    string elem;
+    while (iss >> elem) {
+        targets.push_back(RootDirURL(elem, m_rootdir));
+        if (targets.back().getProtocol() != URLParser::PROT_FILE)
+            hosts.push_back(targets.back().getHostname());
+    }
+    if (targets.empty())
+        throw KError("KDUMP_SAVEDIR is empty.");
+
+    // resolve all network targets at once; the results are cached
+    if (!hosts.empty())
+        Routable::checkAll(hosts, config->KDUMP_NET_TIMEOUT.value());
+
+    // a failed dump must not keep the others in the spool
+    for (StringVector::const_iterator it = pending.begin();
+         it != pending.end(); ++it) {
+        FilePath dumpdir = dir;
+        dumpdir.appendPath(*it);
+        try {
+            upload_one(dumpdir, targets);
+        } catch (const KError &error) {
+            cerr << "Uploading " << dumpdir << " failed: " << error.what()
+                 << endl;
+            setErrorCode(1);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void UploadPending::upload_one(const FilePath &dir,
+                               const RootDirURLVector &targets)
+    throw (KError)
+{
+    Debug::debug()->trace("UploadPending::upload_one(%s)", dir.c_str());
+
+    StringVector files = dir.listDir(FilterUploadFiles());
+
+    cout << "Uploading " << dir << " to";
+    RootDirURLVector::const_iterator tit;
+    for (tit = targets.begin(); tit != targets.end(); ++tit)
+        cout << " " << tit->getURL();
+    cout << endl;
+    if (m_dryRun)
+        return;
+
+    // targets that have the dump already (from an earlier run)
+    FilePath marker = dir;
+    marker.appendPath(UPLOAD_PENDING_FILE);
+    std::set<string> uploaded;
+    {
+        ifstream fin(marker.c_str());
+        string line;
+        while (std::getline(fin, line))
+            if (line.compare(0, strlen(UPLOADED_TO), UPLOADED_TO) == 0)
+                uploaded.insert(line.substr(strlen(UPLOADED_TO)));
+    }
+
+    // every target separately, so that a target that is down does not
+    // go unnoticed; the dump stays in the spool until all have it
+    string subdir = dir.baseName();
+    RootDirURLVector urlv;
+    string error;
+    unsigned failed = 0;
+    for (tit = targets.begin(); tit != targets.end(); ++tit) {
+        const string &name = tit->getURL();
+        bool done = uploaded.count(name) > 0;
+        try {
+            // same directory names as if save_dump had saved there
+            urlv.push_back(SaveDump::dumpDirURL(*tit, subdir, m_rootdir));
+            if (done)
+                cout << "Already uploaded to " << name << endl;
+            else
+                upload_files(dir, files, urlv.back());
+        } catch (const KError &kerror) {
+            if (done)
+                continue;
+            cerr << "Uploading to " << name << " failed: "
+                 << kerror.what() << endl;
+            if (error.empty())
+                error = kerror.what();
+            ++failed;
+            continue;
+        }
+        if (done)
+            continue;
+
+        ofstream fout(marker.c_str(), std::ios::app);
+        fout << UPLOADED_TO << name << endl;
+        fout.close();
+        if (!fout)
+            throw KError("Cannot update " + marker + ".");
+    }
+    if (failed)
+        throw KError("Upload to " + Stringutil::number2string(failed) +
+                     " of " + Stringutil::number2string(targets.size()) +
+                     " targets failed: " + error);
+
+    Debug::debug()->info("Removing %s from the spool.", dir.c_str());
+    DumpCatalog::Entry entry = DumpCatalog::scan(dir, true);
+    FilePath(dir).rmdir(true);
+    move_catalog_entry(dir, urlv, entry);
+}
+
+// -----------------------------------------------------------------------------
+void UploadPending::upload_files(const FilePath &dir,
+                                 const StringVector &files,
+                                 const RootDirURL &url)
+    throw (KError)
+{
+    Debug::debug()->trace("UploadPending::upload_files(%s, %s)",
+        dir.c_str(), url.getURL().c_str());
+
+    Configuration *config = Configuration::config();
+
+    // a retry starts with a new transfer, but skips the files that
+    // have been uploaded already
+    size_t done = 0;
+    int delay = m_retryDelay > 0 ? m_retryDelay : 0;
+    for (int attempt = 0; ; ++attempt) {
+        try {
+            auto_ptr<Transfer> transfer(
+                SaveDump::getTransfer(RootDirURLVector(1, url)));
+            for (; done < files.size(); ++done) {
+                FilePath path = dir;
+                path.appendPath(files[done]);
+
+                FileDataProvider provider(path.c_str());
+                TerminalProgress progress("Uploading " + files[done]);
+                if (config->KDUMP_VERBOSE.value()
+                    & Configuration::VERB_PROGRESS)
+                    provider.setProgress(&progress);
+                else
+                    cout << "Uploading " << files[done] << " ..." << endl;
+                transfer->perform(&provider, files[done], NULL);
+            }
+            break;
+        } catch (const KError &error) {
+            if (attempt >= m_retries)
+                throw;
+            cerr << error.what() << endl;
+            cerr << "Retrying in " << delay << " seconds." << endl;
+            sleep(delay);
+            delay *= 2;
+        }
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,96 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef UPLOAD_PENDING_H
+#define UPLOAD_PENDING_H
+
+#include "subcommand.h"
+#include "fileutil.h"
+#include "rootdirurl.h"
+
+// marks a dump in KDUMP_SPOOL that has not been uploaded yet
+#define UPLOAD_PENDING_FILE ".upload-pending"
+
+//{{{ UploadPending ------------------------------------------------------------
+
+/**
+ * Subcommand to upload the dumps that save_dump left in KDUMP_SPOOL
+ * to KDUMP_SAVEDIR. A dump is removed from the spool once all its
+ * files have been uploaded to all targets; the targets that have the
+ * dump already are recorded in UPLOAD_PENDING_FILE.
+ */
+class UploadPending : public Subcommand {
+
+    public:
+        /**
+         * Creates a new UploadPending object.
+         */
+        UploadPending()
+        throw ();
+
+    public:
+        /**
+         * Returns the name of the subcommand (upload_pending).
+         */
+        const char *getName() const
+        throw ();
+
+        /**
+         * Executes the function.
+         *
+         * @throw KError on any error. No exception indicates success.
+         */
+        void execute()
+        throw (KError);
+
+    protected:
+        /**
+         * Uploads one dump directory, retrying failed transfers.
+         *
+         * @param[in] dir the dump directory in the spool
+         * @param[in] targets the configured targets
+         * @exception KError if the upload failed after all retries
+         */
+        void upload_one(const FilePath &dir, const RootDirURLVector &targets)
+        throw (KError);
+
+        /**
+         * Uploads the files of a dump directory to one target, retrying
+         * failed transfers.
+         *
+         * @param[in] dir the dump directory in the spool
+         * @param[in] files the files to upload
+         * @param[in] url the dump directory on the target
+         * @exception KError if the upload failed after all retries
+         */
+        void upload_files(const FilePath &dir, const StringVector &files,
+                          const RootDirURL &url)
+        throw (KError);
+
+    private:
+        std::string m_rootdir;
+        bool m_dryRun;
+        int m_retries;
+        int m_retryDelay;
+};
+
+//}}}
+
+#endif /* UPLOAD_PENDING_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
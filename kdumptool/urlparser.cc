@@ -125,6 +125,29 @@ string URLParser::extractAuthority(string::iterator &it,
     return string(start, it);
 }
 
+// -----------------------------------------------------------------------------
+void URLParser::parseQuery()
+{
+    StringVector elems = Stringutil::split(m_query, '&');
+    for (StringVector::const_iterator it = elems.begin();
+         it != elems.end(); ++it) {
+        if (it->empty())
+            continue;
+
+        KString name, value;
+        string::size_type eq = it->find('=');
+        if (eq != string::npos) {
+            name = it->substr(0, eq);
+            value = it->substr(eq + 1);
+        } else
+            name = *it;
+
+        name.decodeURL(true);
+        value.decodeURL(true);
+        m_parameters[name] = value;
+    }
+}
+
 // -----------------------------------------------------------------------------
 URLParser::URLParser(const std::string &url)
     throw (KError)
@@ -139,8 +162,19 @@ URLParser::URLParser(const std::string &url)
     //
     string scheme = extractScheme(it, m_url.end());
     string authority = extractAuthority(it, m_url.end());
-    m_path.assign(it, m_url.end());
-    // TODO: query and fragment are not handled
+    string::iterator const path_start = it;
+    while (it != m_url.end() && *it != '?' && *it != '#')
+        ++it;
+    m_path.assign(path_start, it);
+    m_baseurl.assign(m_url.begin(), it);
+    if (it != m_url.end() && *it == '?') {
+        string::iterator const query_start = ++it;
+        while (it != m_url.end() && *it != '#')
+            ++it;
+        m_query.assign(query_start, it);
+        parseQuery();
+    }
+    // the fragment is not used by any protocol
 
     if (m_path.empty() || m_path[0] != '/')
         throw KError("URLParser: Only absolute paths are supported.");
@@ -222,10 +256,10 @@ URLParser::URLParser(const std::string &url)
 	throw KError("File protocol cannot specify a remote host");
 
     Debug::debug()->dbg("URL parsed as: protocol=%s, host=%s, port=%d, "
-        "username=%s, password=%s, path=%s",
+        "username=%s, password=%s, path=%s, query=%s",
         getProtocolAsString().c_str(),
         getHostname().c_str(), getPort(), getUsername().c_str(),
-        getPassword().c_str(), getPath().c_str());
+        getPassword().c_str(), getPath().c_str(), getQuery().c_str());
 
 }
 
@@ -285,6 +319,43 @@ string URLParser::getURL() const
     return m_url;
 }
 
+// -----------------------------------------------------------------------------
+string URLParser::getBaseURL() const
+    throw ()
+{
+    return m_baseurl;
+}
+
+// -----------------------------------------------------------------------------
+string URLParser::getQuery() const
+    throw ()
+{
+    return m_query;
+}
+
+// -----------------------------------------------------------------------------
+const StringStringMap &URLParser::getParameters() const
+    throw ()
+{
+    return m_parameters;
+}
+
+// -----------------------------------------------------------------------------
+bool URLParser::hasParameter(const string &name) const
+    throw ()
+{
+    return m_parameters.find(name) != m_parameters.end();
+}
+
+// -----------------------------------------------------------------------------
+string URLParser::getParameter(const string &name,
+                               const string &defaultValue) const
+    throw ()
+{
+    StringStringMap::const_iterator it = m_parameters.find(name);
+    return it != m_parameters.end() ? it->second : defaultValue;
+}
+
 //}}}
 
 // vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -135,6 +135,54 @@ class URLParser {
         std::string getURL() const
         throw ();
 
+        /**
+         * Returns the URL without the query (and fragment) part.
+         *
+         * @return the URL up to the end of the path
+         */
+        std::string getBaseURL() const
+        throw ();
+
+        /**
+         * Returns the raw (undecoded) query string, i.e. everything between
+         * "?" and the end of the URL (or "#"). Returns an empty string if
+         * the URL has no query.
+         *
+         * @return the query string
+         */
+        std::string getQuery() const
+        throw ();
+
+        /**
+         * Returns all query parameters. The query is split at "&", and
+         * each element is split at the first "=". Names and values are
+         * decoded.
+         *
+         * @return map of parameter names to values
+         */
+        const StringStringMap &getParameters() const
+        throw ();
+
+        /**
+         * Checks whether a query parameter has been specified.
+         *
+         * @param[in] name the parameter name
+         * @return @c true if the parameter is present in the query
+         */
+        bool hasParameter(const std::string &name) const
+        throw ();
+
+        /**
+         * Returns the value of a query parameter.
+         *
+         * @param[in] name the parameter name
+         * @param[in] defaultValue value returned if the parameter is absent
+         * @return the parameter value
+         */
+        std::string getParameter(const std::string &name,
+                                 const std::string &defaultValue = "") const
+        throw ();
+
     public:
 
         /**
@@ -167,6 +215,9 @@ class URLParser {
         KString m_username;
         int m_port;
         KString m_path;
+        std::string m_baseurl;
+        std::string m_query;
+        StringStringMap m_parameters;
 
 	/**
 	 * Extract scheme from a string
@@ -185,6 +236,11 @@ class URLParser {
 	 */
 	std::string extractAuthority(std::string::iterator &it,
 				     const std::string::const_iterator &end);
+
+	/**
+	 * Split the query string into m_parameters
+	 */
+	void parseQuery();
 };
 
 //}}}
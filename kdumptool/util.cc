@@ -26,14 +26,13 @@
 #include <sys/types.h>
 #include <sys/utsname.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
 
-#include <libelf.h>
-#include <gelf.h>
+#include <elf.h>
 
 #include "global.h"
 #include "util.h"
 #include "debug.h"
+#include "vmcoreimage.h"
 
 using std::string;
 using std::strerror;
@@ -169,179 +168,19 @@ bool Util::isElfFile(const string &file)
 }
 
 // -----------------------------------------------------------------------------
-static off_t FindElfNoteByName(int fd, off_t offset, size_t sz,
-                               const char *name)
-    throw (KError)
-{
-    char *buf, *p;
-    size_t to_read;
-    size_t nlen;
-    off_t ret = (off_t)-1;
-
-    Debug::debug()->trace("FindElfNoteByName(%d, %lu, %lu, %s)",
-                          fd, (unsigned long)offset, (unsigned long)sz, name);
-
-    if (lseek(fd, offset, SEEK_SET) == (off_t)-1)
-        throw KSystemError("Cannot seek to ELF notes", errno);
-
-    buf = new char[sz];
-    try {
-        to_read = sz;
-        p = buf;
-        while (to_read) {
-            ssize_t bytes_read = read(fd, p, to_read);
-            if (bytes_read < 0)
-                throw KSystemError("Cannot read ELF note", errno);
-            else if (!bytes_read)
-                throw KError("Unexpected EOF while reading ELF note");
-
-            to_read -= bytes_read;
-            p += bytes_read;
-        }
-
-        nlen = strlen(name);
-        to_read = sz;
-        p = buf;
-        while (to_read) {
-            Elf64_Nhdr *hdr = reinterpret_cast<Elf64_Nhdr*>(p);
-            if (to_read < sizeof(*hdr))
-                break;
-            to_read -= sizeof(*hdr);
-            p += sizeof(*hdr);
-
-            size_t notesz =
-                ((hdr->n_namesz + 3) & (-(Elf64_Word)4)) +
-                ((hdr->n_descsz + 3) & (-(Elf64_Word)4));
-            if (to_read < notesz)
-                break;
-
-            if ((hdr->n_namesz == nlen && !memcmp(p, name, nlen)) ||
-                (hdr->n_namesz == nlen+1 && !memcmp(p, name, nlen+1))) {
-                ret = offset + (p - buf) - sizeof(*hdr);
-                break;
-            }
-
-            to_read -= notesz;
-            p += notesz;
-        }
-    } catch (...) {
-        delete buf;
-        throw;
-    }
-
-    return ret;
-}
-
-// -----------------------------------------------------------------------------
-#define ELF_HEADER_MAPSIZE          (128*1024)
-
-static void *map_elf(int fd, size_t len)
-{
-    void *map;
-    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (map == MAP_FAILED) {
-	map = mmap(NULL, len, PROT_READ | PROT_WRITE,
-		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-	if (map == MAP_FAILED)
-	    throw KSystemError("Cannot allocate ELF headers", errno);
-
-	size_t to_read = len;
-	char *p = reinterpret_cast<char *>(map);
-	while (to_read) {
-	    ssize_t bytes_read = read(fd, p, to_read);
-	    if (bytes_read < 0)
-		throw KSystemError("ELF read error", errno);
-	    else if (!bytes_read)
-		break;
-
-	    to_read -= bytes_read;
-	    p += bytes_read;
-	}
-    }
-    return map;
-}
-
 bool Util::isXenCoreDump(int fd)
     throw (KError)
 {
-    void *map = MAP_FAILED;
-    Elf *elf = (Elf*)0;
-    bool ret = false;
-    size_t mapsize = ELF_HEADER_MAPSIZE;
-
     Debug::debug()->trace("isXenCoreDump(%d)", fd);
 
-    if (elf_version(EV_CURRENT) == EV_NONE)
-        throw KError("libelf is out of date.");
+    unsigned char ident[SELFMAG];
+    ssize_t bytes_read = pread(fd, ident, SELFMAG, 0);
+    if (bytes_read < 0)
+        throw KSystemError("Cannot read ELF header", errno);
+    if (bytes_read != SELFMAG || memcmp(ident, ELFMAG, SELFMAG) != 0)
+        return false;
 
-    try {
-        map = map_elf(fd, mapsize);
-        elf = elf_memory(reinterpret_cast<char *>(map), mapsize);
-        if (!elf)
-            throw KELFError("elf_memory() failed", elf_errno());
-
-        if (elf_kind(elf) != ELF_K_ELF)
-            return false;
-
-        size_t endphdr;
-        Elf32_Ehdr *ehdr32;
-        Elf64_Ehdr *ehdr64;
-
-        switch (gelf_getclass(elf)) {
-        case ELFCLASS32:
-            ehdr32 = reinterpret_cast<Elf32_Ehdr*>(map);
-            endphdr = ehdr32->e_phoff + ehdr32->e_phentsize * ehdr32->e_phnum;
-            break;
-        case ELFCLASS64:
-            ehdr64 = reinterpret_cast<Elf64_Ehdr*>(map);
-            endphdr = ehdr64->e_phoff + ehdr64->e_phentsize * ehdr64->e_phnum;
-            break;
-        default:
-            throw KError("Unrecognized ELF class");
-        }
-
-        if (endphdr > mapsize) {
-            elf_end(elf);
-            munmap(map, mapsize);
-
-            long pagesize = sysconf(_SC_PAGESIZE);
-            mapsize = (endphdr + pagesize - 1) & ~(pagesize - 1);
-            Debug::debug()->dbg("Enlarging map size to %zu bytes", mapsize);
-
-            map = map_elf(fd, mapsize);
-            elf = elf_memory(reinterpret_cast<char *>(map), mapsize);
-            if (!elf)
-                throw KELFError("elf_memory() failed", elf_errno());
-        }
-
-        size_t phnum, i;
-        if (elf_getphdrnum(elf, &phnum))
-            throw KELFError("Cannot count ELF program headers", elf_errno());
-
-        for (i = 0; i < phnum; ++i) {
-            GElf_Phdr phdr;
-
-            if (gelf_getphdr(elf, i, &phdr) != &phdr)
-                throw KELFError("getphdr() failed.", elf_errno());
-
-            if (phdr.p_type == PT_NOTE &&
-                FindElfNoteByName(fd, phdr.p_offset, phdr.p_filesz, "Xen")
-                != (off_t)-1) {
-                ret = true;
-                break;
-            }
-        }
-    } catch (...) {
-        if (elf)
-            elf_end(elf);
-        if (map != MAP_FAILED)
-            munmap(map, mapsize);
-        throw;
-    }
-
-    munmap(map, mapsize);
-    elf_end(elf);
-    return ret;
+    return VmcoreImage(fd).isXen();
 }
 
 // -----------------------------------------------------------------------------
@@ -361,6 +200,7 @@ bool Util::isXenCoreDump(const string &file)
         throw;
     }
 
+    close(fd);
     return ret;
 }
 
@@ -0,0 +1,555 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <strings.h>
+#include <zlib.h>
+
+#include "global.h"
+
+#if HAVE_LIBLZO2
+#   include <lzo/lzo1x.h>
+#endif
+#if HAVE_LIBSNAPPY
+#   include <snappy-c.h>
+#endif
+
+#include "debug.h"
+#include "vmcoreimage.h"
+#include "vmcoreanalyzer.h"
+#include "threads.h"
+
+using std::string;
+
+#define DEFAULT_SAMPLES         4096
+
+// size of a page descriptor in the kdump-compressed format
+#define PAGE_DESC_SIZE          24
+
+//{{{ Helpers ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+/**
+ * Returns the CPU time of the calling thread in seconds.
+ */
+static double threadCpuTime()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Checks whether a page contains only zero bytes.
+ */
+static bool isZeroPage(const unsigned char *page, size_t size)
+{
+    return page[0] == 0 && memcmp(page, page + 1, size - 1) == 0;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Compressed page sizes are computed with the same method and settings
+ * as makedumpfile. A page that does not get smaller is stored as is.
+ */
+class PageCompressor {
+
+    public:
+        PageCompressor(size_t pageSize)
+        throw ()
+            : m_pageSize(pageSize),
+              m_out(pageSize + pageSize / 16 + 1024)
+        {
+#if HAVE_LIBLZO2
+            m_wrkmem.resize(LZO1X_1_MEM_COMPRESS);
+#endif
+#if HAVE_LIBSNAPPY
+            if (m_out.size() < snappy_max_compressed_length(pageSize))
+                m_out.resize(snappy_max_compressed_length(pageSize));
+#endif
+            if (m_out.size() < compressBound(pageSize))
+                m_out.resize(compressBound(pageSize));
+        }
+
+        size_t compress(VmcoreAnalyzer::Format format,
+                        const unsigned char *page)
+        throw ()
+        {
+            size_t ret = m_pageSize;
+
+            switch (format) {
+                case VmcoreAnalyzer::FORMAT_ZLIB: {
+                    uLongf len = m_out.size();
+                    if (compress2(&m_out[0], &len, page, m_pageSize,
+                                  Z_BEST_SPEED) == Z_OK)
+                        ret = len;
+                    break;
+                }
+#if HAVE_LIBLZO2
+                case VmcoreAnalyzer::FORMAT_LZO: {
+                    lzo_uint len = m_out.size();
+                    if (lzo1x_1_compress(page, m_pageSize, &m_out[0], &len,
+                                         &m_wrkmem[0]) == LZO_E_OK)
+                        ret = len;
+                    break;
+                }
+#endif
+#if HAVE_LIBSNAPPY
+                case VmcoreAnalyzer::FORMAT_SNAPPY: {
+                    size_t len = m_out.size();
+                    if (snappy_compress(reinterpret_cast<const char *>(page),
+                            m_pageSize, reinterpret_cast<char *>(&m_out[0]),
+                            &len) == SNAPPY_OK)
+                        ret = len;
+                    break;
+                }
+#endif
+                default:
+                    break;
+            }
+
+            return ret < m_pageSize ? ret : m_pageSize;
+        }
+
+    private:
+        size_t m_pageSize;
+        ByteVector m_out;
+#if HAVE_LIBLZO2
+        ByteVector m_wrkmem;
+#endif
+};
+
+// -----------------------------------------------------------------------------
+/**
+ * Small, fast PRNG (splitmix64). The seed is fixed, so that repeated
+ * runs on the same dump give the same result.
+ */
+class SampleRandom {
+
+    public:
+        SampleRandom()
+        throw ()
+            : m_state(0x6b64756d70ULL)
+        {}
+
+        /**
+         * Returns a number in [0, 1).
+         */
+        double next()
+        throw ()
+        {
+            unsigned long long z = (m_state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            return (z >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+    private:
+        unsigned long long m_state;
+};
+
+//}}}
+//{{{ VmcoreAnalyzer::Sampler --------------------------------------------------
+
+/**
+ * Reads and compresses a slice of the sampled pages.
+ */
+class VmcoreAnalyzer::Sampler : public Thread {
+
+    public:
+        Sampler(const VmcoreImage &image, unsigned long pageSize,
+                const unsigned long long *offsets, size_t count)
+        throw ()
+            : zero(0), m_image(image), m_pageSize(pageSize),
+              m_offsets(offsets), m_count(count)
+        {
+            for (int f = 0; f < FORMAT_MAX; ++f) {
+                compressed[f] = 0;
+                cpuSeconds[f] = 0.0;
+            }
+        }
+
+        ~Sampler()
+        throw ()
+        { joinQuietly(); }
+
+        unsigned long zero;
+        unsigned long long compressed[FORMAT_MAX];
+        double cpuSeconds[FORMAT_MAX];
+
+    protected:
+        void run()
+        throw (KError)
+        {
+            // read all pages first, so that I/O is not counted as CPU
+            // time of the compressors
+            ByteVector pages(m_count * m_pageSize);
+            size_t nonzero = 0;
+            for (size_t i = 0; i < m_count; ++i) {
+                unsigned char *page = &pages[nonzero * m_pageSize];
+                m_image.readData(m_offsets[i], page, m_pageSize);
+                if (isZeroPage(page, m_pageSize))
+                    ++zero;
+                else
+                    ++nonzero;
+            }
+
+            compressed[FORMAT_ELF] = (unsigned long long)nonzero * m_pageSize;
+
+            PageCompressor compressor(m_pageSize);
+            for (int f = FORMAT_ELF + 1; f < FORMAT_MAX; ++f) {
+                Format format = Format(f);
+                if (!isAvailable(format))
+                    continue;
+
+                double start = threadCpuTime();
+                for (size_t i = 0; i < nonzero; ++i)
+                    compressed[f] += compressor.compress(format,
+                        &pages[i * m_pageSize]);
+                cpuSeconds[f] = threadCpuTime() - start;
+            }
+        }
+
+    private:
+        const VmcoreImage &m_image;
+        unsigned long m_pageSize;
+        const unsigned long long *m_offsets;
+        size_t m_count;
+};
+
+//}}}
+//{{{ VmcoreAnalyzer -----------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+VmcoreAnalyzer::VmcoreAnalyzer(const VmcoreImage &image,
+                               unsigned long pageSize)
+    throw ()
+    : m_image(image), m_pageSize(pageSize), m_samples(DEFAULT_SAMPLES),
+      m_threads(1), m_totalPages(0), m_filePages(0), m_fileSize(0),
+      m_sampled(0), m_sampledZero(0)
+{
+    for (int f = 0; f < FORMAT_MAX; ++f) {
+        m_compressed[f] = 0;
+        m_cpuSeconds[f] = 0.0;
+        m_zeroCompressed[f] = 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreAnalyzer::analyze()
+    throw (KError)
+{
+    Debug::debug()->trace("VmcoreAnalyzer::analyze()");
+
+#if HAVE_LIBLZO2
+    if (lzo_init() != LZO_E_OK)
+        throw KError("lzo_init() failed.");
+#endif
+
+    const VmcoreImage::LoadVector &loads = m_image.getLoads();
+    VmcoreImage::LoadVector::const_iterator it;
+
+    m_totalPages = m_filePages = m_fileSize = 0;
+    for (it = loads.begin(); it != loads.end(); ++it) {
+        m_totalPages += it->memsz / m_pageSize;
+        m_filePages += it->filesz / m_pageSize;
+        if (it->offset + it->filesz > m_fileSize)
+            m_fileSize = it->offset + it->filesz;
+    }
+
+    // stratified sample: every segment gets its share, and the pages
+    // are picked randomly from equally sized strata of the segment
+    std::vector<unsigned long long> offsets;
+    SampleRandom random;
+    for (it = loads.begin(); it != loads.end() && m_filePages; ++it) {
+        unsigned long long pages = it->filesz / m_pageSize;
+        if (!pages)
+            continue;
+
+        unsigned long long n = (unsigned long long)
+            ((double)m_samples * pages / m_filePages + 0.5);
+        if (n < 1)
+            n = 1;
+        if (n > pages)
+            n = pages;
+
+        double stride = (double)pages / n;
+        for (unsigned long long j = 0; j < n; ++j) {
+            unsigned long long page = (unsigned long long)
+                ((j + random.next()) * stride);
+            if (page >= pages)
+                page = pages - 1;
+            offsets.push_back(it->offset + page * m_pageSize);
+        }
+    }
+
+    m_sampled = offsets.size();
+    unsigned long threads = m_threads;
+    if (threads > m_sampled)
+        threads = m_sampled;
+
+    Debug::debug()->dbg("Sampling %lu of %llu pages with %lu threads",
+        m_sampled, m_totalPages, threads);
+
+    std::vector<Sampler *> samplers;
+    try {
+        size_t start = 0;
+        for (unsigned long i = 0; i < threads; ++i) {
+            size_t end = (size_t)((unsigned long long)m_sampled * (i + 1) /
+                                  threads);
+            samplers.push_back(new Sampler(m_image, m_pageSize,
+                &offsets[start], end - start));
+            samplers.back()->start();
+            start = end;
+        }
+
+        m_sampledZero = 0;
+        for (int f = 0; f < FORMAT_MAX; ++f) {
+            m_compressed[f] = 0;
+            m_cpuSeconds[f] = 0.0;
+        }
+        for (size_t i = 0; i < samplers.size(); ++i) {
+            samplers[i]->join();
+            m_sampledZero += samplers[i]->zero;
+            for (int f = 0; f < FORMAT_MAX; ++f) {
+                m_compressed[f] += samplers[i]->compressed[f];
+                m_cpuSeconds[f] += samplers[i]->cpuSeconds[f];
+            }
+        }
+    } catch (...) {
+        // the destructor joins the thread
+        for (size_t i = 0; i < samplers.size(); ++i)
+            delete samplers[i];
+        throw;
+    }
+    for (size_t i = 0; i < samplers.size(); ++i)
+        delete samplers[i];
+
+    // zero pages compress to the same size every time
+    ByteVector zeroPage(m_pageSize, 0);
+    PageCompressor compressor(m_pageSize);
+    for (int f = 0; f < FORMAT_MAX; ++f)
+        m_zeroCompressed[f] = isAvailable(Format(f))
+            ? compressor.compress(Format(f), &zeroPage[0])
+            : m_pageSize;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long VmcoreAnalyzer::estimateZeroPages() const
+    throw ()
+{
+    // pages beyond p_filesz are not in the file and read as zero
+    unsigned long long ret = m_totalPages - m_filePages;
+    if (m_sampled)
+        ret += (unsigned long long)
+            ((double)m_filePages * m_sampledZero / m_sampled + 0.5);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+double VmcoreAnalyzer::getZeroRatio() const
+    throw ()
+{
+    if (!m_totalPages)
+        return 0.0;
+    return (double)estimateZeroPages() / m_totalPages;
+}
+
+// -----------------------------------------------------------------------------
+VmcoreAnalyzer::Estimate VmcoreAnalyzer::estimate(Format format,
+                                                  int dumplevel) const
+    throw ()
+{
+    Estimate ret;
+    ret.available = isAvailable(format);
+    ret.size = 0;
+    ret.cpuRate = 0.0;
+    if (!ret.available)
+        return ret;
+
+    bool excludeZero = dumplevel & 1;
+    unsigned long long zero = estimateZeroPages();
+    unsigned long long nonzero = m_totalPages - zero;
+    unsigned long sampledNonzero = m_sampled - m_sampledZero;
+    double perPage = sampledNonzero
+        ? (double)m_compressed[format] / sampledNonzero
+        : m_pageSize;
+
+    if (format == FORMAT_ELF) {
+        // dump level 0 copies the file as is
+        if (dumplevel == 0)
+            ret.size = m_fileSize;
+        else
+            ret.size = (excludeZero ? nonzero : m_totalPages) * m_pageSize;
+        return ret;
+    }
+
+    unsigned long long written = excludeZero ? nonzero : m_totalPages;
+    ret.size = (unsigned long long)(nonzero * perPage) +
+        (excludeZero ? 0 : zero * m_zeroCompressed[format]) +
+        written * PAGE_DESC_SIZE +
+        m_totalPages / 4;                   // two bitmaps
+    if (m_cpuSeconds[format] > 0)
+        ret.cpuRate = (double)sampledNonzero * m_pageSize /
+            m_cpuSeconds[format];
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+double VmcoreAnalyzer::predictSeconds(Format format, int dumplevel,
+                                      unsigned long cpus,
+                                      unsigned long long bandwidth) const
+    throw ()
+{
+    Estimate est = estimate(format, dumplevel);
+    if (!est.available)
+        return 0.0;
+
+    double seconds = 0.0;
+    if (est.cpuRate > 0) {
+        unsigned long long nonzero = m_totalPages - estimateZeroPages();
+        seconds = (double)nonzero * m_pageSize / est.cpuRate /
+            (cpus ? cpus : 1);
+    }
+    if (bandwidth) {
+        double transfer = (double)est.size / bandwidth;
+        if (transfer > seconds)
+            seconds = transfer;
+    }
+    return seconds;
+}
+
+// -----------------------------------------------------------------------------
+VmcoreAnalyzer::Plan VmcoreAnalyzer::choose(int dumplevel, unsigned long cpus,
+                                            unsigned long long bandwidth,
+                                            bool canSplit) const
+    throw ()
+{
+    Plan best;
+    best.format = FORMAT_ZLIB;
+    best.split = best.threads = 0;
+    best.seconds = -1.0;
+    unsigned long long bestSize = 0;
+
+    if (!cpus)
+        cpus = 1;
+
+    for (int f = 0; f < FORMAT_MAX; ++f) {
+        Format format = Format(f);
+        Estimate est = estimate(format, dumplevel);
+        if (!est.available || (format == FORMAT_ELF && !bandwidth))
+            continue;
+
+        double cpu = predictSeconds(format, dumplevel, 1);
+        double transfer = bandwidth ? (double)est.size / bandwidth : 0.0;
+
+        // workers that are needed to keep up with the target
+        unsigned long needed = cpus;
+        if (transfer > 0)
+            needed = (unsigned long)ceil(cpu / transfer);
+        if (!needed)
+            needed = 1;
+
+        // 0: single, 1: threads, 2: split
+        for (int mode = 0; mode < 3; ++mode) {
+            unsigned long workers = 1;
+            if (mode == 1)
+                workers = cpus - 1;
+            else if (mode == 2)
+                workers = canSplit ? cpus : 0;
+            if (workers > needed)
+                workers = needed;
+            if (mode && (format == FORMAT_ELF || workers < 2))
+                continue;
+
+            double seconds = cpu / workers;
+            if (seconds < transfer)
+                seconds = transfer;
+
+            // less than 2% faster is not worth a bigger dump
+            bool better = best.seconds < 0 ||
+                seconds < best.seconds * 0.98 ||
+                (seconds <= best.seconds * 1.02 && est.size < bestSize);
+            if (!better)
+                continue;
+
+            best.format = format;
+            best.split = mode == 2 ? workers : 0;
+            best.threads = mode == 1 ? workers : 0;
+            best.seconds = seconds;
+            bestSize = est.size;
+        }
+    }
+
+    if (best.seconds < 0)
+        best.seconds = 0.0;
+    return best;
+}
+
+// -----------------------------------------------------------------------------
+const char *VmcoreAnalyzer::formatName(Format format)
+    throw ()
+{
+    switch (format) {
+        case FORMAT_ELF:        return "elf";
+        case FORMAT_ZLIB:       return "compressed";
+        case FORMAT_LZO:        return "lzo";
+        case FORMAT_SNAPPY:     return "snappy";
+        default:                return "unknown";
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool VmcoreAnalyzer::parseFormat(const string &name, Format &format)
+    throw ()
+{
+    for (int f = 0; f < FORMAT_MAX; ++f)
+        if (strcasecmp(name.c_str(), formatName(Format(f))) == 0) {
+            format = Format(f);
+            return true;
+        }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+bool VmcoreAnalyzer::isAvailable(Format format)
+    throw ()
+{
+    switch (format) {
+        case FORMAT_ELF:
+        case FORMAT_ZLIB:
+            return true;
+        case FORMAT_LZO:
+            return HAVE_LIBLZO2;
+        case FORMAT_SNAPPY:
+            return HAVE_LIBSNAPPY;
+        default:
+            return false;
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,238 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef VMCOREANALYZER_H
+#define VMCOREANALYZER_H
+
+#include <string>
+
+#include "global.h"
+
+class VmcoreImage;
+
+//{{{ VmcoreAnalyzer -----------------------------------------------------------
+
+/**
+ * Predicts the size of a saved dump and the time needed to write it.
+ *
+ * A stratified random sample of pages is read from every PT_LOAD
+ * segment, using several threads. For each page the analyzer checks
+ * whether it is zero, and compresses non-zero pages with every
+ * compression method that makedumpfile supports (-c, -l, -p) and that
+ * is compiled in, measuring the CPU time spent. The results are
+ * extrapolated to the whole dump.
+ *
+ * Only the zero page exclusion (bit 1 of the dump level) can be
+ * predicted this way; pages excluded by other dump level bits are
+ * counted as dumped, so the prediction is an upper bound.
+ */
+class VmcoreAnalyzer {
+
+    public:
+
+        /**
+         * Output formats, named like the KDUMP_DUMPFORMAT values.
+         */
+        enum Format {
+            FORMAT_ELF,         /**< uncompressed ELF */
+            FORMAT_ZLIB,        /**< compressed (zlib) */
+            FORMAT_LZO,         /**< lzo */
+            FORMAT_SNAPPY,      /**< snappy */
+            FORMAT_MAX
+        };
+
+        /**
+         * Prediction for one output format.
+         */
+        struct Estimate {
+            /** @c false if the format is not compiled in */
+            bool available;
+            /** predicted output size in bytes */
+            unsigned long long size;
+            /** input bytes processed per second of CPU time (0: no CPU
+             *  cost worth mentioning) */
+            double cpuRate;
+        };
+
+        /**
+         * How to run makedumpfile (see choose()).
+         */
+        struct Plan {
+            /** output format */
+            Format format;
+            /** number of split parts (0: do not split) */
+            unsigned long split;
+            /** number of compression threads (0: single-threaded) */
+            unsigned long threads;
+            /** predicted time in seconds */
+            double seconds;
+        };
+
+        /**
+         * Creates a new analyzer.
+         *
+         * @param[in] image the dump
+         * @param[in] pageSize page size of the crashed system
+         */
+        VmcoreAnalyzer(const VmcoreImage &image, unsigned long pageSize)
+        throw ();
+
+        /**
+         * Sets the number of pages to sample (default: 4096). The
+         * sample is spread over all PT_LOAD segments in proportion to
+         * their size.
+         */
+        void setSamples(unsigned long samples)
+        throw ()
+        { m_samples = samples; }
+
+        /**
+         * Sets the number of threads (default: 1).
+         */
+        void setThreads(unsigned long threads)
+        throw ()
+        { m_threads = threads ? threads : 1; }
+
+        /**
+         * Samples the dump.
+         *
+         * @exception KError if the dump cannot be read or a thread
+         *            cannot be started
+         */
+        void analyze()
+        throw (KError);
+
+        /**
+         * Returns the number of pages in the dump (including pages that
+         * are not present in the file).
+         */
+        unsigned long long getTotalPages() const
+        throw ()
+        { return m_totalPages; }
+
+        /**
+         * Returns the number of sampled pages.
+         */
+        unsigned long getSampledPages() const
+        throw ()
+        { return m_sampled; }
+
+        /**
+         * Returns the estimated fraction of zero pages (0 to 1).
+         */
+        double getZeroRatio() const
+        throw ();
+
+        /**
+         * Returns the prediction for a format.
+         *
+         * @param[in] format the output format
+         * @param[in] dumplevel makedumpfile dump level
+         */
+        Estimate estimate(Format format, int dumplevel) const
+        throw ();
+
+        /**
+         * Predicts the time needed to save the dump.
+         *
+         * @param[in] format the output format
+         * @param[in] dumplevel makedumpfile dump level
+         * @param[in] cpus number of CPUs used for compression
+         * @param[in] bandwidth target bandwidth in bytes per second,
+         *            or 0 if unknown (only the CPU time is counted)
+         * @return the predicted time in seconds
+         */
+        double predictSeconds(Format format, int dumplevel,
+                              unsigned long cpus,
+                              unsigned long long bandwidth = 0) const
+        throw ();
+
+        /**
+         * Chooses the output format and the kind of parallelism that
+         * minimise the predicted time to save the dump.
+         *
+         * The time of each candidate is the larger of the compression
+         * time and the transfer time, so no more CPUs are used than
+         * needed to keep up with the target. makedumpfile with
+         * --num-threads needs one CPU for the main thread, while each
+         * split part is compressed by its own process. If two
+         * candidates are about equally fast, the one with the smaller
+         * output wins.
+         *
+         * If the bandwidth is unknown, only the CPU time counts, and
+         * the uncompressed ELF format is never chosen.
+         *
+         * @param[in] dumplevel makedumpfile dump level
+         * @param[in] cpus number of CPUs that may be used
+         * @param[in] bandwidth target bandwidth in bytes per second,
+         *            or 0 if unknown
+         * @param[in] canSplit whether the dump may be split
+         */
+        Plan choose(int dumplevel, unsigned long cpus,
+                    unsigned long long bandwidth, bool canSplit) const
+        throw ();
+
+        /**
+         * Returns the KDUMP_DUMPFORMAT name of a format.
+         */
+        static const char *formatName(Format format)
+        throw ();
+
+        /**
+         * Looks up a format by its KDUMP_DUMPFORMAT name (case
+         * insensitive).
+         *
+         * @param[in] name the format name
+         * @param[out] format the format
+         * @return @c false if @p name is not a known format
+         */
+        static bool parseFormat(const std::string &name, Format &format)
+        throw ();
+
+        /**
+         * Checks whether a compression method is compiled in.
+         */
+        static bool isAvailable(Format format)
+        throw ();
+
+    private:
+        class Sampler;
+
+        const VmcoreImage &m_image;
+        unsigned long m_pageSize;
+        unsigned long m_samples;
+        unsigned long m_threads;
+
+        unsigned long long m_totalPages;
+        unsigned long long m_filePages;
+        unsigned long long m_fileSize;
+        unsigned long m_sampled;
+        unsigned long m_sampledZero;
+        unsigned long long m_compressed[FORMAT_MAX];
+        double m_cpuSeconds[FORMAT_MAX];
+        unsigned long m_zeroCompressed[FORMAT_MAX];
+
+        unsigned long long estimateZeroPages() const
+        throw ();
+};
+
+//}}}
+
+#endif /* VMCOREANALYZER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
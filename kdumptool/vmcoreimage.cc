@@ -0,0 +1,342 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <elf.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "stringutil.h"
+#include "vmcoreimage.h"
+
+using std::string;
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+# define ELFDATA_NATIVE ELFDATA2LSB
+#else
+# define ELFDATA_NATIVE ELFDATA2MSB
+#endif
+
+// -----------------------------------------------------------------------------
+/**
+ * Reads exactly @p size bytes at @p offset.
+ */
+static void pread_full(int fd, void *buf, size_t size, off_t offset,
+                       const string &what)
+    throw (KError)
+{
+    char *p = static_cast<char *>(buf);
+    while (size) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot read " + what + ".", errno);
+        }
+        if (n == 0)
+            throw KError("Unexpected end of file while reading " +
+                what + ".");
+        p += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+/**
+ * Size of the read window for program headers and notes.
+ */
+#define IMAGE_WINDOW_SIZE           (64*1024)
+
+//{{{ VmcoreImage::Window ------------------------------------------------------
+
+/**
+ * Forward-only read buffer over a region of the dump.
+ */
+class VmcoreImage::Window {
+
+    public:
+        Window(int fd)
+        throw ()
+            : m_fd(fd), m_buf(IMAGE_WINDOW_SIZE), m_start(0), m_len(0)
+        {}
+
+        /**
+         * Returns a pointer to @p len bytes at @p offset. The window is
+         * refilled from @p offset, but never beyond @p end.
+         */
+        const unsigned char *get(unsigned long long offset, size_t len,
+                                 unsigned long long end, const char *what)
+        throw (KError)
+        {
+            if (offset >= m_start && offset + len <= m_start + m_len)
+                return &m_buf[offset - m_start];
+
+            if (len > m_buf.size() || offset + len > end)
+                throw KError(string("Truncated ") + what + ".");
+
+            size_t n = std::min((unsigned long long)m_buf.size(),
+                                end - offset);
+            pread_full(m_fd, &m_buf[0], n, offset, what);
+            m_start = offset;
+            m_len = n;
+            return &m_buf[0];
+        }
+
+    private:
+        int m_fd;
+        ByteVector m_buf;
+        unsigned long long m_start;
+        size_t m_len;
+};
+
+//}}}
+//{{{ VmcoreImage --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+VmcoreImage::VmcoreImage(const string &path)
+    throw (KError)
+    : m_path(path), m_fd(-1), m_ownFd(true), m_elf64(false),
+      m_machine(EM_NONE)
+{
+    Debug::debug()->trace("VmcoreImage::VmcoreImage(%s)", path.c_str());
+
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        throw KSystemError("Cannot open " + path + ".", errno);
+
+    try {
+        readHeaders();
+    } catch (...) {
+        close(m_fd);
+        throw;
+    }
+}
+
+// -----------------------------------------------------------------------------
+VmcoreImage::VmcoreImage(int fd)
+    throw (KError)
+    : m_path("fd " + Stringutil::number2string(fd)), m_fd(fd),
+      m_ownFd(false), m_elf64(false), m_machine(EM_NONE)
+{
+    Debug::debug()->trace("VmcoreImage::VmcoreImage(%d)", fd);
+
+    readHeaders();
+}
+
+// -----------------------------------------------------------------------------
+VmcoreImage::~VmcoreImage()
+    throw ()
+{
+    if (m_ownFd)
+        close(m_fd);
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreImage::readHeaders()
+    throw (KError)
+{
+    union {
+        unsigned char ident[EI_NIDENT];
+        Elf32_Ehdr e32;
+        Elf64_Ehdr e64;
+    } ehdr;
+
+    pread_full(m_fd, &ehdr, sizeof(Elf32_Ehdr), 0, "ELF header");
+    if (memcmp(ehdr.ident, ELFMAG, SELFMAG) != 0)
+        throw KError(m_path + " is not an ELF file.");
+    if (ehdr.ident[EI_DATA] != ELFDATA_NATIVE)
+        throw KError(m_path + " has foreign byte order.");
+
+    unsigned long long phoff, shoff;
+    unsigned phentsize, phnum;
+    size_t phdrsize;
+    switch (ehdr.ident[EI_CLASS]) {
+        case ELFCLASS32:
+            m_machine = ehdr.e32.e_machine;
+            phoff = ehdr.e32.e_phoff;
+            shoff = ehdr.e32.e_shoff;
+            phentsize = ehdr.e32.e_phentsize;
+            phnum = ehdr.e32.e_phnum;
+            phdrsize = sizeof(Elf32_Phdr);
+            break;
+
+        case ELFCLASS64:
+            m_elf64 = true;
+            pread_full(m_fd, &ehdr, sizeof(Elf64_Ehdr), 0, "ELF header");
+            m_machine = ehdr.e64.e_machine;
+            phoff = ehdr.e64.e_phoff;
+            shoff = ehdr.e64.e_shoff;
+            phentsize = ehdr.e64.e_phentsize;
+            phnum = ehdr.e64.e_phnum;
+            phdrsize = sizeof(Elf64_Phdr);
+            break;
+
+        default:
+            throw KError(m_path + ": unrecognized ELF class.");
+    }
+
+    // more than 65534 program headers: the count is in section 0
+    if (phnum == PN_XNUM) {
+        if (m_elf64) {
+            Elf64_Shdr shdr;
+            pread_full(m_fd, &shdr, sizeof shdr, shoff, "section header");
+            phnum = shdr.sh_info;
+        } else {
+            Elf32_Shdr shdr;
+            pread_full(m_fd, &shdr, sizeof shdr, shoff, "section header");
+            phnum = shdr.sh_info;
+        }
+    }
+
+    if (phnum && phentsize < phdrsize)
+        throw KError(m_path + ": invalid program header size.");
+
+    Window window(m_fd);
+    unsigned long long phend = phoff + (unsigned long long)phnum * phentsize;
+    LoadVector notesegs;
+
+    for (unsigned i = 0; i < phnum; ++i) {
+        const unsigned char *p = window.get(
+            phoff + (unsigned long long)i * phentsize, phdrsize, phend,
+            "program headers");
+        unsigned type;
+        LoadSegment seg;
+
+        if (m_elf64) {
+            Elf64_Phdr phdr;
+            memcpy(&phdr, p, sizeof phdr);
+            type = phdr.p_type;
+            seg.offset = phdr.p_offset;
+            seg.vaddr = phdr.p_vaddr;
+            seg.paddr = phdr.p_paddr;
+            seg.filesz = phdr.p_filesz;
+            seg.memsz = phdr.p_memsz;
+        } else {
+            Elf32_Phdr phdr;
+            memcpy(&phdr, p, sizeof phdr);
+            type = phdr.p_type;
+            seg.offset = phdr.p_offset;
+            seg.vaddr = phdr.p_vaddr;
+            seg.paddr = phdr.p_paddr;
+            seg.filesz = phdr.p_filesz;
+            seg.memsz = phdr.p_memsz;
+        }
+
+        if (type == PT_LOAD)
+            m_loads.push_back(seg);
+        else if (type == PT_NOTE && seg.filesz)
+            notesegs.push_back(seg);
+    }
+
+    for (LoadVector::const_iterator it = notesegs.begin();
+            it != notesegs.end(); ++it)
+        parseNotes(window, it->offset, it->filesz);
+
+    Debug::debug()->dbg("%s: ELF%d, %zu PT_LOAD, %zu PT_NOTE, %zu notes, "
+        "%llu bytes memory", m_path.c_str(), m_elf64 ? 64 : 32,
+        m_loads.size(), notesegs.size(), m_notes.size(), getMemorySize());
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreImage::parseNotes(Window &window, unsigned long long offset,
+                             unsigned long long size)
+    throw (KError)
+{
+    // Elf32_Nhdr and Elf64_Nhdr have the same layout
+    unsigned long long end = offset + size;
+    unsigned long long pos = offset;
+
+    while (end - pos >= sizeof(Elf64_Nhdr)) {
+        Elf64_Nhdr nhdr;
+        memcpy(&nhdr, window.get(pos, sizeof nhdr, end, "ELF notes"),
+               sizeof nhdr);
+
+        unsigned long long namesz = (nhdr.n_namesz + 3ULL) & ~3ULL;
+        unsigned long long descsz = (nhdr.n_descsz + 3ULL) & ~3ULL;
+        if (namesz + descsz > end - pos - sizeof nhdr) {
+            Debug::debug()->info("%s: truncated ELF note at offset %llu",
+                m_path.c_str(), pos);
+            break;
+        }
+        pos += sizeof nhdr;
+
+        Note note;
+        if (nhdr.n_namesz) {
+            const char *name = reinterpret_cast<const char *>(
+                window.get(pos, nhdr.n_namesz, end, "ELF note name"));
+            note.name.assign(name, strnlen(name, nhdr.n_namesz));
+        }
+        note.type = nhdr.n_type;
+        note.offset = pos + namesz;
+        note.size = nhdr.n_descsz;
+        m_notes.push_back(note);
+
+        pos += namesz + descsz;
+    }
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long VmcoreImage::getMemorySize() const
+    throw ()
+{
+    unsigned long long ret = 0;
+    LoadVector::const_iterator it;
+    for (it = m_loads.begin(); it != m_loads.end(); ++it)
+        ret += it->memsz;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+const VmcoreImage::Note *VmcoreImage::findNote(const string &name) const
+    throw ()
+{
+    NoteVector::const_iterator it;
+    for (it = m_notes.begin(); it != m_notes.end(); ++it)
+        if (it->name == name)
+            return &*it;
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+ByteVector VmcoreImage::getNoteData(const Note &note) const
+    throw (KError)
+{
+    ByteVector ret(note.size);
+    if (!ret.empty())
+        pread_full(m_fd, &ret[0], ret.size(), note.offset,
+                   "ELF note " + note.name);
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreImage::readData(unsigned long long offset, void *buf,
+                           size_t size) const
+    throw (KError)
+{
+    pread_full(m_fd, buf, size, offset, m_path);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,209 @@
+/*
+ * (c) 2026, SUSE LINUX GmbH
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef VMCOREIMAGE_H
+#define VMCOREIMAGE_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+
+//{{{ VmcoreImage --------------------------------------------------------------
+
+/**
+ * In-memory index of the ELF headers and notes of a dump.
+ *
+ * The program headers and all PT_NOTE segments are scanned once with
+ * pread(2) through a fixed-size window when the object is created, so
+ * memory use does not depend on the number of CPUs (one PRSTATUS note
+ * each) or memory ranges of the crashed system. Only the note headers
+ * are kept; descriptors are read on demand with getNoteData(), which
+ * is why the file stays open for the lifetime of the object.
+ *
+ * Both ELF classes are supported; the byte order must be the native
+ * one, as it always is for /proc/vmcore.
+ */
+class VmcoreImage {
+
+    public:
+
+        /**
+         * A PT_LOAD segment.
+         */
+        struct LoadSegment {
+            unsigned long long offset;
+            unsigned long long vaddr;
+            unsigned long long paddr;
+            unsigned long long filesz;
+            unsigned long long memsz;
+        };
+
+        /**
+         * An ELF note.
+         */
+        struct Note {
+            /** name of the note without the terminating NUL */
+            std::string name;
+            /** note type */
+            unsigned type;
+            /** file offset of the note descriptor */
+            unsigned long long offset;
+            /** size of the note descriptor */
+            size_t size;
+        };
+
+        typedef std::vector<LoadSegment> LoadVector;
+        typedef std::vector<Note> NoteVector;
+
+        /**
+         * Reads the headers and notes of @p path.
+         *
+         * @param[in] path the dump file
+         * @exception KError if the file cannot be read or is not a
+         *            valid ELF file
+         */
+        VmcoreImage(const std::string &path)
+        throw (KError);
+
+        /**
+         * Reads the headers and notes from an open file descriptor.
+         * The descriptor is not closed by this object and must stay
+         * open while it is used.
+         *
+         * @param[in] fd the dump file
+         * @exception KError if the file cannot be read or is not a
+         *            valid ELF file
+         */
+        VmcoreImage(int fd)
+        throw (KError);
+
+        /**
+         * Closes the dump file if it was opened by the constructor.
+         */
+        ~VmcoreImage()
+        throw ();
+
+        /**
+         * Returns the name of the dump file.
+         */
+        const std::string &getPath() const
+        throw ()
+        { return m_path; }
+
+        /**
+         * Checks whether the dump is an ELF64 file.
+         */
+        bool isElf64() const
+        throw ()
+        { return m_elf64; }
+
+        /**
+         * Returns the ELF machine type (e_machine).
+         */
+        unsigned getMachine() const
+        throw ()
+        { return m_machine; }
+
+        /**
+         * Returns all PT_LOAD segments in file order.
+         */
+        const LoadVector &getLoads() const
+        throw ()
+        { return m_loads; }
+
+        /**
+         * Returns the sum of the memory sizes of all PT_LOAD segments.
+         */
+        unsigned long long getMemorySize() const
+        throw ();
+
+        /**
+         * Returns all notes in file order.
+         */
+        const NoteVector &getNotes() const
+        throw ()
+        { return m_notes; }
+
+        /**
+         * Looks up the first note with a given name.
+         *
+         * @param[in] name the note name (without the terminating NUL)
+         * @return the note or @c NULL if there is no such note
+         */
+        const Note *findNote(const std::string &name) const
+        throw ();
+
+        /**
+         * Returns the descriptor of a note.
+         *
+         * @param[in] note a note returned by this object
+         * @return the descriptor bytes
+         * @exception KError if the descriptor cannot be read
+         */
+        ByteVector getNoteData(const Note &note) const
+        throw (KError);
+
+        /**
+         * Reads raw data from the dump file. This may be called from
+         * several threads at the same time.
+         *
+         * @param[in] offset file offset
+         * @param[out] buf destination buffer
+         * @param[in] size number of bytes to read
+         * @exception KError if the data cannot be read
+         */
+        void readData(unsigned long long offset, void *buf, size_t size) const
+        throw (KError);
+
+        /**
+         * Checks whether the dump was taken from a Xen hypervisor,
+         * i.e. whether there is a "Xen" note.
+         */
+        bool isXen() const
+        throw ()
+        { return findNote("Xen") != NULL; }
+
+    private:
+        class Window;
+
+        std::string m_path;
+        int m_fd;
+        bool m_ownFd;
+        bool m_elf64;
+        unsigned m_machine;
+        LoadVector m_loads;
+        NoteVector m_notes;
+
+        void readHeaders()
+        throw (KError);
+
+        void parseNotes(Window &window, unsigned long long offset,
+                        unsigned long long size)
+        throw (KError);
+
+        // non-copyable
+        VmcoreImage(const VmcoreImage &);
+        VmcoreImage &operator=(const VmcoreImage &);
+};
+
+//}}}
+
+#endif /* VMCOREIMAGE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
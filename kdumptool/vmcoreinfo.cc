@@ -22,11 +22,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <cerrno>
-#include <sys/mman.h>
 #include <cstring>
-
-#include <libelf.h>
-#include <gelf.h>
+#include <cstdlib>
+#include <algorithm>
 
 #include "global.h"
 #include "subcommand.h"
@@ -40,283 +38,308 @@
 #include "progress.h"
 #include "vmcoreinfo.h"
 #include "stringutil.h"
+#include "vmcoreimage.h"
 
 using std::string;
 using std::cout;
 using std::endl;
-using std::min;
 
 #define VMCOREINFO_NOTE_NAME           "VMCOREINFO"
-#define VMCOREINFO_NOTE_NAME_BYTES     (sizeof(VMCOREINFO_NOTE_NAME))
-#define VMCOREINFO_XEN_NOTE_NAME	   "VMCOREINFO_XEN"
-#define VMCOREINFO_XEN_NOTE_NAME_BYTES (sizeof(VMCOREINFO_XEN_NOTE_NAME))
+#define VMCOREINFO_XEN_NOTE_NAME       "VMCOREINFO_XEN"
 
-#define ELF_HEADER_MAPSIZE          (100*1024)
+/**
+ * Key prefixes, indexed by Vmcoreinfo::Type.
+ */
+static const char *const typeNames[Vmcoreinfo::NTYPES] = {
+    "", "SYMBOL", "OFFSET", "SIZE", "LENGTH", "NUMBER"
+};
 
-//{{{ Vmcoreinfo ---------------------------------------------------------------
+/**
+ * Names of the well-known entries, indexed by Vmcoreinfo::Id.
+ */
+struct WellKnown {
+    Vmcoreinfo::Type type;
+    const char *name;
+    int base;           // for PLAIN entries
+};
+
+static const WellKnown wellKnown[] = {
+    { Vmcoreinfo::PLAIN,  "PAGESIZE", 10 },
+    { Vmcoreinfo::PLAIN,  "CRASHTIME", 10 },
+    { Vmcoreinfo::PLAIN,  "KERNELOFFSET", 16 },
+
+    { Vmcoreinfo::SYMBOL, "init_uts_ns", 0 },
+    { Vmcoreinfo::SYMBOL, "swapper_pg_dir", 0 },
+    { Vmcoreinfo::SYMBOL, "_stext", 0 },
+    { Vmcoreinfo::SYMBOL, "mem_map", 0 },
+    { Vmcoreinfo::SYMBOL, "contig_page_data", 0 },
+    { Vmcoreinfo::SYMBOL, "mem_section", 0 },
+    { Vmcoreinfo::SYMBOL, "node_data", 0 },
+    { Vmcoreinfo::SYMBOL, "vmemmap", 0 },
+    { Vmcoreinfo::SYMBOL, "prb", 0 },
+
+    { Vmcoreinfo::SIZE,   "page", 0 },
+    { Vmcoreinfo::SIZE,   "pglist_data", 0 },
+    { Vmcoreinfo::SIZE,   "zone", 0 },
+    { Vmcoreinfo::SIZE,   "free_area", 0 },
+    { Vmcoreinfo::SIZE,   "list_head", 0 },
+    { Vmcoreinfo::SIZE,   "mem_section", 0 },
+
+    { Vmcoreinfo::OFFSET, "page.flags", 0 },
+    { Vmcoreinfo::OFFSET, "page._refcount", 0 },
+    { Vmcoreinfo::OFFSET, "page.mapping", 0 },
+    { Vmcoreinfo::OFFSET, "page.lru", 0 },
+    { Vmcoreinfo::OFFSET, "page._mapcount", 0 },
+    { Vmcoreinfo::OFFSET, "page.private", 0 },
+    { Vmcoreinfo::OFFSET, "page.compound_head", 0 },
+    { Vmcoreinfo::OFFSET, "pglist_data.node_zones", 0 },
+    { Vmcoreinfo::OFFSET, "pglist_data.nr_zones", 0 },
+    { Vmcoreinfo::OFFSET, "pglist_data.node_start_pfn", 0 },
+    { Vmcoreinfo::OFFSET, "pglist_data.node_spanned_pages", 0 },
+    { Vmcoreinfo::OFFSET, "pglist_data.node_id", 0 },
+    { Vmcoreinfo::OFFSET, "zone.free_area", 0 },
+    { Vmcoreinfo::OFFSET, "free_area.free_list", 0 },
+    { Vmcoreinfo::OFFSET, "list_head.next", 0 },
+    { Vmcoreinfo::OFFSET, "list_head.prev", 0 },
+    { Vmcoreinfo::OFFSET, "mem_section.section_mem_map", 0 },
+
+    { Vmcoreinfo::LENGTH, "zone.free_area", 0 },
+    { Vmcoreinfo::LENGTH, "free_area.free_list", 0 },
+    { Vmcoreinfo::LENGTH, "mem_section", 0 },
+    { Vmcoreinfo::LENGTH, "node_data", 0 },
+
+    { Vmcoreinfo::NUMBER, "NR_FREE_PAGES", 0 },
+    { Vmcoreinfo::NUMBER, "PG_lru", 0 },
+    { Vmcoreinfo::NUMBER, "PG_private", 0 },
+    { Vmcoreinfo::NUMBER, "PG_swapcache", 0 },
+    { Vmcoreinfo::NUMBER, "PG_swapbacked", 0 },
+    { Vmcoreinfo::NUMBER, "PG_slab", 0 },
+    { Vmcoreinfo::NUMBER, "PG_hwpoison", 0 },
+    { Vmcoreinfo::NUMBER, "PG_head_mask", 0 },
+    { Vmcoreinfo::NUMBER, "PAGE_BUDDY_MAPCOUNT_VALUE", 0 },
+    { Vmcoreinfo::NUMBER, "phys_base", 0 },
+    { Vmcoreinfo::NUMBER, "SECTION_SIZE_BITS", 0 },
+    { Vmcoreinfo::NUMBER, "MAX_PHYSMEM_BITS", 0 },
+};
+
+// fails to compile if the table and Vmcoreinfo::Id disagree
+typedef char wellKnownComplete[
+    sizeof(wellKnown) / sizeof(wellKnown[0]) == Vmcoreinfo::ID_MAX ? 1 : -1];
 
 // -----------------------------------------------------------------------------
-Vmcoreinfo::Vmcoreinfo()
-    throw (KError)
-    : m_xenVmcoreinfo(false)
+/**
+ * Converts a VMCOREINFO number. Negative decimal numbers are returned
+ * in two's complement.
+ */
+static bool parseNumber(const char *str, int base, unsigned long long &value)
 {
-    // check that there are no version inconsitencies
-    if (elf_version(EV_CURRENT) == EV_NONE )
-        throw KError("libelf is out of date.");
+    if (!*str)
+        return false;
+
+    char *end;
+    errno = 0;
+    if (base == 10 && *str == '-')
+        value = strtoll(str, &end, base);
+    else
+        value = strtoull(str, &end, base);
+    return *end == '\0' && errno == 0;
 }
 
 // -----------------------------------------------------------------------------
-void Vmcoreinfo::readFromELF(const char *elf_file)
-    throw (KError)
-{
-    Debug::debug()->trace("Vmcoreinfo::readFromELF(%s)", elf_file);
+template <typename T>
+struct KeyLess {
+    bool operator()(const T &a, const T &b) const
+    { return a.first < b.first; }
 
-    ByteVector vmcoreinfo = readElfNote(elf_file);
+    bool operator()(const T &a, const char *b) const
+    { return a.first.compare(b) < 0; }
+};
 
-    StringVector lines = Stringutil::splitlines(
-        Stringutil::bytes2str(vmcoreinfo));
-
-    for (StringVector::const_iterator it = lines.begin();
-            it != lines.end(); ++it) {
-        KString line = *it;
-
-        Debug::debug()->trace("Line: %s", line.c_str());
+// -----------------------------------------------------------------------------
+/**
+ * Sorts @p v by key and removes duplicate keys, keeping the last one.
+ */
+template <typename T>
+static void sortUnique(std::vector<T> &v)
+{
+    std::stable_sort(v.begin(), v.end(), KeyLess<T>());
 
-        // skip empty lines
-        if (line.trim().size() == 0 || line[0] == '\0') {
+    typename std::vector<T>::iterator out = v.begin();
+    for (typename std::vector<T>::iterator it = v.begin();
+            it != v.end(); ++it) {
+        if (it + 1 != v.end() && (it + 1)->first == it->first)
             continue;
-        }
+        if (out != it)
+            *out = *it;
+        ++out;
+    }
+    v.erase(out, v.end());
+}
 
-        string::size_type equal = line.find("=");
-        if (equal == string::npos) {
-            Debug::debug()->info("VMCOREINFO line contains no '='. "
-                "Skipping. (%s)sz=%d", line.c_str(), (line).size() );
-            continue;
-        }
+// -----------------------------------------------------------------------------
+/**
+ * Binary search in a vector sorted by sortUnique().
+ */
+template <typename T>
+static const T *findEntry(const std::vector<T> &v, const char *key)
+{
+    typename std::vector<T>::const_iterator it =
+        std::lower_bound(v.begin(), v.end(), key, KeyLess<T>());
+    if (it == v.end() || it->first != key)
+        return NULL;
+    return &*it;
+}
 
-        string key = line.substr(0, equal);
-        string value = line.substr(equal+1);
+//{{{ Vmcoreinfo ---------------------------------------------------------------
 
-        m_map[key] = value;
-        Debug::debug()->trace("%s=%s", key.c_str(), value.c_str());
+// -----------------------------------------------------------------------------
+Vmcoreinfo::Vmcoreinfo()
+    throw ()
+    : m_xenVmcoreinfo(false)
+{
+    for (int id = 0; id < ID_MAX; ++id) {
+        m_ids[id] = 0;
+        m_haveId[id] = false;
     }
 }
 
 // -----------------------------------------------------------------------------
-ByteVector Vmcoreinfo::readElfNote(const char *file)
+void Vmcoreinfo::readFromELF(const char *elf_file)
     throw (KError)
 {
-    Elf *elf = NULL;
-    int fd = -1;
-    GElf_Off offset = 0;
-    GElf_Xword size = 0;
-    char *buffer = NULL;
-    bool isElf64;
-    void *map = MAP_FAILED;
-    char map_copy[ELF_HEADER_MAPSIZE];
-
-    try {
-        // open the file
-        fd = open(file, O_RDONLY);
-        if (fd < 0)
-            throw KSystemError("Vmcoreinfo: Cannot open " +
-                string(file) + ".", errno);
-
-        // memory-map by hand because the default implementation maps the
-        // whole file which fails for dumps on 32 bit systems because they
-        // can be larger then the address space
-        map = mmap(NULL, ELF_HEADER_MAPSIZE, PROT_READ, MAP_PRIVATE, fd, 0);
-        if (map != MAP_FAILED) {
-            elf = elf_memory(reinterpret_cast<char *>(map), ELF_HEADER_MAPSIZE);
-            if (!elf)
-                throw KError("Vmcoreinfo: elf_begin() failed.");
-
-        } else {
-            // currently, mmap() on /proc/vmcore does not work
-            // so copy it to memory
-
-            for (size_t already_read = 0; already_read < ELF_HEADER_MAPSIZE; ) {
-
-                size_t to_read = min(size_t(BUFSIZ),
-                    size_t(ELF_HEADER_MAPSIZE-already_read));
-                size_t currently_read = read(fd, map_copy+already_read, to_read);
-                if (currently_read == 0)
-                    throw KSystemError("Error when reading from dump.", errno);
-
-                already_read += currently_read;
-            }
+    Debug::debug()->trace("Vmcoreinfo::readFromELF(%s)", elf_file);
 
-            elf = elf_memory(map_copy, ELF_HEADER_MAPSIZE);
-            if (!elf)
-                throw KError("Vmcoreinfo: elf_begin() failed.");
-        }
+    VmcoreImage image(elf_file);
+    readFromImage(image);
+}
 
-        // check the type
-        Elf_Kind ek = elf_kind(elf);
-        if (ek != ELF_K_ELF)
-            throw KError(string(file) + " is no ELF object.");
-
-        // check elf32 vs. elf64
-        int clazz = gelf_getclass(elf);
-        if (clazz == ELFCLASSNONE)
-            throw KError("Vmcoreinfo: Invalid ELF class.");
-
-        isElf64 = clazz == ELFCLASS64;
-
-        // get the number of program header entries
-        size_t n;
-        int ret = elf_getphdrnum(elf, &n);
-        if (ret < 0)
-            throw KELFError("elf_getphdrnum() failed.", elf_errno());
-
-        // iterate over that entries to find offset and size of the
-        // notes section
-        for (unsigned int i = 0; i < n; i++) {
-            GElf_Phdr phdr;
-
-            if (gelf_getphdr(elf, i, &phdr) != &phdr)
-                throw KELFError("getphdr() failed.", elf_errno());
-
-            if (phdr.p_type == PT_NOTE) {
-                offset = phdr.p_offset;
-                size = phdr.p_filesz;
-                break;
-            }
+// -----------------------------------------------------------------------------
+void Vmcoreinfo::readFromImage(const VmcoreImage &image)
+    throw (KError)
+{
+    Debug::debug()->trace("Vmcoreinfo::readFromImage(%s)",
+        image.getPath().c_str());
+
+    const VmcoreImage::Note *vmcoreinfo = NULL;
+    const VmcoreImage::NoteVector &notes = image.getNotes();
+    for (VmcoreImage::NoteVector::const_iterator it = notes.begin();
+            it != notes.end(); ++it) {
+        if (it->name == VMCOREINFO_XEN_NOTE_NAME) {
+            vmcoreinfo = &*it;
+            m_xenVmcoreinfo = true;
+        } else if (it->name == VMCOREINFO_NOTE_NAME) {
+            vmcoreinfo = &*it;
+            break;
         }
-
-        if (offset == 0 && size == 0)
-            throw KError(string(file) + " contains no PT_NOTE segment.");
-
-        Debug::debug()->dbg("PT_NOTE size: %lld, offset: %lld",
-            (unsigned long long)size, (unsigned long long)offset);
-
-        buffer = new char[size];
-
-        // seek to the position
-        off_t oret = lseek(fd, offset, SEEK_SET);
-        if (oret == (off_t)-1)
-            throw KSystemError("Vmcoreinfo: lseek() failed.", errno);
-
-        // read the bytes
-        ssize_t bytes_read = read(fd, buffer, size);
-        if (bytes_read != ssize_t(size))
-            throw KSystemError("Vmcoreinfo: Unable to read " +
-                Stringutil::number2string(size) +
-                " bytes.", errno);
-    } catch (...) {
-        if (map != MAP_FAILED)
-            munmap(map, ELF_HEADER_MAPSIZE);
-        if (elf)
-            elf_end(elf);
-        if (fd > 0)
-            ::close(fd);
-        if (buffer)
-            delete[] buffer;
-
-        throw;
     }
 
-    if (map != MAP_FAILED)
-        munmap(map, ELF_HEADER_MAPSIZE);
-    if (elf)
-        elf_end(elf);
-    if (fd > 0)
-        ::close(fd);
-
-    ByteVector ret;
-    try {
-        ret = readVmcoreinfoFromNotes(buffer, size, isElf64);
-    } catch (...) {
-        delete[] buffer;
-        throw;
-    }
+    if (!vmcoreinfo)
+        throw KError("VMCOREINFO not found.");
 
-    delete[] buffer;
+    Debug::debug()->dbg("Found VMCOREINFO, offset: %lld, size: %lld",
+        vmcoreinfo->offset, (unsigned long long)vmcoreinfo->size);
 
-    return ret;
+    parseVmcoreinfo(image.getNoteData(*vmcoreinfo));
 }
 
 // -----------------------------------------------------------------------------
-ByteVector Vmcoreinfo::readVmcoreinfoFromNotes(const char *buffer, size_t size,
-                                               bool isElf64)
-    throw (KError)
+void Vmcoreinfo::parseVmcoreinfo(const ByteVector &vmcoreinfo)
+    throw ()
 {
+    const char *p = reinterpret_cast<const char *>(&vmcoreinfo[0]);
+    const char *end = p + vmcoreinfo.size();
+
+    // the note is padded with NUL bytes
+    const char *nul = static_cast<const char *>(
+        memchr(p, '\0', vmcoreinfo.size()));
+    if (nul)
+        end = nul;
+
+    while (p < end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!eol)
+            eol = end;
+        parseLine(p, eol - p);
+        p = eol + 1;
+    }
 
-    Elf64_Nhdr *note64;
-    Elf32_Nhdr *note32;
-
-    loff_t offset = 0;
-
-    unsigned long long offset_vmcoreinfo = 0, size_vmcoreinfo = 0;
-
-    while (offset < loff_t(size)) {
-
-        loff_t add_offset;
-
-        if (isElf64) {
-            note64 = (Elf64_Nhdr *)(buffer + offset);
-            add_offset = sizeof(Elf64_Nhdr);
+    // keep the last of several equal keys, like a map assignment would
+    sortUnique(m_entries);
+    for (int type = 0; type < NTYPES; ++type)
+        sortUnique(m_typed[type]);
+
+    for (int id = 0; id < ID_MAX; ++id) {
+        const WellKnown &wk = wellKnown[id];
+        if (wk.type == PLAIN) {
+            const Entry *entry = findEntry(m_entries, wk.name);
+            m_haveId[id] = entry && parseNumber(entry->second.c_str(),
+                wk.base, m_ids[id]);
         } else {
-            note32 = (Elf32_Nhdr *)(buffer + offset);
-            add_offset = sizeof(Elf32_Nhdr);
+            const TypedEntry *entry = findEntry(m_typed[wk.type], wk.name);
+            m_haveId[id] = entry != NULL;
+            if (entry)
+                m_ids[id] = entry->second;
         }
+    }
+}
 
-        if (!strncmp(VMCOREINFO_XEN_NOTE_NAME, buffer+offset+add_offset,
-		        VMCOREINFO_XEN_NOTE_NAME_BYTES)) {
-			if (isElf64) {
-                offset_vmcoreinfo = offset +
-				    (sizeof(*note64) + ((note64->n_namesz + 3) & ~3));
-				size_vmcoreinfo = note64->n_descsz;
-			} else {
-				offset_vmcoreinfo = offset +
-                    (sizeof(*note32) + ((note32->n_namesz + 3) & ~3));
-				size_vmcoreinfo = note32->n_descsz;
-			}
-            m_xenVmcoreinfo = true;
-        } else if (!strncmp(VMCOREINFO_NOTE_NAME, buffer+offset+add_offset,
-                    VMCOREINFO_NOTE_NAME_BYTES)) {
-            if (isElf64) {
-                offset_vmcoreinfo = offset +
-                    (sizeof(*note64) + ((note64->n_namesz + 3) & ~3));
-                size_vmcoreinfo = note64->n_descsz;
-            } else {
-                offset_vmcoreinfo = offset  +
-                    (sizeof(*note32) + ((note32->n_namesz + 3) & ~3));
-                size_vmcoreinfo = note32->n_descsz;
-            }
+// -----------------------------------------------------------------------------
+void Vmcoreinfo::parseLine(const char *line, size_t len)
+    throw ()
+{
+    static const char space[] = " \t\r";
 
+    // trim
+    while (len && strchr(space, line[0])) {
+        ++line;
+        --len;
+    }
+    while (len && strchr(space, line[len - 1]))
+        --len;
+    if (len == 0)
+        return;
+
+    const char *equal = static_cast<const char *>(memchr(line, '=', len));
+    if (!equal) {
+        Debug::debug()->info("VMCOREINFO line contains no '='. "
+            "Skipping. (%.*s)sz=%d", int(len), line, int(len));
+        return;
+    }
+
+    string key(line, equal - line);
+    string value(equal + 1, line + len);
+    Debug::debug()->trace("%s=%s", key.c_str(), value.c_str());
+
+    // decode TYPE(name)=value
+    string::size_type paren = key.find('(');
+    if (paren != string::npos && key[key.size() - 1] == ')') {
+        for (int type = SYMBOL; type < NTYPES; ++type) {
+            if (key.compare(0, paren, typeNames[type]) != 0)
+                continue;
+
+            unsigned long long number;
+            if (parseNumber(value.c_str(), type == SYMBOL ? 16 : 10, number))
+                m_typed[type].push_back(TypedEntry(
+                    key.substr(paren + 1, key.size() - paren - 2), number));
+            else
+                Debug::debug()->info("Invalid VMCOREINFO value: %s=%s",
+                    key.c_str(), value.c_str());
             break;
         }
-
-        if (isElf64)
-            offset += sizeof(Elf64_Nhdr) + ((note64->n_namesz + 3) & ~3)
-                      + ((note64->n_descsz + 3) & ~3);
-        else
-            offset += sizeof(Elf32_Nhdr) + ((note32->n_namesz + 3) & ~3)
-                      + ((note32->n_descsz + 3) & ~3);
     }
 
-    if (offset_vmcoreinfo == 0 && size_vmcoreinfo == 0)
-        throw KError("VMCOREINFO not found.");
-
-    Debug::debug()->dbg("Found VMCOREINFO, offset: %lld, size: %lld",
-        offset_vmcoreinfo, size_vmcoreinfo);
-
-    ByteVector ret;
-    ret.insert(ret.end(), buffer + offset_vmcoreinfo,
-                          buffer + offset_vmcoreinfo + size_vmcoreinfo);
-    return ret;
+    m_entries.push_back(Entry(key, value));
 }
 
 // -----------------------------------------------------------------------------
 string Vmcoreinfo::getStringValue(const char *key) const
     throw (KError)
 {
-    StringStringMap::const_iterator pos = m_map.find(string(key));
-    if (pos == m_map.end())
+    const Entry *entry = findEntry(m_entries, key);
+    if (!entry)
         throw KError("Vmcoreinfo: key " + string(key) + " not found.");
 
-    return pos->second;
+    return entry->second;
 }
 
 // -----------------------------------------------------------------------------
@@ -327,19 +350,62 @@ int Vmcoreinfo::getIntValue(const char *key) const
 }
 
 // -----------------------------------------------------------------------------
-int Vmcoreinfo::getLLongValue(const char *key) const
+long long Vmcoreinfo::getLLongValue(const char *key) const
     throw (KError)
 {
     return Stringutil::string2llong(getStringValue(key));
 }
 
+// -----------------------------------------------------------------------------
+unsigned long long Vmcoreinfo::getValue(Id id) const
+    throw (KError)
+{
+    if (!m_haveId[id]) {
+        const WellKnown &wk = wellKnown[id];
+        string key = wk.type == PLAIN
+            ? string(wk.name)
+            : string(typeNames[wk.type]) + "(" + wk.name + ")";
+        throw KError("Vmcoreinfo: key " + key + " not found.");
+    }
+
+    return m_ids[id];
+}
+
+// -----------------------------------------------------------------------------
+bool Vmcoreinfo::findValue(Type type, const char *name,
+                           unsigned long long &value) const
+    throw ()
+{
+    if (type == PLAIN) {
+        const Entry *entry = findEntry(m_entries, name);
+        return entry && parseNumber(entry->second.c_str(), 10, value);
+    }
+
+    const TypedEntry *entry = findEntry(m_typed[type], name);
+    if (!entry)
+        return false;
+    value = entry->second;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long Vmcoreinfo::getValue(Type type, const char *name) const
+    throw (KError)
+{
+    unsigned long long value;
+    if (!findValue(type, name, value))
+        throw KError("Vmcoreinfo: key " + string(typeNames[type]) +
+            "(" + name + ") not found.");
+    return value;
+}
+
 // -----------------------------------------------------------------------------
 StringList Vmcoreinfo::getKeys() const
     throw ()
 {
     StringList ret;
-    for (StringStringMap::const_iterator it = m_map.begin();
-            it != m_map.end(); ++it)
+    for (EntryVector::const_iterator it = m_entries.begin();
+            it != m_entries.end(); ++it)
         ret.push_back(it->first);
     return ret;
 }
@@ -21,25 +21,112 @@
 
 #include <iostream>
 #include <ctime>
+#include <string>
+#include <vector>
+#include <utility>
 
 #include "global.h"
 
+class VmcoreImage;
+
 //{{{ Vmcoreinfo ---------------------------------------------------------------
 
 /**
  * Represents the VMCOREINFO of makedumpfile.
+ *
+ * Besides the raw KEY=value strings, the SYMBOL(), OFFSET(), SIZE(),
+ * LENGTH() and NUMBER() entries are decoded once into sorted per-type
+ * tables, and a fixed set of well-known entries (see Id) is resolved
+ * to an array, so that lookups in hot loops need neither a string
+ * comparison nor a text conversion.
  */
 class Vmcoreinfo {
 
     public:
 
+        /**
+         * Type of a VMCOREINFO entry.
+         */
+        enum Type {
+            PLAIN,      /**< KEY=value */
+            SYMBOL,     /**< SYMBOL(name)=address (hexadecimal) */
+            OFFSET,     /**< OFFSET(struct.member)=offset */
+            SIZE,       /**< SIZE(type)=size */
+            LENGTH,     /**< LENGTH(name)=number of array elements */
+            NUMBER,     /**< NUMBER(name)=value (may be negative) */
+            NTYPES
+        };
+
+        /**
+         * Well-known entries. The names are listed in the same order in
+         * vmcoreinfo.cc.
+         */
+        enum Id {
+            ID_PAGESIZE,
+            ID_CRASHTIME,
+            ID_KERNELOFFSET,
+
+            ID_SYMBOL_init_uts_ns,
+            ID_SYMBOL_swapper_pg_dir,
+            ID_SYMBOL__stext,
+            ID_SYMBOL_mem_map,
+            ID_SYMBOL_contig_page_data,
+            ID_SYMBOL_mem_section,
+            ID_SYMBOL_node_data,
+            ID_SYMBOL_vmemmap,
+            ID_SYMBOL_prb,
+
+            ID_SIZE_page,
+            ID_SIZE_pglist_data,
+            ID_SIZE_zone,
+            ID_SIZE_free_area,
+            ID_SIZE_list_head,
+            ID_SIZE_mem_section,
+
+            ID_OFFSET_page_flags,
+            ID_OFFSET_page__refcount,
+            ID_OFFSET_page_mapping,
+            ID_OFFSET_page_lru,
+            ID_OFFSET_page__mapcount,
+            ID_OFFSET_page_private,
+            ID_OFFSET_page_compound_head,
+            ID_OFFSET_pglist_data_node_zones,
+            ID_OFFSET_pglist_data_nr_zones,
+            ID_OFFSET_pglist_data_node_start_pfn,
+            ID_OFFSET_pglist_data_node_spanned_pages,
+            ID_OFFSET_pglist_data_node_id,
+            ID_OFFSET_zone_free_area,
+            ID_OFFSET_free_area_free_list,
+            ID_OFFSET_list_head_next,
+            ID_OFFSET_list_head_prev,
+            ID_OFFSET_mem_section_section_mem_map,
+
+            ID_LENGTH_zone_free_area,
+            ID_LENGTH_free_area_free_list,
+            ID_LENGTH_mem_section,
+            ID_LENGTH_node_data,
+
+            ID_NUMBER_NR_FREE_PAGES,
+            ID_NUMBER_PG_lru,
+            ID_NUMBER_PG_private,
+            ID_NUMBER_PG_swapcache,
+            ID_NUMBER_PG_swapbacked,
+            ID_NUMBER_PG_slab,
+            ID_NUMBER_PG_hwpoison,
+            ID_NUMBER_PG_head_mask,
+            ID_NUMBER_PAGE_BUDDY_MAPCOUNT_VALUE,
+            ID_NUMBER_phys_base,
+            ID_NUMBER_SECTION_SIZE_BITS,
+            ID_NUMBER_MAX_PHYSMEM_BITS,
+
+            ID_MAX
+        };
+
         /**
          * Creates a new Vmcoreinfo object.
-         *
-         * @exception KError if the libelf library is out of date
          */
         Vmcoreinfo()
-        throw (KError);
+        throw ();
 
         /**
          * Deletes the Vmcoreinfo object.
@@ -56,6 +143,15 @@ class Vmcoreinfo {
         void readFromELF(const char *elf_file)
         throw (KError);
 
+        /**
+         * Reads the vmcoreinfo from the notes of an already parsed dump.
+         *
+         * @param[in] image the ELF headers of the dump
+         * @exception KError if the dump contains no vmcoreinfo
+         */
+        void readFromImage(const VmcoreImage &image)
+        throw (KError);
+
         /**
          * Gets all keys.
          *
@@ -91,7 +187,53 @@ class Vmcoreinfo {
          * @return the value for @p key
          * @exception KError if the value has not been found
          */
-        int getLLongValue(const char *key) const
+        long long getLLongValue(const char *key) const
+        throw (KError);
+
+        /**
+         * Checks whether a well-known entry is present.
+         *
+         * @param[in] id the entry
+         * @return @c true if the VMCOREINFO contains the entry
+         */
+        bool hasValue(Id id) const
+        throw ()
+        { return m_haveId[id]; }
+
+        /**
+         * Returns the value of a well-known entry. NUMBER() values are
+         * returned in two's complement.
+         *
+         * @param[in] id the entry
+         * @return the value
+         * @exception KError if the entry has not been found
+         */
+        unsigned long long getValue(Id id) const
+        throw (KError);
+
+        /**
+         * Looks up a typed entry by name, e.g. (OFFSET, "page.flags").
+         * PLAIN entries are converted as decimal numbers.
+         *
+         * @param[in] type the entry type
+         * @param[in] name the name inside the parentheses, or the key
+         *            for PLAIN entries
+         * @param[out] value the value (unchanged if not found)
+         * @return @c true if the entry has been found
+         */
+        bool findValue(Type type, const char *name,
+                       unsigned long long &value) const
+        throw ();
+
+        /**
+         * Returns the value of a typed entry.
+         *
+         * @param[in] type the entry type
+         * @param[in] name the name inside the parentheses
+         * @return the value
+         * @exception KError if the entry has not been found
+         */
+        unsigned long long getValue(Type type, const char *name) const
         throw (KError);
 
         /**
@@ -104,15 +246,25 @@ class Vmcoreinfo {
         throw ();
 
     protected:
-        ByteVector readElfNote(const char *file)
-        throw (KError);
+        void parseVmcoreinfo(const ByteVector &vmcoreinfo)
+        throw ();
 
-        ByteVector readVmcoreinfoFromNotes(const char *buffer, size_t size,
-                                           bool isElf64)
-        throw (KError);
+        void parseLine(const char *line, size_t len)
+        throw ();
 
     private:
-        StringStringMap m_map;
+        typedef std::pair<std::string, std::string> Entry;
+        typedef std::vector<Entry> EntryVector;
+        typedef std::pair<std::string, unsigned long long> TypedEntry;
+        typedef std::vector<TypedEntry> TypedVector;
+
+        // all entries, sorted by key
+        EntryVector m_entries;
+        // decoded entries by type, sorted by name (PLAIN is unused)
+        TypedVector m_typed[NTYPES];
+        // well-known entries
+        unsigned long long m_ids[ID_MAX];
+        bool m_haveId[ID_MAX];
         bool m_xenVmcoreinfo;
 };
 
@@ -0,0 +1,134 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Predict the size of a generated dump. Half of its pages are zero and the
+# other pages are half compressible.
+#
+
+#
+# Check that results match expectation
+#                                                                            {{{
+function check()
+{
+    local what="$1"
+    local expect="$2"
+    local result="$3"
+    if [ "$result" != "$expect" ] ; then
+	echo "failed: $what"
+	echo "Expected:"
+	echo "$expect"
+	echo "Result:"
+	echo "$result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+#
+# Prints the size column of a format                                         {{{
+function size_of()
+{
+    echo "$2" | awk -v fmt="$1" '$1 == fmt { print $2 }'
+}
+# }}}
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+MKVMCORE=$2
+DIR=$3
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$MKVMCORE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool testmkvmcore dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-analyze_vmcore"
+rm -rf "$TMP"
+mkdir -p "$TMP" || exit 1
+
+# 4 segments of 1 MiB
+"$MKVMCORE" "$TMP/vmcore" "6.4.0-test" 1700000000 4 256 || exit 1
+echo "KDUMP_DUMPLEVEL=31" > "$TMP/kdump.conf"
+
+errornumber=0
+ANALYZE="$KDUMPTOOL -F $TMP/kdump.conf analyze_vmcore -u $TMP/vmcore"
+
+OUTPUT=$($ANALYZE -s 512 -j 2)
+if [ $? -ne 0 ] ; then
+    echo "analyze_vmcore failed"
+    exit 1
+fi
+
+RESULT=$(echo "$OUTPUT" | awk '/^Memory:/ { print $4 }')
+check "total pages" "(1024" "$RESULT"
+
+RESULT=$(echo "$OUTPUT" | awk '/^Sample:/ { print $2 }')
+check "sampled pages" "512" "$RESULT"
+
+ZERO=$(echo "$OUTPUT" | awk '/^Zero pages:/ { printf "%d", $3 }')
+if [ -z "$ZERO" ] || [ "$ZERO" -lt 40 ] || [ "$ZERO" -gt 60 ] ; then
+    echo "failed: zero pages: $ZERO %"
+    errornumber=$(( errornumber + 1 ))
+fi
+
+# zero pages are excluded at dump level 31
+ELF=$(size_of elf "$OUTPUT")
+RESULT=$(awk -v s="$ELF" 'BEGIN { print (s >= 1.6 && s <= 2.4) }')
+check "elf size ($ELF MiB)" "1" "$RESULT"
+
+COMPRESSED=$(size_of compressed "$OUTPUT")
+RESULT=$(awk -v s="$COMPRESSED" -v e="$ELF" 'BEGIN { print (s > 0 && s < e) }')
+check "compressed size ($COMPRESSED MiB)" "1" "$RESULT"
+
+# dump level 0 copies the whole file
+OUTPUT=$($ANALYZE -d 0)
+check "elf size at dump level 0" "4.0" "$(size_of elf "$OUTPUT")"
+RESULT=$(echo "$OUTPUT" | awk '/^Sample:/ { print $2 }')
+check "sample limited to the dump" "1024" "$RESULT"
+
+# at 1 MiB/s, saving an ELF dump takes as many seconds as it has MiB;
+# at dump level 31 that is an upper bound, but still a prediction
+OUTPUT=$($ANALYZE -j 2 -w 1)
+RESULT=$(echo "$OUTPUT" | awk '$1 == "elf" { print ($4 > 0 && $4 == $2) }')
+check "elf time at 1 MiB/s" "1" "$RESULT"
+
+# format selection: a slow target wants the smallest dump, a very fast
+# target the least CPU time, and without a bandwidth ELF is never chosen
+RESULT=$($ANALYZE -j 2 -w 1 | awk '/^Recommended:/ { print $2 }')
+check "slow target" "compressed" "$RESULT"
+RESULT=$($ANALYZE -j 2 -w 100000 | awk '/^Recommended:/ { print $2 }')
+check "fast target" "elf" "$RESULT"
+RESULT=$($ANALYZE -j 2 | awk '/^Recommended:/ { print $2 }')
+if [ "$RESULT" = "elf" ] || [ -z "$RESULT" ] ; then
+    echo "failed: unknown bandwidth: $RESULT"
+    errornumber=$(( errornumber + 1 ))
+fi
+
+rm -rf "$TMP"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
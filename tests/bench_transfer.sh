@@ -0,0 +1,90 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+DIR=$2
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-bench_transfer"
+rm -rf "$TMP"
+mkdir -p "$TMP/a" "$TMP/b" || exit 1
+touch "$TMP/kdump.conf"
+
+errors=0
+
+# two local targets; the generated file is mirrored and kept
+OUTPUT=$("$KDUMPTOOL" -F "$TMP/kdump.conf" bench_transfer \
+	-s 4 -z 50 -c 25 --keep "file://$TMP/a" "file://$TMP/b")
+if [ $? -ne 0 ] ; then
+    echo "bench_transfer failed"
+    errors=$(( errors + 1 ))
+fi
+echo "$OUTPUT"
+
+if ! echo "$OUTPUT" | grep -q '^Bytes: *4194304$' ; then
+    echo "Wrong byte count"
+    errors=$(( errors + 1 ))
+fi
+if ! echo "$OUTPUT" | grep -q '^Throughput: *[0-9.]* MB/s$' ; then
+    echo "Throughput not reported"
+    errors=$(( errors + 1 ))
+fi
+if ! cmp "$TMP/a/kdump-bench" "$TMP/b/kdump-bench" ; then
+    echo "Targets differ"
+    errors=$(( errors + 1 ))
+fi
+SIZE=$(stat -c %s "$TMP/a/kdump-bench")
+if [ "$SIZE" != 4194304 ] ; then
+    echo "Wrong file size: $SIZE"
+    errors=$(( errors + 1 ))
+fi
+
+# without --keep, the file is removed again
+"$KDUMPTOOL" -F "$TMP/kdump.conf" bench_transfer -s 1 "file://$TMP/a" \
+    > /dev/null || errors=$(( errors + 1 ))
+if [ -e "$TMP/a/kdump-bench" ] ; then
+    echo "Test file not removed"
+    errors=$(( errors + 1 ))
+fi
+
+# rates that are negative or do not fit into 64 bits are rejected, not wrapped around
+for rate in 17179869184G 99999999999999999999 1x -1 ; do
+    if "$KDUMPTOOL" -F "$TMP/kdump.conf" bench_transfer -s 1 \
+	    "file://$TMP/a?rate=$rate" > /dev/null 2>&1 ; then
+	echo "Invalid rate $rate accepted"
+	errors=$(( errors + 1 ))
+    fi
+done
+
+rm -rf "$TMP"
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,87 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Check the buffer budget and the bookkeeping of BufferPool.
+#
+
+#
+# Check that results match expectation
+#                                                                            {{{
+function check()
+{
+    local arg="$1"
+    local expect="$2"
+    local result="$3"
+    if [ "$result" != "$expect" ] ; then
+	echo "failed input: $arg"
+	echo "Expected:"
+	echo "$expect"
+	echo "Result:"
+	echo "$result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+BUFFERPOOL=$1
+DIR=$2
+
+if [ -z "$BUFFERPOOL" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 testbufferpool dir"
+    exit 1
+fi
+
+CONFIG="$DIR/bufferpool.conf"
+errornumber=0
+
+# TEST #1: allocations within 1% of the available memory
+
+echo "KDUMP_BUFFER_MEMORY=1" > "$CONFIG"
+EXPECT="budget: 1%
+used: 0"
+RESULT=$( "$BUFFERPOOL" "$CONFIG" 2>/dev/null )
+check "KDUMP_BUFFER_MEMORY=1" "$EXPECT" "$RESULT"
+
+# TEST #2: the budget follows KDUMP_BUFFER_MEMORY (within 1..100)
+
+for arg in "10 10" "0 1" "-5 1" "100 100" "250 100" ; do
+    set -- $arg
+    echo "KDUMP_BUFFER_MEMORY=$1" > "$CONFIG"
+    RESULT=$( "$BUFFERPOOL" "$CONFIG" budget 2>/dev/null )
+    check "KDUMP_BUFFER_MEMORY=$1" "budget: $2%" "$RESULT"
+done
+
+# the default is 10%
+: > "$CONFIG"
+RESULT=$( "$BUFFERPOOL" "$CONFIG" budget 2>/dev/null )
+check "(default)" "budget: 10%" "$RESULT"
+
+rm -f "$CONFIG"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
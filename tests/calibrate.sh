@@ -43,6 +43,47 @@ elif [ "$REQMEM" -lt 0 ] ; then
     errors=$(( $errors + 1 ))
 fi
 
+#
+# Past kdump runs that needed little memory give a smaller reservation,
+# unless the history is ignored
+#
+function reserved()
+{
+    $KDUMPTOOL $KDUMPOPT calibrate "$@" | \
+	awk '/^(Low|High):/ { sum += $2 } END { print sum }'
+}
+
+HISTORY="$DIR/tmp-calibrate-history"
+cat > "$HISTORY" <<EOF
+# kdump memory history 1
+1700000000 262144 200000 240000 0 1 0 1 -
+1700000100 262144 200000 240000 0 1 1 1 -
+1700000200 262144 200000 240000 0 1 0 0 -
+1700000300 262144 200000 240000 0 1 1 0 -
+1700000400 262144 200000 240000 0 1 0 1 -
+1700000500 262144 200000 240000 0 1 1 1 -
+1700000600 262144 200000 240000 0 1 0 0 -
+1700000700 262144 200000 240000 0 1 1 0 -
+1700000800 262144 200000 240000 0 1 0 1 -
+1700000900 262144 200000 240000 0 1 1 1 -
+1700001000 262144 200000 240000 0 1 0 0 -
+1700001100 262144 200000 240000 0 1 1 0 -
+EOF
+
+STATIC=$(reserved -H "$DIR/tmp-calibrate-nonexistent")
+OBSERVED=$(reserved -H "$HISTORY")
+IGNORED=$(reserved -H "$HISTORY" -s)
+rm -f "$HISTORY"
+
+if [ -z "$OBSERVED" ] || [ "$OBSERVED" -gt "$STATIC" ] ; then
+    echo "calibrate with history should not reserve more than $STATIC MiB, got '$OBSERVED'"
+    errors=$(( $errors + 1 ))
+fi
+if [ "$IGNORED" != "$STATIC" ] ; then
+    echo "calibrate --static should reserve $STATIC MiB, got '$IGNORED'"
+    errors=$(( $errors + 1 ))
+fi
+
 exit $errors
 
 # vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -171,6 +171,144 @@ for f in "${TESTKDUMP[@]}"; do
     fi
 done
 
+echo "Delete dumps older than February 2014"
+
+# directories that are not named after the crash time use their mtime
+setup_testdir "$DIR/tmp-delete_dumps" || exit 1
+for f in old-dump new-dump; do
+    mkdir "$DIR/tmp-delete_dumps/$f" || exit 1
+    touch "$DIR/tmp-delete_dumps/$f/vmcore" || exit 1
+done
+touch -d "2001-01-01" "$DIR/tmp-delete_dumps/old-dump"
+days=$(( ( $(date +%s) - $(date -d 2014-02-01 +%s) ) / 86400 ))
+
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=0
+KDUMP_KEEP_DAYS=$days
+EOF
+
+"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+
+save_ifs=IFS
+IFS=$'\n'
+KEPTDUMP=( $( echo "$SORTDUMPS" | tail -n +3 ) new-dump )
+REMOVEDUMP=( $( echo "$SORTDUMPS" | head -n 2 ) old-dump )
+IFS=save_ifs
+
+for f in "${KEPTDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
+    if ! test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly deleted!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+for f in "${REMOVEDUMP[@]}"; do
+    if test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+echo "Keep dumps within a size budget"
+
+setup_testdir "$DIR/tmp-delete_dumps" || exit 1
+for f in "${TESTKDUMP[@]}"; do
+    dd if=/dev/zero of="$DIR/tmp-delete_dumps/$f/vmcore" bs=1024 count=1024 \
+	2>/dev/null || exit 1
+done
+
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=0
+KDUMP_KEEP_SIZE=2
+EOF
+
+"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+
+save_ifs=IFS
+IFS=$'\n'
+KEPTDUMP=( $( echo "$SORTDUMPS" | tail -n 1 ) )
+REMOVEDUMP=( $( echo "$SORTDUMPS" | head -n $(( ${#TESTKDUMP[@]} - 1)) ) )
+IFS=save_ifs
+
+for f in "${KEPTDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
+    if ! test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly deleted!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+for f in "${REMOVEDUMP[@]}"; do
+    if test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+echo "Failed dumps in the catalog do not count"
+
+# two recent failed attempts must not push out the real dumps, but an
+# old failed dump is deleted like the complete ones
+setup_testdir "$DIR/tmp-delete_dumps" || exit 1
+FAILED=( 2014-04-01-00:00 2014-04-02-00:00 )
+OLDFAILED=2013-01-01-00:00
+{
+    echo "# kdump catalog 1"
+    for f in "$OLDFAILED" "${FAILED[@]}"; do
+	mkdir "$DIR/tmp-delete_dumps/$f" || exit 1
+	touch "$DIR/tmp-delete_dumps/$f/vmcore" || exit 1
+	printf '%s\t0\t-\t-\t-\t-\t0\tfailed\n' "$f"
+    done
+} >"$DIR/tmp-delete_dumps/.catalog"
+
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=2
+EOF
+
+"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+
+save_ifs=IFS
+IFS=$'\n'
+KEPTDUMP=( $( echo "$SORTDUMPS" | tail -n 2 ) "${FAILED[@]}" )
+REMOVEDUMP=( $( echo "$SORTDUMPS" | head -n $(( ${#TESTKDUMP[@]} - 2)) )
+	     "$OLDFAILED" )
+IFS=save_ifs
+
+for f in "${KEPTDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
+    if ! test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly deleted!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+for f in "${REMOVEDUMP[@]}"; do
+    if test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+echo "Failed dumps are deleted by age"
+
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=0
+KDUMP_KEEP_DAYS=1
+EOF
+
+"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+
+for f in "${FAILED[@]}"; do
+    if test -e "$DIR/tmp-delete_dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+rm -rf "$DIR/tmp-delete_dumps"
+
 exit $errors
 
 # }}}
@@ -0,0 +1,104 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Remove dump directories and files from an FTP target with a minimal
+# FTP server on the loopback interface.
+#
+
+#
+# Program								     {{{
+#
+
+FTPREMOVE=$1
+DIR=$2
+
+if [ -z "$FTPREMOVE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 testftpremove dir"
+    exit 1
+fi
+
+. "$DIR/testdirs.sh"
+
+TMPDIR="$DIR/tmp-ftp_remove"
+rm -rf "$TMPDIR"
+mkdir -p "$TMPDIR/dumps" || exit 1
+setup_testdir "$TMPDIR/dumps" || exit 1
+
+errors=0
+
+echo "Remove two dumps"
+REMOVEDUMP=( "${TESTKDUMP[0]}" "${TESTKDUMP[2]}" )
+KEPTDUMP=( "${TESTKDUMP[1]}" "${TESTKDUMP[3]}" )
+for f in "${REMOVEDUMP[@]}"; do
+    echo data > "$TMPDIR/dumps/$f/vmcore" || exit 1
+done
+
+if ! "$FTPREMOVE" "$TMPDIR" dumps dirs "${REMOVEDUMP[@]}"; then
+    echo "Removing succeeded, but an error was reported!" >&2
+    errors=$(( $errors+1 ))
+fi
+
+for f in "${KEPTDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
+    if ! test -e "$TMPDIR/dumps/$f"; then
+	echo "$f incorrectly deleted!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+for f in "${REMOVEDUMP[@]}"; do
+    if test -e "$TMPDIR/dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+echo "A directory that cannot be removed is reported"
+mkdir "$TMPDIR/dumps/${KEPTDUMP[0]}/subdir" || exit 1
+if "$FTPREMOVE" "$TMPDIR" dumps dirs "${KEPTDUMP[0]}"; then
+    echo "Removing failed, but no error was reported!" >&2
+    errors=$(( $errors+1 ))
+fi
+
+echo "Remove hidden and missing files"
+touch "$TMPDIR/dumps/.kdump-probe" "$TMPDIR/dumps/${KEPTDUMP[1]}/.hidden"
+if ! "$FTPREMOVE" "$TMPDIR" dumps file .kdump-probe .missing \
+	"${KEPTDUMP[1]}/.hidden" ; then
+    echo "Removing files failed!" >&2
+    errors=$(( $errors+1 ))
+fi
+for f in .kdump-probe "${KEPTDUMP[1]}/.hidden"; do
+    if test -e "$TMPDIR/dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+if ! test -d "$TMPDIR/dumps/${KEPTDUMP[1]}"; then
+    echo "${KEPTDUMP[1]} incorrectly deleted!" >&2
+    errors=$(( $errors+1 ))
+fi
+
+rm -rf "$TMPDIR"
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -75,6 +75,8 @@ EXPECT=$( LANG= sort <(
 OUTPUT=$( "$LISTDIR" "$DIR/tmp-testdirs" kdumpdirs  || echo "*** testlistdir FAILED!" )
 check_output
 
+rm -rf "$DIR/tmp-testdirs"
+
 exit $errors
 
 # }}}
@@ -0,0 +1,108 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Read the VMCOREINFO of several generated dumps at once in all output
+# formats.
+#
+
+#
+# Check that results match expectation
+#                                                                            {{{
+function check()
+{
+    local what="$1"
+    local expect="$2"
+    local result="$3"
+    if [ "$result" != "$expect" ] ; then
+	echo "failed: $what"
+	echo "Expected:"
+	echo "$expect"
+	echo "Result:"
+	echo "$result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+MKVMCORE=$2
+DIR=$3
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$MKVMCORE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool testmkvmcore dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-read_vmcoreinfo"
+rm -rf "$TMP"
+mkdir -p "$TMP" || exit 1
+
+"$MKVMCORE" "$TMP/a" "4.12.14-a" 1700000000 1 1 || exit 1
+"$MKVMCORE" "$TMP/b" "5.14.21-b" 1600000000 1 1 || exit 1
+
+errornumber=0
+READ="$KDUMPTOOL read_vmcoreinfo -j 2"
+
+# one dump, one key
+RESULT=$($READ -u "$TMP/a" OSRELEASE 2>/dev/null)
+check "single key" "4.12.14-a" "$RESULT"
+
+# text with several dumps
+EXPECT="$TMP/a: OSRELEASE=4.12.14-a
+$TMP/a: CRASHTIME=1700000000
+$TMP/b: OSRELEASE=5.14.21-b
+$TMP/b: CRASHTIME=1600000000"
+RESULT=$($READ -u "$TMP/a" -u "$TMP/b" OSRELEASE CRASHTIME)
+check "text" "$EXPECT" "$RESULT"
+
+# TSV, missing keys are left out
+EXPECT="dump	key	value
+$TMP/b	OSRELEASE	5.14.21-b
+$TMP/a	OSRELEASE	4.12.14-a"
+RESULT=$($READ -f tsv -u "$TMP/b" -u "$TMP/a" OSRELEASE NOSUCHKEY)
+check "tsv" "$EXPECT" "$RESULT"
+
+# JSON with an unreadable dump
+EXPECT="[
+ {\"dump\": \"$TMP/a\", \"xen\": false, \"vmcoreinfo\": {\"PAGESIZE\": \"4096\", \"NOSUCHKEY\": null}},
+ {\"dump\": \"$TMP/missing\", \"error\": \"Cannot open $TMP/missing. (No such file or directory)\"}
+]"
+RESULT=$($READ -f json -u "$TMP/a" -u "$TMP/missing" PAGESIZE NOSUCHKEY \
+    2>/dev/null)
+STATUS=$?
+check "json" "$EXPECT" "$RESULT"
+check "json exit status" "1" "$STATUS"
+
+# all keys
+RESULT=$($READ -f tsv -u "$TMP/a" -u "$TMP/b" | grep -c "	OSRELEASE	")
+check "all keys" "2" "$RESULT"
+
+rm -rf "$TMP"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
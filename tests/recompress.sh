@@ -0,0 +1,201 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Check the recompress subcommand without makedumpfile: the rewriting of
+# README.txt and the selection of the dumps to recompress (dry run).
+#
+
+#
+# Check that results match expectation
+#                                                                            {{{
+function check()
+{
+    local what="$1"
+    local expect="$2"
+    local result="$3"
+    if [ "$result" != "$expect" ] ; then
+	echo "failed: $what"
+	echo "Expected:"
+	echo "$expect"
+	echo "Result:"
+	echo "$result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+#
+# Create a dump directory with a dump of the given kind and format         {{{
+function make_dump()
+{
+    local dir="$1"
+    local file="$2"
+    local signature="$3"
+    local format="$4"
+
+    mkdir -p "$dir" || exit 1
+    printf "$signature" > "$dir/$file" || exit 1
+    truncate -s 4096 "$dir/$file" || exit 1
+    cat > "$dir/README.txt" <<EOR
+Kernel crashdump
+----------------
+
+Dump level     : 31
+Dump format    : $format
+
+EOR
+}
+# }}}
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+TESTRECOMPRESS=$2
+DIR=$3
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$TESTRECOMPRESS" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool testrecompress dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-recompress"
+rm -rf "$TMP"
+mkdir -p "$TMP" || exit 1
+
+export TZ=UTC
+errornumber=0
+
+#
+# README.txt: the format and the dump level change, the note about the
+# flattened format goes away and everything else is kept
+#
+cat > "$TMP/README.txt" <<EOR
+Kernel crashdump
+----------------
+
+Crash time     : 2023-11-14 22:13 (+0000)
+Host           : test
+Dump level     : 1
+Dump format    : snappy
+
+NOTE:
+To save the dump within KDUMP_SAVE_DEADLINE (60 seconds), the following was given up:
+  - dump format changed from compressed to snappy
+
+NOTE:
+This dump was saved in makedumpfile flattened format.
+To read the dump with crash, run "sh rearrange.sh" before.
+
+Some more text
+EOR
+
+EXPECT='Kernel crashdump
+----------------
+
+Crash time     : 2023-11-14 22:13 (+0000)
+Host           : test
+Dump level     : 31
+Dump format    : compressed
+Recompressed   : 2023-11-15 22:13 (+0000) from snappy
+
+NOTE:
+To save the dump within KDUMP_SAVE_DEADLINE (60 seconds), the following was given up:
+  - dump format changed from compressed to snappy
+
+Some more text'
+RESULT=$("$TESTRECOMPRESS" "$TMP/README.txt" compressed snappy 30 1 1700086400)
+check "README.txt of an unflattened dump" "$EXPECT" "$RESULT"
+
+# the note stays if the dump was not flattened, and so does the level
+EXPECT=$(sed -e 's/^Dump format    : .*/Dump format    : zstd\
+Recompressed   : 2023-11-15 22:13 (+0000) from unknown/' "$TMP/README.txt")
+RESULT=$("$TESTRECOMPRESS" "$TMP/README.txt" zstd "" 0 0 1700086400)
+check "README.txt of a dump that was not flattened" "$EXPECT" "$RESULT"
+
+#
+# Selection: dumps already in the target format and directories without
+# a vmcore are left alone
+#
+SAVEDIR="$TMP/dump"
+make_dump "$SAVEDIR/2023-11-14-22:10" vmcore '\177ELF' ELF
+make_dump "$SAVEDIR/2023-11-14-22:11" vmcore 'KDUMP   ' compressed
+make_dump "$SAVEDIR/2023-11-14-22:12" vmcore 'makedumpfile' lzo
+make_dump "$SAVEDIR/2023-11-14-22:13" vmcore1 'KDUMP   ' snappy
+make_dump "$SAVEDIR/2023-11-14-22:14" vmcore 'KDUMP   ' snappy
+make_dump "$SAVEDIR/unrelated" notes 'KDUMP   ' snappy
+cat > "$TMP/kdump.conf" <<EOC
+KDUMP_SAVEDIR="file://$SAVEDIR"
+KDUMP_RECOMPRESS="compressed"
+EOC
+
+EXPECT="Recompressing $SAVEDIR/2023-11-14-22:10/vmcore (ELF -> compressed)
+Recompressing $SAVEDIR/2023-11-14-22:12/vmcore (lzo -> compressed)
+Recompressing $SAVEDIR/2023-11-14-22:14/vmcore (snappy -> compressed)"
+RESULT=$("$KDUMPTOOL" -F "$TMP/kdump.conf" recompress --dry-run)
+check "dumps selected for KDUMP_RECOMPRESS" "$EXPECT" "$RESULT"
+
+# split dumps are refused
+EXPECT="$SAVEDIR/2023-11-14-22:13: split dumps cannot be recompressed."
+RESULT=$("$KDUMPTOOL" -F "$TMP/kdump.conf" recompress --dry-run \
+	"$SAVEDIR/2023-11-14-22:13")
+check "split dump" "$EXPECT" "$RESULT"
+
+# excluding more pages makes sense in any format
+EXPECT="Recompressing $SAVEDIR/2023-11-14-22:11/vmcore (compressed -> compressed)"
+RESULT=$("$KDUMPTOOL" -F "$TMP/kdump.conf" recompress --dry-run -d 31 \
+	"$SAVEDIR/2023-11-14-22:11")
+check "dump selected for a higher dump level" "$EXPECT" "$RESULT"
+
+# a file that is not a dump is an error
+make_dump "$SAVEDIR/2023-11-14-22:15" vmcore 'garbage' snappy
+if "$KDUMPTOOL" -F "$TMP/kdump.conf" recompress --dry-run \
+	"$SAVEDIR/2023-11-14-22:15" > /dev/null 2>&1 ; then
+    echo "failed: a file that is not a dump was accepted"
+    errornumber=$(( errornumber + 1 ))
+fi
+
+# a dry run does not touch anything
+for f in "$SAVEDIR"/*/* ; do
+    case "$f" in
+	*/README.txt)
+	    ;;
+	*)
+	    if [ "$(stat -c %s "$f")" != 4096 ] ; then
+		echo "failed: $f was modified by a dry run"
+		errornumber=$(( errornumber + 1 ))
+	    fi
+	    ;;
+    esac
+done
+if [ -n "$(ls "$SAVEDIR"/*/README.txt.tmp 2>/dev/null)" ] ; then
+    echo "failed: README.txt was rewritten by a dry run"
+    errornumber=$(( errornumber + 1 ))
+fi
+
+rm -rf "$TMP"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,304 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Save a generated ELF vmcore to a local directory and check the result.
+# ELF format with dump level 0 is copied by kdumptool itself, so the test
+# does not need makedumpfile.
+#
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+MKVMCORE=$2
+DIR=$3
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$MKVMCORE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool testmkvmcore dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-save_dump"
+rm -rf "$TMP"
+mkdir -p "$TMP/dump" || exit 1
+
+export TZ=UTC
+RELEASE="4.12.14-test"
+CRASHTIME=1700000000
+SUBDIR=$(date -d "@$CRASHTIME" +%Y-%m-%d-%H:%M)
+
+cat > "$TMP/kdump.conf" <<EOC
+KDUMP_SAVEDIR="file://$TMP/dump"
+KDUMP_DUMPFORMAT="ELF"
+KDUMP_DUMPLEVEL=0
+KDUMP_COPY_KERNEL="no"
+KDUMP_KEEP_OLD_DUMPS=0
+KDUMP_FREE_DISK_SIZE=0
+KDUMP_VERBOSE=0
+KDUMPTOOL_FLAGS="SINGLE"
+KDUMP_METRICS="json:$TMP/metrics.jsonl"
+EOC
+
+errors=0
+
+#
+# Generate a dump with the given number of CPU notes, save it and
+# compare the result. The CPU notes go into a separate PT_NOTE segment
+# before VMCOREINFO, so a large count checks that all note segments
+# are scanned, however big they are.
+#
+function save_and_check()
+{
+    local cpus=$1
+
+    rm -rf "$TMP/dump"
+    mkdir -p "$TMP/dump"
+
+    "$MKVMCORE" "$TMP/vmcore" "$RELEASE" "$CRASHTIME" 4 256 $cpus || exit 1
+
+    "$KDUMPTOOL" -F "$TMP/kdump.conf" save_dump -u "$TMP/vmcore" -M
+    if [ $? -ne 0 ] ; then
+        echo "save_dump failed ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+
+    SAVED="$TMP/dump/$SUBDIR"
+    if ! cmp "$TMP/vmcore" "$SAVED/vmcore" ; then
+        echo "Saved vmcore differs from the original ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+
+    if ! grep -q "$RELEASE" "$SAVED/README.txt" ; then
+        echo "README.txt does not contain the kernel release ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+
+    # the dump phase counts the bytes of the saved vmcore
+    local size=$(stat -c %s "$TMP/vmcore")
+    if ! grep -q "\"name\": \"dump\", \"ok\": true, .*\"bytes\": $size}" \
+            "$SAVED/save-report.json" ; then
+        echo "save-report.json does not report the dump phase ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+
+    # the memory usage is recorded for calibrate
+    if ! grep -q '"memory_kib": {"ram": [0-9]*, ' "$SAVED/save-report.json" ; then
+        echo "save-report.json does not report the memory usage ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+
+    # the final metrics export is marked as done and counts the whole dump
+    local last=$(tail -n 1 "$TMP/metrics.jsonl")
+    local read=$(echo "$last" | sed -n 's/.*"read": \([0-9]*\),.*/\1/p')
+    if ! echo "$last" | grep -q '"done": true' || \
+            [ "${read:-0}" -lt "$size" ] ; then
+        echo "metrics.jsonl does not report the finished save ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+    rm -f "$TMP/metrics.jsonl"
+
+    # the dump is recorded in the catalog, which list_dumps reads
+    local tab=$'\t'
+    if ! grep -q "^$SUBDIR$tab.*$tab$RELEASE$tab.*${tab}ok\$" \
+            "$TMP/dump/.catalog" ; then
+        echo "The catalog does not contain the dump ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+    if ! "$KDUMPTOOL" -F "$TMP/kdump.conf" list_dumps | \
+            grep -q "^$SUBDIR .* $RELEASE .* ok\$" ; then
+        echo "list_dumps does not show the dump ($cpus CPUs)"
+        errors=$(( errors + 1 ))
+    fi
+}
+
+save_and_check 0
+save_and_check 8192
+
+#
+# With KDUMP_COPY_KERNEL, the second dump of the same kernel must link
+# the kernel files from the kernel cache instead of copying them.
+#
+ROOT="$TMP/root"
+mkdir -p "$ROOT/boot" "$ROOT/dump" || exit 1
+head -c 65536 /dev/urandom > "$ROOT/boot/vmlinux-$RELEASE"
+echo "ffffffff81000000 T _text" > "$ROOT/boot/System.map-$RELEASE"
+sed -e 's|^KDUMP_SAVEDIR=.*|KDUMP_SAVEDIR="file:///dump"|' \
+    -e 's|^KDUMP_COPY_KERNEL=.*|KDUMP_COPY_KERNEL="yes"|' \
+    "$TMP/kdump.conf" > "$TMP/kdump-kernel.conf"
+
+for crashtime in $CRASHTIME $(( CRASHTIME + 120 )) ; do
+    "$MKVMCORE" "$TMP/vmcore" "$RELEASE" $crashtime 4 256 0 || exit 1
+    "$KDUMPTOOL" -F "$TMP/kdump-kernel.conf" save_dump \
+        -u "$TMP/vmcore" -R "$ROOT" -M > "$TMP/kernel.out"
+    if [ $? -ne 0 ] ; then
+        echo "save_dump with KDUMP_COPY_KERNEL failed"
+        errors=$(( errors + 1 ))
+    fi
+    SAVED="$ROOT/dump/$(date -d "@$crashtime" +%Y-%m-%d-%H:%M)"
+    for f in "vmlinux-$RELEASE" "System.map-$RELEASE" ; do
+        if ! cmp -s "$ROOT/boot/$f" "$SAVED/$f" ; then
+            echo "$f was not saved correctly"
+            errors=$(( errors + 1 ))
+        fi
+    done
+done
+
+if ! grep -q "Linking kernel from the kernel cache" "$TMP/kernel.out" ; then
+    echo "The second dump did not use the kernel cache"
+    errors=$(( errors + 1 ))
+fi
+if [ "$(stat -c %h "$SAVED/vmlinux-$RELEASE")" != 3 ] ; then
+    echo "The kernel is not shared with the kernel cache"
+    errors=$(( errors + 1 ))
+fi
+
+#
+# With two targets, a write error on one of them must not stop the other.
+# Writing to /dev/full fails with ENOSPC.
+#
+rm -rf "$TMP/dump" "$TMP/dump2"
+mkdir -p "$TMP/dump" "$TMP/dump2/$SUBDIR"
+ln -s /dev/full "$TMP/dump2/$SUBDIR/vmcore"
+"$MKVMCORE" "$TMP/vmcore" "$RELEASE" "$CRASHTIME" 4 256 0 || exit 1
+sed -e "s|^KDUMP_SAVEDIR=.*|KDUMP_SAVEDIR=\"file://$TMP/dump file://$TMP/dump2\"|" \
+    "$TMP/kdump.conf" > "$TMP/kdump-two.conf"
+"$KDUMPTOOL" -F "$TMP/kdump-two.conf" save_dump -u "$TMP/vmcore" -M \
+    > "$TMP/two.out" 2>&1
+if [ $? -ne 0 ] ; then
+    echo "save_dump failed although one target was written"
+    errors=$(( errors + 1 ))
+fi
+if ! cmp -s "$TMP/vmcore" "$TMP/dump/$SUBDIR/vmcore" ; then
+    echo "The good target does not contain the dump"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/dump2/$SUBDIR/vmcore" ] ; then
+    echo "The incomplete copy on the failed target was kept"
+    errors=$(( errors + 1 ))
+fi
+if ! grep -q "WARNING: .*dump2/$SUBDIR/vmcore failed" "$TMP/two.out" ; then
+    echo "The failed target was not reported"
+    errors=$(( errors + 1 ))
+fi
+
+#
+# KDUMP_SAVE_DEADLINE: a dump that cannot be saved in time at the target
+# rate is not even started, also if the prediction is only an upper
+# bound (dump level 31); a fast target gets the dump.
+#
+function save_with_deadline()
+{
+    local level=$1
+    local rate=$2
+
+    rm -rf "$TMP/dump"
+    mkdir -p "$TMP/dump"
+    sed -e "s|^KDUMP_SAVEDIR=.*|KDUMP_SAVEDIR=\"file://$TMP/dump$rate\"|" \
+	-e "s|^KDUMP_DUMPLEVEL=.*|KDUMP_DUMPLEVEL=$level|" \
+	"$TMP/kdump.conf" > "$TMP/kdump-deadline.conf"
+    echo "KDUMP_SAVE_DEADLINE=60" >> "$TMP/kdump-deadline.conf"
+    "$KDUMPTOOL" -F "$TMP/kdump-deadline.conf" save_dump \
+	-u "$TMP/vmcore" -M > "$TMP/deadline.out" 2>&1
+    if [ $? -ne 0 ] ; then
+	echo "save_dump with a deadline failed (level $level)"
+	errors=$(( errors + 1 ))
+    fi
+}
+
+"$MKVMCORE" "$TMP/vmcore" "$RELEASE" "$CRASHTIME" 4 256 0 || exit 1
+for level in 0 31 ; do
+    save_with_deadline $level "?rate=1k"
+    if ! grep -q "^Saving the dump would take .* seconds" "$TMP/deadline.out" ||
+	    ! grep -q '"sacrificed": \[.*"vmcore not saved' \
+		"$TMP/dump/$SUBDIR/save-report.json" ; then
+	echo "A slow target did not prevent the save (level $level)"
+	errors=$(( errors + 1 ))
+    fi
+    # the first step is to raise the dump level
+    if [ $level -ne 31 ] &&
+	    ! grep -q '"sacrificed": \["dump level raised from 0 to 31", ' \
+		"$TMP/dump/$SUBDIR/save-report.json" ; then
+	echo "The dump level was not raised before giving up"
+	errors=$(( errors + 1 ))
+    fi
+done
+save_with_deadline 0 ""
+if ! cmp -s "$TMP/vmcore" "$TMP/dump/$SUBDIR/vmcore" ; then
+    echo "The dump was not saved before the deadline"
+    errors=$(( errors + 1 ))
+fi
+
+#
+# The probe files are removed again, and weights that cannot be used
+# because the dump is not split are reported.
+#
+rm -rf "$TMP/dump" "$TMP/dump2"
+mkdir -p "$TMP/dump" "$TMP/dump2"
+sed -e "s|^KDUMP_SAVEDIR=.*|KDUMP_SAVEDIR=\"file://$TMP/dump file://$TMP/dump2\"|" \
+    "$TMP/kdump.conf" > "$TMP/kdump-probe.conf"
+echo 'KDUMP_TARGET_PROBE="weighted"' >> "$TMP/kdump-probe.conf"
+"$KDUMPTOOL" -F "$TMP/kdump-probe.conf" save_dump -u "$TMP/vmcore" -M \
+    > "$TMP/probe.out" 2>&1
+if [ $? -ne 0 ] ; then
+    echo "save_dump with KDUMP_TARGET_PROBE failed"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/dump/.kdump-probe" ] || [ -e "$TMP/dump2/.kdump-probe" ] ; then
+    echo "The probe file was not removed"
+    errors=$(( errors + 1 ))
+fi
+if ! grep -q 'WARNING: KDUMP_TARGET_PROBE="weighted" has no effect' \
+	"$TMP/probe.out" ; then
+    echo "Unused weights were not reported"
+    errors=$(( errors + 1 ))
+fi
+
+#
+# A save that aborts still writes the report and records the failure.
+#
+rm -rf "$TMP/dump"
+mkdir -p "$TMP/dump/$SUBDIR"
+ln -s /dev/full "$TMP/dump/$SUBDIR/vmcore"
+sed -e 's|^KDUMP_METRICS=.*|KDUMP_CONTINUE_ON_ERROR="no"|' \
+    "$TMP/kdump.conf" > "$TMP/kdump-abort.conf"
+if "$KDUMPTOOL" -F "$TMP/kdump-abort.conf" save_dump -u "$TMP/vmcore" -M \
+	> /dev/null 2>&1 ; then
+    echo "save_dump succeeded although the dump could not be written"
+    errors=$(( errors + 1 ))
+fi
+if ! grep -q '"ok": false' "$TMP/dump/$SUBDIR/save-report.json" ; then
+    echo "save-report.json is missing after a failed save"
+    errors=$(( errors + 1 ))
+fi
+if ! grep -q "^$SUBDIR$(printf '\t').*$(printf '\t')failed\$" \
+	"$TMP/dump/.catalog" ; then
+    echo "The failed save is not recorded in the catalog"
+    errors=$(( errors + 1 ))
+fi
+
+rm -rf "$TMP"
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,100 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# List and remove dump directories on an SFTP target. A minimal SFTP
+# server is started in place of ssh.
+#
+
+#
+# Program								     {{{
+#
+
+SFTPREMOVE=$1
+DIR=$2
+
+if [ -z "$SFTPREMOVE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 testsftpremove dir"
+    exit 1
+fi
+
+. "$DIR/testdirs.sh"
+
+TMPDIR="$DIR/tmp-sftp_remove"
+rm -rf "$TMPDIR"
+mkdir -p "$TMPDIR/dumps" "$TMPDIR/bin" || exit 1
+setup_testdir "$TMPDIR/dumps" || exit 1
+
+# SFTPTransfer runs the server as "ssh"
+case "$SFTPREMOVE" in
+    /*) ln -s "$SFTPREMOVE" "$TMPDIR/bin/ssh" ;;
+    *)  ln -s "$PWD/$SFTPREMOVE" "$TMPDIR/bin/ssh" ;;
+esac || exit 1
+PATH="$TMPDIR/bin:$PATH"
+
+errors=0
+
+echo "List the dump directories"
+EXPECT=$( cd "$TMPDIR/dumps" && for d in */ ; do echo "${d%/}" ; done | sort )
+RESULT=$( "$SFTPREMOVE" "$TMPDIR" dumps list )
+if [ $? -ne 0 ] || [ "$RESULT" != "$EXPECT" ] ; then
+    echo "Listing failed!" >&2
+    echo "Expected:" >&2
+    echo "$EXPECT" >&2
+    echo "Result:" >&2
+    echo "$RESULT" >&2
+    errors=$(( $errors+1 ))
+fi
+
+echo "Remove two dumps"
+REMOVEDUMP=( "${TESTKDUMP[0]}" "${TESTKDUMP[2]}" )
+KEPTDUMP=( "${TESTKDUMP[1]}" "${TESTKDUMP[3]}" )
+for f in "${REMOVEDUMP[@]}"; do
+    echo data > "$TMPDIR/dumps/$f/vmcore" || exit 1
+    mkdir -p "$TMPDIR/dumps/$f/sub/dir" || exit 1
+    touch "$TMPDIR/dumps/$f/sub/dir/file" "$TMPDIR/dumps/$f/.hidden" || exit 1
+done
+
+if ! "$SFTPREMOVE" "$TMPDIR" dumps dirs "${REMOVEDUMP[@]}"; then
+    echo "Removing succeeded, but an error was reported!" >&2
+    errors=$(( $errors+1 ))
+fi
+
+for f in "${KEPTDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
+    if ! test -e "$TMPDIR/dumps/$f"; then
+	echo "$f incorrectly deleted!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+for f in "${REMOVEDUMP[@]}"; do
+    if test -e "$TMPDIR/dumps/$f"; then
+	echo "$f incorrectly kept!" >&2
+	errors=$(( $errors+1 ))
+    fi
+done
+
+rm -rf "$TMPDIR"
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,93 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+# Check that results match expectation
+#                                                                            {{{
+function check()
+{
+    local arg="$1"
+    local expect="$2"
+    local result="$3"
+    if [ "$result" != "$expect" ] ; then
+	echo "failed input: $arg"
+	echo "Expected:"
+	echo "$expect"
+	echo "Result:"
+	echo "$result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+SHA256=$1
+
+if [ -z "$SHA256" ] ; then
+    echo "Usage: $0 testsha256"
+    exit 1
+fi
+
+errornumber=0
+
+# TEST #1: FIPS 180-4 example vectors
+
+ARG=""
+EXPECT="e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855  -"
+RESULT=$( printf "%s" "$ARG" | "$SHA256" )
+check "(empty)" "$EXPECT" "$RESULT"
+
+ARG="abc"
+EXPECT="ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad  -"
+RESULT=$( printf "%s" "$ARG" | "$SHA256" )
+check "$ARG" "$EXPECT" "$RESULT"
+
+# 56 bytes: the length does not fit into the first block
+ARG="abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+EXPECT="248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1  -"
+RESULT=$( printf "%s" "$ARG" | "$SHA256" )
+check "$ARG" "$EXPECT" "$RESULT"
+
+# TEST #2: One million times "a" (read in several chunks)
+
+EXPECT="cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0  -"
+RESULT=$( head -c 1000000 /dev/zero | tr '\0' 'a' | "$SHA256" )
+check "1000000 x a" "$EXPECT" "$RESULT"
+
+# TEST #3: File digests around the block boundaries
+
+if type -p sha256sum >/dev/null ; then
+    TMPFILE=$( mktemp ) || exit 1
+    for size in 1 55 63 64 65 119 120 128 65535 65536 65537 ; do
+	head -c $size /dev/urandom > "$TMPFILE"
+	EXPECT=$( sha256sum "$TMPFILE" )
+	RESULT=$( "$SHA256" "$TMPFILE" )
+	check "$size random bytes" "$EXPECT" "$RESULT"
+    done
+    rm -f "$TMPFILE"
+fi
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
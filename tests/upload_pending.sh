@@ -0,0 +1,176 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Save a generated ELF vmcore to KDUMP_SPOOL, then upload it with
+# upload_pending and check that it arrives in KDUMP_SAVEDIR and leaves
+# the spool.
+#
+
+#
+# Program								     {{{
+#
+
+KDUMPTOOL=$1
+MKVMCORE=$2
+DIR=$3
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$MKVMCORE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool testmkvmcore dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-upload_pending"
+rm -rf "$TMP"
+mkdir -p "$TMP/dump" "$TMP/spool" || exit 1
+
+export TZ=UTC
+RELEASE="4.12.14-test"
+CRASHTIME=1700000000
+SUBDIR=$(date -d "@$CRASHTIME" +%Y-%m-%d-%H:%M)
+
+cat > "$TMP/kdump.conf" <<EOC
+KDUMP_SAVEDIR="file://$TMP/dump"
+KDUMP_SPOOL="$TMP/spool"
+KDUMP_DUMPFORMAT="ELF"
+KDUMP_DUMPLEVEL=0
+KDUMP_COPY_KERNEL="no"
+KDUMP_FREE_DISK_SIZE=0
+KDUMP_VERBOSE=0
+KDUMPTOOL_FLAGS="SINGLE"
+EOC
+
+errors=0
+
+"$MKVMCORE" "$TMP/vmcore" "$RELEASE" "$CRASHTIME" 4 256 0 || exit 1
+
+"$KDUMPTOOL" -F "$TMP/kdump.conf" save_dump -u "$TMP/vmcore" -M
+if [ $? -ne 0 ] ; then
+    echo "save_dump failed"
+    errors=$(( errors + 1 ))
+fi
+
+if [ ! -e "$TMP/spool/$SUBDIR/.upload-pending" ] ; then
+    echo "save_dump did not mark the dump in the spool"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/dump/$SUBDIR" ] ; then
+    echo "save_dump saved to KDUMP_SAVEDIR despite KDUMP_SPOOL"
+    errors=$(( errors + 1 ))
+fi
+
+# a dump without the marker is still being saved
+mkdir -p "$TMP/spool/incomplete"
+echo partial > "$TMP/spool/incomplete/vmcore"
+
+"$KDUMPTOOL" -F "$TMP/kdump.conf" upload_pending
+if [ $? -ne 0 ] ; then
+    echo "upload_pending failed"
+    errors=$(( errors + 1 ))
+fi
+
+if ! cmp "$TMP/vmcore" "$TMP/dump/$SUBDIR/vmcore" ; then
+    echo "Uploaded vmcore differs from the original"
+    errors=$(( errors + 1 ))
+fi
+if ! grep -q "$RELEASE" "$TMP/dump/$SUBDIR/README.txt" ; then
+    echo "README.txt has not been uploaded"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/dump/$SUBDIR/.upload-pending" ] ; then
+    echo "The marker has been uploaded"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/spool/$SUBDIR" ] ; then
+    echo "The uploaded dump is still in the spool"
+    errors=$(( errors + 1 ))
+fi
+if [ ! -e "$TMP/spool/incomplete/vmcore" ] || [ -e "$TMP/dump/incomplete" ]
+then
+    echo "A dump without the marker has been uploaded"
+    errors=$(( errors + 1 ))
+fi
+
+# a target that is down keeps the dump in the spool, also if it uses
+# another protocol than the others (nothing listens on port 1)
+rm -rf "$TMP/dump" "$TMP/spool"
+mkdir -p "$TMP/dump" "$TMP/spool" || exit 1
+sed -i -e "s|^KDUMP_SAVEDIR=.*|KDUMP_SAVEDIR=\"file://$TMP/dump ftp://127.0.0.1:1/dump\"|" \
+    "$TMP/kdump.conf"
+
+"$KDUMPTOOL" -F "$TMP/kdump.conf" save_dump -u "$TMP/vmcore" -M > /dev/null
+"$KDUMPTOOL" -F "$TMP/kdump.conf" upload_pending --retries 0
+if [ $? -eq 0 ] ; then
+    echo "upload_pending succeeded with an unreachable FTP target"
+    errors=$(( errors + 1 ))
+fi
+if [ ! -e "$TMP/spool/$SUBDIR/.upload-pending" ] ; then
+    echo "A dump that is missing on the FTP target left the spool"
+    errors=$(( errors + 1 ))
+fi
+
+# the next run uploads only to the targets that do not have it yet
+rm -rf "$TMP/dump" "$TMP/spool"
+mkdir -p "$TMP/dump" "$TMP/spool" || exit 1
+echo "not a directory" > "$TMP/dump2"
+sed -i -e "s|^KDUMP_SAVEDIR=.*|KDUMP_SAVEDIR=\"file://$TMP/dump file://$TMP/dump2\"|" \
+    "$TMP/kdump.conf"
+
+"$KDUMPTOOL" -F "$TMP/kdump.conf" save_dump -u "$TMP/vmcore" -M > /dev/null
+"$KDUMPTOOL" -F "$TMP/kdump.conf" upload_pending --retries 0
+if [ $? -eq 0 ] ; then
+    echo "upload_pending succeeded with a broken target"
+    errors=$(( errors + 1 ))
+fi
+if [ ! -e "$TMP/spool/$SUBDIR/.upload-pending" ] ; then
+    echo "A dump that is missing on one target left the spool"
+    errors=$(( errors + 1 ))
+fi
+if ! cmp "$TMP/vmcore" "$TMP/dump/$SUBDIR/vmcore" ; then
+    echo "The dump was not uploaded to the working target"
+    errors=$(( errors + 1 ))
+fi
+
+rm -f "$TMP/dump2" "$TMP/dump/$SUBDIR/README.txt"
+"$KDUMPTOOL" -F "$TMP/kdump.conf" upload_pending --retries 0
+if [ $? -ne 0 ] ; then
+    echo "upload_pending failed after the target was repaired"
+    errors=$(( errors + 1 ))
+fi
+if ! cmp "$TMP/vmcore" "$TMP/dump2/$SUBDIR/vmcore" ; then
+    echo "The dump was not uploaded to the repaired target"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/dump/$SUBDIR/README.txt" ] ; then
+    echo "The dump was uploaded again to the working target"
+    errors=$(( errors + 1 ))
+fi
+if [ -e "$TMP/spool/$SUBDIR" ] ; then
+    echo "The uploaded dump is still in the spool"
+    errors=$(( errors + 1 ))
+fi
+
+rm -rf "$TMP"
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
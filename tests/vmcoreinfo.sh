@@ -0,0 +1,83 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LINUX GmbH
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Check the typed VMCOREINFO tables on a generated ELF vmcore.
+#
+
+#
+# Program								     {{{
+#
+
+VMCOREINFO=$1
+MKVMCORE=$2
+DIR=$3
+
+if [ -z "$VMCOREINFO" ] || [ -z "$MKVMCORE" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 testvmcoreinfo testmkvmcore dir"
+    exit 1
+fi
+
+TMP="$DIR/tmp-vmcoreinfo"
+rm -rf "$TMP"
+mkdir -p "$TMP" || exit 1
+
+"$MKVMCORE" "$TMP/vmcore" "4.12.14-test" 1700000000 1 1 || exit 1
+
+EXPECT="PAGESIZE=4096
+CRASHTIME=1700000000
+KERNELOFFSET=3c000000
+SYMBOL(swapper_pg_dir)=ffffffff82a0a000
+SIZE(page)=64
+OFFSET(page.flags)=0
+OFFSET(page.lru)=8
+LENGTH(mem_section)=2048
+NUMBER(PG_lru)=4
+NUMBER(PG_slab)=(missing)
+NUMBER(PAGE_BUDDY_MAPCOUNT_VALUE)=-129
+SYMBOL init_top_pgt=ffffffff82a0a000
+OFFSET page.lru=8
+SIZE page.lru=(missing)
+PLAIN PAGESIZE=1000
+PLAIN OSRELEASE=(missing)"
+
+RESULT=$("$VMCOREINFO" "$TMP/vmcore" \
+    SYMBOL init_top_pgt \
+    OFFSET page.lru \
+    SIZE page.lru \
+    PLAIN PAGESIZE \
+    PLAIN OSRELEASE)
+
+errors=0
+if [ "$RESULT" != "$EXPECT" ] ; then
+    echo "Expected:"
+    echo "$EXPECT"
+    echo "Result:"
+    echo "$RESULT"
+    errors=1
+fi
+
+rm -rf "$TMP"
+
+exit $errors
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1: